@@ -0,0 +1,133 @@
+#include "activitylifecycle.h"
+#include "asyncdatabase.h"
+#include <QTimer>
+#include <QDebug>
+
+namespace {
+const int kTickIntervalMs = 1000;
+const int kRefreshDelayMs = 200;
+const int kRefreshChunk = 500;   // 每次按ID读取的活动数，低于 SQLite 的绑定参数上限
+}
+
+ActivityLifecycle::ActivityLifecycle(Database *database, AsyncDatabase *asyncDatabase, QObject *parent)
+    : QObject(parent)
+    , asyncDatabase(asyncDatabase)
+    , wheel(QDateTime::currentMSecsSinceEpoch(), kTickIntervalMs)
+    , tickTimer(new QTimer(this))
+    , refreshTimer(new QTimer(this))
+{
+    refreshTimer->setSingleShot(true);
+    refreshTimer->setInterval(kRefreshDelayMs);
+    connect(refreshTimer, &QTimer::timeout, this, &ActivityLifecycle::refreshDirtyActivities);
+    connect(tickTimer, &QTimer::timeout, this, &ActivityLifecycle::onTick);
+    connect(database, &Database::activityChanged, this, &ActivityLifecycle::onActivityChanged);
+
+    // 启动时一次性登记全部待开始、待结束的活动；已过期的在第一个刻度处理
+    AsyncDatabase::onFinished(asyncDatabase->getLifecycleSchedule(), this, [this](const QList<ActivityRecord> &schedule) {
+        for (const ActivityRecord &record : schedule) {
+            reschedule(record.id, record.status, record.startTime, record.endTime);
+        }
+        qDebug() << "[生命周期] 已登记活动数:" << schedule.size();
+        tickTimer->start(kTickIntervalMs);
+    });
+}
+
+void ActivityLifecycle::reschedule(int activityId, ActivityStatus status, const QDateTime &startTime, const QDateTime &endTime)
+{
+    if (status == ActivityStatus::Approved && startTime.isValid()) {
+        wheel.schedule(startKey(activityId), startTime.toMSecsSinceEpoch());
+    } else {
+        wheel.cancel(startKey(activityId));
+    }
+
+    if ((status == ActivityStatus::Approved || status == ActivityStatus::Ongoing) && endTime.isValid()) {
+        wheel.schedule(endKey(activityId), endTime.toMSecsSinceEpoch());
+    } else {
+        wheel.cancel(endKey(activityId));
+    }
+}
+
+void ActivityLifecycle::unschedule(int activityId)
+{
+    wheel.cancel(startKey(activityId));
+    wheel.cancel(endKey(activityId));
+}
+
+int ActivityLifecycle::scheduledCount() const
+{
+    return wheel.size();
+}
+
+void ActivityLifecycle::onTick()
+{
+    QDateTime now = QDateTime::currentDateTime();
+    QList<int> due = wheel.advance(now.toMSecsSinceEpoch());
+    if (due.isEmpty()) {
+        return;
+    }
+
+    QList<int> startingIds;
+    QList<int> endingIds;
+    for (int key : due) {
+        if (key % 2 == 0) {
+            startingIds.append(key / 2);
+        } else {
+            endingIds.append(key / 2);
+        }
+    }
+
+    // 同一刻度到期的活动合并成一次写入
+    AsyncDatabase::onFinished(asyncDatabase->advanceActivityStatuses(startingIds, endingIds, now), this,
+                              [this, startingIds, endingIds](int changed) {
+        if (changed < 0) {
+            // 写入失败时放回时间轮，下一个刻度重试
+            QDateTime retryAt = QDateTime::currentDateTime();
+            for (int id : startingIds) {
+                wheel.schedule(startKey(id), retryAt.toMSecsSinceEpoch());
+            }
+            for (int id : endingIds) {
+                wheel.schedule(endKey(id), retryAt.toMSecsSinceEpoch());
+            }
+            return;
+        }
+        if (changed > 0) {
+            qDebug() << "[生命周期] 开始" << startingIds.size() << "个、结束" << endingIds.size()
+                     << "个活动，状态改变" << changed << "个";
+            emit statusesAdvanced(changed);
+        }
+    });
+}
+
+void ActivityLifecycle::onActivityChanged(int activityId)
+{
+    dirtyIds.insert(activityId);
+    if (!refreshTimer->isActive()) {
+        refreshTimer->start();
+    }
+}
+
+void ActivityLifecycle::refreshDirtyActivities()
+{
+    QList<int> ids = dirtyIds.values();
+    dirtyIds.clear();
+
+    for (int offset = 0; offset < ids.size(); offset += kRefreshChunk) {
+        ActivityQuery query;
+        query.ids = ids.mid(offset, kRefreshChunk);
+        AsyncDatabase::onFinished(asyncDatabase->getActivityPage(query, 0, query.ids.size()), this,
+                                  [this, query](const QList<ActivityRecord> &records) {
+            QSet<int> missing;
+            for (int id : query.ids) {
+                missing.insert(id);
+            }
+            for (const ActivityRecord &record : records) {
+                missing.remove(record.id);
+                reschedule(record.id, record.status, record.startTime, record.endTime);
+            }
+            // 已删除或已归档的活动
+            for (int id : missing) {
+                unschedule(id);
+            }
+        });
+    }
+}
@@ -0,0 +1,49 @@
+#ifndef ACTIVITYLIFECYCLE_H
+#define ACTIVITYLIFECYCLE_H
+
+#include <QObject>
+#include <QSet>
+#include <QDateTime>
+#include "database.h"
+#include "timerwheel.h"
+
+class AsyncDatabase;
+class QTimer;
+
+// 活动生命周期：把已批准、进行中活动的开始和结束时间登记在时间轮中，
+// 到点后成批把状态改为进行中 / 已结束（一批一次写入），变更照常通过 Database::activityChanged 通知。
+// 活动被修改（审批、同步改期等）时只重新读取这些活动并在时间轮中改期，每个活动 O(1)。
+class ActivityLifecycle : public QObject
+{
+    Q_OBJECT
+
+public:
+    // database 用于接收变更通知；读写都通过 asyncDatabase 在后台执行
+    ActivityLifecycle(Database *database, AsyncDatabase *asyncDatabase, QObject *parent = nullptr);
+
+    // 按活动当前的状态和时间登记、改期或取消
+    void reschedule(int activityId, ActivityStatus status, const QDateTime &startTime, const QDateTime &endTime);
+    void unschedule(int activityId);
+    int scheduledCount() const;  // 时间轮中的开始、结束事件数
+
+signals:
+    // 一批状态更新已提交，changedCount 为状态实际改变的活动数
+    void statusesAdvanced(int changedCount);
+
+private:
+    AsyncDatabase *asyncDatabase;
+    TimerWheel wheel;
+    QTimer *tickTimer;
+    QTimer *refreshTimer;   // 合并短时间内的多次变更通知
+    QSet<int> dirtyIds;     // 等待重新读取时间和状态的活动
+
+    // 每个活动在时间轮中占两个键：开始事件和结束事件
+    static int startKey(int activityId) { return activityId * 2; }
+    static int endKey(int activityId) { return activityId * 2 + 1; }
+
+    void onTick();
+    void onActivityChanged(int activityId);
+    void refreshDirtyActivities();
+};
+
+#endif // ACTIVITYLIFECYCLE_H
@@ -1,29 +1,57 @@
 #include "activitymanager.h"
 #include <QVBoxLayout>
 #include <QHBoxLayout>
-#include <QTableWidget>
+#include <QTableView>
 #include <QPushButton>
 #include <QLineEdit>
 #include <QTextEdit>
 #include <QDateTimeEdit>
 #include <QSpinBox>
 #include <QComboBox>
+#include <QCheckBox>
 #include <QLabel>
 #include <QMessageBox>
+#include <QInputDialog>
 #include <QDialog>
 #include <QFormLayout>
 #include <QDialogButtonBox>
 #include <QHeaderView>
 #include <QTimer>
+#include <QSet>
 #include <QDebug>
+#include "activitytablemodel.h"
+#include "activitysearch.h"
+#include "dbexecutor.h"
 
-ActivityManager::ActivityManager(Database *db, UserRole role, const QString &studentId, NetworkManager *networkMgr, QWidget *parent)
+namespace {
+// 场地冲突列表的显示文本
+QString roomConflictText(const QList<QHash<QString, QVariant>> &conflicts)
+{
+    QString text;
+    for (const auto &conflict : conflicts) {
+        ActivityStatus status = static_cast<ActivityStatus>(conflict["status"].toInt());
+        text += QString("• %1 (ID: %2，%3)\n  时间：%4 - %5\n")
+            .arg(conflict["title"].toString())
+            .arg(conflict["id"].toInt())
+            .arg(status == ActivityStatus::Pending ? "待审批" : status == ActivityStatus::Ongoing ? "进行中" : "已批准")
+            .arg(conflict["start_time"].toDateTime().toString("yyyy-MM-dd hh:mm"))
+            .arg(conflict["end_time"].toDateTime().toString("yyyy-MM-dd hh:mm"));
+    }
+    return text;
+}
+}
+
+ActivityManager::ActivityManager(Database *db, DbExecutor *executor, UserRole role, const QString &studentId, NetworkManager *networkMgr, QWidget *parent)
     : QWidget(parent)
     , database(db)
+    , executor(executor)
     , networkManager(networkMgr)
     , userRole(role)
     , currentStudentId(studentId)
     , syncButton(nullptr)
+    , capacityButton(nullptr)
+    , matchRoundButton(nullptr)
+    , roomCheckButton(nullptr)
 {
     setupUI();
     refreshActivities();
@@ -64,6 +92,10 @@ void ActivityManager::setupUI()
         buttonLayout->addWidget(rejectButton);
         connect(approveButton, &QPushButton::clicked, this, &ActivityManager::onApproveActivity);
         connect(rejectButton, &QPushButton::clicked, this, &ActivityManager::onRejectActivity);
+        
+        roomCheckButton = new QPushButton("场地冲突检查");
+        buttonLayout->addWidget(roomCheckButton);
+        connect(roomCheckButton, &QPushButton::clicked, this, &ActivityManager::onValidateLocations);
     }
     
     viewButton = new QPushButton("查看详情");
@@ -74,27 +106,69 @@ void ActivityManager::setupUI()
         syncButton = new QPushButton("手动同步");
         buttonLayout->addWidget(syncButton);
         connect(syncButton, &QPushButton::clicked, this, &ActivityManager::onManualSync);
+        
+        capacityButton = new QPushButton("调整人数上限");
+        buttonLayout->addWidget(capacityButton);
+        connect(capacityButton, &QPushButton::clicked, this, &ActivityManager::onAdjustCapacity);
+        
+        matchRoundButton = new QPushButton("发起志愿匹配");
+        buttonLayout->addWidget(matchRoundButton);
+        connect(matchRoundButton, &QPushButton::clicked, this, &ActivityManager::onCreateMatchRound);
     }
     
     buttonLayout->addStretch();
     
     connect(viewButton, &QPushButton::clicked, this, &ActivityManager::onViewDetails);
     connect(searchButton, &QPushButton::clicked, this, &ActivityManager::onSearchActivities);
+    connect(searchLineEdit, &QLineEdit::returnPressed, this, &ActivityManager::onSearchActivities);
+    
+    // 边输入边搜索：停顿一段时间后才发起查询，避免每次按键都访问数据库
+    searchDebounceTimer = new QTimer(this);
+    searchDebounceTimer->setSingleShot(true);
+    searchDebounceTimer->setInterval(250);
+    connect(searchLineEdit, &QLineEdit::textChanged, searchDebounceTimer, static_cast<void (QTimer::*)()>(&QTimer::start));
+    connect(searchDebounceTimer, &QTimer::timeout, this, &ActivityManager::populateTable);
     
     mainLayout->addLayout(buttonLayout);
     
     // 活动列表表格
-    activitiesTable = new QTableWidget();
-    activitiesTable->setColumnCount(7);
-    QStringList headers = {"ID", "标题", "类别", "发起人", "开始时间", "结束时间", "状态"};
-    activitiesTable->setHorizontalHeaderLabels(headers);
+    activityModel = new ActivityTableModel(executor, {
+        ActivityTableModel::IdColumn, ActivityTableModel::TitleColumn,
+        ActivityTableModel::CategoryColumn, ActivityTableModel::OrganizerColumn,
+        ActivityTableModel::StartTimeColumn, ActivityTableModel::EndTimeColumn,
+        ActivityTableModel::StatusColumn
+    }, this);
+    activitiesTable = new QTableView();
+    activitiesTable->setModel(activityModel);
     activitiesTable->setSelectionBehavior(QAbstractItemView::SelectRows);
     activitiesTable->setSelectionMode(QAbstractItemView::SingleSelection);
     activitiesTable->setEditTriggers(QAbstractItemView::NoEditTriggers);
     activitiesTable->horizontalHeader()->setStretchLastSection(true);
+    // 点击表头由模型在SQL中排序；初始不指定列，保持按创建时间倒序
+    activitiesTable->horizontalHeader()->setSortIndicator(-1, Qt::DescendingOrder);
+    activitiesTable->setSortingEnabled(true);
+    
+    // 数据库变更只刷新受影响的行，保留选中状态和滚动位置
+    connect(database, &Database::activityChanged, activityModel, &ActivityTableModel::markActivityDirty);
+    
+    // 搜索在后台执行；结果按当前排序返回活动ID，由模型分页加载
+    activitySearch = new ActivitySearch(executor, this);
+    connect(activitySearch, &ActivitySearch::resultsReady, this, &ActivityManager::onSearchResults);
+    // 搜索结果是固定的ID列表，数据或排序变化后需要重新搜索
+    connect(database, &Database::activityChanged, this, [this]() {
+        activitySearch->invalidate();
+        if (!searchLineEdit->text().trimmed().isEmpty()) {
+            searchDebounceTimer->start();
+        }
+    });
+    connect(activityModel, &ActivityTableModel::sortChanged, this, [this]() {
+        if (!searchLineEdit->text().trimmed().isEmpty()) {
+            populateTable();
+        }
+    });
     
-    connect(activitiesTable, &QTableWidget::itemDoubleClicked, this, &ActivityManager::onViewDetails);
-    connect(activitiesTable, &QTableWidget::itemSelectionChanged, this, &ActivityManager::onActivitySelectionChanged);
+    connect(activitiesTable, &QTableView::doubleClicked, this, &ActivityManager::onViewDetails);
+    connect(activitiesTable->selectionModel(), &QItemSelectionModel::selectionChanged, this, &ActivityManager::onActivitySelectionChanged);
     
     mainLayout->addWidget(activitiesTable);
 }
@@ -106,47 +180,39 @@ void ActivityManager::refreshActivities()
 
 void ActivityManager::populateTable()
 {
-    QString filter = "";
+    ActivityQuery query;
     
     // 根据角色过滤
     if (userRole == UserRole::Organizer) {
-        filter = QString("organizer = '%1'").arg(currentStudentId);
+        query.organizer = currentStudentId;
     } else if (userRole == UserRole::Student) {
-        filter = "status = " + QString::number(static_cast<int>(ActivityStatus::Approved));
+        query.status = static_cast<int>(ActivityStatus::Approved);
     }
     
-    // 搜索过滤
-    QString searchText = searchLineEdit->text().trimmed();
-    if (!searchText.isEmpty()) {
-        if (!filter.isEmpty()) filter += " AND ";
-        filter += QString("(title LIKE '%%1%' OR category LIKE '%%1%' OR organizer LIKE '%%1%')").arg(searchText);
+    searchDebounceTimer->stop();
+    query.searchText = searchLineEdit->text().trimmed();
+    if (query.searchText.isEmpty()) {
+        // 模型只加载第一页，其余行在滚动时通过 fetchMore 加载
+        activityModel->setQuery(query);
+        return;
     }
     
-    QList<QHash<QString, QVariant>> activities = database->getActivities(filter);
-    
-    activitiesTable->setRowCount(activities.size());
-    
-    for (int i = 0; i < activities.size(); ++i) {
-        const auto &activity = activities[i];
-        
-        activitiesTable->setItem(i, 0, new QTableWidgetItem(activity["id"].toString()));
-        activitiesTable->setItem(i, 1, new QTableWidgetItem(activity["title"].toString()));
-        activitiesTable->setItem(i, 2, new QTableWidgetItem(activity["category"].toString()));
-        activitiesTable->setItem(i, 3, new QTableWidgetItem(activity["organizer"].toString()));
-        activitiesTable->setItem(i, 4, new QTableWidgetItem(activity["start_time"].toDateTime().toString("yyyy-MM-dd hh:mm")));
-        activitiesTable->setItem(i, 5, new QTableWidgetItem(activity["end_time"].toDateTime().toString("yyyy-MM-dd hh:mm")));
-        
-        QString statusText;
-        ActivityStatus status = static_cast<ActivityStatus>(activity["status"].toInt());
-        switch (status) {
-            case ActivityStatus::Pending: statusText = "待审批"; break;
-            case ActivityStatus::Approved: statusText = "已批准"; break;
-            case ActivityStatus::Rejected: statusText = "已拒绝"; break;
-            case ActivityStatus::Ongoing: statusText = "进行中"; break;
-            case ActivityStatus::Finished: statusText = "已结束"; break;
-        }
-        activitiesTable->setItem(i, 6, new QTableWidgetItem(statusText));
+    // 搜索结果按表格当前的排序返回
+    ActivityQuery current = activityModel->currentQuery();
+    query.orderBy = current.orderBy;
+    query.descending = current.descending;
+    activitySearch->search(query);
+}
+
+void ActivityManager::onSearchResults(const ActivityQuery &query, const QVector<int> &ids)
+{
+    // 结果返回前搜索词或排序已改变，则等待下一次搜索
+    ActivityQuery current = activityModel->currentQuery();
+    if (query.searchText != searchLineEdit->text().trimmed()
+        || query.orderBy != current.orderBy || query.descending != current.descending) {
+        return;
     }
+    activityModel->setActivityIds(query, ids);
 }
 
 void ActivityManager::onCreateActivity()
@@ -174,6 +240,13 @@ void ActivityManager::onCreateActivity()
     QLineEdit *locationEdit = new QLineEdit();
     QLineEdit *checkinCodeEdit = new QLineEdit();
     checkinCodeEdit->setPlaceholderText("建议6位数字，如：123456");
+    // 热门活动可改为抽签：截止前只收申请，截止后统一抽签
+    QCheckBox *lotteryCheckBox = new QCheckBox("抽签报名");
+    QDateTimeEdit *lotteryDeadlineEdit = new QDateTimeEdit();
+    lotteryDeadlineEdit->setDateTime(QDateTime::currentDateTime().addSecs(12 * 3600));
+    lotteryDeadlineEdit->setCalendarPopup(true);
+    lotteryDeadlineEdit->setEnabled(false);
+    connect(lotteryCheckBox, &QCheckBox::toggled, lotteryDeadlineEdit, &QDateTimeEdit::setEnabled);
     
     formLayout->addRow("标题：", titleEdit);
     formLayout->addRow("描述：", descriptionEdit);
@@ -183,6 +256,8 @@ void ActivityManager::onCreateActivity()
     formLayout->addRow("最大人数：", maxParticipantsEdit);
     formLayout->addRow("地点：", locationEdit);
     formLayout->addRow("签到码：", checkinCodeEdit);
+    formLayout->addRow("报名方式：", lotteryCheckBox);
+    formLayout->addRow("申请截止：", lotteryDeadlineEdit);
     
     QDialogButtonBox *buttonBox = new QDialogButtonBox(QDialogButtonBox::Ok | QDialogButtonBox::Cancel);
     formLayout->addRow(buttonBox);
@@ -201,6 +276,33 @@ void ActivityManager::onCreateActivity()
             return;
         }
         
+        bool lottery = lotteryCheckBox->isChecked();
+        QDateTime lotteryDeadline = lotteryDeadlineEdit->dateTime();
+        if (lottery && (lotteryDeadline <= QDateTime::currentDateTime() || lotteryDeadline >= startTimeEdit->dateTime())) {
+            QMessageBox::warning(this, "错误", "抽签截止时间必须晚于当前时间、早于活动开始时间！");
+            return;
+        }
+        
+        // 同一地点：与已批准的活动重叠时不能发布，与待审批的重叠时由管理员审批时取舍
+        QList<QHash<QString, QVariant>> roomConflicts = database->checkLocationConflict(
+            locationEdit->text(), startTimeEdit->dateTime(), endTimeEdit->dateTime(), -1, true);
+        bool occupied = false;
+        for (const auto &conflict : roomConflicts) {
+            if (static_cast<ActivityStatus>(conflict["status"].toInt()) != ActivityStatus::Pending) {
+                occupied = true;
+            }
+        }
+        if (occupied) {
+            QMessageBox::warning(this, "场地冲突", "该地点在此时间段已被占用：\n\n" + roomConflictText(roomConflicts)
+                                 + "\n请更换地点或时间。");
+            return;
+        }
+        if (!roomConflicts.isEmpty()
+            && QMessageBox::question(this, "场地冲突", "以下待审批的活动也申请了该地点：\n\n" + roomConflictText(roomConflicts)
+                                     + "\n管理员只能批准其中之一，是否仍要发布？") != QMessageBox::Yes) {
+            return;
+        }
+        
         int activityId = database->createActivity(
             titleEdit->text(),
             descriptionEdit->toPlainText(),
@@ -213,9 +315,12 @@ void ActivityManager::onCreateActivity()
             checkinCodeEdit->text().trimmed()
         );
         
+        if (activityId > 0 && lottery && !database->setLotteryDeadline(activityId, lotteryDeadline)) {
+            QMessageBox::warning(this, "警告", "活动已发布，但设置抽签报名失败，将按先到先得报名！");
+            return;
+        }
         if (activityId > 0) {
             QMessageBox::information(this, "成功", "活动发布成功，等待管理员审批！");
-            refreshActivities(); // 添加这一行
         } else {    
             QMessageBox::warning(this, "失败", "活动发布失败！");
         }
@@ -234,6 +339,15 @@ void ActivityManager::onApproveActivity()
     QHash<QString, QVariant> activity = database->getActivity(activityId);
     QString currentCheckinCode = activity["checkin_code"].toString();
     
+    // 场地已被其他已批准、进行中的活动占用时需要确认（如操场等可共用的场地）
+    QList<QHash<QString, QVariant>> roomConflicts = database->checkLocationConflict(
+        activity["location"].toString(), activity["start_time"].toDateTime(), activity["end_time"].toDateTime(), activityId);
+    if (!roomConflicts.isEmpty()
+        && QMessageBox::question(this, "场地冲突", "该地点在此时间段已被以下活动占用：\n\n" + roomConflictText(roomConflicts)
+                                 + "\n仍要批准吗？", QMessageBox::Yes | QMessageBox::No, QMessageBox::No) != QMessageBox::Yes) {
+        return;
+    }
+    
     // 显示对话框允许设置/修改签到码
     QDialog checkinCodeDialog(this);
     checkinCodeDialog.setWindowTitle("设置签到码");
@@ -307,8 +421,6 @@ void ActivityManager::onApproveActivity()
         } else {
             qDebug() << "[活动批准] 警告：NetworkManager为空，跳过同步";
         }
-        
-        refreshActivities();
     } else {
         QMessageBox::warning(this, "失败", "操作失败！");
     }
@@ -325,13 +437,124 @@ void ActivityManager::onRejectActivity()
     if (QMessageBox::question(this, "确认", "确定要拒绝此活动吗？") == QMessageBox::Yes) {
         if (database->updateActivityStatus(activityId, ActivityStatus::Rejected)) {
             QMessageBox::information(this, "成功", "活动已拒绝！");
-            refreshActivities();
         } else {
             QMessageBox::warning(this, "失败", "操作失败！");
         }
     }
 }
 
+void ActivityManager::onAdjustCapacity()
+{
+    int activityId = getSelectedActivityId();
+    if (activityId <= 0) {
+        QMessageBox::warning(this, "提示", "请选择要调整的活动！");
+        return;
+    }
+    
+    QHash<QString, QVariant> activity = database->getActivity(activityId);
+    if (activity.isEmpty()) {
+        QMessageBox::warning(this, "错误", "活动不存在！");
+        return;
+    }
+    
+    bool ok = false;
+    int current = activity["max_participants"].toInt();
+    int maxParticipants = QInputDialog::getInt(this, "调整人数上限",
+                                               QString("当前已报名 %1 人，新的人数上限：")
+                                                   .arg(activity["current_participants"].toInt()),
+                                               current, 1, 10000, 1, &ok);
+    if (!ok || maxParticipants == current) {
+        return;
+    }
+    
+    // 提高上限后由最早的候补学生依次补上
+    if (database->updateMaxParticipants(activityId, maxParticipants)) {
+        QHash<QString, QVariant> updated = database->getActivity(activityId);
+        QMessageBox::information(this, "成功", QString("人数上限已调整为 %1，当前报名 %2 人。")
+                                 .arg(maxParticipants).arg(updated["current_participants"].toInt()));
+    } else {
+        QMessageBox::warning(this, "失败", "调整人数上限失败！");
+    }
+}
+
+void ActivityManager::onCreateMatchRound()
+{
+    QDialog dialog(this);
+    dialog.setWindowTitle("发起志愿匹配");
+    dialog.setMinimumWidth(400);
+    QFormLayout *formLayout = new QFormLayout(&dialog);
+    
+    QLineEdit *titleEdit = new QLineEdit();
+    titleEdit->setPlaceholderText("如：第3周工作坊选课");
+    QDateTimeEdit *cutoffEdit = new QDateTimeEdit();
+    cutoffEdit->setDateTime(QDateTime::currentDateTime().addDays(1));
+    cutoffEdit->setCalendarPopup(true);
+    QLabel *hintLabel = new QLabel("学生在截止前按顺序填写志愿（活动ID），截止后按名额和时间冲突统一分配。");
+    hintLabel->setWordWrap(true);
+    hintLabel->setStyleSheet("color: gray;");
+    
+    formLayout->addRow("名称：", titleEdit);
+    formLayout->addRow("截止时间：", cutoffEdit);
+    formLayout->addRow("", hintLabel);
+    QDialogButtonBox *buttonBox = new QDialogButtonBox(QDialogButtonBox::Ok | QDialogButtonBox::Cancel);
+    formLayout->addRow(buttonBox);
+    connect(buttonBox, &QDialogButtonBox::accepted, &dialog, &QDialog::accept);
+    connect(buttonBox, &QDialogButtonBox::rejected, &dialog, &QDialog::reject);
+    
+    if (dialog.exec() != QDialog::Accepted) {
+        return;
+    }
+    if (titleEdit->text().trimmed().isEmpty() || cutoffEdit->dateTime() <= QDateTime::currentDateTime()) {
+        QMessageBox::warning(this, "错误", "名称不能为空，截止时间必须晚于当前时间！");
+        return;
+    }
+    
+    int roundId = database->createMatchRound(titleEdit->text().trimmed(), cutoffEdit->dateTime(), currentStudentId);
+    if (roundId > 0) {
+        QMessageBox::information(this, "成功", QString("志愿匹配已发起（轮次 %1），学生可在\"志愿报名\"中提交志愿。").arg(roundId));
+    } else {
+        QMessageBox::warning(this, "失败", "发起志愿匹配失败！");
+    }
+}
+
+void ActivityManager::onValidateLocations()
+{
+    // 一次读出全部有地点的活动，在后台线程建索引校验，不阻塞界面
+    roomCheckButton->setEnabled(false);
+    executor->post(this, [](Database *db) {
+        return db->validatePendingLocations();
+    }, [this](const QList<RoomConflict> &conflicts) {
+        roomCheckButton->setEnabled(true);
+        if (conflicts.isEmpty()) {
+            QMessageBox::information(this, "场地冲突检查", "待审批活动没有场地冲突。");
+            return;
+        }
+        
+        QSet<int> activityIds;
+        QString details;
+        for (const RoomConflict &conflict : conflicts) {
+            activityIds.insert(conflict.activityId);
+            details += QString("%1 (ID: %2) 与 %3 (ID: %4，%5)\n  地点：%6  时间：%7 - %8\n\n")
+                .arg(conflict.title)
+                .arg(conflict.activityId)
+                .arg(conflict.conflictingTitle)
+                .arg(conflict.conflictingId)
+                .arg(conflict.conflictingStatus == ActivityStatus::Pending ? "待审批" : "已占用")
+                .arg(conflict.location)
+                .arg(conflict.startTime.toString("yyyy-MM-dd hh:mm"))
+                .arg(conflict.endTime.toString("yyyy-MM-dd hh:mm"));
+        }
+        
+        QMessageBox box(QMessageBox::Warning, "场地冲突检查",
+                        QString("%1 个待审批活动存在场地冲突，共 %2 处。\n"
+                                "与\"已占用\"冲突的活动批准前需更换地点或时间；互相冲突的待审批活动只能批准其一。")
+                            .arg(activityIds.size()).arg(conflicts.size()),
+                        QMessageBox::Ok, this);
+        box.setDetailedText(details);
+        box.exec();
+    });
+}
+
 void ActivityManager::onViewDetails()
 {
     int activityId = getSelectedActivityId();
@@ -356,7 +579,7 @@ void ActivityManager::onSearchActivities()
 
 void ActivityManager::onActivitySelectionChanged()
 {
-    bool hasSelection = activitiesTable->currentRow() >= 0;
+    bool hasSelection = activitiesTable->selectionModel()->hasSelection();
     viewButton->setEnabled(hasSelection);
     
     if (userRole == UserRole::Admin) {
@@ -367,17 +590,17 @@ void ActivityManager::onActivitySelectionChanged()
     if ((userRole == UserRole::Admin || userRole == UserRole::Organizer) && syncButton) {
         syncButton->setEnabled(hasSelection);
     }
+    if (capacityButton) {
+        capacityButton->setEnabled(hasSelection);
+    }
 }
 
 int ActivityManager::getSelectedActivityId()
 {
-    int row = activitiesTable->currentRow();
-    if (row < 0) return -1;
-    
-    QTableWidgetItem *item = activitiesTable->item(row, 0);
-    if (!item) return -1;
+    QModelIndexList rows = activitiesTable->selectionModel()->selectedRows();
+    if (rows.isEmpty()) return -1;
     
-    return item->text().toInt();
+    return activityModel->activityIdAt(rows.first().row());
 }
 
 void ActivityManager::showActivityDialog(const QHash<QString, QVariant> &activity, bool readOnly)
@@ -6,8 +6,12 @@
 #include "database.h"
 #include "networkmanager.h"
 
+class ActivityTableModel;
+class ActivitySearch;
+class DbExecutor;
+
 QT_BEGIN_NAMESPACE
-class QTableWidget;
+class QTableView;
 class QPushButton;
 class QLineEdit;
 class QTextEdit;
@@ -15,6 +19,7 @@ class QDateTimeEdit;
 class QSpinBox;
 class QComboBox;
 class QLabel;
+class QTimer;
 QT_END_NAMESPACE
 
 class ActivityManager : public QWidget
@@ -22,7 +27,7 @@ class ActivityManager : public QWidget
     Q_OBJECT
 
 public:
-    explicit ActivityManager(Database *db, UserRole role, const QString &studentId, NetworkManager *networkMgr = nullptr, QWidget *parent = nullptr);
+    explicit ActivityManager(Database *db, DbExecutor *executor, UserRole role, const QString &studentId, NetworkManager *networkMgr = nullptr, QWidget *parent = nullptr);
     void refreshActivities();
 
 private slots:
@@ -34,14 +39,21 @@ private slots:
     void onActivitySelectionChanged();
     void onRefreshActivities();
     void onManualSync();
+    void onAdjustCapacity();
+    void onCreateMatchRound();
+    void onValidateLocations();  // 批量检查待审批活动的场地冲突
 
 private:
     Database *database;
+    DbExecutor *executor;  // 表格数据在后台线程加载
     NetworkManager *networkManager;
     UserRole userRole;
     QString currentStudentId;
     
-    QTableWidget *activitiesTable;
+    QTableView *activitiesTable;
+    ActivityTableModel *activityModel;  // 按页加载的活动列表模型
+    ActivitySearch *activitySearch;     // 后台搜索及结果缓存
+    QTimer *searchDebounceTimer;        // 输入停顿后再搜索
     QPushButton *createButton;
     QPushButton *approveButton;
     QPushButton *rejectButton;
@@ -50,8 +62,12 @@ private:
     QLineEdit *searchLineEdit;
     QPushButton *refreshButton;  // 新增：刷新按钮
     QPushButton *syncButton;    // 新增：手动同步按钮
+    QPushButton *capacityButton;  // 调整人数上限（提高后自动候补转正）
+    QPushButton *matchRoundButton;  // 发起志愿匹配
+    QPushButton *roomCheckButton;   // 场地冲突检查（管理员）
     void setupUI();
     void populateTable();
+    void onSearchResults(const ActivityQuery &query, const QVector<int> &ids);
     int getSelectedActivityId();
     void showActivityDialog(const QHash<QString, QVariant> &activity, bool readOnly = false);
 };
@@ -0,0 +1,146 @@
+#include "activitysearch.h"
+#include "dbexecutor.h"
+#include <QDebug>
+
+namespace {
+// 缓存最多保留的查询数和总行数（宽泛的搜索词可能命中大量活动）
+const int kCacheCapacity = 16;
+const int kCacheMaxRows = 200000;
+// 内存过滤时每处理这么多行检查一次是否已被新的搜索取代
+const int kCancelCheckInterval = 4096;
+}
+
+ActivitySearch::ActivitySearch(DbExecutor *executor, QObject *parent)
+    : QObject(parent)
+    , executor(executor)
+    , cachedRows(0)
+    , generation(new QAtomicInt(0))
+{
+}
+
+void ActivitySearch::search(const ActivityQuery &query)
+{
+    const int token = generation->fetchAndAddOrdered(1) + 1;
+    const QString filter = filterKey(query);
+    const QString foldedText = foldCase(query.searchText);
+    const QString key = filter + QChar(0x1f) + foldedText;
+    
+    // 命中缓存：直接返回
+    if (cache.contains(key)) {
+        touch(key);
+        emit resultsReady(query, cache.value(key)->ids);
+        return;
+    }
+    
+    if (!executor) return;
+    
+    const ResultPtr base = findRefinementBase(filter, foldedText);
+    const QSharedPointer<QAtomicInt> latest = generation;
+    executor->post(this, [query, filter, foldedText, base, token, latest](Database *db) -> ResultPtr {
+        if (latest->loadAcquire() != token) {
+            return ResultPtr();  // 已有更新的搜索
+        }
+        
+        QSharedPointer<CachedResult> result(new CachedResult);
+        result->filterKey = filter;
+        result->foldedText = foldedText;
+        
+        if (base) {
+            // 前缀细化：新搜索词包含旧搜索词，结果一定是旧结果的子集，顺序不变
+            for (int i = 0; i < base->ids.size(); ++i) {
+                if (i % kCancelCheckInterval == 0 && latest->loadAcquire() != token) {
+                    return ResultPtr();
+                }
+                if (base->texts.at(i).contains(foldedText)) {
+                    result->ids.append(base->ids.at(i));
+                    result->texts.append(base->texts.at(i));
+                }
+            }
+        } else {
+            const QVector<ActivitySearchHit> hits = db->searchActivities(query);
+            result->ids.reserve(hits.size());
+            result->texts.reserve(hits.size());
+            for (const ActivitySearchHit &hit : hits) {
+                result->ids.append(hit.id);
+                result->texts.append(foldCase(hit.text));
+            }
+        }
+        return result;
+    }, [this, query, key, token](const ResultPtr &result) {
+        if (!result) return;
+        store(key, result);
+        if (generation->loadAcquire() == token) {
+            emit resultsReady(query, result->ids);
+        }
+    });
+}
+
+void ActivitySearch::invalidate()
+{
+    cache.clear();
+    recency.clear();
+    cachedRows = 0;
+}
+
+QString ActivitySearch::filterKey(const ActivityQuery &query)
+{
+    return QStringList{
+        query.organizer,
+        QString::number(query.status),
+        query.excludeRegisteredBy,
+        query.orderBy,
+        query.descending ? "desc" : "asc"
+    }.join(QChar(0x1f));
+}
+
+QString ActivitySearch::foldCase(const QString &text)
+{
+    // 与 SQLite 的 LIKE 一致：只对ASCII字母忽略大小写
+    QString folded = text;
+    for (QChar &ch : folded) {
+        ushort code = ch.unicode();
+        if (code >= 'A' && code <= 'Z') {
+            ch = QChar(code + ('a' - 'A'));
+        }
+    }
+    return folded;
+}
+
+ActivitySearch::ResultPtr ActivitySearch::findRefinementBase(const QString &filter, const QString &foldedText) const
+{
+    // 在条件相同、且搜索词被新搜索词包含的缓存结果中选行数最少的一个
+    ResultPtr best;
+    for (const ResultPtr &entry : cache) {
+        if (entry->filterKey != filter || !foldedText.contains(entry->foldedText)) {
+            continue;
+        }
+        if (!best || entry->ids.size() < best->ids.size()) {
+            best = entry;
+        }
+    }
+    return best;
+}
+
+void ActivitySearch::store(const QString &key, const ResultPtr &result)
+{
+    if (cache.contains(key)) {
+        cachedRows -= cache.value(key)->ids.size();
+        recency.removeOne(key);
+    }
+    cache.insert(key, result);
+    recency.append(key);
+    cachedRows += result->ids.size();
+    
+    // 淘汰最久未使用的结果
+    while (recency.size() > 1 && (recency.size() > kCacheCapacity || cachedRows > kCacheMaxRows)) {
+        QString oldest = recency.takeFirst();
+        cachedRows -= cache.value(oldest)->ids.size();
+        cache.remove(oldest);
+    }
+}
+
+void ActivitySearch::touch(const QString &key)
+{
+    recency.removeOne(key);
+    recency.append(key);
+}
@@ -0,0 +1,55 @@
+#ifndef ACTIVITYSEARCH_H
+#define ACTIVITYSEARCH_H
+
+#include <QObject>
+#include <QHash>
+#include <QVector>
+#include <QStringList>
+#include <QSharedPointer>
+#include <QAtomicInt>
+#include "database.h"
+
+class DbExecutor;
+
+// 活动搜索：在后台线程执行，结果为按当前排序排好的活动ID列表。
+// 最近的查询结果放在一个小的LRU缓存中；新的搜索词包含某个已缓存的搜索词时，
+// 直接在内存中过滤该结果集（前缀细化），不再查询数据库。
+class ActivitySearch : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit ActivitySearch(DbExecutor *executor, QObject *parent = nullptr);
+
+    // query.searchText 为搜索词，其余字段为基础过滤条件和排序
+    void search(const ActivityQuery &query);
+    // 活动数据变化后清空缓存
+    void invalidate();
+
+signals:
+    // 只针对最近一次 search() 发出，过期结果会被丢弃
+    void resultsReady(const ActivityQuery &query, const QVector<int> &ids);
+
+private:
+    struct CachedResult {
+        QString filterKey;        // 除搜索词以外的条件
+        QString foldedText;       // 转为小写的搜索词
+        QVector<int> ids;
+        QVector<QString> texts;   // 与 ids 对应的匹配文本（已转小写）
+    };
+    typedef QSharedPointer<const CachedResult> ResultPtr;
+
+    DbExecutor *executor;
+    QHash<QString, ResultPtr> cache;
+    QStringList recency;          // 缓存键，最近使用的在末尾
+    int cachedRows;
+    QSharedPointer<QAtomicInt> generation;
+
+    static QString filterKey(const ActivityQuery &query);
+    static QString foldCase(const QString &text);
+    ResultPtr findRefinementBase(const QString &filter, const QString &foldedText) const;
+    void store(const QString &key, const ResultPtr &result);
+    void touch(const QString &key);
+};
+
+#endif // ACTIVITYSEARCH_H
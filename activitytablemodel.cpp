@@ -0,0 +1,544 @@
+#include "activitytablemodel.h"
+#include "dbexecutor.h"
+#include <QBrush>
+#include <QTimer>
+#include <algorithm>
+
+namespace {
+// 每次 fetchMore 从数据库读取的行数
+const int kPageSize = 200;
+
+// 按给定顺序加载一段活动ID；已被删除的活动不会出现在结果中
+QList<ActivityRecord> loadIdSlice(Database *db, const QList<int> &ids)
+{
+    ActivityQuery sliceQuery;
+    sliceQuery.ids = ids;
+    QList<ActivityRecord> rows = db->getActivityPage(sliceQuery, 0, ids.size());
+    
+    QHash<int, int> position;
+    for (int i = 0; i < ids.size(); ++i) {
+        position.insert(ids.at(i), i);
+    }
+    std::sort(rows.begin(), rows.end(), [&position](const ActivityRecord &a, const ActivityRecord &b) {
+        return position.value(a.id) < position.value(b.id);
+    });
+    return rows;
+}
+}
+
+ActivityTableModel::ActivityTableModel(DbExecutor *executor, const QList<Column> &columns, QObject *parent)
+    : QAbstractTableModel(parent)
+    , executor(executor)
+    , columns(columns)
+    , hasQuery(false)
+    , total(0)
+    , loading(false)
+    , fetching(false)
+    , generation(new QAtomicInt(0))
+    , useIdList(false)
+    , nextIdOffset(0)
+    , refreshScheduled(false)
+{
+}
+
+void ActivityTableModel::setQuery(const ActivityQuery &newQuery)
+{
+    // 排序由表头通过 sort() 决定，切换查询条件时保留
+    QString orderBy = query.orderBy;
+    bool descending = query.descending;
+    
+    query = newQuery;
+    query.orderBy = orderBy;
+    query.descending = descending;
+    hasQuery = true;
+    useIdList = false;
+    idList.clear();
+    reload();
+}
+
+void ActivityTableModel::setActivityIds(const ActivityQuery &newQuery, const QVector<int> &ids)
+{
+    QString orderBy = query.orderBy;
+    bool descending = query.descending;
+    
+    query = newQuery;
+    query.orderBy = orderBy;
+    query.descending = descending;
+    hasQuery = true;
+    useIdList = true;
+    idList = ids;
+    reload();
+}
+
+ActivityQuery ActivityTableModel::currentQuery() const
+{
+    return query;
+}
+
+void ActivityTableModel::reload()
+{
+    // 新的刷新开始，之前所有未完成的请求作废
+    const int token = generation->fetchAndAddOrdered(1) + 1;
+    
+    beginResetModel();
+    records.clear();
+    loadedIds.clear();
+    dirtyIds.clear();  // 整表重新加载会包含这些变更
+    total = 0;
+    loading = hasQuery && executor;
+    fetching = false;
+    endResetModel();
+    
+    if (!loading) {
+        emit loadFinished(0);
+        return;
+    }
+    
+    const QSharedPointer<QAtomicInt> latest = generation;
+    if (useIdList) {
+        // 总数已知，只需加载第一段ID对应的行
+        const QList<int> slice = idList.mid(0, kPageSize).toList();
+        const int listSize = idList.size();
+        nextIdOffset = slice.size();
+        executor->post(this, [slice, listSize, token, latest](Database *db) -> PageResult {
+            PageResult result;
+            if (latest->loadAcquire() != token) {
+                result.cancelled = true;
+                return result;
+            }
+            result.rows = loadIdSlice(db, slice);
+            result.total = listSize - (slice.size() - result.rows.size());
+            return result;
+        }, [this, token](const PageResult &result) {
+            applyFirstPage(result, token);
+        });
+        return;
+    }
+    
+    const ActivityQuery pendingQuery = query;
+    executor->post(this, [pendingQuery, token, latest](Database *db) -> PageResult {
+        PageResult result;
+        // 排队期间已有更新的刷新，跳过查询
+        if (latest->loadAcquire() != token) {
+            result.cancelled = true;
+            return result;
+        }
+        result.total = db->countActivities(pendingQuery);
+        if (latest->loadAcquire() != token) {
+            result.cancelled = true;
+            return result;
+        }
+        result.rows = db->getActivityPage(pendingQuery, 0, kPageSize);
+        return result;
+    }, [this, token](const PageResult &result) {
+        applyFirstPage(result, token);
+    });
+}
+
+void ActivityTableModel::applyFirstPage(const PageResult &result, int token)
+{
+    if (result.cancelled || generation->loadAcquire() != token) {
+        return;  // 过期结果
+    }
+    
+    beginResetModel();
+    loading = false;
+    total = result.total;
+    records.reserve(result.rows.size());
+    for (const ActivityRecord &record : result.rows) {
+        records.append(record);
+        loadedIds.insert(record.id);
+    }
+    endResetModel();
+    emit loadFinished(total);
+    
+    // 加载期间发生的变更可能没有包含在结果中，补一次单行刷新
+    if (!dirtyIds.isEmpty()) {
+        scheduleDirtyRefresh();
+    }
+}
+
+bool ActivityTableModel::isLoading() const
+{
+    return loading;
+}
+
+int ActivityTableModel::totalCount() const
+{
+    return total;
+}
+
+int ActivityTableModel::activityIdAt(int row) const
+{
+    if (loading || row < 0 || row >= records.size()) return -1;
+    return records.at(row).id;
+}
+
+QString ActivityTableModel::statusText(ActivityStatus status)
+{
+    switch (status) {
+        case ActivityStatus::Pending: return "待审批";
+        case ActivityStatus::Approved: return "已批准";
+        case ActivityStatus::Rejected: return "已拒绝";
+        case ActivityStatus::Ongoing: return "进行中";
+        case ActivityStatus::Finished: return "已结束";
+    }
+    return QString();
+}
+
+int ActivityTableModel::rowCount(const QModelIndex &parent) const
+{
+    if (parent.isValid()) return 0;
+    return loading ? 1 : records.size();  // 加载中只有一行占位
+}
+
+int ActivityTableModel::columnCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : columns.size();
+}
+
+QVariant ActivityTableModel::data(const QModelIndex &index, int role) const
+{
+    if (!index.isValid() || index.column() >= columns.size()) {
+        return QVariant();
+    }
+    
+    if (loading) {
+        if (index.column() == 0 && role == Qt::DisplayRole) return "正在加载...";
+        if (role == Qt::ForegroundRole) return QBrush(Qt::gray);
+        return QVariant();
+    }
+    
+    if (index.row() >= records.size()) {
+        return QVariant();
+    }
+    
+    const ActivityRecord &record = records.at(index.row());
+    if (role == Qt::UserRole) {
+        return record.id;
+    }
+    if (role != Qt::DisplayRole) {
+        return QVariant();
+    }
+    
+    switch (columns.at(index.column())) {
+        case IdColumn: return record.id;
+        case TitleColumn: return record.title;
+        case CategoryColumn: return record.category;
+        case OrganizerColumn: return record.organizer;
+        case StartTimeColumn: return record.startTime.toString("yyyy-MM-dd hh:mm");
+        case EndTimeColumn: return record.endTime.toString("yyyy-MM-dd hh:mm");
+        case StatusColumn: return statusText(record.status);
+        case RemainingColumn: return record.maxParticipants - record.currentParticipants;
+    }
+    return QVariant();
+}
+
+QVariant ActivityTableModel::headerData(int section, Qt::Orientation orientation, int role) const
+{
+    if (orientation != Qt::Horizontal || role != Qt::DisplayRole || section < 0 || section >= columns.size()) {
+        return QAbstractTableModel::headerData(section, orientation, role);
+    }
+    
+    switch (columns.at(section)) {
+        case IdColumn: return "ID";
+        case TitleColumn: return "标题";
+        case CategoryColumn: return "类别";
+        case OrganizerColumn: return "发起人";
+        case StartTimeColumn: return "开始时间";
+        case EndTimeColumn: return "结束时间";
+        case StatusColumn: return "状态";
+        case RemainingColumn: return "剩余名额";
+    }
+    return QVariant();
+}
+
+Qt::ItemFlags ActivityTableModel::flags(const QModelIndex &index) const
+{
+    // 占位行不可选中
+    if (loading) return Qt::NoItemFlags;
+    return QAbstractTableModel::flags(index);
+}
+
+bool ActivityTableModel::canFetchMore(const QModelIndex &parent) const
+{
+    if (parent.isValid() || loading || fetching) return false;
+    return useIdList ? nextIdOffset < idList.size() : records.size() < total;
+}
+
+void ActivityTableModel::fetchMore(const QModelIndex &parent)
+{
+    if (parent.isValid() || !executor || loading || fetching) return;
+    
+    fetching = true;
+    const int token = generation->loadAcquire();
+    const QSharedPointer<QAtomicInt> latest = generation;
+    
+    if (useIdList) {
+        const QList<int> slice = idList.mid(nextIdOffset, kPageSize).toList();
+        nextIdOffset += slice.size();
+        executor->post(this, [slice, token, latest](Database *db) -> PageResult {
+            PageResult result;
+            if (latest->loadAcquire() != token) {
+                result.cancelled = true;
+                return result;
+            }
+            result.rows = loadIdSlice(db, slice);
+            result.missing = slice.size() - result.rows.size();
+            return result;
+        }, [this, token](const PageResult &result) {
+            if (result.cancelled || generation->loadAcquire() != token) {
+                return;
+            }
+            fetching = false;
+            total -= result.missing;  // 被删除的活动不计入总数
+            if (result.rows.isEmpty()) {
+                return;
+            }
+            beginInsertRows(QModelIndex(), records.size(), records.size() + result.rows.size() - 1);
+            for (const ActivityRecord &record : result.rows) {
+                records.append(record);
+                loadedIds.insert(record.id);
+            }
+            endInsertRows();
+        });
+        return;
+    }
+    
+    const int offset = records.size();
+    const ActivityQuery pendingQuery = query;
+    executor->post(this, [pendingQuery, token, latest, offset](Database *db) -> PageResult {
+        PageResult result;
+        if (latest->loadAcquire() != token) {
+            result.cancelled = true;
+            return result;
+        }
+        result.rows = db->getActivityPage(pendingQuery, offset, kPageSize);
+        return result;
+    }, [this, token](const PageResult &result) {
+        if (result.cancelled || generation->loadAcquire() != token) {
+            return;  // 已被新的刷新取代，fetching 已在 reload() 中复位
+        }
+        
+        fetching = false;
+        if (result.rows.isEmpty()) {
+            // 加载期间有行被删除，按实际行数结束分页
+            total = records.size();
+            return;
+        }
+        
+        // 分页期间有单行插入/移除时，页边界可能与已加载的行重叠
+        QList<ActivityRecord> newRows;
+        for (const ActivityRecord &record : result.rows) {
+            if (!loadedIds.contains(record.id)) {
+                newRows.append(record);
+            }
+        }
+        if (newRows.isEmpty()) {
+            return;
+        }
+        
+        beginInsertRows(QModelIndex(), records.size(), records.size() + newRows.size() - 1);
+        for (const ActivityRecord &record : newRows) {
+            records.append(record);
+            loadedIds.insert(record.id);
+        }
+        endInsertRows();
+    });
+}
+
+void ActivityTableModel::sort(int column, Qt::SortOrder order)
+{
+    if (column < 0 || column >= columns.size()) {
+        query.orderBy = "created_at";
+        query.descending = true;
+    } else {
+        switch (columns.at(column)) {
+            case IdColumn: query.orderBy = "id"; break;
+            case TitleColumn: query.orderBy = "title"; break;
+            case CategoryColumn: query.orderBy = "category"; break;
+            case OrganizerColumn: query.orderBy = "organizer"; break;
+            case StartTimeColumn: query.orderBy = "start_time"; break;
+            case EndTimeColumn: query.orderBy = "end_time"; break;
+            case StatusColumn: query.orderBy = "status"; break;
+            case RemainingColumn: query.orderBy = "remaining"; break;
+        }
+        query.descending = (order == Qt::DescendingOrder);
+    }
+    
+    emit sortChanged();
+    // ID列表的顺序由调用方按新排序重新生成
+    if (hasQuery && !useIdList) {
+        reload();
+    }
+}
+
+void ActivityTableModel::markActivityDirty(int activityId)
+{
+    // ID列表模式下由调用方重新搜索
+    if (!hasQuery || useIdList) return;
+    
+    dirtyIds.insert(activityId);
+    // 加载中时等第一页返回后再刷新
+    if (!loading) {
+        scheduleDirtyRefresh();
+    }
+}
+
+void ActivityTableModel::scheduleDirtyRefresh()
+{
+    if (refreshScheduled) return;
+    refreshScheduled = true;
+    QTimer::singleShot(0, this, &ActivityTableModel::refreshDirtyRows);
+}
+
+void ActivityTableModel::refreshDirtyRows()
+{
+    refreshScheduled = false;
+    if (loading || dirtyIds.isEmpty() || !executor) return;
+    
+    const QList<int> ids = dirtyIds.values();
+    dirtyIds.clear();
+    
+    // 用当前查询条件加上ID限定重新查询，查不到表示该行已不满足条件
+    ActivityQuery rowQuery = query;
+    rowQuery.ids = ids;
+    const int token = generation->loadAcquire();
+    const QSharedPointer<QAtomicInt> latest = generation;
+    executor->post(this, [rowQuery, token, latest](Database *db) -> PageResult {
+        PageResult result;
+        if (latest->loadAcquire() != token) {
+            result.cancelled = true;
+            return result;
+        }
+        result.rows = db->getActivityPage(rowQuery, 0, rowQuery.ids.size());
+        return result;
+    }, [this, token, ids](const PageResult &result) {
+        if (result.cancelled || generation->loadAcquire() != token) {
+            return;  // 期间整表已重新加载
+        }
+        applyRowUpdates(ids, result.rows);
+    });
+}
+
+void ActivityTableModel::applyRowUpdates(const QList<int> &ids, const QList<ActivityRecord> &rows)
+{
+    QHash<int, ActivityRecord> matched;
+    for (const ActivityRecord &record : rows) {
+        matched.insert(record.id, record);
+    }
+    
+    for (int id : ids) {
+        int row = rowOfActivity(id);
+        
+        if (!matched.contains(id)) {
+            // 已删除或不再满足过滤条件
+            if (row >= 0) {
+                beginRemoveRows(QModelIndex(), row, row);
+                records.removeAt(row);
+                loadedIds.remove(id);
+                endRemoveRows();
+                total--;
+            }
+            continue;
+        }
+        
+        const ActivityRecord record = matched.value(id);
+        bool moreUnloaded = records.size() < total;
+        
+        if (row < 0) {
+            // 新满足条件的行：落在已加载区间内就插入，否则留给 fetchMore
+            total++;
+            int position = insertPosition(record);
+            if (position < records.size() || !moreUnloaded) {
+                beginInsertRows(QModelIndex(), position, position);
+                records.insert(position, record);
+                loadedIds.insert(id);
+                endInsertRows();
+            }
+            continue;
+        }
+        
+        bool inPlace = (row == 0 || !lessThan(record, records.at(row - 1)))
+                    && (row == records.size() - 1 || !lessThan(records.at(row + 1), record));
+        if (inPlace) {
+            records[row] = record;
+            emit dataChanged(index(row, 0), index(row, columns.size() - 1));
+            continue;
+        }
+        
+        // 排序字段变化，移动到新位置（使用 move 以保留选中状态）
+        int position = insertPosition(record, row);
+        if (position == records.size() - 1 && moreUnloaded) {
+            // 排到了已加载行的末尾之后，交给 fetchMore 重新加载
+            beginRemoveRows(QModelIndex(), row, row);
+            records.removeAt(row);
+            loadedIds.remove(id);
+            endRemoveRows();
+            continue;
+        }
+        
+        int destination = position >= row ? position + 1 : position;
+        if (beginMoveRows(QModelIndex(), row, row, QModelIndex(), destination)) {
+            records.removeAt(row);
+            records.insert(position, record);
+            endMoveRows();
+        }
+    }
+}
+
+int ActivityTableModel::rowOfActivity(int activityId) const
+{
+    if (!loadedIds.contains(activityId)) return -1;
+    for (int row = 0; row < records.size(); ++row) {
+        if (records.at(row).id == activityId) return row;
+    }
+    return -1;
+}
+
+int ActivityTableModel::insertPosition(const ActivityRecord &record, int skipRow) const
+{
+    // 已加载的行与SQL排序一致，二分查找插入位置；skipRow 指定的行视为不存在
+    int low = 0;
+    int high = skipRow >= 0 ? records.size() - 1 : records.size();
+    while (low < high) {
+        int mid = (low + high) / 2;
+        int actual = (skipRow >= 0 && mid >= skipRow) ? mid + 1 : mid;
+        if (lessThan(records.at(actual), record)) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+    return low;
+}
+
+bool ActivityTableModel::lessThan(const ActivityRecord &a, const ActivityRecord &b) const
+{
+    // 与 Database::getActivityPage 的 ORDER BY 保持一致（同值时按ID）
+    const QString &orderBy = query.orderBy;
+    int cmp = 0;
+    if (orderBy == "id") {
+        cmp = 0;
+    } else if (orderBy == "title") {
+        cmp = QString::compare(a.title, b.title);
+    } else if (orderBy == "category") {
+        cmp = QString::compare(a.category, b.category);
+    } else if (orderBy == "organizer") {
+        cmp = QString::compare(a.organizer, b.organizer);
+    } else if (orderBy == "start_time") {
+        cmp = a.startTime < b.startTime ? -1 : (b.startTime < a.startTime ? 1 : 0);
+    } else if (orderBy == "end_time") {
+        cmp = a.endTime < b.endTime ? -1 : (b.endTime < a.endTime ? 1 : 0);
+    } else if (orderBy == "status") {
+        cmp = static_cast<int>(a.status) - static_cast<int>(b.status);
+    } else if (orderBy == "remaining") {
+        cmp = (a.maxParticipants - a.currentParticipants) - (b.maxParticipants - b.currentParticipants);
+    } else {
+        cmp = a.createdAt < b.createdAt ? -1 : (b.createdAt < a.createdAt ? 1 : 0);
+    }
+    if (cmp == 0) {
+        cmp = a.id - b.id;
+    }
+    return query.descending ? cmp > 0 : cmp < 0;
+}
@@ -0,0 +1,100 @@
+#ifndef ACTIVITYTABLEMODEL_H
+#define ACTIVITYTABLEMODEL_H
+
+#include <QAbstractTableModel>
+#include <QVector>
+#include <QSharedPointer>
+#include <QAtomicInt>
+#include <QSet>
+#include "database.h"
+
+class DbExecutor;
+
+// 活动列表模型：按页从数据库加载（canFetchMore/fetchMore），排序交给SQL。
+// 查询在 DbExecutor 后台线程执行，加载期间显示占位行；
+// 每次刷新递增代号，旧代号的结果直接丢弃，尚未开始的旧查询被跳过。
+// 数据库发出 activityChanged 后只重新查询变化的行，并就地插入、更新或移除。
+class ActivityTableModel : public QAbstractTableModel
+{
+    Q_OBJECT
+
+public:
+    enum Column {
+        IdColumn,
+        TitleColumn,
+        CategoryColumn,
+        OrganizerColumn,
+        StartTimeColumn,
+        EndTimeColumn,
+        StatusColumn,
+        RemainingColumn   // 剩余名额
+    };
+
+    explicit ActivityTableModel(DbExecutor *executor, const QList<Column> &columns, QObject *parent = nullptr);
+
+    // 设置查询条件并在后台重新加载第一页
+    void setQuery(const ActivityQuery &query);
+    // 显示一组已按当前排序排好的活动ID（搜索结果），按页加载行内容
+    void setActivityIds(const ActivityQuery &query, const QVector<int> &ids);
+    ActivityQuery currentQuery() const;
+    void reload();
+    bool isLoading() const;
+    int totalCount() const;
+    int activityIdAt(int row) const;
+
+    static QString statusText(ActivityStatus status);
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    int columnCount(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+    QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const override;
+    Qt::ItemFlags flags(const QModelIndex &index) const override;
+    bool canFetchMore(const QModelIndex &parent) const override;
+    void fetchMore(const QModelIndex &parent) override;
+    void sort(int column, Qt::SortOrder order = Qt::AscendingOrder) override;
+
+public slots:
+    // 标记活动需要刷新；同一轮事件循环内的多次变更合并为一次后台查询
+    void markActivityDirty(int activityId);
+
+signals:
+    // 第一页加载完成（过期的结果不会触发）
+    void loadFinished(int totalCount);
+    // 用户点击表头改变了排序；ID列表模式下需要调用方按新排序重新搜索
+    void sortChanged();
+
+private:
+    // 后台查询结果
+    struct PageResult {
+        bool cancelled = false;
+        int total = 0;
+        int missing = 0;   // ID列表分页时，本段中搜索之后已被删除的活动数
+        QList<ActivityRecord> rows;
+    };
+
+    DbExecutor *executor;
+    QList<Column> columns;
+    ActivityQuery query;
+    bool hasQuery;
+    QVector<ActivityRecord> records;  // 已加载的行
+    int total;                        // 满足条件的总行数
+    bool loading;                     // 第一页查询进行中（显示占位行）
+    bool fetching;                    // 后续页查询进行中
+    QSharedPointer<QAtomicInt> generation;  // 最新刷新代号，后台线程也会读取
+    bool useIdList;                   // true 时按 idList 分页，而不是按查询条件分页
+    QVector<int> idList;
+    int nextIdOffset;                 // idList 中下一页的起始位置
+    QSet<int> loadedIds;              // 已加载行的活动ID，用于分页去重
+    QSet<int> dirtyIds;               // 等待单行刷新的活动ID
+    bool refreshScheduled;
+
+    void applyFirstPage(const PageResult &result, int token);
+    void scheduleDirtyRefresh();
+    void refreshDirtyRows();
+    void applyRowUpdates(const QList<int> &ids, const QList<ActivityRecord> &rows);
+    int rowOfActivity(int activityId) const;
+    int insertPosition(const ActivityRecord &record, int skipRow = -1) const;
+    bool lessThan(const ActivityRecord &a, const ActivityRecord &b) const;
+};
+
+#endif // ACTIVITYTABLEMODEL_H
@@ -0,0 +1,498 @@
+#include "asyncdatabase.h"
+
+AsyncDatabase::AsyncDatabase(Database *database, QObject *parent)
+    : QObject(parent)
+    , writer(new GroupCommitWriter(database->databaseFileName(), this))
+    , reader(new DbExecutor(database->databaseFileName(), this))
+{
+    // 后台写入的变更通知转发到主连接，表格模型等已有连接照常收到
+    connect(writer, &GroupCommitWriter::activityChanged, database, &Database::activityChanged);
+    connect(writer, &GroupCommitWriter::registrationChanged, database, &Database::registrationChanged);
+    connect(writer, &GroupCommitWriter::checkInRecorded, database, &Database::checkInRecorded);
+}
+
+void AsyncDatabase::setWriteBatchPolicy(int maxOperations, int maxDelayMs)
+{
+    writer->setBatchPolicy(maxOperations, maxDelayMs);
+}
+
+QFuture<bool> AsyncDatabase::addUser(const QString &studentId, const QString &password, UserRole role, const QString &name)
+{
+    return writer->submit<bool>([=](Database *db) {
+        return db->addUser(studentId, password, role, name);
+    });
+}
+
+QFuture<AsyncDatabase::LoginResult> AsyncDatabase::authenticateUser(const QString &studentId, const QString &password)
+{
+    return run<LoginResult>(reader, [=](Database *db) {
+        LoginResult result;
+        result.success = db->authenticateUser(studentId, password, result.role, result.name);
+        return result;
+    });
+}
+
+QFuture<UserRole> AsyncDatabase::getUserRole(const QString &studentId)
+{
+    return run<UserRole>(reader, [=](Database *db) {
+        return db->getUserRole(studentId);
+    });
+}
+
+QFuture<bool> AsyncDatabase::studentIdExists(const QString &studentId)
+{
+    return run<bool>(reader, [=](Database *db) {
+        return db->studentIdExists(studentId);
+    });
+}
+
+QFuture<int> AsyncDatabase::createActivity(const QString &title, const QString &description,
+                                          const QString &category, const QString &organizer,
+                                          const QDateTime &startTime, const QDateTime &endTime,
+                                          int maxParticipants, const QString &location, const QString &checkinCode)
+{
+    return writer->submit<int>([=](Database *db) {
+        return db->createActivity(title, description, category, organizer,
+                                  startTime, endTime, maxParticipants, location, checkinCode);
+    });
+}
+
+QFuture<bool> AsyncDatabase::updateActivityStatus(int activityId, ActivityStatus status)
+{
+    return writer->submit<bool>([=](Database *db) {
+        return db->updateActivityStatus(activityId, status);
+    });
+}
+
+QFuture<bool> AsyncDatabase::updateCheckInCode(int activityId, const QString &checkinCode)
+{
+    return writer->submit<bool>([=](Database *db) {
+        return db->updateCheckInCode(activityId, checkinCode);
+    });
+}
+
+QFuture<QString> AsyncDatabase::getCheckInCode(int activityId)
+{
+    return run<QString>(reader, [=](Database *db) {
+        return db->getCheckInCode(activityId);
+    });
+}
+
+QFuture<QList<QHash<QString, QVariant>>> AsyncDatabase::getActivities(const QString &filter)
+{
+    return run<QList<QHash<QString, QVariant>>>(reader, [=](Database *db) {
+        return db->getActivities(filter);
+    });
+}
+
+QFuture<QHash<QString, QVariant>> AsyncDatabase::getActivity(int activityId)
+{
+    return run<QHash<QString, QVariant>>(reader, [=](Database *db) {
+        return db->getActivity(activityId);
+    });
+}
+
+QFuture<int> AsyncDatabase::countActivities(const ActivityQuery &query)
+{
+    return run<int>(reader, [=](Database *db) {
+        return db->countActivities(query);
+    });
+}
+
+QFuture<QList<ActivityRecord>> AsyncDatabase::getActivityPage(const ActivityQuery &query, int offset, int limit)
+{
+    return run<QList<ActivityRecord>>(reader, [=](Database *db) {
+        return db->getActivityPage(query, offset, limit);
+    });
+}
+
+QFuture<QVector<ActivitySearchHit>> AsyncDatabase::searchActivities(const ActivityQuery &query)
+{
+    return run<QVector<ActivitySearchHit>>(reader, [=](Database *db) {
+        return db->searchActivities(query);
+    });
+}
+
+QFuture<bool> AsyncDatabase::applyActivityChanges(const QList<QHash<QString, QVariant>> &changes, const QString &cursor)
+{
+    // 内部自己开启事务，不参与组提交
+    return writer->submit<bool>([=](Database *db) {
+        return db->applyActivityChanges(changes, cursor);
+    }, true);
+}
+
+QFuture<QString> AsyncDatabase::getSyncState(const QString &key, const QString &defaultValue)
+{
+    return run<QString>(reader, [=](Database *db) {
+        return db->getSyncState(key, defaultValue);
+    });
+}
+
+QFuture<bool> AsyncDatabase::setSyncState(const QString &key, const QString &value)
+{
+    return writer->submit<bool>([=](Database *db) {
+        return db->setSyncState(key, value);
+    });
+}
+
+QFuture<QList<ActivityRecord>> AsyncDatabase::getLifecycleSchedule()
+{
+    return run<QList<ActivityRecord>>(reader, [](Database *db) {
+        return db->getLifecycleSchedule();
+    });
+}
+
+QFuture<int> AsyncDatabase::advanceActivityStatuses(const QList<int> &startingIds, const QList<int> &endingIds, const QDateTime &now)
+{
+    return writer->submit<int>([=](Database *db) {
+        return db->advanceActivityStatuses(startingIds, endingIds, now);
+    });
+}
+
+QFuture<bool> AsyncDatabase::registerActivity(int activityId, const QString &studentId, const QString &studentName)
+{
+    return writer->submit<bool>([=](Database *db) {
+        return db->registerActivity(activityId, studentId, studentName);
+    });
+}
+
+QFuture<bool> AsyncDatabase::cancelRegistration(int activityId, const QString &studentId)
+{
+    return writer->submit<bool>([=](Database *db) {
+        return db->cancelRegistration(activityId, studentId);
+    });
+}
+
+QFuture<int> AsyncDatabase::cancelRegistrations(int activityId, const QStringList &studentIds)
+{
+    return writer->submit<int>([=](Database *db) {
+        return db->cancelRegistrations(activityId, studentIds);
+    });
+}
+
+QFuture<bool> AsyncDatabase::switchRegistrations(int activityId, const QString &studentId, const QString &studentName,
+                                                 const QList<int> &droppedActivityIds)
+{
+    return writer->submit<bool>([=](Database *db) {
+        return db->switchRegistrations(activityId, studentId, studentName, droppedActivityIds);
+    });
+}
+
+QFuture<bool> AsyncDatabase::isRegistered(int activityId, const QString &studentId)
+{
+    return run<bool>(reader, [=](Database *db) {
+        return db->isRegistered(activityId, studentId);
+    });
+}
+
+QFuture<QList<QHash<QString, QVariant>>> AsyncDatabase::getRegistrations(int activityId)
+{
+    return run<QList<QHash<QString, QVariant>>>(reader, [=](Database *db) {
+        return db->getRegistrations(activityId);
+    });
+}
+
+QFuture<QList<QHash<QString, QVariant>>> AsyncDatabase::getStudentRegistrations(const QString &studentId)
+{
+    return run<QList<QHash<QString, QVariant>>>(reader, [=](Database *db) {
+        return db->getStudentRegistrations(studentId);
+    });
+}
+
+QFuture<int> AsyncDatabase::countRegistrations(const RegistrationQuery &query)
+{
+    return run<int>(reader, [=](Database *db) {
+        return db->countRegistrations(query);
+    });
+}
+
+QFuture<QList<RegistrationRecord>> AsyncDatabase::getRegistrationPage(const RegistrationQuery &query, int offset, int limit)
+{
+    return run<QList<RegistrationRecord>>(reader, [=](Database *db) {
+        return db->getRegistrationPage(query, offset, limit);
+    });
+}
+
+QFuture<int> AsyncDatabase::getRegistrationCount(int activityId)
+{
+    return run<int>(reader, [=](Database *db) {
+        return db->getRegistrationCount(activityId);
+    });
+}
+
+QFuture<bool> AsyncDatabase::addToWaitlist(int activityId, const QString &studentId, const QString &studentName)
+{
+    return writer->submit<bool>([=](Database *db) {
+        return db->addToWaitlist(activityId, studentId, studentName);
+    });
+}
+
+QFuture<QList<QHash<QString, QVariant>>> AsyncDatabase::getWaitlist(int activityId)
+{
+    return run<QList<QHash<QString, QVariant>>>(reader, [=](Database *db) {
+        return db->getWaitlist(activityId);
+    });
+}
+
+QFuture<bool> AsyncDatabase::promoteFromWaitlist(int activityId)
+{
+    return writer->submit<bool>([=](Database *db) {
+        return db->promoteFromWaitlist(activityId);
+    });
+}
+
+QFuture<int> AsyncDatabase::promoteWaitlist(int activityId)
+{
+    return writer->submit<int>([=](Database *db) {
+        return db->promoteWaitlist(activityId);
+    });
+}
+
+QFuture<bool> AsyncDatabase::updateMaxParticipants(int activityId, int maxParticipants)
+{
+    return writer->submit<bool>([=](Database *db) {
+        return db->updateMaxParticipants(activityId, maxParticipants);
+    });
+}
+
+QFuture<QList<QHash<QString, QVariant>>> AsyncDatabase::checkTimeConflict(const QString &studentId,
+                                                                         const QDateTime &startTime,
+                                                                         const QDateTime &endTime,
+                                                                         int excludeActivityId)
+{
+    return run<QList<QHash<QString, QVariant>>>(reader, [=](Database *db) {
+        return db->checkTimeConflict(studentId, startTime, endTime, excludeActivityId);
+    });
+}
+
+QFuture<QList<QHash<QString, QVariant>>> AsyncDatabase::getStudentApprovedSchedule(const QString &studentId)
+{
+    return run<QList<QHash<QString, QVariant>>>(reader, [=](Database *db) {
+        return db->getStudentApprovedSchedule(studentId);
+    });
+}
+
+QFuture<QList<QHash<QString, QVariant>>> AsyncDatabase::checkLocationConflict(const QString &location,
+                                                                             const QDateTime &startTime,
+                                                                             const QDateTime &endTime,
+                                                                             int excludeActivityId,
+                                                                             bool includePending)
+{
+    return run<QList<QHash<QString, QVariant>>>(reader, [=](Database *db) {
+        return db->checkLocationConflict(location, startTime, endTime, excludeActivityId, includePending);
+    });
+}
+
+QFuture<QList<RoomConflict>> AsyncDatabase::validatePendingLocations()
+{
+    return run<QList<RoomConflict>>(reader, [](Database *db) {
+        return db->validatePendingLocations();
+    });
+}
+
+QFuture<bool> AsyncDatabase::checkIn(int activityId, const QString &studentId, const QString &checkinCode)
+{
+    return writer->submit<bool>([=](Database *db) {
+        return db->checkIn(activityId, studentId, checkinCode);
+    });
+}
+
+QFuture<CheckInResult> AsyncDatabase::tryCheckIn(int activityId, const QString &studentId, const QString &checkinCode)
+{
+    return writer->submit<CheckInResult>([=](Database *db) {
+        return db->tryCheckIn(activityId, studentId, checkinCode);
+    });
+}
+
+QFuture<QStringList> AsyncDatabase::checkInBatch(int activityId, const QList<QPair<QString, QDateTime>> &checkIns)
+{
+    return writer->submit<QStringList>([=](Database *db) {
+        return db->checkInBatch(activityId, checkIns);
+    });
+}
+
+QFuture<CheckInImportResult> AsyncDatabase::importCheckIns(int activityId, const QHash<QString, QDateTime> &scans)
+{
+    // 按批自己开启事务，单独执行
+    return writer->submit<CheckInImportResult>([=](Database *db) {
+        return db->importCheckIns(activityId, scans);
+    }, true);
+}
+
+QFuture<bool> AsyncDatabase::isCheckedIn(int activityId, const QString &studentId)
+{
+    return run<bool>(reader, [=](Database *db) {
+        return db->isCheckedIn(activityId, studentId);
+    });
+}
+
+QFuture<QList<QHash<QString, QVariant>>> AsyncDatabase::getCheckInList(int activityId)
+{
+    return run<QList<QHash<QString, QVariant>>>(reader, [=](Database *db) {
+        return db->getCheckInList(activityId);
+    });
+}
+
+QFuture<QHash<QString, QVariant>> AsyncDatabase::getCheckInStatistics(int activityId)
+{
+    return run<QHash<QString, QVariant>>(reader, [=](Database *db) {
+        return db->getCheckInStatistics(activityId);
+    });
+}
+
+QFuture<bool> AsyncDatabase::syncActivityReminders(int activityId, int leadMinutes)
+{
+    return writer->submit<bool>([=](Database *db) {
+        return db->syncActivityReminders(activityId, leadMinutes);
+    });
+}
+
+QFuture<QDateTime> AsyncDatabase::nextReminderTime()
+{
+    return run<QDateTime>(reader, [](Database *db) {
+        return db->nextReminderTime();
+    });
+}
+
+QFuture<QList<ReminderRecord>> AsyncDatabase::fireDueReminders(const QDateTime &now, int limit)
+{
+    // 内部自己开启事务，不参与组提交
+    return writer->submit<QList<ReminderRecord>>([=](Database *db) {
+        return db->fireDueReminders(now, limit);
+    }, true);
+}
+
+QFuture<QList<ReminderRecord>> AsyncDatabase::getUndeliveredNotifications(int limit)
+{
+    return run<QList<ReminderRecord>>(reader, [limit](Database *db) {
+        return db->getUndeliveredNotifications(limit);
+    });
+}
+
+QFuture<bool> AsyncDatabase::markNotificationsDelivered(const QList<int> &notificationIds)
+{
+    return writer->submit<bool>([=](Database *db) {
+        return db->markNotificationsDelivered(notificationIds);
+    });
+}
+
+QFuture<bool> AsyncDatabase::setLotteryDeadline(int activityId, const QDateTime &deadline)
+{
+    return writer->submit<bool>([=](Database *db) {
+        return db->setLotteryDeadline(activityId, deadline);
+    });
+}
+
+QFuture<bool> AsyncDatabase::submitApplication(int activityId, const QString &studentId, const QString &studentName)
+{
+    // 截止前的申请高峰只是组提交中的单行插入，不读活动、不检查名额
+    return writer->submit<bool>([=](Database *db) {
+        return db->submitApplication(activityId, studentId, studentName);
+    });
+}
+
+QFuture<int> AsyncDatabase::getApplicationCount(int activityId)
+{
+    return run<int>(reader, [=](Database *db) {
+        return db->getApplicationCount(activityId);
+    });
+}
+
+QFuture<QDateTime> AsyncDatabase::nextLotteryDeadline()
+{
+    return run<QDateTime>(reader, [](Database *db) {
+        return db->nextLotteryDeadline();
+    });
+}
+
+QFuture<QList<LotteryResult>> AsyncDatabase::drawDueLotteries(const QDateTime &now)
+{
+    // 内部自己开启事务，不参与组提交
+    return writer->submit<QList<LotteryResult>>([=](Database *db) {
+        return db->drawDueLotteries(now);
+    }, true);
+}
+
+QFuture<QList<QHash<QString, QVariant>>> AsyncDatabase::getOpenMatchRounds()
+{
+    return run<QList<QHash<QString, QVariant>>>(reader, [](Database *db) {
+        return db->getOpenMatchRounds();
+    });
+}
+
+QFuture<bool> AsyncDatabase::submitPreferences(int roundId, const QString &studentId, const QString &studentName,
+                                               const QList<int> &rankedActivityIds, int maxAssignments)
+{
+    return writer->submit<bool>([=](Database *db) {
+        return db->submitPreferences(roundId, studentId, studentName, rankedActivityIds, maxAssignments);
+    });
+}
+
+QFuture<QDateTime> AsyncDatabase::nextMatchCutoff()
+{
+    return run<QDateTime>(reader, [](Database *db) {
+        return db->nextMatchCutoff();
+    });
+}
+
+QFuture<QList<MatchRoundResult>> AsyncDatabase::runDueMatchRounds(const QDateTime &now)
+{
+    // 内部自己开启事务，不参与组提交
+    return writer->submit<QList<MatchRoundResult>>([=](Database *db) {
+        return db->runDueMatchRounds(now);
+    }, true);
+}
+
+QFuture<QHash<QString, QVariant>> AsyncDatabase::getActivityStatistics(int activityId)
+{
+    return run<QHash<QString, QVariant>>(reader, [=](Database *db) {
+        return db->getActivityStatistics(activityId);
+    });
+}
+
+QFuture<QList<QHash<QString, QVariant>>> AsyncDatabase::getAllStatistics(bool includeArchive)
+{
+    return run<QList<QHash<QString, QVariant>>>(reader, [includeArchive](Database *db) {
+        return db->getAllStatistics(includeArchive);
+    });
+}
+
+QFuture<int> AsyncDatabase::archiveFinishedActivities(const QDateTime &cutoff, int batchSize)
+{
+    QSharedPointer<QFutureInterface<int>> promise(new QFutureInterface<int>(), [](QFutureInterface<int> *pending) {
+        if (!pending->isFinished()) {
+            pending->reportCanceled();
+            pending->reportFinished();
+        }
+        delete pending;
+    });
+    promise->reportStarted();
+    QFuture<int> future = promise->future();
+    
+    // 每批作为一个单独的写操作排队（ATTACH 不能在组提交的事务中执行），
+    // 上一批完成后再提交下一批，避免长时间独占写线程
+    batchSize = qMax(1, batchSize);
+    QSharedPointer<int> total(new int(0));
+    QSharedPointer<std::function<void()>> nextBatch(new std::function<void()>());
+    QWeakPointer<std::function<void()>> weakNext = nextBatch;
+    *nextBatch = [this, cutoff, batchSize, promise, total, weakNext]() {
+        // 由等待中的回调持有，链结束时自动释放
+        QSharedPointer<std::function<void()>> self = weakNext.toStrongRef();
+        QFuture<int> batch = writer->submit<int>([cutoff, batchSize](Database *db) {
+            return db->archiveFinishedActivities(cutoff, batchSize);
+        }, true);
+        onFinished(batch, this, [promise, total, batchSize, self](int moved) {
+            if (moved > 0) {
+                *total += moved;
+            }
+            if (moved >= batchSize) {
+                (*self)();
+                return;
+            }
+            promise->reportResult(moved < 0 ? -1 : *total);
+            promise->reportFinished();
+        });
+    };
+    (*nextBatch)();
+    return future;
+}
@@ -0,0 +1,171 @@
+#ifndef ASYNCDATABASE_H
+#define ASYNCDATABASE_H
+
+#include <QObject>
+#include <QFuture>
+#include <QFutureInterface>
+#include <QFutureWatcher>
+#include <QSharedPointer>
+#include "database.h"
+#include "dbexecutor.h"
+#include "groupcommitwriter.h"
+
+// Database 的异步版本：每个读写操作都在后台执行并立即返回 QFuture。
+// 写操作交给单写线程按提交顺序执行，并按组提交合并事务；读操作使用另一个连接，
+// 数据库为预写日志（WAL）模式（见 Database::initializeDatabase），读写互不阻塞，
+// 但读取不保证能看到尚未完成的写入——需要先写后读时，在写操作的结果回调中再发起读取。
+// 写入产生的变更信号会转发到构造时传入的 Database 上，已有的信号连接无需修改。
+class AsyncDatabase : public QObject
+{
+    Q_OBJECT
+
+public:
+    // 登录验证的结果
+    struct LoginResult {
+        bool success = false;
+        UserRole role = UserRole::Student;
+        QString name;
+    };
+
+    // database 必须已完成 initializeDatabase()，后台连接打开同一个数据库文件
+    explicit AsyncDatabase(Database *database, QObject *parent = nullptr);
+    
+    // 写操作的组提交策略，见 GroupCommitWriter::setBatchPolicy
+    void setWriteBatchPolicy(int maxOperations, int maxDelayMs);
+
+    // 在 context 所在线程中处理结果；context 销毁或操作被丢弃时不回调
+    template <typename T, typename Callback>
+    static void onFinished(const QFuture<T> &future, QObject *context, Callback callback)
+    {
+        QFutureWatcher<T> *watcher = new QFutureWatcher<T>(context);
+        QObject::connect(watcher, &QFutureWatcherBase::finished, context, [watcher, callback]() {
+            if (!watcher->isCanceled()) {
+                callback(watcher->result());
+            }
+            watcher->deleteLater();
+        });
+        watcher->setFuture(future);
+    }
+
+    // 用户相关操作
+    QFuture<bool> addUser(const QString &studentId, const QString &password, UserRole role, const QString &name = "");
+    QFuture<LoginResult> authenticateUser(const QString &studentId, const QString &password);
+    QFuture<UserRole> getUserRole(const QString &studentId);
+    QFuture<bool> studentIdExists(const QString &studentId);
+
+    // 活动相关操作
+    QFuture<int> createActivity(const QString &title, const QString &description,
+                                const QString &category, const QString &organizer,
+                                const QDateTime &startTime, const QDateTime &endTime,
+                                int maxParticipants, const QString &location, const QString &checkinCode = "");
+    QFuture<bool> updateActivityStatus(int activityId, ActivityStatus status);
+    QFuture<bool> updateCheckInCode(int activityId, const QString &checkinCode);
+    QFuture<QString> getCheckInCode(int activityId);
+    QFuture<QList<QHash<QString, QVariant>>> getActivities(const QString &filter = "");
+    QFuture<QHash<QString, QVariant>> getActivity(int activityId);
+    QFuture<int> countActivities(const ActivityQuery &query);
+    QFuture<QList<ActivityRecord>> getActivityPage(const ActivityQuery &query, int offset, int limit);
+    QFuture<QVector<ActivitySearchHit>> searchActivities(const ActivityQuery &query);
+    QFuture<bool> applyActivityChanges(const QList<QHash<QString, QVariant>> &changes, const QString &cursor);
+    QFuture<QString> getSyncState(const QString &key, const QString &defaultValue = "");
+    QFuture<bool> setSyncState(const QString &key, const QString &value);
+    QFuture<QList<ActivityRecord>> getLifecycleSchedule();
+    QFuture<int> advanceActivityStatuses(const QList<int> &startingIds, const QList<int> &endingIds, const QDateTime &now);
+
+    // 报名相关操作
+    QFuture<bool> registerActivity(int activityId, const QString &studentId, const QString &studentName);
+    QFuture<bool> cancelRegistration(int activityId, const QString &studentId);
+    QFuture<int> cancelRegistrations(int activityId, const QStringList &studentIds);
+    QFuture<bool> switchRegistrations(int activityId, const QString &studentId, const QString &studentName,
+                                      const QList<int> &droppedActivityIds);
+    QFuture<bool> isRegistered(int activityId, const QString &studentId);
+    QFuture<QList<QHash<QString, QVariant>>> getRegistrations(int activityId);
+    QFuture<QList<QHash<QString, QVariant>>> getStudentRegistrations(const QString &studentId);
+    QFuture<int> countRegistrations(const RegistrationQuery &query);
+    QFuture<QList<RegistrationRecord>> getRegistrationPage(const RegistrationQuery &query, int offset, int limit);
+    QFuture<int> getRegistrationCount(int activityId);
+    QFuture<bool> addToWaitlist(int activityId, const QString &studentId, const QString &studentName);
+    QFuture<QList<QHash<QString, QVariant>>> getWaitlist(int activityId);
+    QFuture<bool> promoteFromWaitlist(int activityId);
+    QFuture<int> promoteWaitlist(int activityId);
+    QFuture<bool> updateMaxParticipants(int activityId, int maxParticipants);
+
+    // 冲突检测
+    QFuture<QList<QHash<QString, QVariant>>> checkTimeConflict(const QString &studentId,
+                                                               const QDateTime &startTime,
+                                                               const QDateTime &endTime,
+                                                               int excludeActivityId = -1);
+    QFuture<QList<QHash<QString, QVariant>>> getStudentApprovedSchedule(const QString &studentId);
+    QFuture<QList<QHash<QString, QVariant>>> checkLocationConflict(const QString &location,
+                                                                   const QDateTime &startTime,
+                                                                   const QDateTime &endTime,
+                                                                   int excludeActivityId = -1,
+                                                                   bool includePending = false);
+    QFuture<QList<RoomConflict>> validatePendingLocations();
+
+    // 签到相关操作
+    QFuture<bool> checkIn(int activityId, const QString &studentId, const QString &checkinCode = "");
+    QFuture<CheckInResult> tryCheckIn(int activityId, const QString &studentId, const QString &checkinCode = "");
+    QFuture<QStringList> checkInBatch(int activityId, const QList<QPair<QString, QDateTime>> &checkIns);
+    QFuture<CheckInImportResult> importCheckIns(int activityId, const QHash<QString, QDateTime> &scans);
+    QFuture<bool> isCheckedIn(int activityId, const QString &studentId);
+    QFuture<QList<QHash<QString, QVariant>>> getCheckInList(int activityId);
+    QFuture<QHash<QString, QVariant>> getCheckInStatistics(int activityId);
+
+    // 活动提醒
+    QFuture<bool> syncActivityReminders(int activityId, int leadMinutes = kDefaultReminderLeadMinutes);
+    QFuture<QDateTime> nextReminderTime();
+    QFuture<QList<ReminderRecord>> fireDueReminders(const QDateTime &now, int limit);
+    QFuture<QList<ReminderRecord>> getUndeliveredNotifications(int limit);
+    QFuture<bool> markNotificationsDelivered(const QList<int> &notificationIds);
+
+    // 抽签报名
+    QFuture<bool> setLotteryDeadline(int activityId, const QDateTime &deadline);
+    QFuture<bool> submitApplication(int activityId, const QString &studentId, const QString &studentName);
+    QFuture<int> getApplicationCount(int activityId);
+    QFuture<QDateTime> nextLotteryDeadline();
+    QFuture<QList<LotteryResult>> drawDueLotteries(const QDateTime &now);
+
+    // 志愿匹配
+    QFuture<QList<QHash<QString, QVariant>>> getOpenMatchRounds();
+    QFuture<bool> submitPreferences(int roundId, const QString &studentId, const QString &studentName,
+                                    const QList<int> &rankedActivityIds, int maxAssignments);
+    QFuture<QDateTime> nextMatchCutoff();
+    QFuture<QList<MatchRoundResult>> runDueMatchRounds(const QDateTime &now);
+
+    // 统计信息
+    QFuture<QHash<QString, QVariant>> getActivityStatistics(int activityId);
+    QFuture<QList<QHash<QString, QVariant>>> getAllStatistics(bool includeArchive = false);
+
+    // 归档：按批移动已结束的旧活动，每批单独提交，批与批之间其他写操作照常执行；
+    // 结果为移动的活动总数；某一批失败时为 -1（之前已提交的批次保留在归档库中）
+    QFuture<int> archiveFinishedActivities(const QDateTime &cutoff, int batchSize = 200);
+
+private:
+    GroupCommitWriter *writer;   // 所有写操作，保证顺序
+    DbExecutor *reader;          // 所有读操作
+
+    // 在 executor 的线程中执行 operation，结果写入返回的 future；
+    // 任务未执行就被丢弃（执行器销毁）时 future 以取消状态结束
+    template <typename T, typename Operation>
+    static QFuture<T> run(DbExecutor *executor, Operation operation)
+    {
+        QSharedPointer<QFutureInterface<T>> promise(new QFutureInterface<T>(), [](QFutureInterface<T> *pending) {
+            if (!pending->isFinished()) {
+                pending->reportCanceled();
+                pending->reportFinished();
+            }
+            delete pending;
+        });
+        promise->reportStarted();
+        QFuture<T> future = promise->future();
+        executor->execute([promise, operation](Database *db) {
+            T result = operation(db);
+            promise->reportResult(result);
+            promise->reportFinished();
+        });
+        return future;
+    }
+};
+
+#endif // ASYNCDATABASE_H
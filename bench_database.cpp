@@ -0,0 +1,638 @@
+/**
+ * 数据库写入压测程序（无界面）
+ *
+ * 模拟报名高峰：按 报名 → 签到 → 取消 的混合顺序提交大量写操作，
+ * 分别以逐条自动提交和组提交两种方式执行，比较每秒写入数和事务数。
+ * 每种方式使用临时目录中的全新数据库文件。
+ *
+ * --mode startup 测量启动时的数据库初始化耗时：首次启动（建库）和
+ * 已是最新结构的数据库再次启动（只读取 user_version）。
+ *
+ * --mode matching 模拟志愿匹配：每个学生从热门程度不均的活动中填写若干志愿（最多参加两个），
+ * 分别测量纯内存匹配计算和完整一轮（读取、匹配、写入报名）的耗时。
+ *
+ * --mode lottery 模拟热门活动抽签：经组提交写入大量抽签申请，再测量一次抽签
+ * （打乱、冲突检测、写入报名和候补）的耗时。相邻两个活动时间重叠，部分学生同时申请两个。
+ *
+ * --mode checkin 模拟大型讲座入场：--ops 个已报名学生依次签到（约 5% 输错签到码、5% 重复签到），
+ * 比较逐项查询再更新（报名、已签到、活动时间和签到码各查一次）与单条条件 UPDATE 的每秒签到数，
+ * 各自分别以逐条自动提交和组提交执行。
+ *
+ * --mode rooms 模拟一个学期（18 周）的场地预订：--activities 个地点、--ops 个活动（一半已批准，
+ * 一半待审批，地点写法大小写、全角、空格不一），测量单次场地冲突查询和一次批量校验的耗时。
+ *
+ * --mode import 模拟导入扫码枪离线记录：--ops 行扫描（约 20% 重复扫描，另有未报名和不存在的学号），
+ * 分别测量读取去重和按批写入的耗时；再导入一次同一文件，确认结果不变。
+ *
+ * 示例：
+ *     bench_database --ops 5000 --activities 10
+ *     bench_database --mode group --batch 128 --delay-ms 5
+ *     bench_database --mode startup --runs 50
+ *     bench_database --mode lottery --ops 50000 --activities 10
+ *     bench_database --mode matching --ops 20000 --activities 500 --prefs 5
+ *     bench_database --mode rooms --ops 20000 --activities 300
+ *     bench_database --mode checkin --ops 500
+ *     bench_database --mode import --ops 50000
+ */
+
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QTemporaryDir>
+#include <QElapsedTimer>
+#include <QTextStream>
+#include <QFuture>
+#include <QList>
+#include "database.h"
+#include "groupcommitwriter.h"
+#include "preferencematcher.h"
+#include "scandumpreader.h"
+#include <QFile>
+#include <random>
+
+struct WriteRunResult {
+    int operations = 0;
+    int succeeded = 0;
+    int transactions = 0;
+    double seconds = 0.0;
+};
+
+// 准备数据库：若干已开始（可签到）的已批准活动，容量足够容纳全部报名
+static bool prepareDatabase(const QString &path, int activityCount, int capacity, QList<int> &activityIds)
+{
+    Database setup(QString("bench_setup_%1").arg(path), path);
+    if (!setup.initializeDatabase()) {
+        return false;
+    }
+    QDateTime start = QDateTime::currentDateTime().addSecs(-3600);
+    for (int i = 0; i < activityCount; ++i) {
+        int id = setup.createActivity(QString("压测活动%1").arg(i + 1), "组提交压测", "学术讲座", "bench",
+                                      start, start.addSecs(4 * 3600), capacity, "图书馆报告厅");
+        if (id <= 0 || !setup.updateActivityStatus(id, ActivityStatus::Approved)) {
+            return false;
+        }
+        activityIds.append(id);
+    }
+    return true;
+}
+
+// 启动耗时：每次使用新的连接打开同一个文件并初始化，与应用启动时相同
+static double initializeMs(const QString &path, int run)
+{
+    QElapsedTimer timer;
+    timer.start();
+    Database db(QString("bench_startup_%1").arg(run), path);
+    if (!db.initializeDatabase()) {
+        return -1.0;
+    }
+    return timer.nsecsElapsed() / 1e6;
+}
+
+static int runStartup(const QString &path, int runs, QTextStream &out)
+{
+    double first = initializeMs(path, 0);
+    if (first < 0) {
+        out << "初始化数据库失败：" << path << "\n";
+        return 1;
+    }
+
+    double total = 0.0;
+    double worst = 0.0;
+    for (int i = 1; i <= runs; ++i) {
+        double ms = initializeMs(path, i);
+        if (ms < 0) {
+            out << "初始化数据库失败：" << path << "\n";
+            return 1;
+        }
+        total += ms;
+        worst = qMax(worst, ms);
+    }
+    out << QString("首次启动（建库）: %1 ms\n").arg(first, 0, 'f', 2);
+    out << QString("再次启动 x%1: 平均 %2 ms  最慢 %3 ms\n")
+           .arg(runs).arg(total / runs, 0, 'f', 3).arg(worst, 0, 'f', 3);
+    return 0;
+}
+
+static int runMatching(const QString &path, int studentCount, int activityCount, int prefCount, QTextStream &out)
+{
+    // 活动分布在 50 个时间段中，相邻时间段重叠；名额合计约为学生数
+    std::mt19937 rng(20240501);
+    const int capacity = qMax(1, studentCount / activityCount);
+    const QDateTime base = QDateTime::currentDateTime().addDays(2);
+    const QDateTime cutoff = QDateTime::currentDateTime().addSecs(3600);
+    QVector<PreferenceMatcher::Activity> activities;
+    QList<int> activityIds;
+    QVector<QList<int>> choices(studentCount);   // 活动下标，按志愿顺序
+
+    Database setup("bench_matching_setup", path);
+    if (!setup.initializeDatabase() || !setup.executeStatement("BEGIN")) {
+        out << "初始化数据库失败：" << path << "\n";
+        return 1;
+    }
+    for (int i = 0; i < activityCount; ++i) {
+        QDateTime start = base.addSecs((i % 50) * 2 * 3600);
+        int id = setup.createActivity(QString("工作坊%1").arg(i + 1), "志愿匹配压测", "工作坊", "bench",
+                                      start, start.addSecs(3 * 3600), capacity, "教学楼");
+        if (id <= 0 || !setup.updateActivityStatus(id, ActivityStatus::Approved)) {
+            out << "准备活动失败\n";
+            return 1;
+        }
+        PreferenceMatcher::Activity activity;
+        activity.capacity = capacity;
+        activity.start = start.toMSecsSinceEpoch();
+        activity.end = start.addSecs(3 * 3600).toMSecsSinceEpoch();
+        activities.append(activity);
+        activityIds.append(id);
+    }
+    int roundId = setup.createMatchRound("压测轮次", cutoff, "bench");
+    if (roundId <= 0) {
+        out << "创建匹配轮次失败\n";
+        return 1;
+    }
+
+    // 热门程度不均：下标越小越热门
+    std::uniform_real_distribution<double> unit(0.0, 1.0);
+    for (int s = 0; s < studentCount; ++s) {
+        QList<int> &list = choices[s];
+        while (list.size() < qMin(prefCount, activityCount)) {
+            double r = unit(rng);
+            int index = qMin(activityCount - 1, static_cast<int>(activityCount * r * r));
+            if (!list.contains(index)) {
+                list.append(index);
+            }
+        }
+        QList<int> ids;
+        for (int index : list) {
+            ids.append(activityIds.at(index));
+        }
+        if (!setup.submitPreferences(roundId, QString("mat_%1").arg(s, 6, 10, QChar('0')), "压测学生", ids, 2)) {
+            out << "提交志愿失败\n";
+            return 1;
+        }
+    }
+    if (!setup.executeStatement("COMMIT")) {
+        out << "提交准备数据失败\n";
+        return 1;
+    }
+
+    // 纯内存匹配（与数据库中的轮次相同的输入，优先级按学生顺序）
+    QVector<PreferenceMatcher::Student> students(studentCount);
+    for (int s = 0; s < studentCount; ++s) {
+        students[s].maxAssignments = 2;
+        students[s].priority = static_cast<quint32>(s);
+        for (int index : choices[s]) {
+            students[s].preferences.append(index);
+        }
+    }
+    QElapsedTimer timer;
+    timer.start();
+    PreferenceMatcher matcher(activities, students);
+    matcher.run();
+    double matchSeconds = timer.nsecsElapsed() / 1e9;
+
+    timer.restart();
+    QList<MatchRoundResult> results = setup.runDueMatchRounds(cutoff);
+    double roundSeconds = timer.nsecsElapsed() / 1e9;
+    if (results.isEmpty()) {
+        out << "匹配失败\n";
+        return 1;
+    }
+
+    out << QString("学生 %1  活动 %2  每人志愿 %3  每活动名额 %4\n")
+           .arg(studentCount).arg(activityCount).arg(prefCount).arg(capacity);
+    out << QString("匹配计算: 申请 %1 次  分配 %2  耗时 %3 s\n")
+           .arg(matcher.proposals()).arg(matcher.totalAssignments()).arg(matchSeconds, 0, 'f', 3);
+    out << QString("完整一轮（读取、匹配、写入）: 分配 %1  耗时 %2 s\n")
+           .arg(results.first().assignments).arg(roundSeconds, 0, 'f', 3);
+    return 0;
+}
+
+static int runCheckIn(const QString &dirPath, int studentCount, int maxOperations, int maxDelayMs, QTextStream &out)
+{
+    const QString code = "123456";
+    // 逐项查询：与原先的签到流程相同的四次访问
+    auto legacyCheckIn = [](Database *db, int activityId, const QString &studentId, const QString &input) {
+        if (!db->isRegistered(activityId, studentId)) {
+            return CheckInResult::NotRegistered;
+        }
+        if (db->isCheckedIn(activityId, studentId)) {
+            return CheckInResult::AlreadyCheckedIn;
+        }
+        QHash<QString, QVariant> activity = db->getActivity(activityId);
+        if (QDateTime::currentDateTime() < activity["start_time"].toDateTime()) {
+            return CheckInResult::TooEarly;
+        }
+        if (input != activity["checkin_code"].toString()) {
+            return CheckInResult::WrongCode;
+        }
+        return db->tryCheckIn(activityId, studentId, input);
+    };
+
+    const QList<QPair<QString, bool>> paths = {{"逐项查询", false}, {"条件UPDATE", true}};
+    const QList<QPair<QString, int>> commits = {{"autocommit", 1}, {"group", qMax(2, maxOperations)}};
+    for (const auto &path : paths) {
+        for (const auto &commit : commits) {
+            QString file = QString("%1/checkin_%2_%3.db").arg(dirPath).arg(path.second).arg(commit.second);
+            int activityId = -1;
+            {
+                Database setup(QString("bench_checkin_setup_%1").arg(file), file);
+                QDateTime start = QDateTime::currentDateTime().addSecs(-600);
+                if (!setup.initializeDatabase()) {
+                    out << "初始化数据库失败：" << file << "\n";
+                    return 1;
+                }
+                activityId = setup.createActivity("大型讲座", "签到压测", "学术讲座", "bench", start,
+                                                  start.addSecs(2 * 3600), studentCount, "大礼堂", code);
+                if (activityId <= 0 || !setup.updateActivityStatus(activityId, ActivityStatus::Approved)
+                    || !setup.executeStatement("BEGIN")) {
+                    out << "准备活动失败\n";
+                    return 1;
+                }
+                for (int i = 0; i < studentCount; ++i) {
+                    setup.registerActivity(activityId, QString("door_%1").arg(i, 6, 10, QChar('0')), "压测学生");
+                }
+                if (!setup.executeStatement("COMMIT")) {
+                    out << "提交准备数据失败\n";
+                    return 1;
+                }
+            }
+
+            GroupCommitWriter writer(file);
+            writer.setBatchPolicy(commit.second, maxDelayMs);
+            QList<QFuture<CheckInResult>> futures;
+            QElapsedTimer timer;
+            timer.start();
+            for (int i = 0; i < studentCount; ++i) {
+                // 每 20 人中一人先输错签到码，另一人重复刷一次
+                int attempts = (i % 20 == 0 || i % 20 == 1) ? 2 : 1;
+                for (int attempt = 0; attempt < attempts; ++attempt) {
+                    QString studentId = QString("door_%1").arg(i, 6, 10, QChar('0'));
+                    QString input = (i % 20 == 0 && attempt == 0) ? QString("000000") : code;
+                    bool fast = path.second;
+                    futures.append(writer.submit<CheckInResult>([=](Database *db) {
+                        return fast ? db->tryCheckIn(activityId, studentId, input)
+                                    : legacyCheckIn(db, activityId, studentId, input);
+                    }));
+                }
+            }
+
+            QHash<int, int> counts;
+            for (QFuture<CheckInResult> &future : futures) {
+                future.waitForFinished();
+                counts[static_cast<int>(future.result())]++;
+            }
+            double seconds = timer.nsecsElapsed() / 1e9;
+            int success = counts.value(static_cast<int>(CheckInResult::Success));
+            out << QString("%1 %2: 尝试 %3  成功 %4  签到码错误 %5  重复 %6  事务 %7  耗时 %8 s  %9 人/秒\n")
+                   .arg(path.first, -10).arg(commit.first, -10).arg(futures.size()).arg(success)
+                   .arg(counts.value(static_cast<int>(CheckInResult::WrongCode)))
+                   .arg(counts.value(static_cast<int>(CheckInResult::AlreadyCheckedIn)))
+                   .arg(writer.committedTransactions()).arg(seconds, 0, 'f', 3)
+                   .arg(seconds > 0 ? success / seconds : 0.0, 0, 'f', 0);
+        }
+    }
+    return 0;
+}
+
+static int runImport(const QString &dirPath, int lineCount, QTextStream &out)
+{
+    // 每 5 行一行是重复扫描；其余学号中 1/50 未报名、1/50 不存在
+    const int studentCount = qMax(1, lineCount * 4 / 5);
+    QString file = QString("%1/import.db").arg(dirPath);
+    Database db(QString("bench_import_%1").arg(file), file);
+    QDateTime start = QDateTime::currentDateTime().addSecs(-3600);
+    if (!db.initializeDatabase()) {
+        out << "初始化数据库失败：" << file << "\n";
+        return 1;
+    }
+    int activityId = db.createActivity("迎新大会", "离线签到导入压测", "学术讲座", "bench", start,
+                                       start.addSecs(3 * 3600), studentCount, "体育馆", "123456");
+    if (activityId <= 0 || !db.executeStatement("BEGIN")) {
+        out << "准备活动失败\n";
+        return 1;
+    }
+    for (int i = 0; i < studentCount; ++i) {
+        QString studentId = QString("scan_%1").arg(i, 6, 10, QChar('0'));
+        if (i % 50 == 1) {
+            db.addUser(studentId, "bench", UserRole::Student, "压测学生");
+        } else if (i % 50 != 2) {
+            db.registerActivity(activityId, studentId, "压测学生");
+        }
+    }
+    if (!db.executeStatement("COMMIT")) {
+        out << "提交准备数据失败\n";
+        return 1;
+    }
+
+    QString dumpName = QString("%1/scanner.csv").arg(dirPath);
+    {
+        QFile dumpFile(dumpName);
+        if (!dumpFile.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+            out << "无法写入扫码文件\n";
+            return 1;
+        }
+        QTextStream dump(&dumpFile);
+        dump << "student_id,scanned_at\n";
+        QDateTime base = QDateTime::currentDateTime().addSecs(-3000);
+        std::mt19937 rng(20240901);
+        for (int i = 0; i < lineCount; ++i) {
+            int student = (i % 5 == 4) ? static_cast<int>(rng() % studentCount) : (i - i / 5);
+            student = qMin(student, studentCount - 1);
+            QDateTime scannedAt = base.addMSecs(static_cast<qint64>(i) * 37);
+            dump << QString("scan_%1").arg(student, 6, 10, QChar('0')) << ','
+                 << scannedAt.toString("yyyy-MM-dd HH:mm:ss.zzz") << '\n';
+        }
+    }
+
+    for (int round = 1; round <= 2; ++round) {
+        QElapsedTimer timer;
+        timer.start();
+        ScanDump dump;
+        if (!ScanDumpReader::read(dumpName, dump)) {
+            out << "读取扫码文件失败：" << dump.error << "\n";
+            return 1;
+        }
+        double readMs = timer.nsecsElapsed() / 1e6;
+        timer.restart();
+        CheckInImportResult result = db.importCheckIns(activityId, dump.earliest);
+        double writeMs = timer.nsecsElapsed() / 1e6;
+        out << QString("第 %1 次导入: 行 %2  扫描 %3  重复 %4  学生 %5  读取 %6 ms  "
+                       "写入 %7  未变 %8  未报名 %9  不存在 %10  事务 %11  写入耗时 %12 ms%13\n")
+               .arg(round).arg(dump.lines).arg(dump.scans).arg(dump.duplicates).arg(dump.earliest.size())
+               .arg(readMs, 0, 'f', 1).arg(result.applied).arg(result.unchanged)
+               .arg(result.unregistered.size()).arg(result.unknown.size()).arg(result.transactions)
+               .arg(writeMs, 0, 'f', 1).arg(result.success ? "" : "  （失败）");
+    }
+    return 0;
+}
+
+static int runRooms(const QString &path, int bookingCount, int roomCount, QTextStream &out)
+{
+    std::mt19937 rng(20240901);
+    std::uniform_int_distribution<int> roomDist(0, roomCount - 1);
+    std::uniform_int_distribution<int> dayDist(0, 18 * 7 - 1);
+    std::uniform_int_distribution<int> hourDist(8, 20);
+    std::uniform_int_distribution<int> lengthDist(1, 3);
+    // 同一地点的几种写法，规范化后相同
+    auto spelling = [](int room, int variant) {
+        QString building = QString("%1栋").arg(QChar('A' + room % 6));
+        QString number = QString::number(101 + room / 6);
+        switch (variant % 3) {
+        case 0: return building + number;
+        case 1: return building.toLower() + " " + number;
+        default: return QString(QChar(building.at(0).unicode() + 0xFEE0)) + building.mid(1) + "-" + number;  // 全角字母
+        }
+    };
+    const QDateTime termStart = QDateTime::currentDateTime().addDays(1);
+    QVector<QPair<int, QPair<QDateTime, QDateTime>>> probes;   // 地点、时间段，用于单次查询
+
+    Database setup("bench_rooms_setup", path);
+    if (!setup.initializeDatabase() || !setup.executeStatement("BEGIN")) {
+        out << "初始化数据库失败：" << path << "\n";
+        return 1;
+    }
+    for (int i = 0; i < bookingCount; ++i) {
+        int room = roomDist(rng);
+        QDateTime start = termStart.addDays(dayDist(rng));
+        start.setTime(QTime(hourDist(rng), 0));
+        QDateTime end = start.addSecs(lengthDist(rng) * 3600);
+        int id = setup.createActivity(QString("场地压测%1").arg(i + 1), "场地冲突压测", "讲座", "bench",
+                                      start, end, 50, spelling(room, i));
+        if (id <= 0 || (i % 2 == 0 && !setup.updateActivityStatus(id, ActivityStatus::Approved))) {
+            out << "准备活动失败\n";
+            return 1;
+        }
+        if (probes.size() < 1000) {
+            probes.append(qMakePair(room, qMakePair(start, end)));
+        }
+    }
+    if (!setup.executeStatement("COMMIT")) {
+        out << "提交准备数据失败\n";
+        return 1;
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+    int found = 0;
+    for (int i = 0; i < probes.size(); ++i) {
+        found += setup.checkLocationConflict(spelling(probes[i].first, i + 1), probes[i].second.first,
+                                             probes[i].second.second, -1, true).size();
+    }
+    double probeUs = probes.isEmpty() ? 0.0 : timer.nsecsElapsed() / 1e3 / probes.size();
+
+    timer.restart();
+    QList<RoomConflict> conflicts = setup.validatePendingLocations();
+    double validateMs = timer.nsecsElapsed() / 1e6;
+
+    out << QString("地点 %1  活动 %2（一半待审批）  学期 18 周\n").arg(roomCount).arg(bookingCount);
+    out << QString("单次场地冲突查询: %1 次  平均 %2 us  命中 %3\n")
+           .arg(probes.size()).arg(probeUs, 0, 'f', 1).arg(found);
+    out << QString("批量校验待审批活动: 冲突 %1 处  耗时 %2 ms\n")
+           .arg(conflicts.size()).arg(validateMs, 0, 'f', 1);
+    return 0;
+}
+
+static int runLottery(const QString &path, int applicationCount, int activityCount, QTextStream &out)
+{
+    QList<int> activityIds;
+    QDateTime deadline = QDateTime::currentDateTime().addSecs(3600);
+    {
+        Database setup("bench_lottery_setup", path);
+        if (!setup.initializeDatabase()) {
+            out << "初始化数据库失败：" << path << "\n";
+            return 1;
+        }
+        // 名额约为申请数的四分之一；活动两两时间重叠
+        int capacity = qMax(1, applicationCount / (activityCount * 4));
+        QDateTime base = QDateTime::currentDateTime().addDays(1);
+        for (int i = 0; i < activityCount; ++i) {
+            QDateTime start = base.addSecs((i / 2) * 5 * 3600);
+            int id = setup.createActivity(QString("抽签活动%1").arg(i + 1), "抽签压测", "文体活动", "bench",
+                                          start, start.addSecs(3 * 3600), capacity, "体育馆");
+            if (id <= 0 || !setup.updateActivityStatus(id, ActivityStatus::Approved)
+                || !setup.setLotteryDeadline(id, deadline)) {
+                out << "准备活动失败\n";
+                return 1;
+            }
+            activityIds.append(id);
+        }
+    }
+
+    int submitted = 0;
+    QElapsedTimer timer;
+    timer.start();
+    {
+        GroupCommitWriter writer(path);
+        writer.setBatchPolicy(256, 5);
+        QList<QFuture<bool>> futures;
+        // 前三分之二为不同学生的申请；其余三分之一由其中的学生再申请相邻（时间重叠）的活动
+        const int firstRound = applicationCount - applicationCount / 3;
+        for (int i = 0; i < applicationCount; ++i) {
+            int student = i < firstRound ? i : i - firstRound;
+            int index = student % activityIds.size();
+            if (i >= firstRound && (index ^ 1) < activityIds.size()) {
+                index ^= 1;
+            }
+            int activityId = activityIds.at(index);
+            QString studentId = QString("lot_%1").arg(student, 6, 10, QChar('0'));
+            futures.append(writer.submit<bool>([=](Database *db) {
+                return db->submitApplication(activityId, studentId, "压测学生");
+            }));
+        }
+        for (QFuture<bool> &future : futures) {
+            future.waitForFinished();
+            if (future.result()) {
+                submitted++;
+            }
+        }
+    }
+    double submitSeconds = timer.nsecsElapsed() / 1e9;
+
+    Database drawDb("bench_lottery_draw", path);
+    if (!drawDb.open()) {
+        out << "打开数据库失败：" << path << "\n";
+        return 1;
+    }
+    timer.restart();
+    QList<LotteryResult> results = drawDb.drawDueLotteries(deadline);
+    double drawSeconds = timer.nsecsElapsed() / 1e9;
+
+    int winners = 0;
+    int waitlisted = 0;
+    for (const LotteryResult &result : results) {
+        winners += result.winners;
+        waitlisted += result.waitlisted;
+    }
+    out << QString("提交申请: %1（成功 %2）  耗时 %3 s\n")
+           .arg(applicationCount).arg(submitted).arg(submitSeconds, 0, 'f', 3);
+    out << QString("抽签: 活动 %1  中签 %2  候补 %3  耗时 %4 s\n")
+           .arg(results.size()).arg(winners).arg(waitlisted).arg(drawSeconds, 0, 'f', 3);
+    return results.size() == activityIds.size() ? 0 : 1;
+}
+
+static WriteRunResult runWrites(const QString &path, const QList<int> &activityIds, int studentCount,
+                                int maxOperations, int maxDelayMs)
+{
+    WriteRunResult result;
+    GroupCommitWriter writer(path);
+    writer.setBatchPolicy(maxOperations, maxDelayMs);
+
+    QList<QFuture<bool>> futures;
+    QElapsedTimer timer;
+    timer.start();
+
+    for (int i = 0; i < studentCount; ++i) {
+        int activityId = activityIds.at(i % activityIds.size());
+        QString studentId = QString("bench_%1").arg(i, 6, 10, QChar('0'));
+        futures.append(writer.submit<bool>([=](Database *db) {
+            return db->registerActivity(activityId, studentId, "压测学生");
+        }));
+        if (i % 4 == 0) {
+            futures.append(writer.submit<bool>([=](Database *db) {
+                return db->checkIn(activityId, studentId);
+            }));
+        }
+        if (i % 10 == 9) {
+            futures.append(writer.submit<bool>([=](Database *db) {
+                return db->cancelRegistration(activityId, studentId);
+            }));
+        }
+    }
+
+    // 写操作按顺序执行，等到最后一个完成即全部完成
+    for (QFuture<bool> &future : futures) {
+        future.waitForFinished();
+        if (future.result()) {
+            result.succeeded++;
+        }
+    }
+    result.seconds = timer.nsecsElapsed() / 1e9;
+    result.operations = futures.size();
+    result.transactions = writer.committedTransactions();
+    return result;
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QTextStream out(stdout);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("数据库压测：逐条自动提交 vs 组提交，以及启动初始化耗时");
+    parser.addHelpOption();
+    parser.addOptions({
+        {"ops", "报名学生数（默认 5000，另有约 35% 的签到和取消操作）", "n", "5000"},
+        {"activities", "活动数（默认 10）", "n", "10"},
+        {"mode", "执行方式：autocommit / group / both / startup / lottery / matching / rooms / checkin / import（默认 both）", "mode", "both"},
+        {"batch", "组提交每批最多写操作数（默认 64）", "n", "64"},
+        {"delay-ms", "组提交凑批最长等待时间（毫秒，默认 2）", "ms", "2"},
+        {"runs", "startup 模式下再次启动的次数（默认 20）", "n", "20"},
+        {"prefs", "matching 模式下每个学生的志愿数（默认 5）", "n", "5"},
+    });
+    parser.process(app);
+
+    const int studentCount = qMax(1, parser.value("ops").toInt());
+    const int activityCount = qMax(1, parser.value("activities").toInt());
+    const QString mode = parser.value("mode");
+
+    QTemporaryDir dir;
+    if (!dir.isValid()) {
+        out << "无法创建临时目录\n";
+        return 1;
+    }
+
+    if (mode == "startup") {
+        return runStartup(dir.filePath("startup.db"), qMax(1, parser.value("runs").toInt()), out);
+    }
+
+    if (mode == "matching") {
+        return runMatching(dir.filePath("matching.db"), studentCount, activityCount,
+                           qMax(1, parser.value("prefs").toInt()), out);
+    }
+    if (mode == "lottery") {
+        return runLottery(dir.filePath("lottery.db"), studentCount, activityCount, out);
+    }
+    if (mode == "checkin") {
+        return runCheckIn(dir.path(), studentCount, parser.value("batch").toInt(),
+                          parser.value("delay-ms").toInt(), out);
+    }
+    if (mode == "rooms") {
+        return runRooms(dir.filePath("rooms.db"), studentCount, activityCount, out);
+    }
+    if (mode == "import") {
+        return runImport(dir.path(), studentCount, out);
+    }
+
+    QList<QPair<QString, int>> runs;  // 名称、每批最多写操作数
+    if (mode == "autocommit" || mode == "both") {
+        runs.append(qMakePair(QString("autocommit"), 1));
+    }
+    if (mode == "group" || mode == "both") {
+        runs.append(qMakePair(QString("group"), qMax(2, parser.value("batch").toInt())));
+    }
+
+    double baselineRate = 0.0;
+    for (const auto &run : runs) {
+        QString path = dir.filePath(run.first + ".db");
+        QList<int> activityIds;
+        if (!prepareDatabase(path, activityCount, studentCount, activityIds)) {
+            out << "准备数据库失败：" << path << "\n";
+            return 1;
+        }
+
+        WriteRunResult result = runWrites(path, activityIds, studentCount, run.second,
+                                          parser.value("delay-ms").toInt());
+        double rate = result.seconds > 0 ? result.operations / result.seconds : 0.0;
+        out << QString("%1: 写操作 %2（成功 %3）  事务 %4  耗时 %5 s  吞吐 %6 写/秒")
+               .arg(run.first, -10).arg(result.operations).arg(result.succeeded)
+               .arg(result.transactions).arg(result.seconds, 0, 'f', 3).arg(rate, 0, 'f', 0);
+        if (baselineRate > 0) {
+            out << QString("  （%1 倍）").arg(rate / baselineRate, 0, 'f', 1);
+        } else {
+            baselineRate = rate;
+        }
+        out << "\n";
+        out.flush();
+    }
+
+    return 0;
+}
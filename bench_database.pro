@@ -0,0 +1,30 @@
+QT       += core sql
+QT       -= gui
+
+CONFIG += c++11 console
+CONFIG -= app_bundle
+
+# 数据库写入压测程序目标名称（无界面）
+TARGET = bench_database
+
+# 压测程序源文件
+SOURCES += \
+    bench_database.cpp \
+    groupcommitwriter.cpp \
+    database.cpp \
+    preferencematcher.cpp \
+    roomindex.cpp \
+    scandumpreader.cpp
+
+# 压测程序头文件
+HEADERS += \
+    groupcommitwriter.h \
+    database.h \
+    preferencematcher.h \
+    roomindex.h \
+    scandumpreader.h
+
+# Default rules for deployment.
+qnx: target.path = /tmp/$${TARGET}/bin
+else: unix:!android: target.path = /opt/$${TARGET}/bin
+!isEmpty(target.path): INSTALLS += target
@@ -0,0 +1,249 @@
+/**
+ * NetworkManager 压测程序（无界面）
+ *
+ * 以固定并发数循环发起活动类别请求和活动同步请求，统计
+ * p50/p95/p99 延迟、每秒请求数、建立的连接数以及各类失败原因。
+ *
+ * 默认使用进程内的 QTcpServer 模拟服务器，可注入延迟和错误；
+ * 也可以通过 --url 指向 test_server.py（配合 INJECT_DELAY_MS / INJECT_ERROR_RATE）。
+ *
+ * 示例：
+ *     bench_network --requests 2000 --concurrency 64 --delay-ms 20 --error-rate 0.05
+ *     bench_network --url http://localhost:8090/api --mix sync --encoding cbor --gzip
+ */
+
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QTimer>
+#include <QElapsedTimer>
+#include <QRandomGenerator>
+#include <QPointer>
+#include <QTextStream>
+#include <QDateTime>
+#include <QHash>
+#include <QVector>
+#include <algorithm>
+#include "networkmanager.h"
+
+// 进程内HTTP模拟服务器：支持keep-alive，按配置注入延迟和503错误
+struct MockServerConfig {
+    int delayMs = 0;
+    int jitterMs = 0;
+    double errorRate = 0.0;
+};
+
+static void startMockServer(QTcpServer *server, const MockServerConfig &config, int *connectionsOpened)
+{
+    QObject::connect(server, &QTcpServer::newConnection, server, [server, config, connectionsOpened]() {
+        while (QTcpSocket *socket = server->nextPendingConnection()) {
+            (*connectionsOpened)++;
+            QObject::connect(socket, &QTcpSocket::disconnected, socket, &QObject::deleteLater);
+            QObject::connect(socket, &QTcpSocket::readyRead, socket, [socket, config]() {
+                QByteArray buffer = socket->property("buffer").toByteArray() + socket->readAll();
+
+                int headerEnd;
+                while ((headerEnd = buffer.indexOf("\r\n\r\n")) >= 0) {
+                    QByteArray header = buffer.left(headerEnd);
+                    int contentLength = 0;
+                    for (const QByteArray &line : header.split('\n')) {
+                        if (line.toLower().startsWith("content-length:")) {
+                            contentLength = line.mid(15).trimmed().toInt();
+                        }
+                    }
+                    if (buffer.size() < headerEnd + 4 + contentLength) {
+                        break; // 请求体尚未收全
+                    }
+
+                    QByteArray requestLine = header.left(header.indexOf("\r\n"));
+                    buffer.remove(0, headerEnd + 4 + contentLength);
+
+                    bool fail = config.errorRate > 0 && QRandomGenerator::global()->bounded(1.0) < config.errorRate;
+                    QByteArray body;
+                    QByteArray status = "200 OK";
+                    if (fail) {
+                        status = "503 Service Unavailable";
+                        body = "{\"success\":false,\"message\":\"injected error\"}";
+                    } else if (requestLine.contains("/categories")) {
+                        body = "[{\"name\":\"学术讲座\"},{\"name\":\"文体活动\"},{\"name\":\"社会实践\"},"
+                               "{\"name\":\"志愿服务\"},{\"name\":\"竞赛活动\"},{\"name\":\"其他\"}]";
+                    } else {
+                        body = "{\"success\":true,\"message\":\"ok\"}";
+                    }
+
+                    QByteArray response = "HTTP/1.1 " + status + "\r\n"
+                        "Content-Type: application/json\r\n"
+                        "Connection: keep-alive\r\n"
+                        "Content-Length: " + QByteArray::number(body.size()) + "\r\n\r\n" + body;
+
+                    int delay = config.delayMs;
+                    if (config.jitterMs > 0) {
+                        delay += QRandomGenerator::global()->bounded(config.jitterMs + 1);
+                    }
+                    QPointer<QTcpSocket> guard(socket);
+                    QTimer::singleShot(delay, socket, [guard, response]() {
+                        if (guard) guard->write(response);
+                    });
+                }
+                socket->setProperty("buffer", buffer);
+            });
+        }
+    });
+}
+
+static int percentile(const QVector<int> &sorted, double p)
+{
+    if (sorted.isEmpty()) return 0;
+    int index = static_cast<int>(p / 100.0 * sorted.size() + 0.5) - 1;
+    return sorted[qBound(0, index, sorted.size() - 1)];
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QTextStream out(stdout);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("NetworkManager 吞吐量与延迟压测");
+    parser.addHelpOption();
+    parser.addOptions({
+        {"url", "目标服务器基础地址（默认使用进程内模拟服务器）", "url"},
+        {"requests", "请求总数（默认 1000）", "n", "1000"},
+        {"concurrency", "并发请求数（默认 32）", "n", "32"},
+        {"mix", "请求类型：categories / sync / both（默认 both）", "mix", "both"},
+        {"delay-ms", "模拟服务器响应延迟（毫秒）", "ms", "0"},
+        {"jitter-ms", "模拟服务器随机附加延迟上限（毫秒）", "ms", "0"},
+        {"error-rate", "模拟服务器返回503的概率（0~1）", "p", "0"},
+        {"timeout-ms", "单个请求超时（毫秒，默认 5000）", "ms", "5000"},
+        {"breaker-threshold", "熔断器连续失败阈值（默认 5）", "n", "5"},
+        {"breaker-cooldown-ms", "熔断器冷却时间（默认 1000）", "ms", "1000"},
+        {"encoding", "同步负载编码：indented / compact / cbor（默认 compact）", "enc", "compact"},
+        {"gzip", "压缩同步请求体"},
+    });
+    parser.process(app);
+
+    const int totalRequests = qMax(1, parser.value("requests").toInt());
+    const int concurrency = qMax(1, parser.value("concurrency").toInt());
+    const QString mix = parser.value("mix");
+
+    // 准备服务器
+    QTcpServer mockServer;
+    int connectionsOpened = 0;
+    QString baseUrl = parser.value("url");
+    if (baseUrl.isEmpty()) {
+        MockServerConfig config;
+        config.delayMs = parser.value("delay-ms").toInt();
+        config.jitterMs = parser.value("jitter-ms").toInt();
+        config.errorRate = parser.value("error-rate").toDouble();
+        startMockServer(&mockServer, config, &connectionsOpened);
+        if (!mockServer.listen(QHostAddress::LocalHost, 0)) {
+            out << "无法启动模拟服务器：" << mockServer.errorString() << "\n";
+            return 1;
+        }
+        baseUrl = QString("http://127.0.0.1:%1/api").arg(mockServer.serverPort());
+    }
+
+    NetworkManager network;
+    network.setBaseUrl(baseUrl);
+    network.setLogLevel(NetworkManager::LogLevel::Quiet);
+    network.setEndpointTimeout("categories", parser.value("timeout-ms").toInt());
+    network.setEndpointTimeout("sync", parser.value("timeout-ms").toInt());
+    network.setCircuitBreakerPolicy(parser.value("breaker-threshold").toInt(),
+                                    parser.value("breaker-cooldown-ms").toInt());
+
+    QString encoding = parser.value("encoding");
+    network.setPayloadEncoding(encoding == "cbor" ? NetworkManager::PayloadEncoding::Cbor
+                               : encoding == "indented" ? NetworkManager::PayloadEncoding::IndentedJson
+                               : NetworkManager::PayloadEncoding::CompactJson);
+    network.setCompression(parser.isSet("gzip") ? NetworkManager::Compression::Gzip
+                                                : NetworkManager::Compression::Off);
+
+    QHash<QString, QVariant> activity;
+    activity["title"] = "压测活动";
+    activity["description"] = "用于测量同步请求吞吐量的活动，描述字段保持一定长度以体现压缩效果。";
+    activity["category"] = "学术讲座";
+    activity["organizer"] = "bench";
+    activity["start_time"] = QDateTime::currentDateTime();
+    activity["end_time"] = QDateTime::currentDateTime().addSecs(7200);
+    activity["max_participants"] = 100;
+    activity["location"] = "图书馆报告厅";
+    activity["status"] = 1;
+
+    int issued = 0;
+    int completed = 0;
+    QHash<QString, QVector<int>> latencies;  // 按端点记录成功请求的延迟
+    QHash<QString, int> failures;            // 按原因统计失败次数
+    QElapsedTimer wallClock;
+
+    auto issueNext = [&]() {
+        if (issued >= totalRequests) return;
+        int index = issued++;
+        bool useSync = mix == "sync" || (mix == "both" && index % 2 == 1);
+        if (useSync) {
+            network.syncActivityToPlatform(index + 1, activity);
+        } else {
+            network.fetchActivityCategories();
+        }
+    };
+
+    QObject::connect(&network, &NetworkManager::requestFinished, &app,
+                     [&](const QString &endpoint, int elapsedMs, const QString &reason) {
+        completed++;
+        if (reason.isEmpty()) {
+            latencies[endpoint].append(elapsedMs);
+        } else {
+            failures[reason]++;
+        }
+
+        if (completed >= totalRequests) {
+            QTimer::singleShot(0, &app, &QCoreApplication::quit);
+            return;
+        }
+        // 闭环压测：每完成一个请求就补发一个（熔断拒绝时延后1ms，避免同步递归）
+        if (elapsedMs == 0 && reason == "circuit_open") {
+            QTimer::singleShot(1, &app, issueNext);
+        } else {
+            issueNext();
+        }
+    });
+
+    wallClock.start();
+    for (int i = 0; i < concurrency && i < totalRequests; ++i) {
+        issueNext();
+    }
+    app.exec();
+    double seconds = wallClock.elapsed() / 1000.0;
+
+    out << "目标: " << baseUrl << "\n";
+    out << QString("请求: %1  并发: %2  耗时: %3 s  吞吐: %4 req/s\n")
+           .arg(totalRequests).arg(concurrency)
+           .arg(seconds, 0, 'f', 3)
+           .arg(seconds > 0 ? totalRequests / seconds : 0.0, 0, 'f', 1);
+
+    QVector<int> all;
+    for (auto it = latencies.constBegin(); it != latencies.constEnd(); ++it) {
+        QVector<int> sorted = it.value();
+        std::sort(sorted.begin(), sorted.end());
+        all += sorted;
+        out << QString("  %1: 成功 %2  p50 %3 ms  p95 %4 ms  p99 %5 ms\n")
+               .arg(it.key(), -10).arg(sorted.size())
+               .arg(percentile(sorted, 50)).arg(percentile(sorted, 95)).arg(percentile(sorted, 99));
+    }
+    std::sort(all.begin(), all.end());
+    out << QString("  %1: 成功 %2  p50 %3 ms  p95 %4 ms  p99 %5 ms\n")
+           .arg(QString("all"), -10).arg(all.size())
+           .arg(percentile(all, 50)).arg(percentile(all, 95)).arg(percentile(all, 99));
+
+    for (auto it = failures.constBegin(); it != failures.constEnd(); ++it) {
+        out << "  失败 [" << it.key() << "]: " << it.value() << "\n";
+    }
+
+    if (mockServer.isListening()) {
+        out << "建立的TCP连接数: " << connectionsOpened << "\n";
+    } else {
+        out << "建立的TCP连接数: 外部服务器无法统计\n";
+    }
+
+    return 0;
+}
@@ -0,0 +1,28 @@
+QT       += core network sql
+QT       -= gui
+
+CONFIG += c++11 console
+CONFIG -= app_bundle
+
+# 网络压测程序目标名称（无界面）
+TARGET = bench_network
+
+# 压测程序源文件
+SOURCES += \
+    bench_network.cpp \
+    networkmanager.cpp \
+    database.cpp \
+    preferencematcher.cpp \
+    roomindex.cpp
+
+# 压测程序头文件
+HEADERS += \
+    networkmanager.h \
+    database.h \
+    preferencematcher.h \
+    roomindex.h
+
+# Default rules for deployment.
+qnx: target.path = /tmp/$${TARGET}/bin
+else: unix:!android: target.path = /opt/$${TARGET}/bin
+!isEmpty(target.path): INSTALLS += target
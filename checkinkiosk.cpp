@@ -0,0 +1,255 @@
+#include "checkinkiosk.h"
+#include "asyncdatabase.h"
+#include <QVBoxLayout>
+#include <QHBoxLayout>
+#include <QLineEdit>
+#include <QLabel>
+#include <QListWidget>
+#include <QPushButton>
+#include <QTimer>
+#include <QDebug>
+
+namespace {
+const int kFlushIntervalMs = 300;   // 签到合并写入的间隔
+const int kReloadDelayMs = 500;
+const int kMaxLogLines = 200;
+}
+
+CheckInKiosk::CheckInKiosk(Database *database, AsyncDatabase *asyncDatabase, int activityId, QWidget *parent)
+    : QDialog(parent)
+    , asyncDatabase(asyncDatabase)
+    , activityId(activityId)
+    , rosterLoaded(false)
+    , flushing(false)
+    , flushTimer(new QTimer(this))
+    , reloadTimer(new QTimer(this))
+{
+    setWindowTitle(QString("签到机 - 活动ID %1").arg(activityId));
+    setMinimumSize(520, 480);
+    
+    QVBoxLayout *layout = new QVBoxLayout(this);
+    QLabel *hintLabel = new QLabel("请输入或扫描学号，按回车确认：");
+    inputEdit = new QLineEdit();
+    inputEdit->setEnabled(false);  // 名单读入后才接受输入
+    QFont inputFont = inputEdit->font();
+    inputFont.setPointSize(inputFont.pointSize() * 2);
+    inputEdit->setFont(inputFont);
+    
+    feedbackLabel = new QLabel("正在读取报名名单...");
+    QFont feedbackFont = feedbackLabel->font();
+    feedbackFont.setPointSize(feedbackFont.pointSize() * 2);
+    feedbackFont.setBold(true);
+    feedbackLabel->setFont(feedbackFont);
+    feedbackLabel->setAlignment(Qt::AlignCenter);
+    feedbackLabel->setMinimumHeight(60);
+    
+    countLabel = new QLabel();
+    logList = new QListWidget();
+    
+    QHBoxLayout *bottomLayout = new QHBoxLayout();
+    QPushButton *closeButton = new QPushButton("结束签到");
+    // 回车只用于确认学号，不能触发对话框的默认按钮
+    closeButton->setAutoDefault(false);
+    closeButton->setDefault(false);
+    bottomLayout->addWidget(countLabel);
+    bottomLayout->addStretch();
+    bottomLayout->addWidget(closeButton);
+    
+    layout->addWidget(hintLabel);
+    layout->addWidget(inputEdit);
+    layout->addWidget(feedbackLabel);
+    layout->addWidget(logList);
+    layout->addLayout(bottomLayout);
+    
+    connect(inputEdit, &QLineEdit::returnPressed, this, &CheckInKiosk::onInput);
+    connect(closeButton, &QPushButton::clicked, this, &QDialog::accept);
+    
+    flushTimer->setInterval(kFlushIntervalMs);
+    connect(flushTimer, &QTimer::timeout, this, &CheckInKiosk::flush);
+    reloadTimer->setSingleShot(true);
+    reloadTimer->setInterval(kReloadDelayMs);
+    connect(reloadTimer, &QTimer::timeout, this, &CheckInKiosk::loadRoster);
+    
+    // 签到机打开期间新报名或取消报名的学生
+    connect(database, &Database::registrationChanged, this, [this](int changedActivityId, const QString &) {
+        if (changedActivityId == this->activityId && !reloadTimer->isActive()) {
+            reloadTimer->start();
+        }
+    });
+    // 其他设备或窗口的签到（本机写入后也会收到，此时名单中已是已签到）
+    connect(database, &Database::checkInRecorded, this, [this](int changedActivityId, const QString &studentId) {
+        auto it = roster.find(studentId);
+        if (changedActivityId == this->activityId && it != roster.end() && !it->checkedIn) {
+            it->checkedIn = true;
+            updateCount();
+        }
+    });
+    
+    AsyncDatabase::onFinished(asyncDatabase->getActivity(activityId), this,
+                              [this](const QHash<QString, QVariant> &activity) {
+        if (activity.isEmpty()) {
+            showFeedback("活动不存在", "red");
+            return;
+        }
+        setWindowTitle(QString("签到机 - %1").arg(activity["title"].toString()));
+        startTime = activity["start_time"].toDateTime();
+        loadRoster();
+    });
+}
+
+int CheckInKiosk::pendingCount() const
+{
+    return pending.size();
+}
+
+void CheckInKiosk::loadRoster()
+{
+    AsyncDatabase::onFinished(asyncDatabase->getRegistrations(activityId), this,
+                              [this](const QList<QHash<QString, QVariant>> &registrations) {
+        QHash<QString, RosterEntry> loaded;
+        loaded.reserve(registrations.size());
+        for (const auto &registration : registrations) {
+            RosterEntry entry;
+            entry.name = registration["student_name"].toString();
+            entry.checkedIn = !registration["checkin_time"].isNull();
+            loaded.insert(registration["student_id"].toString(), entry);
+        }
+        // 本机已确认、尚未写入的签到以内存为准
+        for (const auto &checkIn : pending) {
+            auto it = loaded.find(checkIn.first);
+            if (it != loaded.end()) {
+                it->checkedIn = true;
+            }
+        }
+        for (const QString &studentId : inFlight) {
+            auto it = loaded.find(studentId);
+            if (it != loaded.end()) {
+                it->checkedIn = true;
+            }
+        }
+        roster = loaded;
+        
+        if (!rosterLoaded) {
+            rosterLoaded = true;
+            inputEdit->setEnabled(true);
+            inputEdit->setFocus();
+            showFeedback("请刷卡或输入学号", "black");
+            qDebug() << "[签到机] 已读入报名名单:" << roster.size() << "人";
+        }
+        updateCount();
+    });
+}
+
+void CheckInKiosk::onInput()
+{
+    QString studentId = inputEdit->text().simplified().remove(QLatin1Char(' '));
+    inputEdit->clear();
+    if (studentId.isEmpty() || !rosterLoaded) {
+        return;
+    }
+    
+    QDateTime now = QDateTime::currentDateTime();
+    auto it = roster.find(studentId);
+    if (it == roster.end()) {
+        showFeedback(QString("未报名：%1").arg(studentId), "red");
+        appendLog(QString("%1  %2  未报名").arg(now.toString("hh:mm:ss"), studentId));
+        return;
+    }
+    if (it->checkedIn) {
+        showFeedback(QString("已签到：%1").arg(it->name), "darkorange");
+        appendLog(QString("%1  %2 %3  重复签到").arg(now.toString("hh:mm:ss"), studentId, it->name));
+        return;
+    }
+    if (startTime.isValid() && now < startTime) {
+        showFeedback("活动尚未开始", "red");
+        return;
+    }
+    
+    it->checkedIn = true;
+    pending.append(qMakePair(studentId, now));
+    showFeedback(QString("签到成功：%1").arg(it->name), "green");
+    appendLog(QString("%1  %2 %3  签到成功").arg(now.toString("hh:mm:ss"), studentId, it->name));
+    updateCount();
+    if (!flushTimer->isActive()) {
+        flushTimer->start();
+    }
+}
+
+void CheckInKiosk::flush()
+{
+    if (pending.isEmpty()) {
+        flushTimer->stop();
+        return;
+    }
+    if (flushing) {
+        return;  // 上一批完成后再写，下一个间隔重试
+    }
+    flushing = true;
+    
+    QList<QPair<QString, QDateTime>> batch = pending;
+    pending.clear();
+    for (const auto &checkIn : batch) {
+        inFlight.insert(checkIn.first);
+    }
+    updateCount();
+    
+    AsyncDatabase::onFinished(asyncDatabase->checkInBatch(activityId, batch), this,
+                              [this, batch](const QStringList &checkedIn) {
+        flushing = false;
+        QSet<QString> written;
+        for (const QString &studentId : checkedIn) {
+            written.insert(studentId);
+        }
+        // 未写入的：期间取消了报名或已在其他设备签到，名单以数据库为准重新读取
+        QStringList failed;
+        for (const auto &checkIn : batch) {
+            inFlight.remove(checkIn.first);
+            if (!written.contains(checkIn.first)) {
+                failed.append(checkIn.first);
+            }
+        }
+        if (!failed.isEmpty()) {
+            qDebug() << "[签到机] 签到未写入:" << failed;
+            appendLog(QString("未写入（已取消报名或已在其他设备签到）：%1").arg(failed.join("、")));
+            if (!reloadTimer->isActive()) {
+                reloadTimer->start();
+            }
+        }
+    });
+}
+
+void CheckInKiosk::done(int result)
+{
+    // 写操作按提交顺序执行，对话框关闭后剩余的一批照常写入
+    flushTimer->stop();
+    if (!pending.isEmpty()) {
+        asyncDatabase->checkInBatch(activityId, pending);
+        pending.clear();
+    }
+    QDialog::done(result);
+}
+
+void CheckInKiosk::showFeedback(const QString &text, const QString &color)
+{
+    feedbackLabel->setStyleSheet(QString("color: %1;").arg(color));
+    feedbackLabel->setText(text);
+}
+
+void CheckInKiosk::appendLog(const QString &text)
+{
+    logList->insertItem(0, text);
+    while (logList->count() > kMaxLogLines) {
+        delete logList->takeItem(logList->count() - 1);
+    }
+}
+
+void CheckInKiosk::updateCount()
+{
+    int checkedIn = 0;
+    for (const RosterEntry &entry : roster) {
+        if (entry.checkedIn) {
+            ++checkedIn;
+        }
+    }
+    countLabel->setText(QString("已签到 %1 / %2 人，待写入 %3").arg(checkedIn).arg(roster.size()).arg(pending.size()));
+}
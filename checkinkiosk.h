@@ -0,0 +1,66 @@
+#ifndef CHECKINKIOSK_H
+#define CHECKINKIOSK_H
+
+#include <QDialog>
+#include <QDateTime>
+#include <QHash>
+#include <QSet>
+#include <QPair>
+#include "database.h"
+
+class AsyncDatabase;
+
+QT_BEGIN_NAMESPACE
+class QLineEdit;
+class QLabel;
+class QListWidget;
+class QTimer;
+QT_END_NAMESPACE
+
+// 签到机模式：打开时把活动的报名名单一次性读入内存，之后每次输入学号（键盘或扫码枪，以回车结束）
+// 只在内存中校验并立即显示结果，不访问数据库；确认的签到每隔几百毫秒合并成一批，
+// 经组提交写入（一批一个保存点、至多一次提交），不会每刷一次卡就同步一次磁盘。
+// 其他窗口的报名变更会在后台重新读取名单，其他设备的签到直接更新名单。
+class CheckInKiosk : public QDialog
+{
+    Q_OBJECT
+
+public:
+    // database 用于接收报名和签到变更；写入通过 asyncDatabase 在后台执行
+    CheckInKiosk(Database *database, AsyncDatabase *asyncDatabase, int activityId, QWidget *parent = nullptr);
+
+    int pendingCount() const;   // 已确认、尚未提交写入的签到数
+
+protected:
+    void done(int result) override;   // 关闭前提交剩余的签到
+
+private:
+    struct RosterEntry {
+        QString name;
+        bool checkedIn = false;
+    };
+
+    AsyncDatabase *asyncDatabase;
+    int activityId;
+    QDateTime startTime;
+    bool rosterLoaded;
+    bool flushing;
+    QHash<QString, RosterEntry> roster;              // 学号 -> 报名信息
+    QList<QPair<QString, QDateTime>> pending;        // 等待写入的签到（学号、刷卡时间）
+    QSet<QString> inFlight;                          // 已提交、尚未完成写入的学号
+    QLineEdit *inputEdit;
+    QLabel *feedbackLabel;
+    QLabel *countLabel;
+    QListWidget *logList;
+    QTimer *flushTimer;
+    QTimer *reloadTimer;     // 合并短时间内的多次报名变更
+
+    void loadRoster();
+    void onInput();
+    void flush();
+    void showFeedback(const QString &text, const QString &color);
+    void appendLog(const QString &text);
+    void updateCount();
+};
+
+#endif // CHECKINKIOSK_H
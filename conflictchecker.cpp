@@ -1,13 +1,54 @@
 #include "conflictchecker.h"
+#include "taskscheduler.h"
+#include <QElapsedTimer>
+#include <QSet>
 #include <QDebug>
+#include <algorithm>
+
+namespace {
+// 与 Database::checkTimeConflict 中的SQL条件一致
+bool timesConflict(const QDateTime &activityStart, const QDateTime &activityEnd,
+                   const QDateTime &startTime, const QDateTime &endTime)
+{
+    return (activityStart <= startTime && activityEnd > startTime)
+        || (activityStart < endTime && activityEnd >= endTime)
+        || (activityStart >= startTime && activityEnd <= endTime);
+}
+}
 
 ConflictChecker::ConflictChecker(Database *db, QObject *parent)
-    : QThread(parent)
-    , database(db)
+    : QObject(parent)
+    , databaseName(db->databaseFileName())
+    , queue(new PendingQueue)
+    , nextRequestId(0)
+    , queryCount(0)
     , activityId(-1)
 {
 }
 
+int ConflictChecker::check(const QString &studentId, int activityId, const QDateTime &startTime, const QDateTime &endTime)
+{
+    Job job;
+    job.requestId = ++nextRequestId;
+    job.activityId = activityId;
+    job.startTime = startTime;
+    job.endTime = endTime;
+    
+    // 该学生没有排队中的请求时才需要投递新任务，否则并入已投递但尚未执行的那一批
+    bool needSchedule;
+    {
+        QMutexLocker locker(&queue->mutex);
+        QList<Job> &jobs = queue->jobsByStudent[studentId];
+        needSchedule = jobs.isEmpty();
+        jobs.append(job);
+    }
+    if (needSchedule) {
+        scheduleStudent(studentId);
+    }
+    
+    return job.requestId;
+}
+
 void ConflictChecker::setStudentId(const QString &studentId)
 {
     this->studentId = studentId;
@@ -20,21 +61,209 @@ void ConflictChecker::setActivityTime(int activityId, const QDateTime &startTime
     this->endTime = endTime;
 }
 
-void ConflictChecker::run()
+int ConflictChecker::start()
+{
+    return check(studentId, activityId, startTime, endTime);
+}
+
+int ConflictChecker::executedQueries() const
+{
+    return queryCount;
+}
+
+int ConflictChecker::suggestSchedule(const QString &studentId, const QList<int> &wishList, const QList<int> &weights)
 {
-    if (studentId.isEmpty() || activityId <= 0) {
-        emit checkCompleted(false);
-        return;
+    const int requestId = ++nextRequestId;
+    QString databaseName = this->databaseName;
+    
+    // 意向中重复的活动只保留第一次
+    QList<int> candidates;
+    QHash<int, qint64> weightById;
+    for (int i = 0; i < wishList.size(); ++i) {
+        int activityId = wishList[i];
+        if (activityId <= 0 || weightById.contains(activityId)) {
+            continue;
+        }
+        candidates.append(activityId);
+        weightById.insert(activityId, i < weights.size() ? weights[i] : wishList.size() - i);
     }
     
-    QList<QHash<QString, QVariant>> conflicts = database->checkTimeConflict(
-        studentId, startTime, endTime, activityId);
+    TaskScheduler::globalInstance()->submit(TaskPriority::Interactive, this,
+        [studentId, candidates, weightById, databaseName](TaskContext &context) -> ScheduleSuggestion {
+        QElapsedTimer timer;
+        timer.start();
+        Database *db = context.database(databaseName);
+        
+        // 已报名的活动即使已满也可以保留
+        QSet<int> registered;
+        for (const QHash<QString, QVariant> &activity : db->getStudentApprovedSchedule(studentId)) {
+            registered.insert(activity["id"].toInt());
+        }
+        
+        QList<ActivityRecord> records;
+        if (!candidates.isEmpty()) {
+            ActivityQuery query;
+            query.ids = candidates;
+            records = db->getActivityPage(query, 0, candidates.size());
+        }
+        
+        QVector<ScheduleCandidate> eligible;
+        QSet<int> found;
+        for (const ActivityRecord &record : records) {
+            bool hasSeat = record.currentParticipants < record.maxParticipants || registered.contains(record.id);
+            // 进行中的活动不再接受报名，但已报名的仍占用时间
+            bool open = record.status == ActivityStatus::Approved
+                     || (record.status == ActivityStatus::Ongoing && registered.contains(record.id));
+            if (!open || !hasSeat || record.startTime >= record.endTime) {
+                continue;
+            }
+            ScheduleCandidate candidate;
+            candidate.activityId = record.id;
+            candidate.start = record.startTime.toMSecsSinceEpoch();
+            candidate.end = record.endTime.toMSecsSinceEpoch();
+            candidate.weight = weightById.value(record.id);
+            eligible.append(candidate);
+            found.insert(record.id);
+        }
+        
+        ScheduleSuggestion suggestion = optimizeSchedule(eligible);
+        for (int activityId : candidates) {
+            if (!found.contains(activityId)) {
+                suggestion.unavailable.append(activityId);
+            }
+        }
+        suggestion.elapsedUs = timer.nsecsElapsed() / 1000;
+        if (suggestion.elapsedUs > 5000) {
+            qDebug() << "[日程推荐] 候选" << candidates.size() << "个，耗时" << suggestion.elapsedUs << "us";
+        }
+        return suggestion;
+    }, [this, requestId](const ScheduleSuggestion &suggestion) {
+        emit scheduleSuggested(requestId, suggestion);
+    });
+    
+    return requestId;
+}
+
+ScheduleSuggestion ConflictChecker::optimizeSchedule(QVector<ScheduleCandidate> candidates)
+{
+    ScheduleSuggestion suggestion;
+    const int n = candidates.size();
+    std::sort(candidates.begin(), candidates.end(), [](const ScheduleCandidate &a, const ScheduleCandidate &b) {
+        return a.end != b.end ? a.end < b.end : a.start < b.start;
+    });
+    QVector<qint64> ends(n);
+    for (int i = 0; i < n; ++i) {
+        ends[i] = candidates[i].end;
+    }
     
-    if (!conflicts.isEmpty()) {
-        emit conflictDetected(conflicts);
-        emit checkCompleted(true);
-    } else {
-        emit checkCompleted(false);
+    // best[i]：前 i 个候选中的最优值，先比总权重，再比活动数。
+    // 首尾相接不算冲突（与 timesConflict 一致），所以前驱是结束时间 <= 开始时间的候选
+    QVector<QPair<qint64, int>> best(n + 1, qMakePair(qint64(0), 0));
+    QVector<int> previous(n);
+    QVector<char> taken(n, 0);
+    for (int i = 0; i < n; ++i) {
+        previous[i] = static_cast<int>(std::upper_bound(ends.begin(), ends.begin() + i, candidates[i].start) - ends.begin());
+        QPair<qint64, int> take = qMakePair(best[previous[i]].first + candidates[i].weight, best[previous[i]].second + 1);
+        if (best[i] < take) {
+            best[i + 1] = take;
+            taken[i] = 1;
+        } else {
+            best[i + 1] = best[i];
+        }
     }
+    
+    QVector<char> selected(n, 0);
+    for (int i = n; i > 0;) {
+        if (taken[i - 1]) {
+            selected[i - 1] = 1;
+            i = previous[i - 1];
+        } else {
+            --i;
+        }
+    }
+    
+    QVector<ScheduleCandidate> chosen;
+    for (int i = 0; i < n; ++i) {
+        if (selected[i]) {
+            chosen.append(candidates[i]);
+        } else {
+            suggestion.dropped.append(candidates[i].activityId);
+        }
+    }
+    std::sort(chosen.begin(), chosen.end(), [](const ScheduleCandidate &a, const ScheduleCandidate &b) {
+        return a.start < b.start;
+    });
+    for (const ScheduleCandidate &candidate : chosen) {
+        suggestion.selected.append(candidate.activityId);
+        suggestion.totalWeight += candidate.weight;
+    }
+    return suggestion;
 }
 
+void ConflictChecker::scheduleStudent(const QString &studentId)
+{
+    QSharedPointer<PendingQueue> pending = queue;
+    QString databaseName = this->databaseName;
+    TaskScheduler::globalInstance()->submit(TaskPriority::Interactive, this,
+        [pending, studentId, databaseName](TaskContext &context) -> QList<Result> {
+        // 执行时才取出请求，这样排队期间新到的请求也会合并进来
+        QList<Job> jobs;
+        {
+            QMutexLocker locker(&pending->mutex);
+            jobs = pending->jobsByStudent.take(studentId);
+        }
+        
+        QList<Result> results;
+        if (jobs.isEmpty()) {
+            return results;
+        }
+        
+        QList<QHash<QString, QVariant>> schedule;
+        if (!studentId.isEmpty()) {
+            schedule = context.database(databaseName)->getStudentApprovedSchedule(studentId);
+        }
+        
+        // 相同的活动和时间段只计算一次
+        QHash<QString, QList<QHash<QString, QVariant>>> computed;
+        for (const Job &job : jobs) {
+            Result result;
+            result.requestId = job.requestId;
+            if (studentId.isEmpty() || job.activityId <= 0) {
+                results.append(result);
+                continue;
+            }
+            
+            QString key = QString("%1|%2|%3").arg(job.activityId)
+                .arg(job.startTime.toMSecsSinceEpoch()).arg(job.endTime.toMSecsSinceEpoch());
+            auto it = computed.constFind(key);
+            if (it == computed.constEnd()) {
+                QList<QHash<QString, QVariant>> conflicts;
+                for (const QHash<QString, QVariant> &activity : schedule) {
+                    if (activity["id"].toInt() == job.activityId) {
+                        continue;
+                    }
+                    if (timesConflict(activity["start_time"].toDateTime(), activity["end_time"].toDateTime(),
+                                      job.startTime, job.endTime)) {
+                        conflicts.append(activity);
+                    }
+                }
+                it = computed.insert(key, conflicts);
+            }
+            result.conflicts = it.value();
+            results.append(result);
+        }
+        return results;
+    }, [this](const QList<Result> &results) {
+        if (results.isEmpty()) {
+            return;
+        }
+        queryCount++;
+        for (const Result &result : results) {
+            emit conflictChecked(result.requestId, result.conflicts);
+            if (!result.conflicts.isEmpty()) {
+                emit conflictDetected(result.conflicts);
+            }
+            emit checkCompleted(!result.conflicts.isEmpty());
+        }
+    });
+}
@@ -2,35 +2,96 @@
 #define CONFLICTCHECKER_H
 
 #include <QObject>
-#include <QThread>
 #include <QDateTime>
 #include <QVariant>
 #include <QHash>
+#include <QList>
+#include <QMutex>
+#include <QSharedPointer>
 #include "database.h"
 
-class ConflictChecker : public QThread
+// 日程推荐的候选活动：时间为毫秒时间戳，weight 越大越优先
+struct ScheduleCandidate {
+    int activityId = 0;
+    qint64 start = 0;
+    qint64 end = 0;
+    qint64 weight = 1;
+};
+
+// 日程推荐结果：selected 为互不重叠、总权重最大（相同时活动数最多）的一组活动
+struct ScheduleSuggestion {
+    QList<int> selected;       // 推荐报名或保留的活动，按开始时间排列
+    QList<int> dropped;        // 因时间重叠未被选中的候选
+    QList<int> unavailable;    // 不存在、未批准或已满（且学生未报名）
+    qint64 totalWeight = 0;
+    qint64 elapsedUs = 0;      // 后台计算耗时（含读取数据库）
+};
+
+// 时间冲突检测服务：以 Interactive 优先级在全局任务调度器中执行（工作线程使用独立的数据库连接），
+// 不会排在导出等批量任务之后，可同时接受大量检测请求。
+// 同一学生排队中的请求会合并为一次数据库查询，完全相同的请求只计算一次；
+// 每个请求的结果通过 conflictChecked 按请求ID返回。
+class ConflictChecker : public QObject
 {
     Q_OBJECT
 
 public:
     explicit ConflictChecker(Database *db, QObject *parent = nullptr);
+
+    // 提交一次检测，返回请求ID；结果在GUI线程中通过 conflictChecked 发出
+    int check(const QString &studentId, int activityId, const QDateTime &startTime, const QDateTime &endTime);
+    
+    // 旧接口：先设置参数再调用 start()，等价于 check()
     void setStudentId(const QString &studentId);
     void setActivityTime(int activityId, const QDateTime &startTime, const QDateTime &endTime);
+    int start();
+    
+    // 已执行的数据库查询次数（合并后的批次数），用于统计合并效果
+    int executedQueries() const;
+    
+    // 日程推荐：从学生的意向活动中选出互不重叠、仍有名额（或已报名）的最优组合，
+    // 结果通过 scheduleSuggested 按请求ID返回。weights 为空时按意向顺序赋权（越靠前越优先）。
+    // 需要保留的已有报名也应放进 wishList，否则不参与计算
+    int suggestSchedule(const QString &studentId, const QList<int> &wishList, const QList<int> &weights = QList<int>());
+    // 带权区间调度：按结束时间排序后动态规划，O(n log n)；只看时间，不检查名额
+    static ScheduleSuggestion optimizeSchedule(QVector<ScheduleCandidate> candidates);
 
 signals:
+    void conflictChecked(int requestId, const QList<QHash<QString, QVariant>> &conflicts);
+    // 每个请求完成时也会发出以下信号（兼容旧接口）
     void conflictDetected(const QList<QHash<QString, QVariant>> &conflicts);
     void checkCompleted(bool hasConflict);
-
-protected:
-    void run() override;
+    void scheduleSuggested(int requestId, const ScheduleSuggestion &suggestion);
 
 private:
-    Database *database;
+    struct Job {
+        int requestId;
+        int activityId;
+        QDateTime startTime;
+        QDateTime endTime;
+    };
+    struct Result {
+        int requestId;
+        QList<QHash<QString, QVariant>> conflicts;
+    };
+    // 等待执行的请求，按学生分组；GUI线程写入，后台线程取出
+    struct PendingQueue {
+        QMutex mutex;
+        QHash<QString, QList<Job>> jobsByStudent;
+    };
+
+    QString databaseName;
+    QSharedPointer<PendingQueue> queue;
+    int nextRequestId;
+    int queryCount;
+    
+    // 旧接口的参数
     QString studentId;
     int activityId;
     QDateTime startTime;
     QDateTime endTime;
+
+    void scheduleStudent(const QString &studentId);
 };
 
 #endif // CONFLICTCHECKER_H
-
@@ -1,13 +1,44 @@
 #include "database.h"
+#include "preferencematcher.h"
+#include "roomindex.h"
 #include <QCryptographicHash>
 #include <QDateTime>
+#include <QStringList>
+#include <QSet>
+#include <QFileInfo>
+#include <QDir>
 #include <QDebug>
+#include <QRandomGenerator>
+#include <functional>
+#include <random>
+
+namespace {
+// 写连接提交时读连接可能正在执行检查点，短暂等待而不是直接返回 SQLITE_BUSY
+const char *const kConnectOptions = "QSQLITE_BUSY_TIMEOUT=5000";
+
+// 未填写地点时存 NULL，不进入场地索引
+QVariant locationKeyValue(const QString &location)
+{
+    QString key = RoomIndex::locationKey(location);
+    return key.isEmpty() ? QVariant(QVariant::String) : QVariant(key);
+}
+}
 
 Database::Database(QObject *parent)
     : QObject(parent)
 {
     db = QSqlDatabase::addDatabase("QSQLITE");
     db.setDatabaseName("activity_management.db");
+    db.setConnectOptions(kConnectOptions);
+}
+
+Database::Database(const QString &connectionName, const QString &databaseName, QObject *parent)
+    : QObject(parent)
+    , connectionName(connectionName)
+{
+    db = QSqlDatabase::addDatabase("QSQLITE", connectionName);
+    db.setDatabaseName(databaseName);
+    db.setConnectOptions(kConnectOptions);
 }
 
 Database::~Database()
@@ -15,6 +46,44 @@ Database::~Database()
     if (db.isOpen()) {
         db.close();
     }
+    if (!connectionName.isEmpty()) {
+        // 释放连接对象后才能移除命名连接
+        db = QSqlDatabase();
+        QSqlDatabase::removeDatabase(connectionName);
+    }
+}
+
+bool Database::open()
+{
+    if (!db.open()) {
+        qDebug() << "Error: Failed to open database" << connectionName << db.lastError().text();
+        return false;
+    }
+    return true;
+}
+
+QString Database::databaseFileName() const
+{
+    return db.databaseName();
+}
+
+QString Database::journalMode()
+{
+    QSqlQuery query(db);
+    if (query.exec("PRAGMA journal_mode") && query.next()) {
+        return query.value(0).toString().toLower();
+    }
+    return QString();
+}
+
+bool Database::executeStatement(const QString &statement)
+{
+    QSqlQuery query(db);
+    if (!query.exec(statement)) {
+        qDebug() << "[数据库] 执行失败:" << statement << query.lastError().text();
+        return false;
+    }
+    return true;
 }
 
 bool Database::initializeDatabase()
@@ -24,240 +93,341 @@ bool Database::initializeDatabase()
         return false;
     }
     
-    return createTables();
+    // 预写日志（WAL）模式记录在数据库文件中，之后打开的后台连接自动沿用：
+    // 读连接看到的是开始读取时已提交的数据，既不等待写入，也不会让单写线程的提交等待
+    if (db.databaseName() != ":memory:") {
+        QSqlQuery query(db);
+        if (!query.exec("PRAGMA journal_mode = WAL") || !query.next()
+            || query.value(0).toString().compare("wal", Qt::CaseInsensitive) != 0) {
+            qDebug() << "[数据库] 无法启用预写日志，读写连接将互相等待:" << query.lastError().text();
+        }
+    }
+    
+    return migrateSchema();
 }
 
-bool Database::createTables()
+int Database::schemaVersion()
 {
     QSqlQuery query(db);
-    
-    // 检查users表是否存在，以及需要哪种迁移
-    bool needsUsernameMigration = false;
-    bool needsPrimaryKeyMigration = false;
-    bool hasIdField = false;
-    
-    query.prepare("SELECT name FROM sqlite_master WHERE type='table' AND name='users'");
-    if (query.exec() && query.next()) {
-        // 表存在，检查表结构
-        QSqlQuery checkQuery(db);
-        checkQuery.prepare("PRAGMA table_info(users)");
-        if (checkQuery.exec()) {
-            while (checkQuery.next()) {
-                QString columnName = checkQuery.value("name").toString();
-                if (columnName == "username") {
-                    needsUsernameMigration = true;
-                }
-                if (columnName == "id") {
-                    hasIdField = true;
-                }
+    if (query.exec("PRAGMA user_version") && query.next()) {
+        return query.value(0).toInt();
+    }
+    return -1;
+}
+
+bool Database::hasColumn(const QString &table, const QString &column)
+{
+    QSqlQuery query(db);
+    if (query.exec(QString("PRAGMA table_info(%1)").arg(table))) {
+        while (query.next()) {
+            if (query.value("name").toString() == column) {
+                return true;
             }
         }
-        
-        // 如果表有id字段但没有将student_id设为主键，需要迁移主键
-        if (hasIdField) {
-            // 检查student_id是否为主键
-            checkQuery.prepare("PRAGMA table_info(users)");
-            bool studentIdIsPrimary = false;
-            if (checkQuery.exec()) {
+    }
+    return false;
+}
+
+bool Database::migrateSchema()
+{
+    // 按版本号排列的迁移步骤，每步只执行一次。
+    // 版本号记录在 PRAGMA user_version 中，已是最新的数据库启动时只需读取一次该值。
+    // 加入本机制之前创建的数据库版本号为 0，各步骤对其同样适用（表和列已存在时跳过）。
+    struct Migration {
+        int version;
+        const char *description;
+        std::function<bool(QSqlQuery &)> apply;
+    };
+    
+    const QList<Migration> migrations = {
+        {1, "用户表（student_id 为主键）", [this](QSqlQuery &query) {
+            // 旧版本的用户表可能以 username 或自增 id 为主键，需要迁移
+            bool needsUsernameMigration = false;
+            bool needsPrimaryKeyMigration = false;
+            QSqlQuery checkQuery(db);
+            if (checkQuery.exec("PRAGMA table_info(users)")) {
+                bool hasIdField = false;
+                bool studentIdIsPrimary = false;
                 while (checkQuery.next()) {
                     QString columnName = checkQuery.value("name").toString();
-                    int pk = checkQuery.value("pk").toInt();
-                    if (columnName == "student_id" && pk == 1) {
+                    if (columnName == "username") {
+                        needsUsernameMigration = true;
+                    }
+                    if (columnName == "id") {
+                        hasIdField = true;
+                    }
+                    if (columnName == "student_id" && checkQuery.value("pk").toInt() == 1) {
                         studentIdIsPrimary = true;
-                        break;
                     }
                 }
+                needsPrimaryKeyMigration = hasIdField && !studentIdIsPrimary;
             }
-            if (!studentIdIsPrimary) {
-                needsPrimaryKeyMigration = true;
+            
+            const QString createUsersTable = R"(
+                CREATE TABLE IF NOT EXISTS %1 (
+                    student_id TEXT PRIMARY KEY NOT NULL,
+                    password TEXT NOT NULL,
+                    role INTEGER NOT NULL,
+                    name TEXT,
+                    created_at DATETIME DEFAULT CURRENT_TIMESTAMP
+                )
+            )";
+            if (!needsUsernameMigration && !needsPrimaryKeyMigration) {
+                return query.exec(createUsersTable.arg("users"));
             }
-        }
+            
+            qDebug() << "Migrating users table: setting student_id as primary key";
+            const QString sourceColumn = needsUsernameMigration ? "username" : "student_id";
+            return query.exec("DROP TABLE IF EXISTS users_new")
+                && query.exec(createUsersTable.arg("users_new"))
+                && query.exec(QString("INSERT INTO users_new (student_id, password, role, name, created_at) "
+                                      "SELECT %1, password, role, name, created_at FROM users").arg(sourceColumn))
+                && query.exec("DROP TABLE users")
+                && query.exec("ALTER TABLE users_new RENAME TO users");
+        }},
+        {2, "活动表、报名表、候补表", [](QSqlQuery &query) {
+            return query.exec(R"(
+                CREATE TABLE IF NOT EXISTS activities (
+                    id INTEGER PRIMARY KEY AUTOINCREMENT,
+                    title TEXT NOT NULL,
+                    description TEXT,
+                    category TEXT,
+                    organizer TEXT NOT NULL,
+                    start_time DATETIME NOT NULL,
+                    end_time DATETIME NOT NULL,
+                    max_participants INTEGER NOT NULL,
+                    current_participants INTEGER DEFAULT 0,
+                    location TEXT,
+                    status INTEGER DEFAULT 0,
+                    created_at DATETIME DEFAULT CURRENT_TIMESTAMP,
+                    approved_at DATETIME,
+                    approved_by TEXT,
+                    checkin_code TEXT
+                )
+            )") && query.exec(R"(
+                CREATE TABLE IF NOT EXISTS registrations (
+                    id INTEGER PRIMARY KEY AUTOINCREMENT,
+                    activity_id INTEGER NOT NULL,
+                    student_id TEXT NOT NULL,
+                    student_name TEXT NOT NULL,
+                    status INTEGER DEFAULT 0,
+                    registered_at DATETIME DEFAULT CURRENT_TIMESTAMP,
+                    checkin_time DATETIME,
+                    FOREIGN KEY (activity_id) REFERENCES activities(id) ON DELETE CASCADE,
+                    UNIQUE(activity_id, student_id)
+                )
+            )") && query.exec(R"(
+                CREATE TABLE IF NOT EXISTS waitlist (
+                    id INTEGER PRIMARY KEY AUTOINCREMENT,
+                    activity_id INTEGER NOT NULL,
+                    student_id TEXT NOT NULL,
+                    student_name TEXT NOT NULL,
+                    added_at DATETIME DEFAULT CURRENT_TIMESTAMP,
+                    FOREIGN KEY (activity_id) REFERENCES activities(id) ON DELETE CASCADE,
+                    UNIQUE(activity_id, student_id)
+                )
+            )");
+        }},
+        // 3、4：为加入签到功能之前创建的表补上字段
+        {3, "报名表签到时间字段", [this](QSqlQuery &query) {
+            return hasColumn("registrations", "checkin_time")
+                || query.exec("ALTER TABLE registrations ADD COLUMN checkin_time DATETIME");
+        }},
+        {4, "活动表签到码字段", [this](QSqlQuery &query) {
+            return hasColumn("activities", "checkin_code")
+                || query.exec("ALTER TABLE activities ADD COLUMN checkin_code TEXT");
+        }},
+        {5, "同步状态表（保存增量同步游标等键值）", [](QSqlQuery &query) {
+            return query.exec(R"(
+                CREATE TABLE IF NOT EXISTS sync_state (
+                    key TEXT PRIMARY KEY NOT NULL,
+                    value TEXT,
+                    updated_at DATETIME DEFAULT CURRENT_TIMESTAMP
+                )
+            )");
+        }},
+        {6, "查询索引", [](QSqlQuery &query) {
+            return query.exec("CREATE INDEX IF NOT EXISTS idx_registrations_activity ON registrations(activity_id)")
+                && query.exec("CREATE INDEX IF NOT EXISTS idx_registrations_student ON registrations(student_id)")
+                && query.exec("CREATE INDEX IF NOT EXISTS idx_waitlist_activity ON waitlist(activity_id)")
+                && query.exec("CREATE INDEX IF NOT EXISTS idx_activities_status ON activities(status)")
+                && query.exec("CREATE INDEX IF NOT EXISTS idx_activities_created ON activities(created_at)");
+        }},
+        {7, "默认管理员账户", [this](QSqlQuery &query) {
+            if (!query.exec("SELECT COUNT(*) FROM users WHERE student_id = 'admin'") || !query.next()) {
+                return false;
+            }
+            bool exists = query.value(0).toInt() > 0;
+            query.finish();
+            return exists || addUser("admin", "admin123", UserRole::Admin, "系统管理员");
+        }},
+        {8, "活动提醒队列和通知发件箱", [this](QSqlQuery &query) {
+            // reminders 是持久化的优先队列：未发出的提醒按 remind_at 排序取出
+            bool created = query.exec(R"(
+                CREATE TABLE IF NOT EXISTS reminders (
+                    activity_id INTEGER NOT NULL,
+                    student_id TEXT NOT NULL,
+                    remind_at DATETIME NOT NULL,
+                    fired_at DATETIME,
+                    PRIMARY KEY (activity_id, student_id)
+                )
+            )") && query.exec("CREATE INDEX IF NOT EXISTS idx_reminders_pending ON reminders(remind_at) "
+                              "WHERE fired_at IS NULL")
+              && query.exec(R"(
+                CREATE TABLE IF NOT EXISTS notification_outbox (
+                    id INTEGER PRIMARY KEY AUTOINCREMENT,
+                    student_id TEXT NOT NULL,
+                    activity_id INTEGER NOT NULL,
+                    message TEXT NOT NULL,
+                    created_at DATETIME DEFAULT CURRENT_TIMESTAMP,
+                    delivered_at DATETIME
+                )
+            )") && query.exec("CREATE INDEX IF NOT EXISTS idx_outbox_undelivered ON notification_outbox(id) "
+                              "WHERE delivered_at IS NULL");
+            if (!created) {
+                return false;
+            }
+            
+            // 为已有的报名补上提醒
+            QList<int> activityIds;
+            query.prepare("SELECT id FROM activities WHERE status = ? AND start_time > ?");
+            query.addBindValue(static_cast<int>(ActivityStatus::Approved));
+            query.addBindValue(QDateTime::currentDateTime());
+            if (!query.exec()) {
+                return false;
+            }
+            while (query.next()) {
+                activityIds.append(query.value(0).toInt());
+            }
+            query.finish();
+            for (int activityId : activityIds) {
+                if (!syncActivityReminders(activityId, kDefaultReminderLeadMinutes)) {
+                    return false;
+                }
+            }
+            return true;
+        }},
+        {9, "候补按加入时间的索引，修正报名人数", [](QSqlQuery &query) {
+            // 旧版本的候补转正没有增加 current_participants，这里按实际报名数重新计算一次
+            return query.exec("CREATE INDEX IF NOT EXISTS idx_waitlist_activity_added ON waitlist(activity_id, added_at)")
+                && query.exec("DROP INDEX IF EXISTS idx_waitlist_activity")
+                && query.exec(R"(
+                    UPDATE activities SET current_participants =
+                        (SELECT COUNT(*) FROM registrations r WHERE r.activity_id = activities.id)
+                )");
+        }},
+        {10, "抽签报名（申请表和活动的抽签字段）", [this](QSqlQuery &query) {
+            return (hasColumn("activities", "lottery_deadline")
+                    || query.exec("ALTER TABLE activities ADD COLUMN lottery_deadline DATETIME"))
+                && (hasColumn("activities", "lottery_seed")
+                    || query.exec("ALTER TABLE activities ADD COLUMN lottery_seed INTEGER"))
+                && (hasColumn("activities", "lottery_drawn_at")
+                    || query.exec("ALTER TABLE activities ADD COLUMN lottery_drawn_at DATETIME"))
+                && query.exec(R"(
+                    CREATE TABLE IF NOT EXISTS applications (
+                        id INTEGER PRIMARY KEY AUTOINCREMENT,
+                        activity_id INTEGER NOT NULL,
+                        student_id TEXT NOT NULL,
+                        student_name TEXT NOT NULL,
+                        applied_at DATETIME DEFAULT CURRENT_TIMESTAMP,
+                        FOREIGN KEY (activity_id) REFERENCES activities(id) ON DELETE CASCADE,
+                        UNIQUE(activity_id, student_id)
+                    )
+                )")
+                && query.exec("CREATE INDEX IF NOT EXISTS idx_activities_lottery_pending ON activities(lottery_deadline) "
+                              "WHERE lottery_deadline IS NOT NULL AND lottery_drawn_at IS NULL");
+        }},
+        {11, "志愿匹配（轮次、学生申请和志愿）", [](QSqlQuery &query) {
+            return query.exec(R"(
+                CREATE TABLE IF NOT EXISTS match_rounds (
+                    id INTEGER PRIMARY KEY AUTOINCREMENT,
+                    title TEXT NOT NULL,
+                    cutoff DATETIME NOT NULL,
+                    seed INTEGER NOT NULL,
+                    created_by TEXT,
+                    created_at DATETIME DEFAULT CURRENT_TIMESTAMP,
+                    matched_at DATETIME
+                )
+            )") && query.exec(R"(
+                CREATE TABLE IF NOT EXISTS match_requests (
+                    round_id INTEGER NOT NULL,
+                    student_id TEXT NOT NULL,
+                    student_name TEXT NOT NULL,
+                    max_assignments INTEGER NOT NULL DEFAULT 1,
+                    submitted_at DATETIME DEFAULT CURRENT_TIMESTAMP,
+                    PRIMARY KEY (round_id, student_id),
+                    FOREIGN KEY (round_id) REFERENCES match_rounds(id) ON DELETE CASCADE
+                )
+            )") && query.exec(R"(
+                CREATE TABLE IF NOT EXISTS match_preferences (
+                    round_id INTEGER NOT NULL,
+                    student_id TEXT NOT NULL,
+                    preference_rank INTEGER NOT NULL,
+                    activity_id INTEGER NOT NULL,
+                    assigned INTEGER NOT NULL DEFAULT 0,
+                    PRIMARY KEY (round_id, student_id, preference_rank),
+                    FOREIGN KEY (round_id) REFERENCES match_rounds(id) ON DELETE CASCADE
+                )
+            )") && query.exec("CREATE INDEX IF NOT EXISTS idx_match_rounds_pending ON match_rounds(cutoff) "
+                              "WHERE matched_at IS NULL");
+        }},
+        {12, "场地冲突检测（规范化地点键和按地点、开始时间的索引）", [this](QSqlQuery &query) {
+            if (!hasColumn("activities", "location_key")
+                && !query.exec("ALTER TABLE activities ADD COLUMN location_key TEXT")) {
+                return false;
+            }
+            // 规范化在 C++ 中完成（全角转半角等 SQLite 做不到），逐行回填
+            QList<QPair<int, QString>> locations;
+            if (!query.exec("SELECT id, location FROM activities WHERE location IS NOT NULL AND location <> ''")) {
+                return false;
+            }
+            while (query.next()) {
+                locations.append(qMakePair(query.value(0).toInt(), query.value(1).toString()));
+            }
+            query.finish();
+            query.prepare("UPDATE activities SET location_key = ? WHERE id = ?");
+            for (const auto &location : locations) {
+                query.addBindValue(locationKeyValue(location.second));
+                query.addBindValue(location.first);
+                if (!query.exec()) {
+                    return false;
+                }
+            }
+            return query.exec("CREATE INDEX IF NOT EXISTS idx_activities_location_time "
+                              "ON activities(location_key, start_time)");
+        }},
+    };
+    
+    int version = schemaVersion();
+    if (version < 0) {
+        qDebug() << "Error: Failed to read schema version" << db.lastError().text();
+        return false;
     }
     
-    // 如果需要迁移，执行数据迁移
-    if (needsUsernameMigration || needsPrimaryKeyMigration) {
-        qDebug() << "Migrating users table: setting student_id as primary key";
-        
-        // 先删除可能存在的临时表
-        query.exec("DROP TABLE IF EXISTS users_new");
-        
-        // 创建新表（student_id为主键）
-        QString createNewTable = R"(
-            CREATE TABLE users_new (
-                student_id TEXT PRIMARY KEY NOT NULL,
-                password TEXT NOT NULL,
-                role INTEGER NOT NULL,
-                name TEXT,
-                created_at DATETIME DEFAULT CURRENT_TIMESTAMP
-            )
-        )";
-        
-        if (!query.exec(createNewTable)) {
-            qDebug() << "Error creating new users table:" << query.lastError().text();
-            return false;
-        }
-        
-        // 迁移数据
-        if (needsUsernameMigration) {
-            // 从username字段迁移
-            query.prepare("INSERT INTO users_new (student_id, password, role, name, created_at) "
-                         "SELECT username, password, role, name, created_at FROM users");
-        } else {
-            // 从student_id字段迁移（已有student_id，只需移除id）
-            query.prepare("INSERT INTO users_new (student_id, password, role, name, created_at) "
-                         "SELECT student_id, password, role, name, created_at FROM users");
-        }
-        
-        if (!query.exec()) {
-            qDebug() << "Error migrating data:" << query.lastError().text();
-            query.exec("DROP TABLE IF EXISTS users_new");
-            return false;
-        }
-        
-        // 删除旧表
-        if (!query.exec("DROP TABLE users")) {
-            qDebug() << "Error dropping old table:" << query.lastError().text();
-            query.exec("DROP TABLE IF EXISTS users_new");
-            return false;
+    for (const Migration &migration : migrations) {
+        if (migration.version <= version) {
+            continue;
         }
         
-        // 重命名新表
-        if (!query.exec("ALTER TABLE users_new RENAME TO users")) {
-            qDebug() << "Error renaming table:" << query.lastError().text();
+        // 每一步连同版本号在同一个事务中提交，失败时数据库停留在上一个版本
+        QSqlQuery query(db);
+        bool success = db.transaction()
+            && migration.apply(query)
+            && query.exec(QString("PRAGMA user_version = %1").arg(migration.version));
+        if (!success) {
+            qDebug() << "Error: Schema migration" << migration.version << migration.description
+                     << "failed:" << query.lastError().text();
+            query.finish();
+            db.rollback();
             return false;
         }
-        
-        qDebug() << "Migration completed successfully";
-    } else {
-        // 创建新表（如果不存在）- student_id为主键
-        QString createUsersTable = R"(
-            CREATE TABLE IF NOT EXISTS users (
-                student_id TEXT PRIMARY KEY NOT NULL,
-                password TEXT NOT NULL,
-                role INTEGER NOT NULL,
-                name TEXT,
-                created_at DATETIME DEFAULT CURRENT_TIMESTAMP
-            )
-        )";
-        
-        if (!query.exec(createUsersTable)) {
-            qDebug() << "Error creating users table:" << query.lastError().text();
+        query.finish();
+        if (!db.commit()) {
+            qDebug() << "Error: Failed to commit schema migration" << migration.version << db.lastError().text();
             return false;
         }
-    }
-    
-    // 活动表
-    QString createActivitiesTable = R"(
-        CREATE TABLE IF NOT EXISTS activities (
-            id INTEGER PRIMARY KEY AUTOINCREMENT,
-            title TEXT NOT NULL,
-            description TEXT,
-            category TEXT,
-            organizer TEXT NOT NULL,
-            start_time DATETIME NOT NULL,
-            end_time DATETIME NOT NULL,
-            max_participants INTEGER NOT NULL,
-            current_participants INTEGER DEFAULT 0,
-            location TEXT,
-            status INTEGER DEFAULT 0,
-            created_at DATETIME DEFAULT CURRENT_TIMESTAMP,
-            approved_at DATETIME,
-            approved_by TEXT,
-            checkin_code TEXT
-        )
-    )";
-    
-    if (!query.exec(createActivitiesTable)) {
-        qDebug() << "Error creating activities table:" << query.lastError().text();
-        return false;
-    }
-    
-    // 报名表
-    QString createRegistrationsTable = R"(
-        CREATE TABLE IF NOT EXISTS registrations (
-            id INTEGER PRIMARY KEY AUTOINCREMENT,
-            activity_id INTEGER NOT NULL,
-            student_id TEXT NOT NULL,
-            student_name TEXT NOT NULL,
-            status INTEGER DEFAULT 0,
-            registered_at DATETIME DEFAULT CURRENT_TIMESTAMP,
-            checkin_time DATETIME,
-            FOREIGN KEY (activity_id) REFERENCES activities(id) ON DELETE CASCADE,
-            UNIQUE(activity_id, student_id)
-        )
-    )";
-    
-    if (!query.exec(createRegistrationsTable)) {
-        qDebug() << "Error creating registrations table:" << query.lastError().text();
-        return false;
-    }
-    
-    // 候补表
-    QString createWaitlistTable = R"(
-        CREATE TABLE IF NOT EXISTS waitlist (
-            id INTEGER PRIMARY KEY AUTOINCREMENT,
-            activity_id INTEGER NOT NULL,
-            student_id TEXT NOT NULL,
-            student_name TEXT NOT NULL,
-            added_at DATETIME DEFAULT CURRENT_TIMESTAMP,
-            FOREIGN KEY (activity_id) REFERENCES activities(id) ON DELETE CASCADE,
-            UNIQUE(activity_id, student_id)
-        )
-    )";
-    
-    if (!query.exec(createWaitlistTable)) {
-        qDebug() << "Error creating waitlist table:" << query.lastError().text();
-        return false;
-    }
-    
-    // 创建索引以提高查询性能
-    query.exec("CREATE INDEX IF NOT EXISTS idx_registrations_activity ON registrations(activity_id)");
-    query.exec("CREATE INDEX IF NOT EXISTS idx_registrations_student ON registrations(student_id)");
-    query.exec("CREATE INDEX IF NOT EXISTS idx_waitlist_activity ON waitlist(activity_id)");
-    query.exec("CREATE INDEX IF NOT EXISTS idx_activities_status ON activities(status)");
-    
-    // 数据库迁移：为已存在的表添加签到字段（如果不存在）
-    QSqlQuery checkColumnQuery(db);
-    checkColumnQuery.prepare("PRAGMA table_info(registrations)");
-    bool hasCheckinColumn = false;
-    if (checkColumnQuery.exec()) {
-        while (checkColumnQuery.next()) {
-            if (checkColumnQuery.value("name").toString() == "checkin_time") {
-                hasCheckinColumn = true;
-                break;
-            }
-        }
-    }
-    if (!hasCheckinColumn) {
-        query.prepare("ALTER TABLE registrations ADD COLUMN checkin_time DATETIME");
-        if (!query.exec()) {
-            qDebug() << "Warning: Failed to add checkin_time column:" << query.lastError().text();
-        }
-    }
-    
-    // 数据库迁移：为已存在的活动表添加签到码字段（如果不存在）
-    QSqlQuery checkCheckinCodeQuery(db);
-    checkCheckinCodeQuery.prepare("PRAGMA table_info(activities)");
-    bool hasCheckinCodeColumn = false;
-    if (checkCheckinCodeQuery.exec()) {
-        while (checkCheckinCodeQuery.next()) {
-            if (checkCheckinCodeQuery.value("name").toString() == "checkin_code") {
-                hasCheckinCodeColumn = true;
-                break;
-            }
-        }
-    }
-    if (!hasCheckinCodeColumn) {
-        query.prepare("ALTER TABLE activities ADD COLUMN checkin_code TEXT");
-        if (!query.exec()) {
-            qDebug() << "Warning: Failed to add checkin_code column:" << query.lastError().text();
-        }
-    }
-    
-    // 插入默认管理员账户（如果不存在）
-    query.prepare("SELECT COUNT(*) FROM users WHERE student_id = 'admin'");
-    if (query.exec() && query.next() && query.value(0).toInt() == 0) {
-        addUser("admin", "admin123", UserRole::Admin, "系统管理员");
+        qDebug() << "[数据库] 已迁移到结构版本" << migration.version << migration.description;
+        version = migration.version;
     }
     
     return true;
@@ -336,8 +506,8 @@ int Database::createActivity(const QString &title, const QString &description,
     QSqlQuery query(db);
     query.prepare(R"(
         INSERT INTO activities (title, description, category, organizer, start_time, 
-                               end_time, max_participants, location, status, checkin_code)
-        VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?, ?)
+                               end_time, max_participants, location, location_key, status, checkin_code)
+        VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?)
     )");
     query.addBindValue(title);
     query.addBindValue(description);
@@ -347,6 +517,7 @@ int Database::createActivity(const QString &title, const QString &description,
     query.addBindValue(endTime);
     query.addBindValue(maxParticipants);
     query.addBindValue(location);
+    query.addBindValue(locationKeyValue(location));
     query.addBindValue(static_cast<int>(ActivityStatus::Pending));
     query.addBindValue(checkinCode);
     
@@ -355,7 +526,9 @@ int Database::createActivity(const QString &title, const QString &description,
         return -1;
     }
     
-    return query.lastInsertId().toInt();
+    int activityId = query.lastInsertId().toInt();
+    emit activityChanged(activityId);
+    return activityId;
 }
 
 bool Database::updateActivityStatus(int activityId, ActivityStatus status)
@@ -367,7 +540,11 @@ bool Database::updateActivityStatus(int activityId, ActivityStatus status)
     query.addBindValue(""); // 可以从当前登录用户获取
     query.addBindValue(activityId);
     
-    return query.exec();
+    if (!query.exec()) {
+        return false;
+    }
+    emit activityChanged(activityId);
+    return true;
 }
 
 bool Database::updateCheckInCode(int activityId, const QString &checkinCode)
@@ -377,7 +554,11 @@ bool Database::updateCheckInCode(int activityId, const QString &checkinCode)
     query.addBindValue(checkinCode);
     query.addBindValue(activityId);
     
-    return query.exec();
+    if (!query.exec()) {
+        return false;
+    }
+    emit activityChanged(activityId);
+    return true;
 }
 
 QString Database::getCheckInCode(int activityId)
@@ -447,11 +628,382 @@ QHash<QString, QVariant> Database::getActivity(int activityId)
         activity["location"] = query.value("location");
         activity["status"] = query.value("status");
         activity["checkin_code"] = query.value("checkin_code");
+        activity["lottery_deadline"] = query.value("lottery_deadline");
+        activity["lottery_drawn_at"] = query.value("lottery_drawn_at");
     }
     
     return activity;
 }
 
+namespace {
+
+// 允许排序的列（防止把任意字符串拼进 ORDER BY）
+const QStringList kActivitySortColumns = {
+    "id", "title", "category", "organizer", "start_time", "end_time",
+    "status", "created_at", "remaining"
+};
+const QStringList kRegistrationSortColumns = {
+    "student_id", "student_name", "registered_at", "status", "activity_id",
+    "title", "start_time", "end_time", "location"
+};
+
+// 拼出活动查询的 WHERE 子句，绑定值按顺序追加到 bindValues
+QString activityWhereClause(const ActivityQuery &query, QVariantList &bindValues)
+{
+    QStringList conditions;
+    if (!query.organizer.isEmpty()) {
+        conditions << "a.organizer = ?";
+        bindValues << query.organizer;
+    }
+    if (query.status >= 0) {
+        conditions << "a.status = ?";
+        bindValues << query.status;
+    }
+    if (!query.searchText.isEmpty()) {
+        // 转义通配符，使搜索词按字面匹配（与内存中的前缀细化结果一致）
+        QString escaped = query.searchText;
+        escaped.replace("\\", "\\\\").replace("%", "\\%").replace("_", "\\_");
+        QString pattern = "%" + escaped + "%";
+        conditions << "(a.title LIKE ? ESCAPE '\\' OR a.category LIKE ? ESCAPE '\\' OR a.organizer LIKE ? ESCAPE '\\')";
+        bindValues << pattern << pattern << pattern;
+    }
+    if (!query.excludeRegisteredBy.isEmpty()) {
+        // 用 NOT EXISTS 代替逐行调用 isRegistered
+        conditions << "NOT EXISTS (SELECT 1 FROM registrations r "
+                      "WHERE r.activity_id = a.id AND r.student_id = ?)";
+        bindValues << query.excludeRegisteredBy;
+    }
+    if (!query.ids.isEmpty()) {
+        QStringList placeholders;
+        for (int id : query.ids) {
+            placeholders << "?";
+            bindValues << id;
+        }
+        conditions << "a.id IN (" + placeholders.join(", ") + ")";
+    }
+    return conditions.isEmpty() ? QString() : " WHERE " + conditions.join(" AND ");
+}
+
+// 活动查询的 ORDER BY 子句（同值时按ID，保证分页稳定）
+QString activityOrderClause(const ActivityQuery &query)
+{
+    QString orderBy = kActivitySortColumns.contains(query.orderBy) ? query.orderBy : "created_at";
+    if (orderBy == "remaining") {
+        orderBy = "(a.max_participants - a.current_participants)";
+    } else {
+        orderBy = "a." + orderBy;
+    }
+    QString direction = query.descending ? " DESC" : " ASC";
+    return " ORDER BY " + orderBy + direction + ", a.id" + direction;
+}
+
+QString registrationWhereClause(const RegistrationQuery &query, QVariantList &bindValues)
+{
+    QStringList conditions;
+    if (query.activityId > 0) {
+        conditions << "r.activity_id = ?";
+        bindValues << query.activityId;
+    }
+    if (!query.studentId.isEmpty()) {
+        conditions << "r.student_id = ?";
+        bindValues << query.studentId;
+    }
+    return conditions.isEmpty() ? QString() : " WHERE " + conditions.join(" AND ");
+}
+
+} // namespace
+
+int Database::countActivities(const ActivityQuery &query)
+{
+    QVariantList bindValues;
+    QSqlQuery sqlQuery(db);
+    sqlQuery.prepare("SELECT COUNT(*) FROM activities a" + activityWhereClause(query, bindValues));
+    for (const QVariant &value : bindValues) {
+        sqlQuery.addBindValue(value);
+    }
+    
+    if (sqlQuery.exec() && sqlQuery.next()) {
+        return sqlQuery.value(0).toInt();
+    }
+    
+    qDebug() << "[分页查询] 活动计数失败:" << sqlQuery.lastError().text();
+    return 0;
+}
+
+QList<ActivityRecord> Database::getActivityPage(const ActivityQuery &query, int offset, int limit)
+{
+    QList<ActivityRecord> activities;
+    QVariantList bindValues;
+    
+    QSqlQuery sqlQuery(db);
+    sqlQuery.setForwardOnly(true);
+    sqlQuery.prepare("SELECT a.id, a.title, a.category, a.organizer, a.location, a.start_time, a.end_time, "
+                     "a.max_participants, a.current_participants, a.status, a.created_at FROM activities a"
+                     + activityWhereClause(query, bindValues)
+                     + activityOrderClause(query)
+                     + " LIMIT ? OFFSET ?");
+    for (const QVariant &value : bindValues) {
+        sqlQuery.addBindValue(value);
+    }
+    sqlQuery.addBindValue(limit);
+    sqlQuery.addBindValue(offset);
+    
+    if (!sqlQuery.exec()) {
+        qDebug() << "[分页查询] 活动查询失败:" << sqlQuery.lastError().text();
+        return activities;
+    }
+    
+    while (sqlQuery.next()) {
+        ActivityRecord record;
+        record.id = sqlQuery.value(0).toInt();
+        record.title = sqlQuery.value(1).toString();
+        record.category = sqlQuery.value(2).toString();
+        record.organizer = sqlQuery.value(3).toString();
+        record.location = sqlQuery.value(4).toString();
+        record.startTime = sqlQuery.value(5).toDateTime();
+        record.endTime = sqlQuery.value(6).toDateTime();
+        record.maxParticipants = sqlQuery.value(7).toInt();
+        record.currentParticipants = sqlQuery.value(8).toInt();
+        record.status = static_cast<ActivityStatus>(sqlQuery.value(9).toInt());
+        record.createdAt = sqlQuery.value(10).toDateTime();
+        activities.append(record);
+    }
+    
+    return activities;
+}
+
+bool Database::applyActivityChanges(const QList<QHash<QString, QVariant>> &changes, const QString &cursor)
+{
+    if (!db.transaction()) {
+        qDebug() << "Error starting transaction:" << db.lastError().text();
+        return false;
+    }
+    
+    // 预编译语句在整批变更中复用
+    QSqlQuery updateQuery(db);
+    updateQuery.prepare(R"(
+        UPDATE activities SET title = ?, description = ?, category = ?, organizer = ?,
+                              start_time = ?, end_time = ?, max_participants = ?,
+                              location = ?, location_key = ?, status = ?
+        WHERE id = ?
+    )");
+    QSqlQuery insertQuery(db);
+    insertQuery.prepare(R"(
+        INSERT INTO activities (id, title, description, category, organizer, start_time,
+                               end_time, max_participants, location, location_key, status)
+        VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?)
+    )");
+    QSqlQuery deleteQuery(db);
+    QList<int> updatedIds;  // 已存在的活动，人数上限可能被提高
+    bool deletedAny = false;
+    
+    for (const auto &change : changes) {
+        int activityId = change["id"].toInt();
+        if (activityId <= 0) {
+            continue;
+        }
+        
+        if (change["op"].toString() == "delete") {
+            // 平台删除的活动连同本地引用它的全部数据（报名、候补、抽签申请、提醒、通知、匹配志愿）一起删除，
+            // 任何一步失败整批回滚
+            static const char *const deleteStatements[] = {
+                "DELETE FROM registrations WHERE activity_id = ?",
+                "DELETE FROM waitlist WHERE activity_id = ?",
+                "DELETE FROM applications WHERE activity_id = ?",
+                "DELETE FROM reminders WHERE activity_id = ?",
+                "DELETE FROM notification_outbox WHERE activity_id = ?",
+                "DELETE FROM match_preferences WHERE activity_id = ?",
+                "DELETE FROM activities WHERE id = ?",
+            };
+            for (const char *statement : deleteStatements) {
+                deleteQuery.prepare(statement);
+                deleteQuery.addBindValue(activityId);
+                if (!deleteQuery.exec()) {
+                    qDebug() << "Error deleting activity:" << deleteQuery.lastError().text();
+                    db.rollback();
+                    return false;
+                }
+            }
+            deletedAny = true;
+            continue;
+        }
+        
+        // 先尝试更新；本地不存在时再插入（保留本地的报名人数和签到码）
+        updateQuery.addBindValue(change["title"]);
+        updateQuery.addBindValue(change["description"]);
+        updateQuery.addBindValue(change["category"]);
+        updateQuery.addBindValue(change["organizer"]);
+        updateQuery.addBindValue(change["start_time"]);
+        updateQuery.addBindValue(change["end_time"]);
+        updateQuery.addBindValue(change["max_participants"]);
+        updateQuery.addBindValue(change["location"]);
+        updateQuery.addBindValue(locationKeyValue(change["location"].toString()));
+        updateQuery.addBindValue(change["status"]);
+        updateQuery.addBindValue(activityId);
+        
+        if (!updateQuery.exec()) {
+            qDebug() << "Error updating activity:" << updateQuery.lastError().text();
+            db.rollback();
+            return false;
+        }
+        
+        if (updateQuery.numRowsAffected() > 0) {
+            updatedIds.append(activityId);
+        } else {
+            insertQuery.addBindValue(activityId);
+            insertQuery.addBindValue(change["title"]);
+            insertQuery.addBindValue(change["description"]);
+            insertQuery.addBindValue(change["category"]);
+            insertQuery.addBindValue(change["organizer"]);
+            insertQuery.addBindValue(change["start_time"]);
+            insertQuery.addBindValue(change["end_time"]);
+            insertQuery.addBindValue(change["max_participants"]);
+            insertQuery.addBindValue(change["location"]);
+            insertQuery.addBindValue(locationKeyValue(change["location"].toString()));
+            insertQuery.addBindValue(change["status"]);
+            
+            if (!insertQuery.exec()) {
+                qDebug() << "Error inserting activity:" << insertQuery.lastError().text();
+                db.rollback();
+                return false;
+            }
+        }
+    }
+    
+    // 尚未匹配的轮次中，志愿全部指向已删除活动的学生不再参与匹配
+    if (deletedAny) {
+        if (!deleteQuery.exec(R"(
+                DELETE FROM match_requests
+                WHERE round_id IN (SELECT id FROM match_rounds WHERE matched_at IS NULL)
+                AND NOT EXISTS (
+                    SELECT 1 FROM match_preferences p
+                    WHERE p.round_id = match_requests.round_id AND p.student_id = match_requests.student_id
+                )
+            )")) {
+            qDebug() << "Error deleting empty match requests:" << deleteQuery.lastError().text();
+            db.rollback();
+            return false;
+        }
+    }
+    
+    // 上限变化后由候补补满空位，与同步数据在同一事务中提交
+    for (int activityId : updatedIds) {
+        if (promoteWaitlist(activityId) < 0) {
+            db.rollback();
+            return false;
+        }
+    }
+    
+    // 游标与数据在同一事务内提交，中断后可从最后一批继续
+    if (!setSyncState("activity_changes_cursor", cursor)) {
+        qDebug() << "Error saving sync cursor:" << db.lastError().text();
+        db.rollback();
+        return false;
+    }
+    
+    return db.commit();
+}
+
+QList<ActivityRecord> Database::getLifecycleSchedule()
+{
+    QList<ActivityRecord> schedule;
+    QSqlQuery query(db);
+    query.setForwardOnly(true);
+    query.prepare("SELECT id, start_time, end_time, status FROM activities WHERE status IN (?, ?)");
+    query.addBindValue(static_cast<int>(ActivityStatus::Approved));
+    query.addBindValue(static_cast<int>(ActivityStatus::Ongoing));
+    
+    if (!query.exec()) {
+        qDebug() << "[生命周期] 读取活动时间失败:" << query.lastError().text();
+        return schedule;
+    }
+    while (query.next()) {
+        ActivityRecord record;
+        record.id = query.value(0).toInt();
+        record.startTime = query.value(1).toDateTime();
+        record.endTime = query.value(2).toDateTime();
+        record.status = static_cast<ActivityStatus>(query.value(3).toInt());
+        schedule.append(record);
+    }
+    return schedule;
+}
+
+int Database::advanceActivityStatuses(const QList<int> &startingIds, const QList<int> &endingIds, const QDateTime &now)
+{
+    // ID 均为整数，直接拼进 IN 列表；一批只执行两条 UPDATE
+    auto idList = [](const QList<int> &ids) {
+        QStringList items;
+        for (int id : ids) {
+            items.append(QString::number(id));
+        }
+        return items.join(",");
+    };
+    
+    int changed = 0;
+    QSqlQuery query(db);
+    if (!startingIds.isEmpty()) {
+        query.prepare(QString("UPDATE activities SET status = ? WHERE id IN (%1) AND status = ? AND start_time <= ?")
+                          .arg(idList(startingIds)));
+        query.addBindValue(static_cast<int>(ActivityStatus::Ongoing));
+        query.addBindValue(static_cast<int>(ActivityStatus::Approved));
+        query.addBindValue(now);
+        if (!query.exec()) {
+            qDebug() << "[生命周期] 更新为进行中失败:" << query.lastError().text();
+            return -1;
+        }
+        changed += query.numRowsAffected();
+    }
+    if (!endingIds.isEmpty()) {
+        query.prepare(QString("UPDATE activities SET status = ? WHERE id IN (%1) AND status IN (?, ?) AND end_time <= ?")
+                          .arg(idList(endingIds)));
+        query.addBindValue(static_cast<int>(ActivityStatus::Finished));
+        query.addBindValue(static_cast<int>(ActivityStatus::Approved));
+        query.addBindValue(static_cast<int>(ActivityStatus::Ongoing));
+        query.addBindValue(now);
+        if (!query.exec()) {
+            qDebug() << "[生命周期] 更新为已结束失败:" << query.lastError().text();
+            return -1;
+        }
+        changed += query.numRowsAffected();
+    }
+    
+    if (changed > 0) {
+        // 未改变的行（时间已被修改）刷新一次也无妨
+        QSet<int> notified;
+        for (int id : startingIds + endingIds) {
+            if (!notified.contains(id)) {
+                notified.insert(id);
+                emit activityChanged(id);
+            }
+        }
+    }
+    return changed;
+}
+
+QString Database::getSyncState(const QString &key, const QString &defaultValue)
+{
+    QSqlQuery query(db);
+    query.prepare("SELECT value FROM sync_state WHERE key = ?");
+    query.addBindValue(key);
+    
+    if (query.exec() && query.next()) {
+        return query.value(0).toString();
+    }
+    
+    return defaultValue;
+}
+
+bool Database::setSyncState(const QString &key, const QString &value)
+{
+    QSqlQuery query(db);
+    query.prepare("INSERT OR REPLACE INTO sync_state (key, value, updated_at) VALUES (?, ?, ?)");
+    query.addBindValue(key);
+    query.addBindValue(value);
+    query.addBindValue(QDateTime::currentDateTime());
+    
+    return query.exec();
+}
+
 bool Database::registerActivity(int activityId, const QString &studentId, const QString &studentName)
 {
     QSqlQuery query(db);
@@ -463,6 +1015,9 @@ bool Database::registerActivity(int activityId, const QString &studentId, const
     
     // 检查活动是否已满
     QHash<QString, QVariant> activity = getActivity(activityId);
+    if (!activity["lottery_deadline"].isNull() && activity["lottery_drawn_at"].isNull()) {
+        return false;  // 抽签前只接受申请（submitApplication）
+    }
     int current = activity["current_participants"].toInt();
     int max = activity["max_participants"].toInt();
     
@@ -487,28 +1042,151 @@ bool Database::registerActivity(int activityId, const QString &studentId, const
     query.addBindValue(activityId);
     query.exec();
     
+    emit registrationChanged(activityId, studentId);
+    emit activityChanged(activityId);
     return true;
 }
 
 bool Database::cancelRegistration(int activityId, const QString &studentId)
 {
+    // 删除与候补转正在同一个保存点内，任何一步失败都不留下不一致的人数和候补
+    if (!executeStatement("SAVEPOINT cancel_registration")) {
+        return false;
+    }
+    
     QSqlQuery query(db);
     query.prepare("DELETE FROM registrations WHERE activity_id = ? AND student_id = ?");
     query.addBindValue(activityId);
     query.addBindValue(studentId);
     
     if (!query.exec()) {
+        qDebug() << "[报名] 取消失败:" << query.lastError().text();
+        executeStatement("ROLLBACK TO cancel_registration");
+        executeStatement("RELEASE cancel_registration");
         return false;
     }
     
-    // 更新活动参与人数
-    query.prepare("UPDATE activities SET current_participants = current_participants - 1 WHERE id = ?");
-    query.addBindValue(activityId);
-    query.exec();
-    
-    // 从候补列表中提升一个学生
-    promoteFromWaitlist(activityId);
+    // 由候补补满空出的名额，并按实际报名数更新参与人数
+    if (promoteWaitlist(activityId) < 0) {
+        executeStatement("ROLLBACK TO cancel_registration");
+        executeStatement("RELEASE cancel_registration");
+        return false;
+    }
+    if (!executeStatement("RELEASE cancel_registration")) {
+        return false;
+    }
+    
+    emit registrationChanged(activityId, studentId);
+    emit activityChanged(activityId);
+    return true;
+}
+
+int Database::cancelRegistrations(int activityId, const QStringList &studentIds)
+{
+    if (!executeStatement("SAVEPOINT cancel_registrations")) {
+        return -1;
+    }
+    
+    int cancelled = 0;
+    QSqlQuery query(db);
+    query.prepare("DELETE FROM registrations WHERE activity_id = ? AND student_id = ?");
+    for (const QString &studentId : studentIds) {
+        query.addBindValue(activityId);
+        query.addBindValue(studentId);
+        if (!query.exec()) {
+            qDebug() << "[报名] 批量取消失败:" << query.lastError().text();
+            executeStatement("ROLLBACK TO cancel_registrations");
+            executeStatement("RELEASE cancel_registrations");
+            return -1;
+        }
+        if (query.numRowsAffected() > 0) {
+            ++cancelled;
+            emit registrationChanged(activityId, studentId);
+        }
+    }
+    
+    // 全部取消后只做一次候补转正
+    if (promoteWaitlist(activityId) < 0) {
+        executeStatement("ROLLBACK TO cancel_registrations");
+        executeStatement("RELEASE cancel_registrations");
+        return -1;
+    }
+    if (!executeStatement("RELEASE cancel_registrations")) {
+        return -1;
+    }
+    
+    emit activityChanged(activityId);
+    return cancelled;
+}
+
+bool Database::switchRegistrations(int activityId, const QString &studentId, const QString &studentName,
+                                   const QList<int> &droppedActivityIds)
+{
+    if (!executeStatement("SAVEPOINT switch_registrations")) {
+        return false;
+    }
+    auto fail = [this](const QSqlQuery &query) {
+        qDebug() << "[报名] 调整报名失败:" << query.lastError().text();
+        executeStatement("ROLLBACK TO switch_registrations");
+        executeStatement("RELEASE switch_registrations");
+        return false;
+    };
+    
+    // 先报名新活动：已满、未批准或仍在抽签申请期时不插入任何行，整体回滚
+    QSqlQuery query(db);
+    query.prepare(R"(
+        INSERT INTO registrations (activity_id, student_id, student_name, status)
+        SELECT a.id, ?, ?, ? FROM activities a
+        WHERE a.id = ? AND a.status = ?
+        AND (a.lottery_deadline IS NULL OR a.lottery_drawn_at IS NOT NULL)
+        AND (SELECT COUNT(*) FROM registrations r WHERE r.activity_id = a.id) < a.max_participants
+    )");
+    query.addBindValue(studentId);
+    query.addBindValue(studentName);
+    query.addBindValue(static_cast<int>(RegistrationStatus::Registered));
+    query.addBindValue(activityId);
+    query.addBindValue(static_cast<int>(ActivityStatus::Approved));
+    if (!query.exec()) {
+        return fail(query);
+    }
+    if (query.numRowsAffected() <= 0) {
+        executeStatement("ROLLBACK TO switch_registrations");
+        executeStatement("RELEASE switch_registrations");
+        return false;
+    }
+    query.prepare("DELETE FROM waitlist WHERE activity_id = ? AND student_id = ?");
+    query.addBindValue(activityId);
+    query.addBindValue(studentId);
+    if (!query.exec()) {
+        return fail(query);
+    }
     
+    // 再取消放弃的报名，空出的名额由各自的候补补上
+    query.prepare("DELETE FROM registrations WHERE activity_id = ? AND student_id = ?");
+    for (int droppedId : droppedActivityIds) {
+        query.addBindValue(droppedId);
+        query.addBindValue(studentId);
+        if (!query.exec()) {
+            return fail(query);
+        }
+        if (promoteWaitlist(droppedId) < 0) {
+            return fail(query);
+        }
+    }
+    // 重算新活动的参与人数
+    if (promoteWaitlist(activityId) < 0) {
+        return fail(query);
+    }
+    if (!executeStatement("RELEASE switch_registrations")) {
+        return false;
+    }
+    
+    emit registrationChanged(activityId, studentId);
+    emit activityChanged(activityId);
+    for (int droppedId : droppedActivityIds) {
+        emit registrationChanged(droppedId, studentId);
+        emit activityChanged(droppedId);
+    }
     return true;
 }
 
@@ -542,6 +1220,7 @@ QList<QHash<QString, QVariant>> Database::getRegistrations(int activityId)
             reg["student_name"] = query.value("student_name");
             reg["status"] = query.value("status");
             reg["registered_at"] = query.value("registered_at");
+            reg["checkin_time"] = query.value("checkin_time");
             registrations.append(reg);
         }
     }
@@ -581,6 +1260,106 @@ QList<QHash<QString, QVariant>> Database::getStudentRegistrations(const QString
     return registrations;
 }
 
+QVector<ActivitySearchHit> Database::searchActivities(const ActivityQuery &query)
+{
+    QVector<ActivitySearchHit> hits;
+    QVariantList bindValues;
+    
+    // 只取ID和参与匹配的三个字段，结果按当前排序返回
+    QSqlQuery sqlQuery(db);
+    sqlQuery.setForwardOnly(true);
+    sqlQuery.prepare("SELECT a.id, a.title, a.category, a.organizer FROM activities a"
+                     + activityWhereClause(query, bindValues)
+                     + activityOrderClause(query));
+    for (const QVariant &value : bindValues) {
+        sqlQuery.addBindValue(value);
+    }
+    
+    if (!sqlQuery.exec()) {
+        qDebug() << "[活动搜索] 查询失败:" << sqlQuery.lastError().text();
+        return hits;
+    }
+    
+    while (sqlQuery.next()) {
+        ActivitySearchHit hit;
+        hit.id = sqlQuery.value(0).toInt();
+        hit.text = sqlQuery.value(1).toString() + '\n'
+                 + sqlQuery.value(2).toString() + '\n'
+                 + sqlQuery.value(3).toString();
+        hits.append(hit);
+    }
+    
+    return hits;
+}
+
+int Database::countRegistrations(const RegistrationQuery &query)
+{
+    QVariantList bindValues;
+    QSqlQuery sqlQuery(db);
+    sqlQuery.prepare("SELECT COUNT(*) FROM registrations r" + registrationWhereClause(query, bindValues));
+    for (const QVariant &value : bindValues) {
+        sqlQuery.addBindValue(value);
+    }
+    
+    if (sqlQuery.exec() && sqlQuery.next()) {
+        return sqlQuery.value(0).toInt();
+    }
+    
+    qDebug() << "[分页查询] 报名计数失败:" << sqlQuery.lastError().text();
+    return 0;
+}
+
+QList<RegistrationRecord> Database::getRegistrationPage(const RegistrationQuery &query, int offset, int limit)
+{
+    QList<RegistrationRecord> registrations;
+    QVariantList bindValues;
+    
+    QString orderBy = query.orderBy;
+    if (!kRegistrationSortColumns.contains(orderBy)) {
+        orderBy = query.activityId > 0 ? "registered_at" : "start_time";
+    }
+    // 活动字段来自 activities 表，其余来自 registrations 表
+    QString orderColumn = (orderBy == "title" || orderBy == "start_time" || orderBy == "end_time" || orderBy == "location")
+                          ? "a." + orderBy : "r." + orderBy;
+    
+    QSqlQuery sqlQuery(db);
+    sqlQuery.setForwardOnly(true);
+    sqlQuery.prepare("SELECT r.id, r.activity_id, r.student_id, r.student_name, r.status, r.registered_at, "
+                     "a.title, a.location, a.start_time, a.end_time "
+                     "FROM registrations r LEFT JOIN activities a ON r.activity_id = a.id"
+                     + registrationWhereClause(query, bindValues)
+                     + " ORDER BY " + orderColumn + (query.descending ? " DESC" : " ASC")
+                     + ", r.id" + (query.descending ? " DESC" : " ASC")
+                     + " LIMIT ? OFFSET ?");
+    for (const QVariant &value : bindValues) {
+        sqlQuery.addBindValue(value);
+    }
+    sqlQuery.addBindValue(limit);
+    sqlQuery.addBindValue(offset);
+    
+    if (!sqlQuery.exec()) {
+        qDebug() << "[分页查询] 报名查询失败:" << sqlQuery.lastError().text();
+        return registrations;
+    }
+    
+    while (sqlQuery.next()) {
+        RegistrationRecord record;
+        record.id = sqlQuery.value(0).toInt();
+        record.activityId = sqlQuery.value(1).toInt();
+        record.studentId = sqlQuery.value(2).toString();
+        record.studentName = sqlQuery.value(3).toString();
+        record.status = static_cast<RegistrationStatus>(sqlQuery.value(4).toInt());
+        record.registeredAt = sqlQuery.value(5).toDateTime();
+        record.title = sqlQuery.value(6).toString();
+        record.location = sqlQuery.value(7).toString();
+        record.startTime = sqlQuery.value(8).toDateTime();
+        record.endTime = sqlQuery.value(9).toDateTime();
+        registrations.append(record);
+    }
+    
+    return registrations;
+}
+
 int Database::getRegistrationCount(int activityId)
 {
     QSqlQuery query(db);
@@ -629,139 +1408,1433 @@ QList<QHash<QString, QVariant>> Database::getWaitlist(int activityId)
 
 bool Database::promoteFromWaitlist(int activityId)
 {
-    QSqlQuery query(db);
+    return promoteWaitlist(activityId) > 0;
+}
+
+int Database::promoteWaitlist(int activityId)
+{
+    // 用保存点而不是事务：既可单独调用，也可嵌在组提交或同步的事务中
+    if (!executeStatement("SAVEPOINT promote_waitlist")) {
+        return -1;
+    }
+    auto fail = [this](const QSqlQuery &query) {
+        qDebug() << "[候补] 转正失败:" << query.lastError().text();
+        executeStatement("ROLLBACK TO promote_waitlist");
+        executeStatement("RELEASE promote_waitlist");
+        return -1;
+    };
     
-    // 获取候补列表中的第一个学生
-    query.prepare("SELECT student_id, student_name FROM waitlist WHERE activity_id = ? ORDER BY added_at LIMIT 1");
+    QSqlQuery query(db);
+    query.prepare(R"(
+        SELECT a.max_participants - (SELECT COUNT(*) FROM registrations r WHERE r.activity_id = a.id)
+        FROM activities a WHERE a.id = ?
+    )");
     query.addBindValue(activityId);
-    
-    if (!query.exec() || !query.next()) {
-        return false; // 没有候补学生
+    if (!query.exec()) {
+        return fail(query);
+    }
+    int freeSeats = query.next() ? query.value(0).toInt() : 0;
+    query.finish();
+    
+    // 按加入时间取最早的候补（走 activity_id, added_at 索引），跳过与已报名活动时间冲突的学生；
+    // 时间重叠的判断与 checkTimeConflict 相同。被跳过的学生留在候补中
+    struct Candidate {
+        int waitlistId;
+        QString studentId;
+        QString studentName;
+    };
+    QList<Candidate> promoted;
+    if (freeSeats > 0) {
+        query.prepare(R"(
+            SELECT w.id, w.student_id, w.student_name
+            FROM waitlist w
+            JOIN activities cur ON cur.id = w.activity_id
+            WHERE w.activity_id = ?
+            AND NOT EXISTS (
+                SELECT 1 FROM registrations r
+                JOIN activities a ON a.id = r.activity_id
+                WHERE r.student_id = w.student_id
+                AND a.id != cur.id
+                AND a.status IN (?, ?)
+                AND a.start_time < cur.end_time AND a.end_time > cur.start_time
+            )
+            ORDER BY w.added_at, w.id
+            LIMIT ?
+        )");
+        query.addBindValue(activityId);
+        query.addBindValue(static_cast<int>(ActivityStatus::Approved));
+        query.addBindValue(static_cast<int>(ActivityStatus::Ongoing));
+        query.addBindValue(freeSeats);
+        if (!query.exec()) {
+            return fail(query);
+        }
+        while (query.next()) {
+            promoted.append({query.value(0).toInt(), query.value(1).toString(), query.value(2).toString()});
+        }
+        query.finish();
     }
     
-    QString studentId = query.value(0).toString();
-    QString studentName = query.value(1).toString();
-    
-    // 从候补列表中删除
-    query.prepare("DELETE FROM waitlist WHERE activity_id = ? AND student_id = ?");
-    query.addBindValue(activityId);
-    query.addBindValue(studentId);
-    query.exec();
+    QSqlQuery insertQuery(db);
+    insertQuery.prepare("INSERT OR IGNORE INTO registrations (activity_id, student_id, student_name, status) VALUES (?, ?, ?, ?)");
+    QSqlQuery deleteQuery(db);
+    deleteQuery.prepare("DELETE FROM waitlist WHERE id = ?");
+    for (const Candidate &candidate : promoted) {
+        insertQuery.addBindValue(activityId);
+        insertQuery.addBindValue(candidate.studentId);
+        insertQuery.addBindValue(candidate.studentName);
+        insertQuery.addBindValue(static_cast<int>(RegistrationStatus::Registered));
+        if (!insertQuery.exec()) {
+            return fail(insertQuery);
+        }
+        deleteQuery.addBindValue(candidate.waitlistId);
+        if (!deleteQuery.exec()) {
+            return fail(deleteQuery);
+        }
+    }
     
-    // 添加到报名列表
-    query.prepare("INSERT INTO registrations (activity_id, student_id, student_name, status) VALUES (?, ?, ?, ?)");
+    // 参与人数按实际报名数重新计算，不再靠增减维护
+    query.prepare(R"(
+        UPDATE activities SET current_participants =
+            (SELECT COUNT(*) FROM registrations r WHERE r.activity_id = activities.id)
+        WHERE id = ?
+    )");
     query.addBindValue(activityId);
-    query.addBindValue(studentId);
-    query.addBindValue(studentName);
-    query.addBindValue(static_cast<int>(RegistrationStatus::Registered));
+    if (!query.exec()) {
+        return fail(query);
+    }
+    if (!executeStatement("RELEASE promote_waitlist")) {
+        return -1;
+    }
     
-    return query.exec();
+    if (!promoted.isEmpty()) {
+        qDebug() << "[候补] 活动" << activityId << "候补转正" << promoted.size() << "人";
+        for (const Candidate &candidate : promoted) {
+            emit registrationChanged(activityId, candidate.studentId);
+        }
+        emit activityChanged(activityId);
+    }
+    return promoted.size();
 }
 
-QList<QHash<QString, QVariant>> Database::checkTimeConflict(const QString &studentId,
-                                                            const QDateTime &startTime,
-                                                            const QDateTime &endTime,
-                                                            int excludeActivityId)
+bool Database::updateMaxParticipants(int activityId, int maxParticipants)
 {
-    QList<QHash<QString, QVariant>> conflicts;
-    QSqlQuery query(db);
-    
-    QString sql = R"(
-        SELECT a.id, a.title, a.start_time, a.end_time
-        FROM activities a
-        JOIN registrations r ON a.id = r.activity_id
-        WHERE r.student_id = ?
-        AND a.status = ?
-        AND (
-            (a.start_time <= ? AND a.end_time > ?) OR
-            (a.start_time < ? AND a.end_time >= ?) OR
-            (a.start_time >= ? AND a.end_time <= ?)
-        )
-    )";
-    
-    if (excludeActivityId > 0) {
-        sql += " AND a.id != ?";
+    if (maxParticipants <= 0) {
+        return false;
     }
     
-    query.prepare(sql);
-    query.addBindValue(studentId);
-    query.addBindValue(static_cast<int>(ActivityStatus::Approved));
-    query.addBindValue(startTime);
-    query.addBindValue(startTime);
-    query.addBindValue(endTime);
-    query.addBindValue(endTime);
-    query.addBindValue(startTime);
-    query.addBindValue(endTime);
-    
-    if (excludeActivityId > 0) {
-        query.addBindValue(excludeActivityId);
+    QSqlQuery query(db);
+    query.prepare("UPDATE activities SET max_participants = ? WHERE id = ?");
+    query.addBindValue(maxParticipants);
+    query.addBindValue(activityId);
+    if (!query.exec() || query.numRowsAffected() == 0) {
+        return false;
     }
     
-    if (query.exec()) {
-        while (query.next()) {
-            QHash<QString, QVariant> conflict;
-            conflict["id"] = query.value("id");
-            conflict["title"] = query.value("title");
-            conflict["start_time"] = query.value("start_time");
-            conflict["end_time"] = query.value("end_time");
-            conflicts.append(conflict);
-        }
+    // 上限提高后空出的名额由候补补上（上限降低时不会取消已有报名）
+    if (promoteWaitlist(activityId) < 0) {
+        return false;
     }
-    
-    return conflicts;
+    emit activityChanged(activityId);
+    return true;
 }
 
-QHash<QString, QVariant> Database::getActivityStatistics(int activityId)
+bool Database::setLotteryDeadline(int activityId, const QDateTime &deadline)
 {
-    QHash<QString, QVariant> stats;
     QSqlQuery query(db);
+    if (deadline.isValid()) {
+        query.prepare("UPDATE activities SET lottery_deadline = ?, lottery_seed = ? "
+                      "WHERE id = ? AND lottery_drawn_at IS NULL");
+        query.addBindValue(deadline);
+        query.addBindValue(static_cast<qint64>(QRandomGenerator::global()->generate()));
+        query.addBindValue(activityId);
+    } else {
+        query.prepare("UPDATE activities SET lottery_deadline = NULL, lottery_seed = NULL "
+                      "WHERE id = ? AND lottery_drawn_at IS NULL");
+        query.addBindValue(activityId);
+    }
     
+    if (!query.exec() || query.numRowsAffected() == 0) {
+        qDebug() << "[抽签] 设置抽签失败:" << activityId << query.lastError().text();
+        return false;
+    }
+    emit activityChanged(activityId);
+    return true;
+}
+
+bool Database::isLotteryPending(int activityId)
+{
+    QSqlQuery query(db);
+    query.prepare("SELECT 1 FROM activities WHERE id = ? AND lottery_deadline IS NOT NULL AND lottery_drawn_at IS NULL");
+    query.addBindValue(activityId);
+    return query.exec() && query.next();
+}
+
+bool Database::submitApplication(int activityId, const QString &studentId, const QString &studentName)
+{
+    // 只有截止前、尚未抽签的活动接受申请；截止时刻的判断与抽签使用同一列
+    QSqlQuery query(db);
     query.prepare(R"(
-        SELECT 
-            COUNT(DISTINCT r.id) as total_registrations,
-            COUNT(DISTINCT w.id) as total_waitlist,
-            a.max_participants,
-            a.current_participants
-        FROM activities a
-        LEFT JOIN registrations r ON a.id = r.activity_id
-        LEFT JOIN waitlist w ON a.id = w.activity_id
-        WHERE a.id = ?
+        INSERT OR IGNORE INTO applications (activity_id, student_id, student_name)
+        SELECT id, ?, ? FROM activities
+        WHERE id = ? AND lottery_drawn_at IS NULL AND lottery_deadline > ?
     )");
+    query.addBindValue(studentId);
+    query.addBindValue(studentName);
+    query.addBindValue(activityId);
+    query.addBindValue(QDateTime::currentDateTime());
+    
+    if (!query.exec()) {
+        qDebug() << "[抽签] 提交申请失败:" << query.lastError().text();
+        return false;
+    }
+    return query.numRowsAffected() > 0;
+}
+
+int Database::getApplicationCount(int activityId)
+{
+    QSqlQuery query(db);
+    query.prepare("SELECT COUNT(*) FROM applications WHERE activity_id = ?");
     query.addBindValue(activityId);
     
     if (query.exec() && query.next()) {
-        stats["total_registrations"] = query.value("total_registrations");
-        stats["total_waitlist"] = query.value("total_waitlist");
-        stats["max_participants"] = query.value("max_participants");
-        stats["current_participants"] = query.value("current_participants");
+        return query.value(0).toInt();
     }
+    return 0;
+}
+
+QDateTime Database::nextLotteryDeadline()
+{
+    QSqlQuery query(db);
+    query.prepare("SELECT MIN(lottery_deadline) FROM activities "
+                  "WHERE lottery_deadline IS NOT NULL AND lottery_drawn_at IS NULL AND status = ?");
+    query.addBindValue(static_cast<int>(ActivityStatus::Approved));
     
-    return stats;
+    if (query.exec() && query.next()) {
+        return query.value(0).toDateTime();
+    }
+    return QDateTime();
 }
 
-QList<QHash<QString, QVariant>> Database::getAllStatistics()
+namespace {
+
+// 在 [0, bound) 中均匀取值。不用 std::uniform_int_distribution：它的算法由标准库实现决定，
+// 换编译器后同一种子的结果会不同；mt19937 的输出序列则是标准规定的
+quint32 drawBelow(std::mt19937 &rng, quint32 bound)
 {
-    QList<QHash<QString, QVariant>> allStats;
+    const quint32 threshold = (0u - bound) % bound;  // 舍去不能整除的尾部，避免偏差
+    for (;;) {
+        quint32 value = static_cast<quint32>(rng());
+        if (value >= threshold) {
+            return value % bound;
+        }
+    }
+}
+
+struct Interval {
+    int activityId;
+    qint64 start;
+    qint64 end;
+};
+
+bool overlapsAny(const QVector<Interval> &schedule, int activityId, qint64 start, qint64 end)
+{
+    for (const Interval &interval : schedule) {
+        if (interval.activityId != activityId && interval.start < end && interval.end > start) {
+            return true;
+        }
+    }
+    return false;
+}
+
+} // namespace
+
+QList<LotteryResult> Database::drawDueLotteries(const QDateTime &now)
+{
+    struct DueActivity {
+        int id;
+        quint32 seed;
+        int freeSeats;
+        qint64 start;
+        qint64 end;
+    };
+    struct Applicant {
+        QString studentId;
+        QString studentName;
+    };
+    
+    QList<LotteryResult> results;
     QSqlQuery query(db);
+    query.setForwardOnly(true);
     
+    if (!db.transaction()) {
+        qDebug() << "[抽签] 开启事务失败:" << db.lastError().text();
+        return results;
+    }
+    auto fail = [this, &results](const QSqlQuery &failed) {
+        qDebug() << "[抽签] 抽签失败:" << failed.lastError().text();
+        db.rollback();
+        results.clear();
+        return results;
+    };
+    
+    // 按截止时间先后抽签，先截止的活动先占用学生的时间段
+    QList<DueActivity> due;
     query.prepare(R"(
-        SELECT 
-            a.id,
-            a.title,
-            a.category,
-            a.organizer,
-            a.start_time,
-            a.end_time,
-            a.max_participants,
-            COUNT(DISTINCT r.id) as current_participants,
-            COUNT(DISTINCT w.id) as waitlist_count,
-            a.status
+        SELECT a.id, a.lottery_seed, a.start_time, a.end_time,
+               a.max_participants - (SELECT COUNT(*) FROM registrations r WHERE r.activity_id = a.id)
+        FROM activities a
+        WHERE a.lottery_deadline IS NOT NULL AND a.lottery_drawn_at IS NULL
+        AND a.lottery_deadline <= ? AND a.status = ?
+        ORDER BY a.lottery_deadline, a.id
+    )");
+    query.addBindValue(now);
+    query.addBindValue(static_cast<int>(ActivityStatus::Approved));
+    if (!query.exec()) {
+        return fail(query);
+    }
+    while (query.next()) {
+        due.append({query.value(0).toInt(), static_cast<quint32>(query.value(1).toLongLong()),
+                    qMax(0, query.value(4).toInt()),
+                    query.value(2).toDateTime().toMSecsSinceEpoch(),
+                    query.value(3).toDateTime().toMSecsSinceEpoch()});
+    }
+    query.finish();
+    if (due.isEmpty()) {
+        db.rollback();
+        return results;
+    }
+    
+    QStringList idList;
+    for (const DueActivity &activity : due) {
+        idList.append(QString::number(activity.id));
+    }
+    const QString ids = idList.join(",");
+    
+    // 申请人已报名的已批准、进行中活动一次读出，冲突检测在内存中进行
+    QHash<QString, QVector<Interval>> schedules;
+    query.prepare(QString(R"(
+        SELECT r.student_id, a.id, a.start_time, a.end_time
+        FROM registrations r
+        JOIN activities a ON a.id = r.activity_id
+        WHERE a.status IN (?, ?)
+        AND r.student_id IN (SELECT student_id FROM applications WHERE activity_id IN (%1))
+    )").arg(ids));
+    query.addBindValue(static_cast<int>(ActivityStatus::Approved));
+    query.addBindValue(static_cast<int>(ActivityStatus::Ongoing));
+    if (!query.exec()) {
+        return fail(query);
+    }
+    while (query.next()) {
+        schedules[query.value(0).toString()].append({query.value(1).toInt(),
+                                                     query.value(2).toDateTime().toMSecsSinceEpoch(),
+                                                     query.value(3).toDateTime().toMSecsSinceEpoch()});
+    }
+    query.finish();
+    
+    QSqlQuery applicationQuery(db);
+    applicationQuery.setForwardOnly(true);
+    applicationQuery.prepare("SELECT student_id, student_name FROM applications WHERE activity_id = ? ORDER BY id");
+    QSqlQuery registerQuery(db);
+    registerQuery.prepare("INSERT OR IGNORE INTO registrations (activity_id, student_id, student_name, status) VALUES (?, ?, ?, ?)");
+    QSqlQuery waitlistQuery(db);
+    waitlistQuery.prepare("INSERT OR IGNORE INTO waitlist (activity_id, student_id, student_name, added_at) VALUES (?, ?, ?, ?)");
+    QSqlQuery finishQuery(db);
+    finishQuery.prepare(R"(
+        UPDATE activities SET lottery_drawn_at = ?,
+            current_participants = (SELECT COUNT(*) FROM registrations r WHERE r.activity_id = activities.id)
+        WHERE id = ?
+    )");
+    QSqlQuery cleanupQuery(db);
+    cleanupQuery.prepare("DELETE FROM applications WHERE activity_id = ?");
+    
+    QList<QPair<int, QString>> winners;  // 提交后发出变更通知
+    for (const DueActivity &activity : due) {
+        QVector<Applicant> applicants;
+        applicationQuery.addBindValue(activity.id);
+        if (!applicationQuery.exec()) {
+            return fail(applicationQuery);
+        }
+        while (applicationQuery.next()) {
+            applicants.append({applicationQuery.value(0).toString(), applicationQuery.value(1).toString()});
+        }
+        applicationQuery.finish();
+        
+        // Fisher-Yates 洗牌：申请按提交顺序读出，种子相同则结果可复现
+        std::mt19937 rng(activity.seed);
+        for (int i = applicants.size() - 1; i > 0; --i) {
+            int j = static_cast<int>(drawBelow(rng, static_cast<quint32>(i + 1)));
+            std::swap(applicants[i], applicants[j]);
+        }
+        
+        LotteryResult result;
+        result.activityId = activity.id;
+        result.seed = activity.seed;
+        result.applicants = applicants.size();
+        
+        // 候补的 added_at 相同，按插入顺序（自增 id）排列，即抽签顺序
+        for (const Applicant &applicant : applicants) {
+            QVector<Interval> &schedule = schedules[applicant.studentId];
+            bool wins = result.winners < activity.freeSeats
+                && !overlapsAny(schedule, activity.id, activity.start, activity.end);
+            QSqlQuery &insert = wins ? registerQuery : waitlistQuery;
+            insert.addBindValue(activity.id);
+            insert.addBindValue(applicant.studentId);
+            insert.addBindValue(applicant.studentName);
+            insert.addBindValue(wins ? QVariant(static_cast<int>(RegistrationStatus::Registered)) : QVariant(now));
+            if (!insert.exec()) {
+                return fail(insert);
+            }
+            if (insert.numRowsAffected() == 0) {
+                continue;  // 已在报名或候补名单中
+            }
+            if (wins) {
+                schedule.append({activity.id, activity.start, activity.end});
+                winners.append(qMakePair(activity.id, applicant.studentId));
+                result.winners++;
+            } else {
+                result.waitlisted++;
+            }
+        }
+        
+        finishQuery.addBindValue(now);
+        finishQuery.addBindValue(activity.id);
+        cleanupQuery.addBindValue(activity.id);
+        if (!finishQuery.exec() || !cleanupQuery.exec()) {
+            return fail(finishQuery.lastError().isValid() ? finishQuery : cleanupQuery);
+        }
+        results.append(result);
+    }
+    
+    if (!db.commit()) {
+        qDebug() << "[抽签] 提交失败:" << db.lastError().text();
+        db.rollback();
+        return QList<LotteryResult>();
+    }
+    
+    // 只为中签的学生发报名变更通知；候补不在报名列表中显示
+    for (const auto &winner : winners) {
+        emit registrationChanged(winner.first, winner.second);
+    }
+    for (const LotteryResult &result : results) {
+        qDebug() << "[抽签] 活动" << result.activityId << "申请" << result.applicants
+                 << "人，中签" << result.winners << "人，候补" << result.waitlisted << "人";
+        emit activityChanged(result.activityId);
+    }
+    return results;
+}
+
+int Database::createMatchRound(const QString &title, const QDateTime &cutoff, const QString &createdBy)
+{
+    QSqlQuery query(db);
+    query.prepare("INSERT INTO match_rounds (title, cutoff, seed, created_by) VALUES (?, ?, ?, ?)");
+    query.addBindValue(title);
+    query.addBindValue(cutoff);
+    query.addBindValue(static_cast<qint64>(QRandomGenerator::global()->generate()));
+    query.addBindValue(createdBy);
+    
+    if (!query.exec()) {
+        qDebug() << "[志愿匹配] 创建轮次失败:" << query.lastError().text();
+        return -1;
+    }
+    int roundId = query.lastInsertId().toInt();
+    emit matchRoundCreated(roundId);
+    return roundId;
+}
+
+QList<QHash<QString, QVariant>> Database::getOpenMatchRounds()
+{
+    QList<QHash<QString, QVariant>> rounds;
+    QSqlQuery query(db);
+    query.prepare("SELECT id, title, cutoff FROM match_rounds WHERE matched_at IS NULL AND cutoff > ? ORDER BY cutoff");
+    query.addBindValue(QDateTime::currentDateTime());
+    
+    if (query.exec()) {
+        while (query.next()) {
+            QHash<QString, QVariant> round;
+            round["id"] = query.value("id");
+            round["title"] = query.value("title");
+            round["cutoff"] = query.value("cutoff");
+            rounds.append(round);
+        }
+    }
+    return rounds;
+}
+
+bool Database::submitPreferences(int roundId, const QString &studentId, const QString &studentName,
+                                 const QList<int> &rankedActivityIds, int maxAssignments)
+{
+    if (rankedActivityIds.isEmpty() || maxAssignments <= 0) {
+        return false;
+    }
+    if (!executeStatement("SAVEPOINT submit_preferences")) {
+        return false;
+    }
+    auto fail = [this](const QSqlQuery &query) {
+        qDebug() << "[志愿匹配] 提交志愿失败:" << query.lastError().text();
+        executeStatement("ROLLBACK TO submit_preferences");
+        executeStatement("RELEASE submit_preferences");
+        return false;
+    };
+    
+    QSqlQuery query(db);
+    query.prepare("SELECT 1 FROM match_rounds WHERE id = ? AND matched_at IS NULL AND cutoff > ?");
+    query.addBindValue(roundId);
+    query.addBindValue(QDateTime::currentDateTime());
+    if (!query.exec()) {
+        return fail(query);
+    }
+    if (!query.next()) {
+        query.finish();
+        executeStatement("RELEASE submit_preferences");
+        return false;  // 轮次不存在或已截止
+    }
+    query.finish();
+    
+    query.prepare("INSERT OR REPLACE INTO match_requests (round_id, student_id, student_name, max_assignments) "
+                  "VALUES (?, ?, ?, ?)");
+    query.addBindValue(roundId);
+    query.addBindValue(studentId);
+    query.addBindValue(studentName);
+    query.addBindValue(maxAssignments);
+    if (!query.exec()) {
+        return fail(query);
+    }
+    query.prepare("DELETE FROM match_preferences WHERE round_id = ? AND student_id = ?");
+    query.addBindValue(roundId);
+    query.addBindValue(studentId);
+    if (!query.exec()) {
+        return fail(query);
+    }
+    
+    // 不符合条件的活动在匹配时才排除（截止前可能被批准），这里只去掉重复
+    QSet<int> seen;
+    int rank = 0;
+    query.prepare("INSERT INTO match_preferences (round_id, student_id, preference_rank, activity_id) VALUES (?, ?, ?, ?)");
+    for (int activityId : rankedActivityIds) {
+        if (activityId <= 0 || seen.contains(activityId)) {
+            continue;
+        }
+        seen.insert(activityId);
+        query.addBindValue(roundId);
+        query.addBindValue(studentId);
+        query.addBindValue(++rank);
+        query.addBindValue(activityId);
+        if (!query.exec()) {
+            return fail(query);
+        }
+    }
+    
+    return executeStatement("RELEASE submit_preferences");
+}
+
+QDateTime Database::nextMatchCutoff()
+{
+    QSqlQuery query(db);
+    if (query.exec("SELECT MIN(cutoff) FROM match_rounds WHERE matched_at IS NULL") && query.next()) {
+        return query.value(0).toDateTime();
+    }
+    return QDateTime();
+}
+
+QList<MatchRoundResult> Database::runDueMatchRounds(const QDateTime &now)
+{
+    QList<MatchRoundResult> results;
+    QSqlQuery query(db);
+    query.setForwardOnly(true);
+    
+    if (!db.transaction()) {
+        qDebug() << "[志愿匹配] 开启事务失败:" << db.lastError().text();
+        return results;
+    }
+    auto fail = [this, &results](const QSqlQuery &failed) {
+        qDebug() << "[志愿匹配] 匹配失败:" << failed.lastError().text();
+        db.rollback();
+        results.clear();
+        return results;
+    };
+    
+    QList<QPair<int, quint32>> rounds;
+    query.prepare("SELECT id, seed FROM match_rounds WHERE matched_at IS NULL AND cutoff <= ? ORDER BY cutoff, id");
+    query.addBindValue(now);
+    if (!query.exec()) {
+        return fail(query);
+    }
+    while (query.next()) {
+        rounds.append(qMakePair(query.value(0).toInt(), static_cast<quint32>(query.value(1).toLongLong())));
+    }
+    query.finish();
+    if (rounds.isEmpty()) {
+        db.rollback();
+        return results;
+    }
+    
+    QSqlQuery registerQuery(db);
+    registerQuery.prepare("INSERT OR IGNORE INTO registrations (activity_id, student_id, student_name, status) VALUES (?, ?, ?, ?)");
+    QSqlQuery assignedQuery(db);
+    assignedQuery.prepare("UPDATE match_preferences SET assigned = 1 WHERE round_id = ? AND student_id = ? AND activity_id = ?");
+    QSqlQuery counterQuery(db);
+    counterQuery.prepare(R"(
+        UPDATE activities SET current_participants =
+            (SELECT COUNT(*) FROM registrations r WHERE r.activity_id = activities.id)
+        WHERE id = ?
+    )");
+    QSqlQuery finishQuery(db);
+    finishQuery.prepare("UPDATE match_rounds SET matched_at = ? WHERE id = ?");
+    
+    QList<QPair<int, QString>> assigned;  // 提交后发出变更通知
+    QSet<int> touchedActivities;
+    for (const auto &round : rounds) {
+        const int roundId = round.first;
+        
+        // 参与匹配的活动：已批准、不在抽签中，名额为上限减去已有报名
+        QVector<PreferenceMatcher::Activity> activities;
+        QVector<int> activityIds;
+        QHash<int, int> activityIndex;
+        query.prepare(R"(
+            SELECT a.id, a.start_time, a.end_time,
+                   a.max_participants - (SELECT COUNT(*) FROM registrations r WHERE r.activity_id = a.id)
+            FROM activities a
+            WHERE a.id IN (SELECT DISTINCT activity_id FROM match_preferences WHERE round_id = ?)
+            AND a.status = ?
+            AND (a.lottery_deadline IS NULL OR a.lottery_drawn_at IS NOT NULL)
+        )");
+        query.addBindValue(roundId);
+        query.addBindValue(static_cast<int>(ActivityStatus::Approved));
+        if (!query.exec()) {
+            return fail(query);
+        }
+        while (query.next()) {
+            PreferenceMatcher::Activity activity;
+            activity.start = query.value(1).toDateTime().toMSecsSinceEpoch();
+            activity.end = query.value(2).toDateTime().toMSecsSinceEpoch();
+            activity.capacity = qMax(0, query.value(3).toInt());
+            activityIndex.insert(query.value(0).toInt(), activities.size());
+            activityIds.append(query.value(0).toInt());
+            activities.append(activity);
+        }
+        query.finish();
+        
+        QVector<PreferenceMatcher::Student> students;
+        QVector<QPair<QString, QString>> identities;   // 学号、姓名
+        QHash<QString, int> studentIndex;
+        query.prepare("SELECT student_id, student_name, max_assignments FROM match_requests WHERE round_id = ? ORDER BY student_id");
+        query.addBindValue(roundId);
+        if (!query.exec()) {
+            return fail(query);
+        }
+        while (query.next()) {
+            PreferenceMatcher::Student student;
+            student.maxAssignments = qMax(1, query.value(2).toInt());
+            studentIndex.insert(query.value(0).toString(), students.size());
+            identities.append(qMakePair(query.value(0).toString(), query.value(1).toString()));
+            students.append(student);
+        }
+        query.finish();
+        
+        query.prepare("SELECT student_id, activity_id FROM match_preferences WHERE round_id = ? ORDER BY student_id, preference_rank");
+        query.addBindValue(roundId);
+        if (!query.exec()) {
+            return fail(query);
+        }
+        while (query.next()) {
+            auto student = studentIndex.constFind(query.value(0).toString());
+            auto activity = activityIndex.constFind(query.value(1).toInt());
+            if (student != studentIndex.constEnd() && activity != activityIndex.constEnd()) {
+                students[student.value()].preferences.append(activity.value());
+            }
+        }
+        query.finish();
+        
+        // 学生已有的日程（前面的轮次在本事务中写入的报名也在内）
+        query.prepare(R"(
+            SELECT r.student_id, a.start_time, a.end_time
+            FROM registrations r
+            JOIN activities a ON a.id = r.activity_id
+            WHERE a.status IN (?, ?)
+            AND r.student_id IN (SELECT student_id FROM match_requests WHERE round_id = ?)
+        )");
+        query.addBindValue(static_cast<int>(ActivityStatus::Approved));
+        query.addBindValue(static_cast<int>(ActivityStatus::Ongoing));
+        query.addBindValue(roundId);
+        if (!query.exec()) {
+            return fail(query);
+        }
+        while (query.next()) {
+            auto student = studentIndex.constFind(query.value(0).toString());
+            if (student != studentIndex.constEnd()) {
+                students[student.value()].busy.append(qMakePair(query.value(1).toDateTime().toMSecsSinceEpoch(),
+                                                                query.value(2).toDateTime().toMSecsSinceEpoch()));
+            }
+        }
+        query.finish();
+        
+        // 学生之间的优先顺序：按种子打乱后的位置（与抽签使用同样可复现的洗牌）
+        std::mt19937 rng(round.second);
+        QVector<int> order(students.size());
+        for (int i = 0; i < order.size(); ++i) {
+            order[i] = i;
+        }
+        for (int i = order.size() - 1; i > 0; --i) {
+            std::swap(order[i], order[static_cast<int>(drawBelow(rng, static_cast<quint32>(i + 1)))]);
+        }
+        for (int i = 0; i < order.size(); ++i) {
+            students[order[i]].priority = static_cast<quint32>(i);
+        }
+        
+        PreferenceMatcher matcher(activities, students);
+        matcher.run();
+        
+        MatchRoundResult result;
+        result.roundId = roundId;
+        result.seed = round.second;
+        result.students = students.size();
+        for (int s = 0; s < students.size(); ++s) {
+            for (int activity : matcher.assignments(s)) {
+                const int activityId = activityIds[activity];
+                registerQuery.addBindValue(activityId);
+                registerQuery.addBindValue(identities[s].first);
+                registerQuery.addBindValue(identities[s].second);
+                registerQuery.addBindValue(static_cast<int>(RegistrationStatus::Registered));
+                assignedQuery.addBindValue(roundId);
+                assignedQuery.addBindValue(identities[s].first);
+                assignedQuery.addBindValue(activityId);
+                if (!registerQuery.exec() || !assignedQuery.exec()) {
+                    return fail(registerQuery.lastError().isValid() ? registerQuery : assignedQuery);
+                }
+                assigned.append(qMakePair(activityId, identities[s].first));
+                touchedActivities.insert(activityId);
+                result.assignments++;
+            }
+        }
+        
+        finishQuery.addBindValue(now);
+        finishQuery.addBindValue(roundId);
+        if (!finishQuery.exec()) {
+            return fail(finishQuery);
+        }
+        results.append(result);
+    }
+    
+    for (int activityId : touchedActivities) {
+        counterQuery.addBindValue(activityId);
+        if (!counterQuery.exec()) {
+            return fail(counterQuery);
+        }
+    }
+    
+    if (!db.commit()) {
+        qDebug() << "[志愿匹配] 提交失败:" << db.lastError().text();
+        db.rollback();
+        return QList<MatchRoundResult>();
+    }
+    
+    for (const auto &registration : assigned) {
+        emit registrationChanged(registration.first, registration.second);
+    }
+    for (int activityId : touchedActivities) {
+        emit activityChanged(activityId);
+    }
+    for (const MatchRoundResult &result : results) {
+        qDebug() << "[志愿匹配] 轮次" << result.roundId << "学生" << result.students
+                 << "人，分配" << result.assignments << "个名额";
+    }
+    return results;
+}
+
+QList<QHash<QString, QVariant>> Database::checkTimeConflict(const QString &studentId,
+                                                            const QDateTime &startTime,
+                                                            const QDateTime &endTime,
+                                                            int excludeActivityId)
+{
+    QList<QHash<QString, QVariant>> conflicts;
+    QSqlQuery query(db);
+    
+    QString sql = R"(
+        SELECT a.id, a.title, a.start_time, a.end_time
+        FROM activities a
+        JOIN registrations r ON a.id = r.activity_id
+        WHERE r.student_id = ?
+        AND a.status IN (?, ?)
+        AND (
+            (a.start_time <= ? AND a.end_time > ?) OR
+            (a.start_time < ? AND a.end_time >= ?) OR
+            (a.start_time >= ? AND a.end_time <= ?)
+        )
+    )";
+    
+    if (excludeActivityId > 0) {
+        sql += " AND a.id != ?";
+    }
+    
+    query.prepare(sql);
+    query.addBindValue(studentId);
+    query.addBindValue(static_cast<int>(ActivityStatus::Approved));
+    query.addBindValue(static_cast<int>(ActivityStatus::Ongoing));
+    query.addBindValue(startTime);
+    query.addBindValue(startTime);
+    query.addBindValue(endTime);
+    query.addBindValue(endTime);
+    query.addBindValue(startTime);
+    query.addBindValue(endTime);
+    
+    if (excludeActivityId > 0) {
+        query.addBindValue(excludeActivityId);
+    }
+    
+    if (query.exec()) {
+        while (query.next()) {
+            QHash<QString, QVariant> conflict;
+            conflict["id"] = query.value("id");
+            conflict["title"] = query.value("title");
+            conflict["start_time"] = query.value("start_time");
+            conflict["end_time"] = query.value("end_time");
+            conflicts.append(conflict);
+        }
+    }
+    
+    return conflicts;
+}
+
+QList<QHash<QString, QVariant>> Database::getStudentApprovedSchedule(const QString &studentId)
+{
+    QList<QHash<QString, QVariant>> schedule;
+    QSqlQuery query(db);
+    
+    // 与 checkTimeConflict 的连接条件一致，只是不限定时间段
+    query.prepare(R"(
+        SELECT a.id, a.title, a.start_time, a.end_time
+        FROM activities a
+        JOIN registrations r ON a.id = r.activity_id
+        WHERE r.student_id = ?
+        AND a.status IN (?, ?)
+    )");
+    query.addBindValue(studentId);
+    query.addBindValue(static_cast<int>(ActivityStatus::Approved));
+    query.addBindValue(static_cast<int>(ActivityStatus::Ongoing));
+    
+    if (!query.exec()) {
+        qDebug() << "[冲突检测] 查询学生日程失败:" << query.lastError().text();
+        return schedule;
+    }
+    
+    while (query.next()) {
+        QHash<QString, QVariant> activity;
+        activity["id"] = query.value("id");
+        activity["title"] = query.value("title");
+        activity["start_time"] = query.value("start_time");
+        activity["end_time"] = query.value("end_time");
+        schedule.append(activity);
+    }
+    
+    return schedule;
+}
+
+QList<QHash<QString, QVariant>> Database::checkLocationConflict(const QString &location,
+                                                                const QDateTime &startTime,
+                                                                const QDateTime &endTime,
+                                                                int excludeActivityId,
+                                                                bool includePending)
+{
+    QList<QHash<QString, QVariant>> conflicts;
+    QString key = RoomIndex::locationKey(location);
+    if (key.isEmpty()) {
+        return conflicts;
+    }
+    
+    // 按 (location_key, start_time) 索引只扫描该地点开始时间早于 endTime 的预订
+    QString sql = R"(
+        SELECT id, title, organizer, start_time, end_time, status
+        FROM activities
+        WHERE location_key = ?
+        AND start_time < ? AND end_time > ?
+    )";
+    sql += includePending ? " AND status IN (?, ?, ?)" : " AND status IN (?, ?)";
+    if (excludeActivityId > 0) {
+        sql += " AND id != ?";
+    }
+    sql += " ORDER BY start_time";
+    
+    QSqlQuery query(db);
+    query.prepare(sql);
+    query.addBindValue(key);
+    query.addBindValue(endTime);
+    query.addBindValue(startTime);
+    query.addBindValue(static_cast<int>(ActivityStatus::Approved));
+    query.addBindValue(static_cast<int>(ActivityStatus::Ongoing));
+    if (includePending) {
+        query.addBindValue(static_cast<int>(ActivityStatus::Pending));
+    }
+    if (excludeActivityId > 0) {
+        query.addBindValue(excludeActivityId);
+    }
+    
+    if (!query.exec()) {
+        qDebug() << "[场地冲突] 查询失败:" << query.lastError().text();
+        return conflicts;
+    }
+    
+    while (query.next()) {
+        QHash<QString, QVariant> activity;
+        activity["id"] = query.value("id");
+        activity["title"] = query.value("title");
+        activity["organizer"] = query.value("organizer");
+        activity["start_time"] = query.value("start_time");
+        activity["end_time"] = query.value("end_time");
+        activity["status"] = query.value("status");
+        conflicts.append(activity);
+    }
+    
+    return conflicts;
+}
+
+QList<RoomConflict> Database::validatePendingLocations()
+{
+    QList<RoomConflict> conflicts;
+    QSqlQuery query(db);
+    query.prepare(R"(
+        SELECT id, title, location, location_key, start_time, end_time, status
+        FROM activities
+        WHERE location_key IS NOT NULL
+        AND status IN (?, ?, ?)
+        AND end_time > ?
+        ORDER BY location_key, start_time
+    )");
+    query.addBindValue(static_cast<int>(ActivityStatus::Pending));
+    query.addBindValue(static_cast<int>(ActivityStatus::Approved));
+    query.addBindValue(static_cast<int>(ActivityStatus::Ongoing));
+    query.addBindValue(QDateTime::currentDateTime());
+    
+    if (!query.exec()) {
+        qDebug() << "[场地冲突] 批量校验查询失败:" << query.lastError().text();
+        return conflicts;
+    }
+    
+    struct Booking {
+        int id;
+        QString title;
+        QString location;
+        QString key;
+        QDateTime startTime;
+        QDateTime endTime;
+        ActivityStatus status;
+    };
+    QVector<Booking> bookings;
+    QHash<int, int> indexById;
+    RoomIndex occupied;   // 已批准、进行中
+    while (query.next()) {
+        Booking booking;
+        booking.id = query.value(0).toInt();
+        booking.title = query.value(1).toString();
+        booking.location = query.value(2).toString();
+        booking.key = query.value(3).toString();
+        booking.startTime = query.value(4).toDateTime();
+        booking.endTime = query.value(5).toDateTime();
+        booking.status = static_cast<ActivityStatus>(query.value(6).toInt());
+        if (booking.status != ActivityStatus::Pending) {
+            occupied.add(booking.key, booking.id, booking.startTime.toMSecsSinceEpoch(),
+                         booking.endTime.toMSecsSinceEpoch());
+        }
+        indexById.insert(booking.id, bookings.size());
+        bookings.append(booking);
+    }
+    
+    // 待审批活动按开始时间依次检查：先和已占用的比，再和之前检查过的待审批活动比（每对只报告一次）
+    RoomIndex pending;
+    for (const Booking &booking : bookings) {
+        if (booking.status != ActivityStatus::Pending) {
+            continue;
+        }
+        qint64 start = booking.startTime.toMSecsSinceEpoch();
+        qint64 end = booking.endTime.toMSecsSinceEpoch();
+        QList<int> overlaps = occupied.overlapping(booking.key, start, end, booking.id)
+                            + pending.overlapping(booking.key, start, end, booking.id);
+        for (int otherId : overlaps) {
+            const Booking &other = bookings[indexById.value(otherId)];
+            RoomConflict conflict;
+            conflict.activityId = booking.id;
+            conflict.title = booking.title;
+            conflict.location = booking.location;
+            conflict.startTime = booking.startTime;
+            conflict.endTime = booking.endTime;
+            conflict.conflictingId = other.id;
+            conflict.conflictingTitle = other.title;
+            conflict.conflictingStatus = other.status;
+            conflicts.append(conflict);
+        }
+        pending.add(booking.key, booking.id, start, end);
+    }
+    
+    qDebug() << "[场地冲突] 校验活动" << bookings.size() << "个（已占用" << occupied.size()
+             << "个），冲突" << conflicts.size() << "处";
+    return conflicts;
+}
+
+bool Database::loadSnapshotFrom(const QString &sourceFile)
+{
+    QSqlQuery query(db);
+    query.prepare("ATTACH DATABASE ? AS snapshot_source");
+    query.addBindValue(sourceFile);
+    if (!query.exec()) {
+        qDebug() << "[快照] 附加数据库失败:" << query.lastError().text();
+        return false;
+    }
+    
+    // 预写日志模式下读事务不阻塞写入，所有复制在同一个事务中完成，源库上是一个一致的读快照。
+    // 回滚日志模式下读事务持有源文件的共享锁，写入要等它结束才能提交，
+    // 因此每个表单独一个事务，写入最多等待一个表的复制（各表之间不再保证是同一时刻）
+    bool wal = query.exec("PRAGMA snapshot_source.journal_mode") && query.next()
+               && query.value(0).toString().compare("wal", Qt::CaseInsensitive) == 0;
+    query.finish();
+    
+    bool success = db.transaction();
+    if (success) {
+        QList<QPair<QString, QString>> tables;
+        QStringList indexes;
+        success = query.exec("SELECT type, name, sql FROM snapshot_source.sqlite_master "
+                             "WHERE sql IS NOT NULL AND name NOT LIKE 'sqlite_%'");
+        while (success && query.next()) {
+            if (query.value(0).toString() == "table") {
+                tables.append(qMakePair(query.value(1).toString(), query.value(2).toString()));
+            } else if (query.value(0).toString() == "index") {
+                indexes.append(query.value(2).toString());
+            }
+        }
+        
+        for (int i = 0; i < tables.size() && success; ++i) {
+            const auto &table = tables[i];
+            if (!wal && i > 0) {
+                success = db.commit() && db.transaction();  // 释放源文件上的共享锁
+            }
+            QString name = "\"" + QString(table.first).replace("\"", "\"\"") + "\"";
+            success = success && query.exec("DROP TABLE IF EXISTS main." + name)
+                   && query.exec(table.second)
+                   && query.exec("INSERT INTO main." + name + " SELECT * FROM snapshot_source." + name);
+        }
+        for (const QString &index : indexes) {
+            if (!success) break;
+            success = query.exec(index);
+        }
+        
+        if (success) {
+            success = db.commit();
+        } else {
+            qDebug() << "[快照] 复制失败:" << query.lastError().text();
+            db.rollback();
+        }
+    }
+    
+    query.finish();
+    if (!query.exec("DETACH DATABASE snapshot_source")) {
+        qDebug() << "[快照] 分离数据库失败:" << query.lastError().text();
+    }
+    return success;
+}
+
+QString Database::archiveFileName() const
+{
+    // 与主库放在同一目录：activity_management.db -> activity_management_archive.db
+    QFileInfo info(db.databaseName());
+    return info.dir().filePath(info.completeBaseName() + "_archive.db");
+}
+
+QStringList Database::tableColumns(const QString &schema, const QString &table)
+{
+    QStringList columns;
+    QSqlQuery query(db);
+    if (query.exec(QString("PRAGMA %1.table_info(%2)").arg(schema, table))) {
+        while (query.next()) {
+            columns.append(query.value("name").toString());
+        }
+    }
+    return columns;
+}
+
+bool Database::ensureArchiveTable(const QString &table)
+{
+    QSqlQuery query(db);
+    QStringList archivedColumns = tableColumns("archive", table);
+    
+    if (archivedColumns.isEmpty()) {
+        // 按主库的列和类型建表，只保留主键，不带唯一约束和外键
+        QStringList definitions;
+        if (query.exec(QString("PRAGMA main.table_info(%1)").arg(table))) {
+            while (query.next()) {
+                QString definition = query.value("name").toString() + " " + query.value("type").toString();
+                if (query.value("pk").toInt() > 0) {
+                    definition += " PRIMARY KEY";
+                }
+                definitions.append(definition);
+            }
+        }
+        if (definitions.isEmpty()
+            || !query.exec(QString("CREATE TABLE archive.%1 (%2)").arg(table, definitions.join(", ")))) {
+            qDebug() << "[归档] 创建归档表失败:" << table << query.lastError().text();
+            return false;
+        }
+        return true;
+    }
+    
+    // 主库后来新增的列同样加到归档表
+    for (const QString &column : tableColumns("main", table)) {
+        if (!archivedColumns.contains(column)
+            && !query.exec(QString("ALTER TABLE archive.%1 ADD COLUMN %2").arg(table, column))) {
+            qDebug() << "[归档] 归档表添加列失败:" << table << column << query.lastError().text();
+            return false;
+        }
+    }
+    return true;
+}
+
+bool Database::attachArchive()
+{
+    QSqlQuery query(db);
+    query.prepare("ATTACH DATABASE ? AS archive");
+    query.addBindValue(archiveFileName());
+    if (!query.exec()) {
+        qDebug() << "[归档] 附加归档库失败:" << query.lastError().text();
+        return false;
+    }
+    
+    if (!ensureArchiveTable("activities")
+        || !ensureArchiveTable("registrations")
+        || !ensureArchiveTable("waitlist")
+        || !ensureArchiveTable("applications")) {
+        detachArchive();
+        return false;
+    }
+    query.exec("CREATE INDEX IF NOT EXISTS archive.idx_archive_activities_start ON activities(start_time)");
+    query.exec("CREATE INDEX IF NOT EXISTS archive.idx_archive_registrations_activity ON registrations(activity_id)");
+    query.exec("CREATE INDEX IF NOT EXISTS archive.idx_archive_registrations_student ON registrations(student_id)");
+    query.exec("CREATE INDEX IF NOT EXISTS archive.idx_archive_waitlist_activity ON waitlist(activity_id)");
+    query.exec("CREATE INDEX IF NOT EXISTS archive.idx_archive_applications_activity ON applications(activity_id)");
+    return true;
+}
+
+void Database::detachArchive()
+{
+    QSqlQuery query(db);
+    if (!query.exec("DETACH DATABASE archive")) {
+        qDebug() << "[归档] 分离归档库失败:" << query.lastError().text();
+    }
+}
+
+int Database::archiveFinishedActivities(const QDateTime &cutoff, int batchSize)
+{
+    if (!attachArchive()) {
+        return -1;
+    }
+    
+    QList<int> activityIds;
+    QSqlQuery query(db);
+    query.prepare("SELECT id FROM main.activities WHERE status = ? AND end_time < ? ORDER BY end_time LIMIT ?");
+    query.addBindValue(static_cast<int>(ActivityStatus::Finished));
+    query.addBindValue(cutoff);
+    query.addBindValue(qMax(1, batchSize));
+    if (query.exec()) {
+        while (query.next()) {
+            activityIds.append(query.value(0).toInt());
+        }
+    }
+    
+    bool success = true;
+    if (!activityIds.isEmpty()) {
+        // ID 均为整数，直接拼进 IN 列表
+        QStringList idList;
+        for (int id : activityIds) {
+            idList.append(QString::number(id));
+        }
+        const QString ids = idList.join(",");
+        
+        // 主库为预写日志模式时，跨附加库的事务在两个文件上分别提交，不是原子的。
+        // 因此分两步：先把复制提交到归档库，再在主库中只删除归档库里已有的记录。
+        // 两步之间中断时记录暂时两边都有，下次重复复制（按主键覆盖）后照常删除，不会丢失也不会卡住
+        const QList<QPair<QString, QString>> tables = {
+            qMakePair(QString("registrations"), QString("activity_id")),
+            qMakePair(QString("waitlist"), QString("activity_id")),
+            qMakePair(QString("applications"), QString("activity_id")),
+            qMakePair(QString("activities"), QString("id"))
+        };
+        success = db.transaction();
+        for (const auto &table : tables) {
+            if (!success) break;
+            QString columns = tableColumns("main", table.first).join(", ");
+            success = query.exec(QString("INSERT OR REPLACE INTO archive.%1 (%2) SELECT %2 FROM main.%1 WHERE %3 IN (%4)")
+                                     .arg(table.first, columns, table.second, ids));
+        }
+        if (success) {
+            success = db.commit();
+        } else {
+            qDebug() << "[归档] 复制失败:" << query.lastError().text();
+            db.rollback();
+        }
+        
+        if (success) {
+            success = db.transaction();
+            // 已归档活动的提醒、通知和匹配志愿不再需要，直接删除
+            for (const QString &table : {QString("reminders"), QString("notification_outbox"),
+                                         QString("match_preferences")}) {
+                if (!success) break;
+                success = query.exec(QString("DELETE FROM main.%1 WHERE activity_id IN "
+                                             "(SELECT id FROM archive.activities WHERE id IN (%2))").arg(table, ids));
+            }
+            for (const auto &table : tables) {
+                if (!success) break;
+                success = query.exec(QString("DELETE FROM main.%1 WHERE id IN "
+                                             "(SELECT id FROM archive.%1 WHERE %2 IN (%3))")
+                                         .arg(table.first, table.second, ids));
+            }
+            if (success) {
+                success = db.commit();
+            } else {
+                qDebug() << "[归档] 删除失败:" << query.lastError().text();
+                db.rollback();
+            }
+        }
+    }
+    
+    query.finish();
+    detachArchive();
+    if (!success) {
+        return -1;
+    }
+    
+    for (int id : activityIds) {
+        emit activityChanged(id);
+    }
+    return activityIds.size();
+}
+
+bool Database::syncActivityReminders(int activityId, int leadMinutes)
+{
+    QSqlQuery query(db);
+    query.prepare("SELECT start_time, status FROM activities WHERE id = ?");
+    query.addBindValue(activityId);
+    if (!query.exec()) {
+        qDebug() << "[提醒] 读取活动失败:" << query.lastError().text();
+        return false;
+    }
+    
+    bool remindable = false;
+    QDateTime startTime;
+    if (query.next()) {
+        startTime = query.value(0).toDateTime();
+        remindable = static_cast<ActivityStatus>(query.value(1).toInt()) == ActivityStatus::Approved
+                  && startTime > QDateTime::currentDateTime();
+    }
+    query.finish();
+    
+    if (!remindable) {
+        // 活动已删除、未批准或已开始：撤销尚未发出的提醒
+        query.prepare("DELETE FROM reminders WHERE activity_id = ? AND fired_at IS NULL");
+        query.addBindValue(activityId);
+        return query.exec();
+    }
+    
+    const QDateTime remindAt = startTime.addSecs(-60 * leadMinutes);
+    
+    // 已取消报名的学生
+    query.prepare("DELETE FROM reminders WHERE activity_id = ? AND student_id NOT IN "
+                  "(SELECT student_id FROM registrations WHERE activity_id = ?)");
+    query.addBindValue(activityId);
+    query.addBindValue(activityId);
+    if (!query.exec()) {
+        return false;
+    }
+    
+    // 活动改期：未发出的提醒跟着改
+    query.prepare("UPDATE reminders SET remind_at = ? WHERE activity_id = ? AND fired_at IS NULL AND remind_at <> ?");
+    query.addBindValue(remindAt);
+    query.addBindValue(activityId);
+    query.addBindValue(remindAt);
+    if (!query.exec()) {
+        return false;
+    }
+    
+    // 新报名的学生；已发出过提醒的保持不变
+    query.prepare("INSERT OR IGNORE INTO reminders (activity_id, student_id, remind_at) "
+                  "SELECT activity_id, student_id, ? FROM registrations WHERE activity_id = ?");
+    query.addBindValue(remindAt);
+    query.addBindValue(activityId);
+    if (!query.exec()) {
+        qDebug() << "[提醒] 生成提醒失败:" << query.lastError().text();
+        return false;
+    }
+    return true;
+}
+
+QDateTime Database::nextReminderTime()
+{
+    QSqlQuery query(db);
+    if (query.exec("SELECT MIN(remind_at) FROM reminders WHERE fired_at IS NULL") && query.next()) {
+        return query.value(0).toDateTime();
+    }
+    return QDateTime();
+}
+
+QList<ReminderRecord> Database::fireDueReminders(const QDateTime &now, int limit)
+{
+    QList<ReminderRecord> fired;
+    if (!db.transaction()) {
+        return fired;
+    }
+    
+    // 活动已不存在的提醒无法发出，先清掉，避免一直排在队首
+    QSqlQuery query(db);
+    query.prepare("DELETE FROM reminders WHERE fired_at IS NULL AND remind_at <= ? "
+                  "AND activity_id NOT IN (SELECT id FROM activities)");
+    query.addBindValue(now);
+    bool success = query.exec();
+    
+    query.setForwardOnly(true);
+    query.prepare(R"(
+        SELECT r.rowid, r.activity_id, r.student_id, a.title, a.location, a.start_time
+        FROM reminders r
+        JOIN activities a ON a.id = r.activity_id
+        WHERE r.fired_at IS NULL AND r.remind_at <= ?
+        ORDER BY r.remind_at
+        LIMIT ?
+    )");
+    query.addBindValue(now);
+    query.addBindValue(qMax(1, limit));
+    
+    QStringList rowIds;
+    success = success && query.exec();
+    while (success && query.next()) {
+        rowIds.append(query.value(0).toString());
+        ReminderRecord record;
+        record.activityId = query.value(1).toInt();
+        record.studentId = query.value(2).toString();
+        record.title = query.value(3).toString();
+        record.location = query.value(4).toString();
+        record.startTime = query.value(5).toDateTime();
+        record.message = QString("您报名的活动「%1」将于 %2 在%3开始")
+                             .arg(record.title, record.startTime.toString("MM-dd hh:mm"), record.location);
+        fired.append(record);
+    }
+    query.finish();
+    
+    // 写入发件箱并标记已发出，与取出在同一个事务中，重启后不会重复或遗漏
+    QSqlQuery insert(db);
+    insert.prepare("INSERT INTO notification_outbox (student_id, activity_id, message) VALUES (?, ?, ?)");
+    for (int i = 0; success && i < fired.size(); ++i) {
+        insert.addBindValue(fired[i].studentId);
+        insert.addBindValue(fired[i].activityId);
+        insert.addBindValue(fired[i].message);
+        success = insert.exec();
+        fired[i].notificationId = insert.lastInsertId().toInt();
+    }
+    if (success && !rowIds.isEmpty()) {
+        query.prepare(QString("UPDATE reminders SET fired_at = ? WHERE rowid IN (%1)").arg(rowIds.join(",")));
+        query.addBindValue(now);
+        success = query.exec();
+    }
+    
+    if (success && db.commit()) {
+        return fired;
+    }
+    qDebug() << "[提醒] 发出提醒失败:" << query.lastError().text() << insert.lastError().text();
+    db.rollback();
+    return QList<ReminderRecord>();
+}
+
+QList<ReminderRecord> Database::getUndeliveredNotifications(int limit)
+{
+    QList<ReminderRecord> notifications;
+    QSqlQuery query(db);
+    query.setForwardOnly(true);
+    query.prepare("SELECT id, student_id, activity_id, message FROM notification_outbox "
+                  "WHERE delivered_at IS NULL ORDER BY id LIMIT ?");
+    query.addBindValue(qMax(1, limit));
+    if (query.exec()) {
+        while (query.next()) {
+            ReminderRecord record;
+            record.notificationId = query.value(0).toInt();
+            record.studentId = query.value(1).toString();
+            record.activityId = query.value(2).toInt();
+            record.message = query.value(3).toString();
+            notifications.append(record);
+        }
+    }
+    return notifications;
+}
+
+bool Database::markNotificationsDelivered(const QList<int> &notificationIds)
+{
+    if (notificationIds.isEmpty()) {
+        return true;
+    }
+    QStringList ids;
+    for (int id : notificationIds) {
+        ids.append(QString::number(id));
+    }
+    QSqlQuery query(db);
+    query.prepare(QString("UPDATE notification_outbox SET delivered_at = ? WHERE id IN (%1)").arg(ids.join(",")));
+    query.addBindValue(QDateTime::currentDateTime());
+    return query.exec();
+}
+
+QHash<QString, QVariant> Database::getActivityStatistics(int activityId)
+{
+    QHash<QString, QVariant> stats;
+    QSqlQuery query(db);
+    
+    query.prepare(R"(
+        SELECT 
+            COUNT(DISTINCT r.id) as total_registrations,
+            COUNT(DISTINCT w.id) as total_waitlist,
+            a.max_participants,
+            a.current_participants
         FROM activities a
         LEFT JOIN registrations r ON a.id = r.activity_id
         LEFT JOIN waitlist w ON a.id = w.activity_id
-        GROUP BY a.id
-        ORDER BY a.start_time
+        WHERE a.id = ?
     )");
+    query.addBindValue(activityId);
+    
+    if (query.exec() && query.next()) {
+        stats["total_registrations"] = query.value("total_registrations");
+        stats["total_waitlist"] = query.value("total_waitlist");
+        stats["max_participants"] = query.value("max_participants");
+        stats["current_participants"] = query.value("current_participants");
+    }
+    
+    return stats;
+}
+
+QList<QHash<QString, QVariant>> Database::getAllStatistics(bool includeArchive)
+{
+    QList<QHash<QString, QVariant>> allStats;
+    
+    // 归档库只在明确要求时附加，平时的统计只扫描主库中的表
+    if (includeArchive && !attachArchive()) {
+        return allStats;
+    }
+    
+    const QString select = R"(
+        SELECT 
+            a.id,
+            a.title,
+            a.category,
+            a.organizer,
+            a.start_time,
+            a.end_time,
+            a.max_participants,
+            COUNT(DISTINCT r.id) as current_participants,
+            COUNT(DISTINCT w.id) as waitlist_count,
+            a.status
+        FROM %1.activities a
+        LEFT JOIN %1.registrations r ON a.id = r.activity_id
+        LEFT JOIN %1.waitlist w ON a.id = w.activity_id
+        GROUP BY a.id
+    )";
+    QString sql = select.arg("main");
+    if (includeArchive) {
+        sql += " UNION ALL " + select.arg("archive");
+    }
+    sql += " ORDER BY start_time";
+    
+    QSqlQuery query(db);
+    query.prepare(sql);
     
     if (query.exec()) {
         while (query.next()) {
@@ -780,49 +2853,225 @@ QList<QHash<QString, QVariant>> Database::getAllStatistics()
         }
     }
     
+    query.finish();
+    if (includeArchive) {
+        detachArchive();
+    }
+    
     return allStats;
 }
 
 bool Database::checkIn(int activityId, const QString &studentId, const QString &checkinCode)
 {
-    // 检查是否已报名
-    if (!isRegistered(activityId, studentId)) {
-        return false;
-    }
+    return tryCheckIn(activityId, studentId, checkinCode) == CheckInResult::Success;
+}
+
+CheckInResult Database::tryCheckIn(int activityId, const QString &studentId, const QString &checkinCode)
+{
+    QDateTime currentTime = QDateTime::currentDateTime();
+    bool verifyCode = !checkinCode.isEmpty();  // 学生端需要验证，管理员/发起人端不提供签到码
     
-    // 检查是否已签到
-    if (isCheckedIn(activityId, studentId)) {
-        return false;
-    }
+    // 按 UNIQUE(activity_id, student_id) 定位到报名行，活动按主键查一次
+    QSqlQuery query(db);
+    query.prepare(R"(
+        UPDATE registrations SET checkin_time = ?
+        WHERE activity_id = ? AND student_id = ?
+        AND checkin_time IS NULL
+        AND EXISTS (
+            SELECT 1 FROM activities a
+            WHERE a.id = registrations.activity_id
+            AND a.start_time <= ?
+            AND (? = 0 OR a.checkin_code = ?)
+        )
+    )");
+    query.addBindValue(currentTime);
+    query.addBindValue(activityId);
+    query.addBindValue(studentId);
+    query.addBindValue(currentTime);
+    query.addBindValue(verifyCode ? 1 : 0);
+    query.addBindValue(checkinCode);
     
-    // 检查活动是否已开始
-    QHash<QString, QVariant> activity = getActivity(activityId);
-    QDateTime startTime = activity["start_time"].toDateTime();
-    QDateTime currentTime = QDateTime::currentDateTime();
+    if (!query.exec()) {
+        qDebug() << "[签到] 签到失败:" << query.lastError().text();
+        return CheckInResult::Failed;
+    }
+    if (query.numRowsAffected() > 0) {
+        emit checkInRecorded(activityId, studentId);
+        return CheckInResult::Success;
+    }
     
-    if (currentTime < startTime) {
-        return false; // 活动尚未开始
+    // 没有更新时才查原因，判断顺序与条件顺序一致：报名、已签到、开始时间、签到码
+    query.prepare(R"(
+        SELECT r.checkin_time, a.start_time
+        FROM registrations r
+        JOIN activities a ON a.id = r.activity_id
+        WHERE r.activity_id = ? AND r.student_id = ?
+    )");
+    query.addBindValue(activityId);
+    query.addBindValue(studentId);
+    if (!query.exec()) {
+        qDebug() << "[签到] 查询签到失败原因失败:" << query.lastError().text();
+        return CheckInResult::Failed;
+    }
+    if (!query.next()) {
+        return CheckInResult::NotRegistered;
+    }
+    if (!query.value(0).isNull()) {
+        return CheckInResult::AlreadyCheckedIn;
+    }
+    if (currentTime < query.value(1).toDateTime()) {
+        return CheckInResult::TooEarly;
+    }
+    return CheckInResult::WrongCode;
+}
+
+QStringList Database::checkInBatch(int activityId, const QList<QPair<QString, QDateTime>> &checkIns)
+{
+    QStringList checkedIn;
+    if (checkIns.isEmpty() || !executeStatement("SAVEPOINT checkin_batch")) {
+        return checkedIn;
     }
     
-    // 如果提供了签到码，需要验证（学生端需要，管理员/发起人端不提供签到码）
-    if (!checkinCode.isEmpty()) {
-        QString storedCheckinCode = activity["checkin_code"].toString();
-        if (storedCheckinCode.isEmpty()) {
-            return false; // 活动没有设置签到码
+    // 与 tryCheckIn 相同的条件，预编译一次、逐项绑定
+    QSqlQuery query(db);
+    query.prepare(R"(
+        UPDATE registrations SET checkin_time = ?
+        WHERE activity_id = ? AND student_id = ?
+        AND checkin_time IS NULL
+        AND EXISTS (
+            SELECT 1 FROM activities a
+            WHERE a.id = registrations.activity_id
+            AND a.start_time <= ?
+        )
+    )");
+    for (const auto &checkIn : checkIns) {
+        query.addBindValue(checkIn.second);
+        query.addBindValue(activityId);
+        query.addBindValue(checkIn.first);
+        query.addBindValue(checkIn.second);
+        if (!query.exec()) {
+            qDebug() << "[签到机] 批量签到失败:" << query.lastError().text();
+            executeStatement("ROLLBACK TO checkin_batch");
+            executeStatement("RELEASE checkin_batch");
+            return QStringList();
         }
-        if (checkinCode != storedCheckinCode) {
-            return false; // 签到码不匹配
+        if (query.numRowsAffected() > 0) {
+            checkedIn.append(checkIn.first);
         }
     }
+    if (!executeStatement("RELEASE checkin_batch")) {
+        return QStringList();
+    }
+    
+    for (const QString &studentId : checkedIn) {
+        emit checkInRecorded(activityId, studentId);
+    }
+    return checkedIn;
+}
+
+CheckInImportResult Database::importCheckIns(int activityId, const QHash<QString, QDateTime> &scans, int batchSize)
+{
+    CheckInImportResult result;
+    batchSize = qMax(1, batchSize);
     
-    // 执行签到
+    // 报名名单一次读入内存，之后只对已报名的学生执行更新
+    QSet<QString> roster;
     QSqlQuery query(db);
-    query.prepare("UPDATE registrations SET checkin_time = ? WHERE activity_id = ? AND student_id = ?");
-    query.addBindValue(currentTime);
+    query.prepare("SELECT student_id FROM registrations WHERE activity_id = ?");
     query.addBindValue(activityId);
-    query.addBindValue(studentId);
+    if (!query.exec()) {
+        qDebug() << "[签到导入] 读取报名名单失败:" << query.lastError().text();
+        return result;
+    }
+    while (query.next()) {
+        roster.insert(query.value(0).toString());
+    }
+    query.finish();
     
-    return query.exec();
+    QStringList registered;
+    QStringList others;
+    for (auto it = scans.constBegin(); it != scans.constEnd(); ++it) {
+        if (roster.contains(it.key())) {
+            registered.append(it.key());
+        } else {
+            others.append(it.key());
+        }
+    }
+    registered.sort();
+    others.sort();
+    
+    // 未报名的再按用户表区分"未报名"和"不存在"，每次查询的参数个数低于 SQLite 的绑定上限
+    const int kLookupChunk = 500;
+    QSet<QString> knownUsers;
+    for (int offset = 0; offset < others.size(); offset += kLookupChunk) {
+        QStringList chunk = others.mid(offset, kLookupChunk);
+        QStringList placeholders;
+        for (int i = 0; i < chunk.size(); ++i) {
+            placeholders.append("?");
+        }
+        query.prepare(QString("SELECT student_id FROM users WHERE student_id IN (%1)").arg(placeholders.join(", ")));
+        for (const QString &studentId : chunk) {
+            query.addBindValue(studentId);
+        }
+        if (!query.exec()) {
+            qDebug() << "[签到导入] 查询用户失败:" << query.lastError().text();
+            return result;
+        }
+        while (query.next()) {
+            knownUsers.insert(query.value(0).toString());
+        }
+    }
+    for (const QString &studentId : others) {
+        if (knownUsers.contains(studentId)) {
+            result.unregistered.append(studentId);
+        } else {
+            result.unknown.append(studentId);
+        }
+    }
+    
+    // 只在没有签到或已有的签到时间更晚时写入，多台扫码枪的文件按任意顺序导入结果相同
+    query.prepare(R"(
+        UPDATE registrations SET checkin_time = ?
+        WHERE activity_id = ? AND student_id = ?
+        AND (checkin_time IS NULL OR checkin_time > ?)
+    )");
+    for (int offset = 0; offset < registered.size(); offset += batchSize) {
+        QStringList batch = registered.mid(offset, batchSize);
+        if (!db.transaction()) {
+            qDebug() << "[签到导入] 开始事务失败:" << db.lastError().text();
+            return result;
+        }
+        QStringList applied;
+        for (const QString &studentId : batch) {
+            QDateTime scannedAt = scans.value(studentId);
+            query.addBindValue(scannedAt);
+            query.addBindValue(activityId);
+            query.addBindValue(studentId);
+            query.addBindValue(scannedAt);
+            if (!query.exec()) {
+                qDebug() << "[签到导入] 写入签到失败:" << query.lastError().text();
+                db.rollback();
+                return result;
+            }
+            if (query.numRowsAffected() > 0) {
+                applied.append(studentId);
+            }
+        }
+        if (!db.commit()) {
+            qDebug() << "[签到导入] 提交失败:" << db.lastError().text();
+            db.rollback();
+            return result;
+        }
+        ++result.transactions;
+        result.applied += applied.size();
+        result.unchanged += batch.size() - applied.size();
+        for (const QString &studentId : applied) {
+            emit checkInRecorded(activityId, studentId);
+        }
+    }
+    
+    result.success = true;
+    return result;
 }
 
 bool Database::isCheckedIn(int activityId, const QString &studentId)
@@ -9,6 +9,9 @@
 #include <QVariant>
 #include <QHash>
 #include <QList>
+#include <QStringList>
+#include <QVector>
+#include <QPair>
 #include <QDateTime>
 
 // 用户角色枚举
@@ -35,16 +38,142 @@ enum class RegistrationStatus {
     Confirmed       // 已确认
 };
 
+// 签到结果
+enum class CheckInResult {
+    Failed,             // 数据库错误；也是值初始化的默认值（组提交失败时返回）
+    Success,
+    NotRegistered,      // 未报名（或活动不存在）
+    TooEarly,           // 活动尚未开始
+    WrongCode,          // 签到码错误，或活动未设置签到码
+    AlreadyCheckedIn
+};
+
+// 活动列表中的一行（表格模型使用的类型化记录）
+struct ActivityRecord {
+    int id = 0;
+    QString title;
+    QString category;
+    QString organizer;
+    QString location;
+    QDateTime startTime;
+    QDateTime endTime;
+    QDateTime createdAt;
+    int maxParticipants = 0;
+    int currentParticipants = 0;
+    ActivityStatus status = ActivityStatus::Pending;
+};
+
+// 报名列表中的一行（按学生查询时附带活动信息）
+struct RegistrationRecord {
+    int id = 0;
+    int activityId = 0;
+    QString studentId;
+    QString studentName;
+    QString title;
+    QString location;
+    QDateTime startTime;
+    QDateTime endTime;
+    QDateTime registeredAt;
+    RegistrationStatus status = RegistrationStatus::Registered;
+};
+
+// 活动分页查询条件（条件全部使用绑定参数，排序交给SQL）
+struct ActivityQuery {
+    QString organizer;            // 非空时只查询该发起人的活动
+    int status = -1;              // >= 0 时按状态过滤
+    QString searchText;           // 标题、类别、发起人模糊匹配
+    QString excludeRegisteredBy;  // 非空时排除该学生已报名的活动
+    QList<int> ids;               // 非空时只查询这些活动（用于单行增量刷新）
+    QString orderBy = "created_at";
+    bool descending = true;
+};
+
+// 搜索结果中的一行：活动ID和参与匹配的文本（标题、类别、发起人以换行分隔）
+struct ActivitySearchHit {
+    int id = 0;
+    QString text;
+};
+
+// 活动提醒：发出后写入通知发件箱（notification_outbox）
+struct ReminderRecord {
+    int notificationId = 0;   // 发件箱中的ID
+    int activityId = 0;
+    QString studentId;
+    QString title;
+    QString location;
+    QDateTime startTime;
+    QString message;
+};
+
+// 一个抽签报名活动的抽签结果
+struct LotteryResult {
+    int activityId = 0;
+    quint32 seed = 0;        // 设置抽签时生成并保存，按同一种子和申请重新抽签结果相同
+    int applicants = 0;
+    int winners = 0;
+    int waitlisted = 0;      // 未中签的按抽签顺序进入候补
+};
+
+// 一轮志愿匹配的结果
+struct MatchRoundResult {
+    int roundId = 0;
+    quint32 seed = 0;        // 决定学生之间的优先顺序，同一种子和志愿的匹配结果相同
+    int students = 0;
+    int assignments = 0;     // 写入的报名数
+};
+
+// 场地冲突：activityId（待审批）与 conflictingId 在同一地点、时间重叠
+struct RoomConflict {
+    int activityId = 0;
+    QString title;
+    QString location;
+    QDateTime startTime;
+    QDateTime endTime;
+    int conflictingId = 0;
+    QString conflictingTitle;
+    // 已批准 / 进行中：场地已被占用；待审批：两者只能批准其一
+    ActivityStatus conflictingStatus = ActivityStatus::Pending;
+};
+
+// 离线签到导入（扫码枪导出文件）的写入结果
+struct CheckInImportResult {
+    bool success = false;
+    int applied = 0;             // 写入签到时间，或把已有的签到时间提前
+    int unchanged = 0;           // 已有更早（或相同）的签到时间
+    QStringList unregistered;    // 用户存在但未报名该活动
+    QStringList unknown;         // 不存在的学号
+    int transactions = 0;
+};
+
+// 默认在活动开始前多久提醒（分钟）
+const int kDefaultReminderLeadMinutes = 60;
+
+// 报名分页查询条件：activityId 与 studentId 至少设置一个
+struct RegistrationQuery {
+    int activityId = -1;
+    QString studentId;
+    QString orderBy;              // 为空时按活动查询用报名时间，按学生查询用开始时间
+    bool descending = false;
+};
+
 class Database : public QObject
 {
     Q_OBJECT
 
 public:
     explicit Database(QObject *parent = nullptr);
+    // 使用命名连接打开同一个数据库文件（供后台线程使用，每个线程一个连接）
+    Database(const QString &connectionName, const QString &databaseName, QObject *parent = nullptr);
     ~Database();
 
-    // 初始化数据库，创建表结构
+    // 初始化数据库，创建表结构或迁移到最新版本
     bool initializeDatabase();
+    // 只打开连接，不建表（表结构已由主连接创建）
+    bool open();
+    QString databaseFileName() const;
+    QString journalMode();  // 当前日志模式（小写，如 "wal"、"delete"）
+    // 在本连接上执行一条不带参数的语句（BEGIN、COMMIT、SAVEPOINT 等），供单写线程组提交使用
+    bool executeStatement(const QString &statement);
     
     // 用户相关操作
     bool addUser(const QString &studentId, const QString &password, UserRole role, const QString &name = "");
@@ -63,36 +192,149 @@ public:
     QList<QHash<QString, QVariant>> getActivities(const QString &filter = "");
     QHash<QString, QVariant> getActivity(int activityId);
     
+    // 分页查询（供表格模型按需加载）
+    int countActivities(const ActivityQuery &query);
+    QList<ActivityRecord> getActivityPage(const ActivityQuery &query, int offset, int limit);
+    // 返回满足条件的全部活动ID（按 query 的排序），供搜索结果缓存和前缀细化
+    QVector<ActivitySearchHit> searchActivities(const ActivityQuery &query);
+    
+    // 平台增量同步：在一个事务内应用一批变更，并写入新的同步游标
+    bool applyActivityChanges(const QList<QHash<QString, QVariant>> &changes, const QString &cursor);
+    
+    // 活动生命周期：全部已批准、进行中的活动（只填 id、startTime、endTime、status），供时间轮登记
+    QList<ActivityRecord> getLifecycleSchedule();
+    // 已到开始时间的已批准活动置为进行中，已到结束时间的已批准/进行中活动置为已结束。
+    // 条件更新，重复调用没有副作用；返回状态改变的行数，失败返回 -1
+    int advanceActivityStatuses(const QList<int> &startingIds, const QList<int> &endingIds, const QDateTime &now);
+    QString getSyncState(const QString &key, const QString &defaultValue = "");
+    bool setSyncState(const QString &key, const QString &value);
+    
     // 报名相关操作
     bool registerActivity(int activityId, const QString &studentId, const QString &studentName);
     bool cancelRegistration(int activityId, const QString &studentId);
+    // 批量取消同一活动的报名，全部删除后只做一次候补转正；返回实际取消的人数，失败返回 -1
+    int cancelRegistrations(int activityId, const QStringList &studentIds);
+    // 按推荐方案调整：在一个保存点内取消 droppedActivityIds 的报名并报名 activityId。
+    // 只在活动已批准、不在抽签申请期、仍有空位时报名，否则整体回滚、原有报名不变，返回 false
+    bool switchRegistrations(int activityId, const QString &studentId, const QString &studentName,
+                             const QList<int> &droppedActivityIds);
     bool isRegistered(int activityId, const QString &studentId);
     QList<QHash<QString, QVariant>> getRegistrations(int activityId);
     QList<QHash<QString, QVariant>> getStudentRegistrations(const QString &studentId);
+    int countRegistrations(const RegistrationQuery &query);
+    QList<RegistrationRecord> getRegistrationPage(const RegistrationQuery &query, int offset, int limit);
     int getRegistrationCount(int activityId);
     bool addToWaitlist(int activityId, const QString &studentId, const QString &studentName);
     QList<QHash<QString, QVariant>> getWaitlist(int activityId);
-    bool promoteFromWaitlist(int activityId);
+    bool promoteFromWaitlist(int activityId);   // 至少转正一人时返回 true
+    // 在一个保存点内用最早加入的候补补满全部空位（跳过时间冲突的学生），
+    // 并按实际报名数重算 current_participants；返回转正人数，失败返回 -1
+    int promoteWaitlist(int activityId);
+    // 修改人数上限，提高后自动由候补补位
+    bool updateMaxParticipants(int activityId, int maxParticipants);
+    
+    // 抽签报名：截止前只收申请，截止后统一抽签，之后剩余名额照常先到先得。
+    // deadline 无效时取消抽签（已抽签的活动不能修改）；同时生成并保存随机种子
+    bool setLotteryDeadline(int activityId, const QDateTime &deadline);
+    bool isLotteryPending(int activityId);   // 设置了抽签且尚未抽签
+    // 截止前提交申请，重复提交或已截止返回 false
+    bool submitApplication(int activityId, const QString &studentId, const QString &studentName);
+    int getApplicationCount(int activityId);
+    QDateTime nextLotteryDeadline();   // 已批准、尚未抽签的最早截止时间，没有时为无效时间
+    // 在一个事务中为截止时间不晚于 now 的已批准活动抽签：按种子打乱申请顺序，
+    // 依次录取到名额用完（跳过与已报名或本批已中签活动时间冲突的学生），其余按顺序写入候补
+    QList<LotteryResult> drawDueLotteries(const QDateTime &now);
+    
+    // 志愿匹配：学生在截止前为一轮匹配提交按顺序排列的志愿和最多参加几个，
+    // 截止后统一计算分配（学生提出的延迟接受算法，见 PreferenceMatcher），报名一次性写入
+    int createMatchRound(const QString &title, const QDateTime &cutoff, const QString &createdBy);  // 返回轮次ID，失败返回 -1
+    QList<QHash<QString, QVariant>> getOpenMatchRounds();   // 尚未截止的轮次（id、title、cutoff）
+    // 截止前提交或替换志愿；只保留已批准、非抽签中的活动，重复的活动只保留第一次
+    bool submitPreferences(int roundId, const QString &studentId, const QString &studentName,
+                           const QList<int> &rankedActivityIds, int maxAssignments);
+    QDateTime nextMatchCutoff();   // 最早的未匹配轮次截止时间，没有时为无效时间
+    // 在一个事务中为截止时间不晚于 now 的轮次计算并写入分配
+    QList<MatchRoundResult> runDueMatchRounds(const QDateTime &now);
     
-    // 冲突检测
+    // 冲突检测：已批准和进行中的活动都占用学生的时间
     QList<QHash<QString, QVariant>> checkTimeConflict(const QString &studentId, 
                                                       const QDateTime &startTime, 
                                                       const QDateTime &endTime,
                                                       int excludeActivityId = -1);
+    // 学生已报名的全部已批准、进行中活动（id、title、start_time、end_time），
+    // 供批量冲突检测在内存中比较，一个学生只需查询一次
+    QList<QHash<QString, QVariant>> getStudentApprovedSchedule(const QString &studentId);
+    // 场地冲突：同一地点（按 RoomIndex::locationKey 规范化）时间重叠的已批准、进行中活动
+    // （id、title、organizer、start_time、end_time、status），includePending 时也包括待审批的；
+    // 未填写地点时返回空列表
+    QList<QHash<QString, QVariant>> checkLocationConflict(const QString &location,
+                                                          const QDateTime &startTime,
+                                                          const QDateTime &endTime,
+                                                          int excludeActivityId = -1,
+                                                          bool includePending = false);
+    // 批量校验全部未结束的待审批活动：一次读出有地点的已批准、进行中和待审批活动，
+    // 在内存中按地点建区间索引，返回与已占用场地重叠、以及待审批活动之间互相重叠的全部冲突
+    QList<RoomConflict> validatePendingLocations();
     
     // 签到相关操作
-    bool checkIn(int activityId, const QString &studentId, const QString &checkinCode = "");
+    // 签到：报名、已开始、签到码、尚未签到四个条件放在一条条件 UPDATE 中，成功时只访问一次数据库，
+    // 未更新时再查一次原因。checkinCode 为空表示管理员/发起人代签，不校验签到码
+    CheckInResult tryCheckIn(int activityId, const QString &studentId, const QString &checkinCode = "");
+    bool checkIn(int activityId, const QString &studentId, const QString &checkinCode = "");  // 签到成功时返回 true
+    // 签到机批量写入：每项 (学号, 刷卡时间) 按已报名、已开始、尚未签到的条件更新（不校验签到码），
+    // 在一个保存点内完成，可嵌在组提交的事务中；返回实际签到的学号，失败时整批回滚并返回空列表
+    QStringList checkInBatch(int activityId, const QList<QPair<QString, QDateTime>> &checkIns);
+    // 离线签到导入：scans 为每个学号最早的扫描时间（已去重），签到时间只会提前不会推后，重复导入没有副作用。
+    // 先读出报名名单区分未报名和不存在的学号，再每 batchSize 人一个事务写入；不能在事务中调用。
+    // 中途失败时已提交的批次保留，success 为 false
+    CheckInImportResult importCheckIns(int activityId, const QHash<QString, QDateTime> &scans, int batchSize = 2000);
     bool isCheckedIn(int activityId, const QString &studentId);
     QList<QHash<QString, QVariant>> getCheckInList(int activityId);
     QHash<QString, QVariant> getCheckInStatistics(int activityId);
     
+    // 活动提醒：reminders 表按 remind_at 排序，作为持久化的优先队列
+    // 按活动当前的报名名单和开始时间重建尚未发出的提醒（报名、取消、改期、审批后调用）
+    bool syncActivityReminders(int activityId, int leadMinutes = kDefaultReminderLeadMinutes);
+    QDateTime nextReminderTime();   // 最早的未发出提醒，没有时为无效时间
+    // 在一个事务中取出至多 limit 条到期提醒，写入发件箱并标记为已发出
+    QList<ReminderRecord> fireDueReminders(const QDateTime &now, int limit);
+    QList<ReminderRecord> getUndeliveredNotifications(int limit);
+    bool markNotificationsDelivered(const QList<int> &notificationIds);
+    
+    // 只读快照：在一个读事务中把 sourceFile 的全部表和索引复制到本连接（用于 ":memory:" 连接）
+    bool loadSnapshotFrom(const QString &sourceFile);
+    
+    // 归档：把结束时间早于 cutoff 的已结束活动及其报名、候补、抽签申请记录移入归档库（archiveFileName()），
+    // 同时删除这些活动的提醒、通知和匹配志愿；
+    // 每次调用移动至多 batchSize 个活动：先提交归档库中的副本，再从主库删除已归档的记录，
+    // 中途中断后重新调用即可继续；返回本批移动的活动数，失败返回 -1
+    int archiveFinishedActivities(const QDateTime &cutoff, int batchSize);
+    QString archiveFileName() const;
+    
     // 统计信息
     QHash<QString, QVariant> getActivityStatistics(int activityId);
-    QList<QHash<QString, QVariant>> getAllStatistics();
+    // includeArchive 为 true 时临时附加归档库，结果中包含已归档的活动
+    QList<QHash<QString, QVariant>> getAllStatistics(bool includeArchive = false);
+
+signals:
+    // 细粒度变更通知（只在写入成功后发出），表格模型据此做单行更新
+    void activityChanged(int activityId);
+    void registrationChanged(int activityId, const QString &studentId);
+    void checkInRecorded(int activityId, const QString &studentId);
+    void matchRoundCreated(int roundId);   // 截止时定时器据此重新定时
 
 private:
     QSqlDatabase db;
-    bool createTables();
+    QString connectionName;  // 为空表示默认连接
+    // 按 PRAGMA user_version 依次执行尚未执行的结构迁移
+    bool migrateSchema();
+    int schemaVersion();
+    bool hasColumn(const QString &table, const QString &column);
+    // 归档库以 "archive" 为名附加到本连接，不存在的表按主库的列创建；不能在事务中调用
+    bool attachArchive();
+    void detachArchive();
+    bool ensureArchiveTable(const QString &table);
+    QStringList tableColumns(const QString &schema, const QString &table);
     QString hashPassword(const QString &password);
 };
 
@@ -0,0 +1,39 @@
+#include "dbexecutor.h"
+#include <QDebug>
+
+DbExecutor::DbExecutor(const QString &databaseName, QObject *parent)
+    : QObject(parent)
+    , worker(new QObject())
+    , databaseName(databaseName)
+    , workerDatabase(nullptr)
+{
+    thread.setObjectName("DbExecutor");
+    worker->moveToThread(&thread);
+    connect(&thread, &QThread::finished, worker, &QObject::deleteLater);
+    thread.start();
+}
+
+DbExecutor::~DbExecutor()
+{
+    // 连接必须在创建它的线程中关闭
+    QMetaObject::invokeMethod(worker, [this]() {
+        delete workerDatabase;
+        workerDatabase = nullptr;
+    }, Qt::BlockingQueuedConnection);
+    
+    thread.quit();
+    thread.wait();
+}
+
+Database *DbExecutor::threadDatabase()
+{
+    if (!workerDatabase) {
+        // 每个执行器一个连接名，多窗口时互不影响
+        QString connectionName = QString("db_executor_%1").arg(reinterpret_cast<quintptr>(this));
+        workerDatabase = new Database(connectionName, databaseName);
+        if (!workerDatabase->open()) {
+            qDebug() << "[后台查询] 打开数据库连接失败:" << databaseName;
+        }
+    }
+    return workerDatabase;
+}
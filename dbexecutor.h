@@ -0,0 +1,54 @@
+#ifndef DBEXECUTOR_H
+#define DBEXECUTOR_H
+
+#include <QObject>
+#include <QThread>
+#include <QPointer>
+#include <QMetaObject>
+#include "database.h"
+
+// 后台数据库执行器：在专用线程上用独立连接执行查询，结果排队回到GUI线程。
+// 任务按提交顺序串行执行；请求方（context）销毁后其结果会被丢弃。
+class DbExecutor : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit DbExecutor(const QString &databaseName, QObject *parent = nullptr);
+    ~DbExecutor();
+
+    // task 在后台线程执行，签名为 Result(Database *)；
+    // callback 在执行器所在线程（GUI线程）执行，签名为 void(const Result &)
+    template <typename Task, typename Callback>
+    void post(QObject *context, Task task, Callback callback)
+    {
+        QPointer<QObject> guard(context);
+        QMetaObject::invokeMethod(worker, [this, guard, task, callback]() {
+            auto result = task(threadDatabase());
+            QMetaObject::invokeMethod(this, [guard, callback, result]() {
+                if (guard) {
+                    callback(result);
+                }
+            }, Qt::QueuedConnection);
+        }, Qt::QueuedConnection);
+    }
+
+    // 只在后台线程执行、不需要回调的任务，签名为 void(Database *)
+    template <typename Task>
+    void execute(Task task)
+    {
+        QMetaObject::invokeMethod(worker, [this, task]() {
+            task(threadDatabase());
+        }, Qt::QueuedConnection);
+    }
+
+private:
+    QThread thread;
+    QObject *worker;            // 生活在后台线程中，用于接收任务
+    QString databaseName;
+    Database *workerDatabase;   // 只在后台线程中创建和访问
+
+    Database *threadDatabase();
+};
+
+#endif // DBEXECUTOR_H
@@ -15,11 +15,27 @@ SOURCES += \
     loginwindow.cpp \
     registerwindow.cpp \
     activitymanager.cpp \
+    activitytablemodel.cpp \
+    activitysearch.cpp \
     registrationmanager.cpp \
+    registrationtablemodel.cpp \
     conflictchecker.cpp \
     networkmanager.cpp \
     csvexporter.cpp \
-    exportthread.cpp
+    exportthread.cpp \
+    dbexecutor.cpp \
+    taskscheduler.cpp \
+    asyncdatabase.cpp \
+    groupcommitwriter.cpp \
+    snapshotdatabase.cpp \
+    timerwheel.cpp \
+    activitylifecycle.cpp \
+    reminderengine.cpp \
+    lotterydrawer.cpp \
+    preferencematcher.cpp \
+    roomindex.cpp \
+    scandumpreader.cpp \
+    checkinkiosk.cpp
 
 HEADERS += \
     mainwindow.h \
@@ -27,11 +43,27 @@ HEADERS += \
     loginwindow.h \
     registerwindow.h \
     activitymanager.h \
+    activitytablemodel.h \
+    activitysearch.h \
     registrationmanager.h \
+    registrationtablemodel.h \
     conflictchecker.h \
     networkmanager.h \
     csvexporter.h \
-    exportthread.h
+    exportthread.h \
+    dbexecutor.h \
+    taskscheduler.h \
+    asyncdatabase.h \
+    groupcommitwriter.h \
+    snapshotdatabase.h \
+    timerwheel.h \
+    activitylifecycle.h \
+    reminderengine.h \
+    lotterydrawer.h \
+    preferencematcher.h \
+    roomindex.h \
+    scandumpreader.h \
+    checkinkiosk.h
 
 FORMS += \
     mainwindow.ui \
@@ -1,18 +1,14 @@
 #include "exportthread.h"
 #include "csvexporter.h"
+#include <QThread>
 #include <QDebug>
 
 ExportThread::ExportThread(QObject *parent)
-    : QThread(parent)
-    , exporter(new CsvExporter(this))
+    : QObject(parent)
+    , running(false)
 {
 }
 
-ExportThread::~ExportThread()
-{
-    wait(); // 等待线程完成
-}
-
 void ExportThread::setExportType(const QString &type)
 {
     exportType = type;
@@ -35,55 +31,84 @@ void ExportThread::setStatisticsData(const QList<QHash<QString, QVariant>> &stat
     this->statistics = statistics;
 }
 
-void ExportThread::run()
+void ExportThread::start()
 {
-    bool success = false;
-    QString message;
+    if (running) {
+        return;
+    }
+    running = true;
+    
+    // 任务只使用参数的副本，导出对象销毁后任务仍可安全结束（结果被丢弃）
+    QString exportType = this->exportType;
+    QString filename = this->filename;
+    QList<QHash<QString, QVariant>> registrations = this->registrations;
+    QHash<QString, QVariant> activity = this->activity;
+    QList<QHash<QString, QVariant>> statistics = this->statistics;
     
-    try {
-        if (exportType == "registrations") {
-            emit exportProgress(10);
-            success = exporter->exportRegistrations(filename, registrations, activity);
-            emit exportProgress(100);
-            message = success ? "报名名单导出成功！" : "报名名单导出失败！";
-        } else if (exportType == "statistics") {
-            // 对于大数据量，模拟进度更新
-            int total = statistics.size();
-            int processed = 0;
-            
-            emit exportProgress(10);
-            
-            // 这里可以分批处理数据以显示进度
-            // 由于CsvExporter是一次性写入，我们模拟进度
-            for (int i = 0; i < total; i += qMax(1, total / 10)) {
-                processed = qMin(i + total / 10, total);
-                emit exportProgress(10 + (processed * 80 / total));
-                msleep(10); // 模拟处理时间
+    token = TaskScheduler::globalInstance()->submit(TaskPriority::Bulk, this,
+        [exportType, filename, registrations, activity, statistics](TaskContext &context) -> Outcome {
+        Outcome outcome;
+        CsvExporter exporter;
+        
+        try {
+            if (exportType == "registrations") {
+                context.reportProgress(10);
+                outcome.success = exporter.exportRegistrations(filename, registrations, activity);
+                context.reportProgress(100);
+                outcome.message = outcome.success ? "报名名单导出成功！" : "报名名单导出失败！";
+            } else if (exportType == "statistics") {
+                // 对于大数据量，模拟进度更新
+                int total = statistics.size();
+                int processed = 0;
+                
+                context.reportProgress(10);
+                
+                // 这里可以分批处理数据以显示进度
+                // 由于CsvExporter是一次性写入，我们模拟进度
+                for (int i = 0; i < total; i += qMax(1, total / 10)) {
+                    if (context.isCancelled()) {
+                        return outcome;
+                    }
+                    processed = qMin(i + total / 10, total);
+                    context.reportProgress(10 + (processed * 80 / total));
+                    QThread::msleep(10); // 模拟处理时间
+                }
+                
+                outcome.success = exporter.exportStatistics(filename, statistics);
+                context.reportProgress(100);
+                outcome.message = outcome.success ? "统计报表导出成功！" : "统计报表导出失败！";
+            } else {
+                outcome.error = "未知的导出类型：" + exportType;
             }
-            
-            success = exporter->exportStatistics(filename, statistics);
-            emit exportProgress(100);
-            message = success ? "统计报表导出成功！" : "统计报表导出失败！";
+        } catch (const std::exception &e) {
+            outcome.error = QString("导出异常：%1").arg(e.what());
+        } catch (...) {
+            outcome.error = "导出过程中发生未知错误";
+        }
+        return outcome;
+    }, [this](const Outcome &outcome) {
+        running = false;
+        if (!outcome.error.isEmpty()) {
+            emit exportError(outcome.error);
         } else {
-            emit exportError("未知的导出类型：" + exportType);
-            return;
+            emit exportFinished(outcome.success, outcome.message);
         }
-        
-        emit exportFinished(success, message);
-    } catch (const std::exception &e) {
-        emit exportError(QString("导出异常：%1").arg(e.what()));
-    } catch (...) {
-        emit exportError("导出过程中发生未知错误");
-    }
+    }, [this](int percentage) {
+        emit exportProgress(percentage);
+    });
 }
 
+void ExportThread::cancel()
+{
+    if (!running) {
+        return;
+    }
+    token.cancel();
+    running = false;
+    emit exportFinished(false, "导出已取消");
+}
 
-
-
-
-
-
-
-
-
-
+bool ExportThread::isRunning() const
+{
+    return running;
+}
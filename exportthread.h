@@ -1,43 +1,53 @@
 #ifndef EXPORTTHREAD_H
 #define EXPORTTHREAD_H
 
-#include <QThread>
+#include <QObject>
 #include <QString>
 #include <QHash>
 #include <QVariant>
 #include <QList>
+#include "taskscheduler.h"
 
-class CsvExporter;
-
-class ExportThread : public QThread
+// CSV导出任务：在全局任务调度器中以 Bulk 优先级执行，不会占用交互任务的线程。
+// 接口与原来的线程类保持一致：设置参数后调用 start()，通过信号获得进度和结果。
+class ExportThread : public QObject
 {
     Q_OBJECT
 
 public:
     explicit ExportThread(QObject *parent = nullptr);
-    ~ExportThread();
     
     void setExportType(const QString &type); // "registrations" or "statistics"
     void setFilename(const QString &filename);
     void setRegistrationsData(const QList<QHash<QString, QVariant>> &registrations,
                              const QHash<QString, QVariant> &activity);
     void setStatisticsData(const QList<QHash<QString, QVariant>> &statistics);
+    
+    void start();
+    // 取消尚未完成的导出（已开始写入的文件不会删除）
+    void cancel();
+    bool isRunning() const;
 
 signals:
     void exportProgress(int percentage);
     void exportFinished(bool success, const QString &message);
     void exportError(const QString &error);
 
-protected:
-    void run() override;
-
 private:
+    // 后台任务的结果
+    struct Outcome {
+        bool success = false;
+        QString message;
+        QString error;    // 非空时发出 exportError
+    };
+
     QString exportType;
     QString filename;
     QList<QHash<QString, QVariant>> registrations;
     QHash<QString, QVariant> activity;
     QList<QHash<QString, QVariant>> statistics;
-    CsvExporter *exporter;
+    CancellationToken token;
+    bool running;
 };
 
 #endif // EXPORTTHREAD_H
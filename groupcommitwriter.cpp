@@ -0,0 +1,209 @@
+#include "groupcommitwriter.h"
+#include <QThread>
+#include <QElapsedTimer>
+#include <QDebug>
+
+// 写线程：持有唯一的写连接，循环执行 GroupCommitWriter 队列中的写操作
+class WriterThread : public QThread
+{
+public:
+    explicit WriterThread(GroupCommitWriter *writer)
+        : writer(writer)
+    {
+    }
+
+protected:
+    void run() override
+    {
+        writer->writerLoop();
+    }
+
+private:
+    GroupCommitWriter *writer;
+};
+
+GroupCommitWriter::GroupCommitWriter(const QString &databaseName, QObject *parent)
+    : QObject(parent)
+    , databaseName(databaseName)
+    , thread(new WriterThread(this))
+    , stopping(false)
+    , maxOperations(64)
+    , maxDelayMs(2)
+    , transactionCount(0)
+{
+    thread->setObjectName("GroupCommitWriter");
+    thread->start();
+}
+
+GroupCommitWriter::~GroupCommitWriter()
+{
+    {
+        QMutexLocker locker(&mutex);
+        stopping = true;
+        condition.wakeAll();
+    }
+    thread->wait();
+    delete thread;
+}
+
+void GroupCommitWriter::setBatchPolicy(int maxOperations, int maxDelayMs)
+{
+    QMutexLocker locker(&mutex);
+    this->maxOperations = qMax(1, maxOperations);
+    this->maxDelayMs = qMax(0, maxDelayMs);
+}
+
+int GroupCommitWriter::committedTransactions() const
+{
+    return transactionCount.loadAcquire();
+}
+
+void GroupCommitWriter::enqueue(const WriteOperation &operation)
+{
+    QMutexLocker locker(&mutex);
+    queue.append(operation);
+    condition.wakeOne();
+}
+
+bool GroupCommitWriter::takeBatch(QList<WriteOperation> &batch, bool &grouping)
+{
+    QMutexLocker locker(&mutex);
+    while (queue.isEmpty() && !stopping) {
+        condition.wait(&mutex);
+    }
+    if (queue.isEmpty()) {
+        return false;  // 已停止且队列已清空
+    }
+
+    grouping = maxOperations > 1;
+    if (grouping && !stopping) {
+        // 等待更多写操作凑成一批，最多等 maxDelayMs 毫秒
+        QElapsedTimer waited;
+        waited.start();
+        while (queue.size() < maxOperations && !stopping) {
+            qint64 remaining = maxDelayMs - waited.elapsed();
+            if (remaining <= 0) {
+                break;
+            }
+            condition.wait(&mutex, static_cast<unsigned long>(remaining));
+        }
+    }
+
+    int count = grouping ? qMin(maxOperations, queue.size()) : 1;
+    for (int i = 0; i < count; ++i) {
+        batch.append(queue.takeFirst());
+    }
+    return true;
+}
+
+void GroupCommitWriter::writerLoop()
+{
+    // 写连接在写线程中创建和销毁
+    Database db(QString("group_commit_writer_%1").arg(reinterpret_cast<quintptr>(this)), databaseName);
+    if (!db.open()) {
+        qDebug() << "[组提交] 打开数据库连接失败:" << databaseName;
+    }
+
+    // 操作执行期间的变更先记下来，提交后再通知
+    connect(&db, &Database::activityChanged, &db, [this](int activityId) {
+        pendingChanges.append({Change::Activity, activityId, QString()});
+    }, Qt::DirectConnection);
+    connect(&db, &Database::registrationChanged, &db, [this](int activityId, const QString &studentId) {
+        pendingChanges.append({Change::Registration, activityId, studentId});
+    }, Qt::DirectConnection);
+    connect(&db, &Database::checkInRecorded, &db, [this](int activityId, const QString &studentId) {
+        pendingChanges.append({Change::CheckIn, activityId, studentId});
+    }, Qt::DirectConnection);
+
+    QList<WriteOperation> batch;
+    bool grouping = false;
+    while (takeBatch(batch, grouping)) {
+        QList<WriteOperation> group;
+        for (WriteOperation &operation : batch) {
+            if (!grouping || operation.managesTransaction) {
+                // 先提交已攒下的写操作，保持提交顺序
+                commitGroup(&db, group);
+                executeAlone(&db, operation);
+            } else {
+                group.append(operation);
+            }
+        }
+        commitGroup(&db, group);
+        batch.clear();
+    }
+}
+
+void GroupCommitWriter::executeAlone(Database *db, WriteOperation &operation)
+{
+    operation.run(db);
+    transactionCount.ref();
+    operation.finish(true);
+    emitPendingChanges();
+}
+
+void GroupCommitWriter::commitGroup(Database *db, QList<WriteOperation> &group)
+{
+    if (group.isEmpty()) {
+        return;
+    }
+
+    // IMMEDIATE：开始时就取得写锁，避免提交时才与其他连接冲突
+    if (!db->executeStatement("BEGIN IMMEDIATE")) {
+        // 无法开启事务时退化为逐条自动提交
+        for (WriteOperation &operation : group) {
+            executeAlone(db, operation);
+        }
+        group.clear();
+        return;
+    }
+
+    for (WriteOperation &operation : group) {
+        int mark = pendingChanges.size();
+        db->executeStatement("SAVEPOINT group_write");
+        if (!operation.run(db)) {
+            db->executeStatement("ROLLBACK TO group_write");
+            discardChangesFrom(mark);
+        }
+        db->executeStatement("RELEASE group_write");
+    }
+
+    bool committed = db->executeStatement("COMMIT");
+    if (committed) {
+        transactionCount.ref();
+    } else {
+        qDebug() << "[组提交] 提交失败，回滚本批" << group.size() << "个写操作";
+        db->executeStatement("ROLLBACK");
+        pendingChanges.clear();
+    }
+
+    for (WriteOperation &operation : group) {
+        operation.finish(committed);
+    }
+    emitPendingChanges();
+    group.clear();
+}
+
+void GroupCommitWriter::discardChangesFrom(int mark)
+{
+    while (pendingChanges.size() > mark) {
+        pendingChanges.removeLast();
+    }
+}
+
+void GroupCommitWriter::emitPendingChanges()
+{
+    for (const Change &change : pendingChanges) {
+        switch (change.kind) {
+            case Change::Activity:
+                emit activityChanged(change.activityId);
+                break;
+            case Change::Registration:
+                emit registrationChanged(change.activityId, change.studentId);
+                break;
+            case Change::CheckIn:
+                emit checkInRecorded(change.activityId, change.studentId);
+                break;
+        }
+    }
+    pendingChanges.clear();
+}
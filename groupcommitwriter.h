@@ -0,0 +1,123 @@
+#ifndef GROUPCOMMITWRITER_H
+#define GROUPCOMMITWRITER_H
+
+#include <QObject>
+#include <QFuture>
+#include <QFutureInterface>
+#include <QSharedPointer>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QAtomicInt>
+#include <QList>
+#include <functional>
+#include "database.h"
+
+class WriterThread;
+
+// 单写线程：所有写操作排队到同一个连接上按顺序执行。
+// 开启组提交时，队列中的写操作攒够 maxOperations 条或等待超过 maxDelayMs 毫秒后
+// 放进同一个事务提交，一次 fsync 分摊给整批写入；每个操作用 SAVEPOINT 隔离，失败只回滚自己。
+// 每个调用方仍得到自己的结果，结果和变更信号都在事务提交之后才发出。
+class GroupCommitWriter : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit GroupCommitWriter(const QString &databaseName, QObject *parent = nullptr);
+    // 等待队列中已提交的写操作全部执行完
+    ~GroupCommitWriter();
+
+    // maxOperations <= 1 时不做组提交，每条写入单独自动提交
+    void setBatchPolicy(int maxOperations, int maxDelayMs);
+    // 已提交的事务数（组提交时为批次数，否则为写操作数）
+    int committedTransactions() const;
+
+    // operation 在写线程执行，签名为 T(Database *)。
+    // managesTransaction 为 true 表示操作内部自己开启事务（如 applyActivityChanges），单独执行不参与组提交
+    template <typename T, typename Operation>
+    QFuture<T> submit(Operation operation, bool managesTransaction = false)
+    {
+        QSharedPointer<QFutureInterface<T>> promise(new QFutureInterface<T>(), [](QFutureInterface<T> *pending) {
+            if (!pending->isFinished()) {
+                pending->reportCanceled();
+                pending->reportFinished();
+            }
+            delete pending;
+        });
+        promise->reportStarted();
+        QFuture<T> future = promise->future();
+
+        QSharedPointer<T> result(new T());
+        WriteOperation write;
+        write.managesTransaction = managesTransaction;
+        write.run = [operation, result](Database *db) {
+            *result = operation(db);
+            return succeeded(*result);
+        };
+        write.finish = [promise, result](bool committed) {
+            if (!committed) {
+                markFailed(*result);
+            }
+            promise->reportResult(*result);
+            promise->reportFinished();
+        };
+        enqueue(write);
+        return future;
+    }
+
+signals:
+    // 变更通知，在写线程中于事务提交后发出（跨线程连接会自动排队）
+    void activityChanged(int activityId);
+    void registrationChanged(int activityId, const QString &studentId);
+    void checkInRecorded(int activityId, const QString &studentId);
+
+private:
+    struct WriteOperation {
+        bool managesTransaction = false;
+        std::function<bool(Database *)> run;     // 返回 false 表示操作失败，回滚到它自己的保存点
+        std::function<void(bool)> finish;        // 参数为所在事务是否已提交
+    };
+    // 写操作执行期间产生的变更，提交后才发出
+    struct Change {
+        enum Kind { Activity, Registration, CheckIn };
+        Kind kind;
+        int activityId;
+        QString studentId;
+    };
+    friend class WriterThread;
+
+    QString databaseName;
+    WriterThread *thread;
+    QMutex mutex;
+    QWaitCondition condition;
+    QList<WriteOperation> queue;   // 受 mutex 保护
+    bool stopping;                 // 受 mutex 保护
+    int maxOperations;             // 受 mutex 保护
+    int maxDelayMs;                // 受 mutex 保护
+    QAtomicInt transactionCount;
+
+    // 以下只在写线程中访问
+    QList<Change> pendingChanges;
+
+    // 写操作的结果是否表示成功；失败的操作回滚到自己的保存点。
+    // int 结果为受影响的行数或新ID，负数表示失败，0 只是没有需要改动的数据
+    static bool succeeded(bool result) { return result; }
+    static bool succeeded(int result) { return result >= 0; }
+    static bool succeeded(CheckInResult result) { return result == CheckInResult::Success; }
+    template <typename T>
+    static bool succeeded(const T &) { return true; }
+    // 事务未能提交时交给调用方的结果
+    static void markFailed(int &result) { result = -1; }
+    template <typename T>
+    static void markFailed(T &result) { result = T(); }
+
+    void enqueue(const WriteOperation &operation);
+    void writerLoop();
+    bool takeBatch(QList<WriteOperation> &batch, bool &grouping);
+    void executeAlone(Database *db, WriteOperation &operation);
+    void commitGroup(Database *db, QList<WriteOperation> &group);
+    void discardChangesFrom(int mark);
+    void emitPendingChanges();
+};
+
+#endif // GROUPCOMMITWRITER_H
@@ -0,0 +1,95 @@
+#include "lotterydrawer.h"
+#include "asyncdatabase.h"
+#include <QTimer>
+#include <QDebug>
+
+namespace {
+const int kMaxWaitMs = 60000;      // 最长一分钟重新核对一次（系统时间可能被调整）
+const int kRearmDelayMs = 300;
+const int kRetryDelayMs = 30000;
+}
+
+LotteryDrawer::LotteryDrawer(Database *database, AsyncDatabase *asyncDatabase, QObject *parent)
+    : QObject(parent)
+    , asyncDatabase(asyncDatabase)
+    , dueTimer(new QTimer(this))
+    , rearmTimer(new QTimer(this))
+    , drawing(false)
+    , lastDrawEmpty(false)
+{
+    dueTimer->setSingleShot(true);
+    rearmTimer->setSingleShot(true);
+    rearmTimer->setInterval(kRearmDelayMs);
+    connect(dueTimer, &QTimer::timeout, this, &LotteryDrawer::drawDue);
+    connect(rearmTimer, &QTimer::timeout, this, &LotteryDrawer::rearm);
+    connect(database, &Database::activityChanged, this, &LotteryDrawer::scheduleRearm);
+    connect(database, &Database::matchRoundCreated, this, &LotteryDrawer::scheduleRearm);
+
+    rearm();  // 程序未运行期间已截止的立即处理
+}
+
+void LotteryDrawer::scheduleRearm()
+{
+    if (!rearmTimer->isActive()) {
+        rearmTimer->start();
+    }
+}
+
+void LotteryDrawer::rearm()
+{
+    if (drawing) {
+        return;  // 这一批完成后会重新定时
+    }
+    AsyncDatabase::onFinished(asyncDatabase->nextLotteryDeadline(), this, [this](const QDateTime &lottery) {
+        AsyncDatabase::onFinished(asyncDatabase->nextMatchCutoff(), this, [this, lottery](const QDateTime &match) {
+            if (drawing) {
+                return;
+            }
+            QDateTime next = lottery;
+            if (!next.isValid() || (match.isValid() && match < next)) {
+                next = match;
+            }
+            if (!next.isValid()) {
+                dueTimer->stop();  // 没有待处理的截止时间，设置抽签或新建轮次后会重新定时
+                return;
+            }
+            armedDeadline = next;
+            qint64 delay = QDateTime::currentDateTime().msecsTo(next);
+            if (lastDrawEmpty) {
+                delay = qMax<qint64>(delay, kRetryDelayMs);
+            }
+            dueTimer->start(static_cast<int>(qBound<qint64>(0, delay, kMaxWaitMs)));
+        });
+    });
+}
+
+void LotteryDrawer::drawDue()
+{
+    if (drawing) {
+        return;
+    }
+    if (QDateTime::currentDateTime() < armedDeadline) {
+        rearm();  // 等待超过一分钟时分段定时，尚未到截止时间
+        return;
+    }
+    drawing = true;
+
+    const QDateTime now = QDateTime::currentDateTime();
+    AsyncDatabase::onFinished(asyncDatabase->drawDueLotteries(now), this,
+                              [this, now](const QList<LotteryResult> &lotteries) {
+        if (!lotteries.isEmpty()) {
+            qDebug() << "[抽签] 完成抽签的活动数:" << lotteries.size();
+            emit lotteriesDrawn(lotteries);
+        }
+        AsyncDatabase::onFinished(asyncDatabase->runDueMatchRounds(now), this,
+                                  [this, lotteries](const QList<MatchRoundResult> &rounds) {
+            drawing = false;
+            lastDrawEmpty = lotteries.isEmpty() && rounds.isEmpty();
+            if (!rounds.isEmpty()) {
+                qDebug() << "[志愿匹配] 完成匹配的轮次数:" << rounds.size();
+                emit matchRoundsCompleted(rounds);
+            }
+            rearm();
+        });
+    });
+}
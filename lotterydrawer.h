@@ -0,0 +1,41 @@
+#ifndef LOTTERYDRAWER_H
+#define LOTTERYDRAWER_H
+
+#include <QObject>
+#include <QDateTime>
+#include "database.h"
+
+class AsyncDatabase;
+class QTimer;
+
+// 截止后的批量分配：抽签报名和志愿匹配都是截止前只收申请、截止后一次性写入报名。
+// 只用一个定时器，定在最早的截止时间；到期后先抽签、再做志愿匹配（匹配时抽签结果已在日程中），
+// 各自在一个写事务中完成。截止前学生只提交申请，开放时不会集中抢占名额。
+class LotteryDrawer : public QObject
+{
+    Q_OBJECT
+
+public:
+    // database 用于接收活动变更（设置抽签、审批、改截止时间）和新建匹配轮次后重新定时
+    LotteryDrawer(Database *database, AsyncDatabase *asyncDatabase, QObject *parent = nullptr);
+
+signals:
+    // 一批抽签已提交
+    void lotteriesDrawn(const QList<LotteryResult> &results);
+    // 一批志愿匹配已提交
+    void matchRoundsCompleted(const QList<MatchRoundResult> &results);
+
+private:
+    AsyncDatabase *asyncDatabase;
+    QTimer *dueTimer;      // 最早的截止时间
+    QTimer *rearmTimer;    // 合并短时间内的多次活动变更
+    QDateTime armedDeadline;  // 定时器对应的截止时间
+    bool drawing;
+    bool lastDrawEmpty;    // 到期却没有抽出结果（写入失败），稍后再试
+
+    void scheduleRearm();
+    void rearm();
+    void drawDue();
+};
+
+#endif // LOTTERYDRAWER_H
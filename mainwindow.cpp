@@ -8,28 +8,64 @@
 #include <QPushButton>
 #include <QMessageBox>
 #include <QFileDialog>
+#include <QInputDialog>
+#include <QSystemTrayIcon>
+#include <QStyle>
 #include <QDebug>
 #include <QTimer> 
-#include "csvexporter.h"
 #include "exportthread.h"
 
 MainWindow::MainWindow(QWidget *parent)
     : QMainWindow(parent)
     , database(new Database(this))
+    , queryExecutor(nullptr)
+    , asyncDatabase(nullptr)
+    , reportSnapshot(nullptr)
+    , activityLifecycle(nullptr)
+    , reminderEngine(nullptr)
+    , lotteryDrawer(nullptr)
+    , trayIcon(nullptr)
     , loginWindow(nullptr)
     , activityManager(nullptr)
     , registrationManager(nullptr)
     , networkManager(new NetworkManager(this))
     , conflictChecker(nullptr)
     , exportThread(nullptr)
+    , tabWidget(nullptr)
     , currentRole(UserRole::Student)
     , isLoggedIn(false)
 {
+    // 启动耗时：数据库初始化和首次显示登录窗口
+    startupTimer.start();
+    
     // 初始化数据库
     if (!database->initializeDatabase()) {
         QMessageBox::critical(this, "错误", "数据库初始化失败！");
         return;
     }
+    qDebug() << "[启动] 数据库初始化耗时" << startupTimer.elapsed() << "ms";
+    queryExecutor = new DbExecutor(database->databaseFileName(), this);
+    asyncDatabase = new AsyncDatabase(database, this);
+    reportSnapshot = new SnapshotDatabase(database, 30000, this);
+    conflictChecker = new ConflictChecker(database, this);
+    activityLifecycle = new ActivityLifecycle(database, asyncDatabase, this);
+    reminderEngine = new ReminderEngine(database, asyncDatabase, networkManager, this);
+    connect(reminderEngine, &ReminderEngine::remindersFired, this, &MainWindow::onRemindersFired);
+    lotteryDrawer = new LotteryDrawer(database, asyncDatabase, this);
+    connect(lotteryDrawer, &LotteryDrawer::lotteriesDrawn, this, [this](const QList<LotteryResult> &results) {
+        int winners = 0;
+        for (const LotteryResult &result : results) {
+            winners += result.winners;
+        }
+        statusLabel->setText(QString("已完成 %1 个活动的抽签，共录取 %2 人").arg(results.size()).arg(winners));
+    });
+    connect(lotteryDrawer, &LotteryDrawer::matchRoundsCompleted, this, [this](const QList<MatchRoundResult> &results) {
+        int assignments = 0;
+        for (const MatchRoundResult &result : results) {
+            assignments += result.assignments;
+        }
+        statusLabel->setText(QString("已完成 %1 轮志愿匹配，共分配 %2 个名额").arg(results.size()).arg(assignments));
+    });
     
     setupUI();
     setupMenuBar();
@@ -39,6 +75,9 @@ MainWindow::MainWindow(QWidget *parent)
 
 MainWindow::~MainWindow()
 {
+    // 先销毁标签页中的表格模型，再停止后台执行器
+    delete tabWidget;
+    tabWidget = nullptr;
 }
 
 void MainWindow::setupUI()
@@ -87,6 +126,12 @@ void MainWindow::setupMenuBar()
 
     QAction *exportStatsAction = fileMenu->addAction("导出统计报表");
     connect(exportStatsAction, &QAction::triggered, this, &MainWindow::onExportStatistics);
+    QAction *exportArchivedStatsAction = fileMenu->addAction("导出统计报表（含已归档活动）");
+    connect(exportArchivedStatsAction, &QAction::triggered, this, [this]() {
+        exportStatistics(true);
+    });
+    QAction *archiveAction = fileMenu->addAction("归档已结束活动...");
+    connect(archiveAction, &QAction::triggered, this, &MainWindow::onArchiveFinishedActivities);
     fileMenu->addSeparator();
     QAction *exitAction = fileMenu->addAction("退出(&X)");
     connect(exitAction, &QAction::triggered, this, &QWidget::close);
@@ -97,6 +142,9 @@ void MainWindow::setupMenuBar()
     QAction *fetchAnnouncementsAction = networkMenu->addAction("获取公告");
     connect(fetchCategoriesAction, &QAction::triggered, this, &MainWindow::onFetchCategories);
     connect(fetchAnnouncementsAction, &QAction::triggered, this, &MainWindow::onFetchAnnouncements);
+    networkMenu->addSeparator();
+    QAction *pullChangesAction = networkMenu->addAction("拉取平台活动变更");
+    connect(pullChangesAction, &QAction::triggered, this, &MainWindow::onPullActivityChanges);
     
     // 帮助菜单
     QMenu *helpMenu = menuBar->addMenu("帮助(&H)");
@@ -112,6 +160,13 @@ void MainWindow::setupMenuBar()
 void MainWindow::showLoginWindow()
 {
     loginWindow = new LoginWindow(database, this);
+    if (startupTimer.isValid()) {
+        // 对话框的事件循环开始处理事件时即已显示
+        QTimer::singleShot(0, loginWindow, [this]() {
+            qDebug() << "[启动] 登录窗口显示耗时" << startupTimer.elapsed() << "ms";
+            startupTimer.invalidate();
+        });
+    }
     if (loginWindow->exec() == QDialog::Accepted && loginWindow->isLoggedIn()) {
         currentRole = loginWindow->getLoggedInRole();
         currentStudentId = loginWindow->getLoggedInStudentId();
@@ -196,15 +251,22 @@ void MainWindow::updateUIForRole()
     userLabel->setText(QString("用户：%1 (%2) - %3").arg(currentName).arg(currentStudentId).arg(roleText));
     
     // 创建活动管理标签页
-    activityManager = new ActivityManager(database, currentRole, currentStudentId, networkManager, this);
+    activityManager = new ActivityManager(database, queryExecutor, currentRole, currentStudentId, networkManager, this);
     tabWidget->addTab(activityManager, "活动管理");
     
     // 创建报名管理标签页
-    registrationManager = new RegistrationManager(database, currentRole, currentStudentId, currentName, this);
+    registrationManager = new RegistrationManager(database, queryExecutor, asyncDatabase, currentRole, currentStudentId, currentName, this);
+    registrationManager->setSnapshotDatabase(reportSnapshot);
+    registrationManager->setConflictChecker(conflictChecker);
     tabWidget->addTab(registrationManager, "报名管理");
 }
 
 void MainWindow::onExportStatistics()
+{
+    exportStatistics(false);
+}
+
+void MainWindow::exportStatistics(bool includeArchive)
 {
     if (!isLoggedIn || currentRole != UserRole::Admin) {
         QMessageBox::warning(this, "提示", "只有管理员可以导出统计报表！");
@@ -214,17 +276,125 @@ void MainWindow::onExportStatistics()
     QString filename = QFileDialog::getSaveFileName(this, "导出统计报表", 
         "活动统计报表.csv", "CSV Files (*.csv)");
     
-    if (!filename.isEmpty()) {
-        QList<QHash<QString, QVariant>> statistics = database->getAllStatistics();
-        
-        CsvExporter exporter;
-        if (exporter.exportStatistics(filename, statistics)) {
-            QMessageBox::information(this, "成功", "统计报表导出成功！");
+    if (filename.isEmpty()) {
+        return;
+    }
+    if (exportThread && exportThread->isRunning()) {
+        QMessageBox::information(this, "提示", "上一次导出尚未完成，请稍候！");
+        return;
+    }
+    
+    if (includeArchive) {
+        // 含归档的报表需要附加归档库，直接在后台读连接上查询
+        statusLabel->setText("正在读取统计数据（含已归档活动）...");
+        AsyncDatabase::onFinished(asyncDatabase->getAllStatistics(true), this,
+                                  [this, filename](const QList<QHash<QString, QVariant>> &statistics) {
+            startStatisticsExport(filename, statistics);
+        });
+        return;
+    }
+    
+    // 统计在只读快照上查询，不与报名等写入争用数据库
+    statusLabel->setText(QString("正在读取统计数据（快照时间 %1）...")
+                         .arg(reportSnapshot->snapshotTime().toString("hh:mm:ss")));
+    reportSnapshot->query(this, [](Database *db) {
+        return db->getAllStatistics();
+    }, [this, filename](const QList<QHash<QString, QVariant>> &statistics) {
+        startStatisticsExport(filename, statistics);
+    });
+}
+
+void MainWindow::startStatisticsExport(const QString &filename, const QList<QHash<QString, QVariant>> &statistics)
+{
+    // 导出在后台以 Bulk 优先级执行，期间界面和冲突检测不受影响
+    ExportThread *exporter = new ExportThread(this);
+    exportThread = exporter;
+    connect(exporter, &ExportThread::exportProgress, this, [this](int percentage) {
+        statusLabel->setText(QString("正在导出统计报表... %1%").arg(percentage));
+    });
+    connect(exporter, &ExportThread::exportFinished, this, [this, exporter, filename](bool success, const QString &message) {
+        if (exportThread == exporter) {
+            exportThread = nullptr;
+        }
+        exporter->deleteLater();
+        if (success) {
+            QMessageBox::information(this, "成功", message);
             statusLabel->setText("统计报表已导出：" + filename);
         } else {
-            QMessageBox::warning(this, "失败", "导出失败！");
+            QMessageBox::warning(this, "失败", message);
+            statusLabel->setText(message);
+        }
+    });
+    connect(exporter, &ExportThread::exportError, this, [this, exporter](const QString &error) {
+        if (exportThread == exporter) {
+            exportThread = nullptr;
+        }
+        exporter->deleteLater();
+        QMessageBox::warning(this, "失败", error);
+        statusLabel->setText("导出失败");
+    });
+
+    exporter->setExportType("statistics");
+    exporter->setFilename(filename);
+    exporter->setStatisticsData(statistics);
+    exporter->start();
+}
+
+void MainWindow::onArchiveFinishedActivities()
+{
+    if (!isLoggedIn || currentRole != UserRole::Admin) {
+        QMessageBox::warning(this, "提示", "只有管理员可以归档活动！");
+        return;
+    }
+    
+    bool ok = false;
+    int months = QInputDialog::getInt(this, "归档已结束活动",
+        "将结束超过多少个月的已结束活动（含报名、候补记录）移入归档库：", 6, 1, 120, 1, &ok);
+    if (!ok) {
+        return;
+    }
+    
+    QDateTime cutoff = QDateTime::currentDateTime().addMonths(-months);
+    statusLabel->setText("正在归档已结束的活动...");
+    AsyncDatabase::onFinished(asyncDatabase->archiveFinishedActivities(cutoff), this, [this](int archived) {
+        if (archived < 0) {
+            statusLabel->setText("归档失败");
+            QMessageBox::warning(this, "失败", "归档过程中出错，已完成的批次保留在归档库中。");
+            return;
+        }
+        statusLabel->setText(QString("已归档 %1 个活动").arg(archived));
+        qDebug() << "[归档] 已归档活动数:" << archived;
+    });
+}
+
+void MainWindow::onRemindersFired(const QList<ReminderRecord> &reminders)
+{
+    // 一批提醒包含所有学生的，只显示当前登录学生的
+    if (!isLoggedIn || currentRole != UserRole::Student) {
+        return;
+    }
+    QStringList messages;
+    for (const ReminderRecord &reminder : reminders) {
+        if (reminder.studentId == currentStudentId) {
+            messages.append(reminder.message);
         }
     }
+    if (messages.isEmpty()) {
+        return;
+    }
+    
+    QString text = messages.size() == 1
+        ? messages.first()
+        : QString("您有 %1 个报名的活动即将开始：\n%2").arg(messages.size()).arg(messages.join("\n"));
+    if (QSystemTrayIcon::isSystemTrayAvailable()) {
+        if (!trayIcon) {
+            trayIcon = new QSystemTrayIcon(style()->standardIcon(QStyle::SP_MessageBoxInformation), this);
+            trayIcon->setToolTip(windowTitle());
+            trayIcon->show();
+        }
+        trayIcon->showMessage("活动提醒", text, QSystemTrayIcon::Information);
+    }
+    statusLabel->setText(messages.first());
 }
 
 void MainWindow::setupNetworkConnections()
@@ -236,6 +406,14 @@ void MainWindow::setupNetworkConnections()
             this, &MainWindow::onAnnouncementsReceived);
     connect(networkManager, &NetworkManager::errorOccurred,
             this, &MainWindow::onNetworkError);
+    
+    // 增量同步写入本地数据库
+    networkManager->setDatabase(database);
+    connect(networkManager, &NetworkManager::activityChangesProgress, this, [this](int appliedCount) {
+        statusLabel->setText(QString("正在拉取平台活动变更：已应用 %1 条").arg(appliedCount));
+    });
+    connect(networkManager, &NetworkManager::activityChangesPulled,
+            this, &MainWindow::onActivityChangesPulled);
 }
 
 void MainWindow::onFetchCategories()
@@ -250,6 +428,21 @@ void MainWindow::onFetchAnnouncements()
     networkManager->fetchAnnouncements();
 }
 
+void MainWindow::onPullActivityChanges()
+{
+    statusLabel->setText("正在拉取平台活动变更...");
+    networkManager->pullActivityChanges();
+}
+
+void MainWindow::onActivityChangesPulled(int appliedCount, const QString &cursor)
+{
+    statusLabel->setText(QString("平台活动变更拉取完成：共 %1 条（游标 %2）").arg(appliedCount).arg(cursor));
+    
+    if (appliedCount > 0 && activityManager) {
+        activityManager->refreshActivities();
+    }
+}
+
 void MainWindow::onCategoriesReceived(const QStringList &categories)
 {
     QString message = "获取到的活动类别：\n";
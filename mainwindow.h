@@ -2,6 +2,7 @@
 #define MAINWINDOW_H
 
 #include <QMainWindow>
+#include <QElapsedTimer>
 #include "database.h"
 #include "loginwindow.h"
 #include "activitymanager.h"
@@ -9,12 +10,19 @@
 #include "networkmanager.h"
 #include "conflictchecker.h"
 #include "exportthread.h"
+#include "dbexecutor.h"
+#include "asyncdatabase.h"
+#include "snapshotdatabase.h"
+#include "activitylifecycle.h"
+#include "reminderengine.h"
+#include "lotterydrawer.h"
 
 QT_BEGIN_NAMESPACE
 class QTabWidget;
 class QMenuBar;
 class QStatusBar;
 class QLabel;
+class QSystemTrayIcon;
 QT_END_NAMESPACE
 
 class MainWindow : public QMainWindow
@@ -29,20 +37,33 @@ private slots:
     void onLogin();
     void onLogout();
     void onExportStatistics();
+    void onArchiveFinishedActivities();
     void onFetchCategories();
     void onFetchAnnouncements();
+    void onPullActivityChanges();
+    void onActivityChangesPulled(int appliedCount, const QString &cursor);
     void onCategoriesReceived(const QStringList &categories);
     void onAnnouncementsReceived(const QList<QHash<QString, QString>> &announcements);
     void onNetworkError(const QString &error);
     void onNewWindow();
+    void onRemindersFired(const QList<ReminderRecord> &reminders);
 private:
     void setupUI();
     void setupMenuBar();
+    void exportStatistics(bool includeArchive);
+    void startStatisticsExport(const QString &filename, const QList<QHash<QString, QVariant>> &statistics);
     void setupNetworkConnections();
     void showLoginWindow();
     void updateUIForRole();
     
     Database *database;
+    DbExecutor *queryExecutor;  // 表格查询的后台执行器
+    AsyncDatabase *asyncDatabase;  // 界面操作的异步读写
+    SnapshotDatabase *reportSnapshot;  // 统计、导出使用的只读快照
+    ActivityLifecycle *activityLifecycle;  // 按开始、结束时间自动更新活动状态
+    ReminderEngine *reminderEngine;  // 活动开始前提醒已报名的学生
+    LotteryDrawer *lotteryDrawer;    // 抽签、志愿匹配到截止时间后统一分配
+    QSystemTrayIcon *trayIcon;  // 首次显示提醒时创建
     LoginWindow *loginWindow;
     ActivityManager *activityManager;
     RegistrationManager *registrationManager;
@@ -58,6 +79,7 @@ private:
     QString currentStudentId;
     QString currentName;
     bool isLoggedIn;
+    QElapsedTimer startupTimer;  // 从构造到首次显示登录窗口，之后失效
 };
 
 #endif // MAINWINDOW_H
@@ -1,37 +1,309 @@
 #include "networkmanager.h"
+#include "database.h"
 #include <QNetworkRequest>
 #include <QUrl>
+#include <QUrlQuery>
+#include <QDateTime>
+#include <QTimer>
+#include <QCborValue>
+#include <QCborMap>
 #include <QDebug>
+#include <array>
+
+namespace {
+// 每页请求的变更条数，以及每个写入事务包含的变更条数
+const int kChangesPageSize = 1000;
+const int kChangesBatchSize = 200;
+
+// gzip 尾部需要的 CRC-32（IEEE 802.3）
+quint32 crc32(const QByteArray &data)
+{
+    // 局部静态变量的初始化是线程安全的，后台线程同时压缩时也只生成一次
+    static const std::array<quint32, 256> table = [] {
+        std::array<quint32, 256> entries;
+        for (quint32 i = 0; i < 256; ++i) {
+            quint32 c = i;
+            for (int k = 0; k < 8; ++k) {
+                c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            }
+            entries[i] = c;
+        }
+        return entries;
+    }();
+    
+    quint32 crc = 0xFFFFFFFFu;
+    for (char ch : data) {
+        crc = table[(crc ^ static_cast<quint8>(ch)) & 0xFF] ^ (crc >> 8);
+    }
+    return crc ^ 0xFFFFFFFFu;
+}
+}
 
 NetworkManager::NetworkManager(QObject *parent)
     : QObject(parent)
     , networkManager(new QNetworkAccessManager(this))
-    , categoriesReply(nullptr)
-    , announcementsReply(nullptr)
-    , syncActivityReply(nullptr)
-    , syncingActivityId(-1)
+    , breakerFailureThreshold(5)
+    , breakerCooldownMs(15000)
+    , payloadEncoding(PayloadEncoding::CompactJson)
+    , compression(Compression::Auto)
+    , logLevel(LogLevel::Info)
+    , database(nullptr)
+    , changesReply(nullptr)
+    , changesHasMore(false)
+    , changesApplied(0)
+    , changesDeadlineMs(0)
+{
+    // 各端点默认超时（毫秒）
+    endpointTimeouts["categories"] = 5000;
+    endpointTimeouts["announcements"] = 5000;
+    endpointTimeouts["sync"] = 10000;
+    endpointTimeouts["changes"] = 30000;
+    endpointTimeouts["notifications"] = 10000;
+    
+    monotonicClock.start();
+}
+
+NetworkManager::~NetworkManager()
+{
+}
+
+void NetworkManager::setEndpointTimeout(const QString &endpoint, int msecs)
+{
+    endpointTimeouts[endpoint] = msecs;
+}
+
+void NetworkManager::setCircuitBreakerPolicy(int failureThreshold, int cooldownMs)
+{
+    breakerFailureThreshold = qMax(1, failureThreshold);
+    breakerCooldownMs = qMax(0, cooldownMs);
+}
+
+void NetworkManager::setPayloadEncoding(PayloadEncoding encoding)
+{
+    payloadEncoding = encoding;
+}
+
+void NetworkManager::setCompression(Compression mode)
 {
-    connect(networkManager, &QNetworkAccessManager::finished, this, [this](QNetworkReply *reply) {
-        if (reply == categoriesReply) {
-            onCategoriesReplyFinished();
-        } else if (reply == announcementsReply) {
-            onAnnouncementsReplyFinished();
-        } else if (reply == syncActivityReply) {
-            onSyncActivityReplyFinished();
+    compression = mode;
+}
+
+void NetworkManager::setLogLevel(LogLevel level)
+{
+    logLevel = level;
+}
+
+void NetworkManager::setBaseUrl(const QString &url)
+{
+    baseUrl = url;
+}
+
+QByteArray NetworkManager::gzipCompress(const QByteArray &data)
+{
+    // qCompress 输出为：4字节长度 + zlib头(2字节) + deflate数据 + adler32(4字节)
+    // 去掉长度、zlib头和校验和后即为gzip所需的原始deflate数据
+    QByteArray zlibData = qCompress(data, 6);
+    if (zlibData.size() < 10) {
+        return QByteArray();
+    }
+    QByteArray deflateData = zlibData.mid(6, zlibData.size() - 10);
+    
+    QByteArray gzip;
+    gzip.reserve(deflateData.size() + 18);
+    const char header[10] = { '\x1f', '\x8b', 8, 0, 0, 0, 0, 0, 0, '\xff' };
+    gzip.append(header, 10);
+    gzip.append(deflateData);
+    
+    quint32 crc = crc32(data);
+    quint32 size = static_cast<quint32>(data.size());
+    for (int i = 0; i < 4; ++i) {
+        gzip.append(static_cast<char>((crc >> (8 * i)) & 0xFF));
+    }
+    for (int i = 0; i < 4; ++i) {
+        gzip.append(static_cast<char>((size >> (8 * i)) & 0xFF));
+    }
+    return gzip;
+}
+
+QJsonDocument NetworkManager::parseReplyBody(QNetworkReply *reply, const QByteArray &data,
+                                             QJsonParseError *error) const
+{
+    QString contentType = reply->header(QNetworkRequest::ContentTypeHeader).toString();
+    if (!contentType.contains("application/cbor")) {
+        return QJsonDocument::fromJson(data, error);
+    }
+    
+    QCborParserError cborError;
+    QCborValue value = QCborValue::fromCbor(data, &cborError);
+    if (cborError.error != QCborError::NoError) {
+        error->error = QJsonParseError::IllegalValue;
+        error->offset = static_cast<int>(cborError.offset);
+        return QJsonDocument();
+    }
+    
+    error->error = QJsonParseError::NoError;
+    if (value.isArray()) {
+        return QJsonDocument(value.toArray().toJsonArray());
+    }
+    return QJsonDocument(value.toMap().toJsonObject());
+}
+
+bool NetworkManager::allowRequest(const QString &hostKey)
+{
+    CircuitBreaker &breaker = breakers[hostKey];
+    
+    switch (breaker.state) {
+        case CircuitBreaker::Closed:
+            return true;
+        case CircuitBreaker::Open:
+            if (monotonicClock.elapsed() - breaker.openedAtMs < breakerCooldownMs) {
+                return false;
+            }
+            // 冷却结束：放行一个探测请求
+            breaker.state = CircuitBreaker::HalfOpen;
+            breaker.probeInFlight = true;
+            qDebug() << "[熔断器]" << hostKey << "进入半开状态，发送探测请求";
+            return true;
+        case CircuitBreaker::HalfOpen:
+            if (breaker.probeInFlight) {
+                return false;
+            }
+            breaker.probeInFlight = true;
+            return true;
+    }
+    return true;
+}
+
+void NetworkManager::recordOutcome(const QString &hostKey, bool success)
+{
+    CircuitBreaker &breaker = breakers[hostKey];
+    breaker.probeInFlight = false;
+    
+    if (success) {
+        if (breaker.state != CircuitBreaker::Closed) {
+            qDebug() << "[熔断器]" << hostKey << "恢复正常";
         }
+        breaker.state = CircuitBreaker::Closed;
+        breaker.consecutiveFailures = 0;
+        return;
+    }
+    
+    breaker.consecutiveFailures++;
+    if (breaker.state == CircuitBreaker::HalfOpen
+        || breaker.consecutiveFailures >= breakerFailureThreshold) {
+        if (breaker.state != CircuitBreaker::Open) {
+            qDebug() << "[熔断器]" << hostKey << "连续失败" << breaker.consecutiveFailures << "次，暂停请求";
+        }
+        breaker.state = CircuitBreaker::Open;
+        breaker.openedAtMs = monotonicClock.elapsed();
+    }
+}
+
+QNetworkReply *NetworkManager::startRequest(const QString &endpoint, QNetworkRequest request,
+                                            const QByteArray &body, bool isPost, int timeoutMs)
+{
+    QString hostKey = request.url().host() + ":" + QString::number(request.url().port(80));
+    
+    if (!allowRequest(hostKey)) {
+        emit errorOccurred(QString("服务器暂时不可用（%1），请稍后重试").arg(hostKey), "circuit_open");
+        emit requestFinished(endpoint, 0, "circuit_open");
+        return nullptr;
+    }
+    
+    if (timeoutMs < 0) {
+        timeoutMs = endpointTimeouts.value(endpoint, 10000);
+    }
+    // 将剩余时间告知服务器，便于服务器提前放弃无法按时完成的工作
+    request.setRawHeader("X-Request-Timeout-Ms", QByteArray::number(timeoutMs));
+    
+    // 响应的 Accept-Encoding/解压由 QNetworkAccessManager 自动处理，这里只压缩请求体
+    QByteArray payload = body;
+    bool gzipBody = isPost && !body.isEmpty()
+        && (compression == Compression::Gzip
+            || (compression == Compression::Auto && gzipAcceptedByHost.value(hostKey, false)));
+    if (gzipBody) {
+        payload = gzipCompress(body);
+        request.setRawHeader("Content-Encoding", "gzip");
+    }
+    
+    QNetworkReply *reply = isPost ? networkManager->post(request, payload) : networkManager->get(request);
+    reply->setProperty("endpoint", endpoint);
+    reply->setProperty("hostKey", hostKey);
+    reply->setProperty("gzipBody", gzipBody);
+    reply->setProperty("startedAtMs", monotonicClock.elapsed());
+    // 半开状态下放行的请求就是探测请求
+    reply->setProperty("probe", breakers.value(hostKey).state == CircuitBreaker::HalfOpen);
+    
+    if (logLevel >= LogLevel::Info && isPost) {
+        qDebug() << "[请求]" << endpoint << "原始" << body.size() << "字节，发送" << payload.size() << "字节";
+    }
+    
+    // 截止时间到达后中止请求，避免请求永久挂起
+    QTimer *deadline = new QTimer(reply);
+    deadline->setSingleShot(true);
+    connect(deadline, &QTimer::timeout, reply, [reply]() {
+        reply->setProperty("timedOut", true);
+        reply->abort();
     });
+    deadline->start(timeoutMs);
+    
+    return reply;
 }
 
-NetworkManager::~NetworkManager()
+QString NetworkManager::finishRequest(QNetworkReply *reply)
 {
-    if (categoriesReply) {
-        categoriesReply->deleteLater();
+    QString hostKey = reply->property("hostKey").toString();
+    int httpStatus = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+    
+    QString reason;
+    if (reply->property("timedOut").toBool()) {
+        reason = "timeout";
+    } else if (reply->error() == QNetworkReply::OperationCanceledError) {
+        reason = "cancelled";
+    } else if (httpStatus >= 400) {
+        reason = "http_error";
+    } else if (reply->error() != QNetworkReply::NoError) {
+        reason = "network_error";
     }
-    if (announcementsReply) {
-        announcementsReply->deleteLater();
+    
+    // 服务器在响应头中声明可接受 gzip 请求体（RFC 7694）；415 表示不接受
+    if (reply->rawHeader("Accept-Encoding").contains("gzip")) {
+        gzipAcceptedByHost[hostKey] = true;
+    } else if (httpStatus == 415 && reply->property("gzipBody").toBool()) {
+        gzipAcceptedByHost[hostKey] = false;
     }
-    if (syncActivityReply) {
-        syncActivityReply->deleteLater();
+    
+    // 主动取消和4xx不代表服务器故障，不计入熔断；
+    // 被取消的若是探测请求，保持半开状态，让下一个请求重新探测
+    if (reason != "cancelled") {
+        bool hostHealthy = reason.isEmpty() || (reason == "http_error" && httpStatus < 500);
+        recordOutcome(hostKey, hostHealthy);
+    } else if (reply->property("probe").toBool()) {
+        breakers[hostKey].probeInFlight = false;
+    }
+    
+    int elapsedMs = static_cast<int>(monotonicClock.elapsed() - reply->property("startedAtMs").toLongLong());
+    emit requestFinished(reply->property("endpoint").toString(), elapsedMs, reason);
+    
+    reply->deleteLater();
+    return reason;
+}
+
+QString NetworkManager::describeError(QNetworkReply *reply, const QString &reason) const
+{
+    if (reason == "timeout") {
+        return "请求超时";
+    }
+    
+    switch (reply->error()) {
+        case QNetworkReply::ConnectionRefusedError:
+            return "连接被拒绝";
+        case QNetworkReply::HostNotFoundError:
+            return "主机未找到";
+        case QNetworkReply::TimeoutError:
+            return "请求超时";
+        default:
+            return "网络错误：" + reply->errorString();
     }
 }
 
@@ -40,15 +312,15 @@ void NetworkManager::fetchActivityCategories()
     QUrl url(baseUrl + "/categories");
     QNetworkRequest request(url);
     
-    categoriesReply = networkManager->get(request);
-    // Qt 5.12使用error信号，Qt 5.15+使用errorOccurred
-    #if QT_VERSION >= QT_VERSION_CHECK(5, 15, 0)
-    connect(categoriesReply, QOverload<QNetworkReply::NetworkError>::of(&QNetworkReply::errorOccurred),
-            this, &NetworkManager::onNetworkError);
-    #else
-    connect(categoriesReply, static_cast<void(QNetworkReply::*)(QNetworkReply::NetworkError)>(&QNetworkReply::error),
-            this, &NetworkManager::onNetworkError);
-    #endif
+    QNetworkReply *reply = startRequest("categories", request);
+    if (!reply) {
+        // 熔断期间直接使用默认类别列表
+        onCategoriesReplyFinished(nullptr);
+        return;
+    }
+    connect(reply, &QNetworkReply::finished, this, [this, reply]() {
+        onCategoriesReplyFinished(reply);
+    });
 }
 
 void NetworkManager::fetchAnnouncements()
@@ -56,39 +328,34 @@ void NetworkManager::fetchAnnouncements()
     QUrl url(baseUrl + "/announcements");
     QNetworkRequest request(url);
     
-    announcementsReply = networkManager->get(request);
-    // Qt 5.12使用error信号，Qt 5.15+使用errorOccurred
-    #if QT_VERSION >= QT_VERSION_CHECK(5, 15, 0)
-    connect(announcementsReply, QOverload<QNetworkReply::NetworkError>::of(&QNetworkReply::errorOccurred),
-            this, &NetworkManager::onNetworkError);
-    #else
-    connect(announcementsReply, static_cast<void(QNetworkReply::*)(QNetworkReply::NetworkError)>(&QNetworkReply::error),
-            this, &NetworkManager::onNetworkError);
-    #endif
+    QNetworkReply *reply = startRequest("announcements", request);
+    if (!reply) return;
+    connect(reply, &QNetworkReply::finished, this, [this, reply]() {
+        onAnnouncementsReplyFinished(reply);
+    });
 }
 
-void NetworkManager::onCategoriesReplyFinished()
+void NetworkManager::onCategoriesReplyFinished(QNetworkReply *reply)
 {
-    if (!categoriesReply) return;
+    QString reason = reply ? finishRequest(reply) : QString("circuit_open");
     
-    if (categoriesReply->error() != QNetworkReply::NoError) {
+    if (!reason.isEmpty()) {
+        if (reply && reason != "cancelled") {
+            emit errorOccurred(describeError(reply, reason), reason);
+        }
         // 如果网络请求失败，返回默认类别列表
         QStringList defaultCategories;
         defaultCategories << "学术讲座" << "文体活动" << "社会实践" << "志愿服务" << "竞赛活动" << "其他";
         emit categoriesReceived(defaultCategories);
-        categoriesReply->deleteLater();
-        categoriesReply = nullptr;
         return;
     }
     
-    QByteArray data = categoriesReply->readAll();
+    QByteArray data = reply->readAll();
     QJsonParseError error;
     QJsonDocument doc = QJsonDocument::fromJson(data, &error);
     
     if (error.error != QJsonParseError::NoError) {
-        emit errorOccurred("解析JSON失败：" + error.errorString());
-        categoriesReply->deleteLater();
-        categoriesReply = nullptr;
+        emit errorOccurred("解析JSON失败：" + error.errorString(), "parse_error");
         return;
     }
     
@@ -113,29 +380,25 @@ void NetworkManager::onCategoriesReplyFinished()
     }
     
     emit categoriesReceived(categories);
-    categoriesReply->deleteLater();
-    categoriesReply = nullptr;
 }
 
-void NetworkManager::onAnnouncementsReplyFinished()
+void NetworkManager::onAnnouncementsReplyFinished(QNetworkReply *reply)
 {
-    if (!announcementsReply) return;
+    QString reason = finishRequest(reply);
     
-    if (announcementsReply->error() != QNetworkReply::NoError) {
-        emit errorOccurred("网络请求失败：" + announcementsReply->errorString());
-        announcementsReply->deleteLater();
-        announcementsReply = nullptr;
+    if (!reason.isEmpty()) {
+        if (reason != "cancelled") {
+            emit errorOccurred("网络请求失败：" + describeError(reply, reason), reason);
+        }
         return;
     }
     
-    QByteArray data = announcementsReply->readAll();
+    QByteArray data = reply->readAll();
     QJsonParseError error;
     QJsonDocument doc = QJsonDocument::fromJson(data, &error);
     
     if (error.error != QJsonParseError::NoError) {
-        emit errorOccurred("解析JSON失败：" + error.errorString());
-        announcementsReply->deleteLater();
-        announcementsReply = nullptr;
+        emit errorOccurred("解析JSON失败：" + error.errorString(), "parse_error");
         return;
     }
     
@@ -161,8 +424,6 @@ void NetworkManager::onAnnouncementsReplyFinished()
     }
     
     emit announcementsReceived(announcements);
-    announcementsReply->deleteLater();
-    announcementsReply = nullptr;
 }
 
 void NetworkManager::syncActivityToPlatform(int activityId, const QHash<QString, QVariant> &activityData)
@@ -184,50 +445,62 @@ void NetworkManager::syncActivityToPlatform(int activityId, const QHash<QString,
     json["location"] = activityData["location"].toString();
     json["status"] = activityData["status"].toInt();
     
-    QJsonDocument doc(json);
-    QByteArray data = doc.toJson();
-    
-    qDebug() << "[同步请求] 活动ID:" << activityId;
-    qDebug() << "[同步请求] URL:" << url.toString();
-    qDebug() << "[同步请求] 数据:" << QString::fromUtf8(data);
+    QByteArray data;
+    switch (payloadEncoding) {
+        case PayloadEncoding::IndentedJson:
+            data = QJsonDocument(json).toJson(QJsonDocument::Indented);
+            break;
+        case PayloadEncoding::CompactJson:
+            data = QJsonDocument(json).toJson(QJsonDocument::Compact);
+            break;
+        case PayloadEncoding::Cbor:
+            data = QCborMap::fromJsonObject(json).toCborValue().toCbor();
+            request.setHeader(QNetworkRequest::ContentTypeHeader, "application/cbor");
+            break;
+    }
+    request.setRawHeader("Accept", "application/cbor, application/json;q=0.9");
     
-    syncingActivityId = activityId;
-    syncActivityReply = networkManager->post(request, data);
+    if (logLevel >= LogLevel::Info) {
+        qDebug() << "[同步请求] 活动ID:" << activityId << "URL:" << url.toString();
+    }
+    if (logLevel >= LogLevel::Debug) {
+        qDebug() << "[同步请求] 数据:" << (payloadEncoding == PayloadEncoding::Cbor
+                                         ? QString::fromLatin1(data.toHex())
+                                         : QString::fromUtf8(data));
+    }
     
-    #if QT_VERSION >= QT_VERSION_CHECK(5, 15, 0)
-    connect(syncActivityReply, QOverload<QNetworkReply::NetworkError>::of(&QNetworkReply::errorOccurred),
-            this, &NetworkManager::onNetworkError);
-    #else
-    connect(syncActivityReply, static_cast<void(QNetworkReply::*)(QNetworkReply::NetworkError)>(&QNetworkReply::error),
-            this, &NetworkManager::onNetworkError);
-    #endif
+    QNetworkReply *reply = startRequest("sync", request, data, true);
+    if (!reply) {
+        emit activitySynced(activityId, false);
+        return;
+    }
+    connect(reply, &QNetworkReply::finished, this, [this, reply, activityId]() {
+        onSyncActivityReplyFinished(reply, activityId);
+    });
 }
 
-void NetworkManager::onSyncActivityReplyFinished()
+void NetworkManager::onSyncActivityReplyFinished(QNetworkReply *reply, int activityId)
 {
-    if (!syncActivityReply) return;
-    
     bool success = false;
-    int activityId = syncingActivityId;
+    QString reason = finishRequest(reply);
     
-    if (syncActivityReply->error() == QNetworkReply::NoError) {
-        QByteArray data = syncActivityReply->readAll();
-        qDebug() << "[同步响应] 活动ID:" << activityId << "响应数据:" << data;
+    if (reason.isEmpty()) {
+        QByteArray data = reply->readAll();
+        if (logLevel >= LogLevel::Debug) {
+            qDebug() << "[同步响应] 活动ID:" << activityId << "响应数据:" << data;
+        }
         
         QJsonParseError error;
-        QJsonDocument doc = QJsonDocument::fromJson(data, &error);
+        QJsonDocument doc = parseReplyBody(reply, data, &error);
         
         if (error.error != QJsonParseError::NoError) {
-            qDebug() << "[同步错误] JSON解析失败:" << error.errorString();
-            qDebug() << "[同步错误] 响应内容:" << QString::fromUtf8(data);
+            qDebug() << "[同步错误] 响应解析失败:" << error.errorString();
         } else if (doc.isObject()) {
             QJsonObject obj = doc.object();
-            qDebug() << "[同步响应] JSON对象:" << obj;
             
             if (obj.contains("success")) {
                 success = obj["success"].toBool();
-                qDebug() << "[同步结果] 活动ID:" << activityId << "成功:" << success;
-                if (obj.contains("message")) {
+                if (logLevel >= LogLevel::Debug && obj.contains("message")) {
                     qDebug() << "[同步消息]:" << obj["message"].toString();
                 }
             } else {
@@ -237,34 +510,236 @@ void NetworkManager::onSyncActivityReplyFinished()
             qDebug() << "[同步错误] 响应不是JSON对象";
         }
     } else {
-        qDebug() << "[同步错误] 网络请求失败:" << syncActivityReply->errorString();
-        qDebug() << "[同步错误] 错误代码:" << syncActivityReply->error();
+        qDebug() << "[同步错误] 网络请求失败:" << reply->errorString() << "原因:" << reason;
+        if (reason != "cancelled") {
+            emit errorOccurred(describeError(reply, reason), reason);
+        }
     }
     
-    qDebug() << "[同步完成] 活动ID:" << activityId << "最终结果:" << success;
+    if (logLevel >= LogLevel::Info) {
+        qDebug() << "[同步完成] 活动ID:" << activityId << "最终结果:" << success;
+    }
     emit activitySynced(activityId, success);
-    syncActivityReply->deleteLater();
-    syncActivityReply = nullptr;
-    syncingActivityId = -1;
 }
 
-void NetworkManager::onNetworkError(QNetworkReply::NetworkError error)
+void NetworkManager::deliverNotifications(const QList<ReminderRecord> &notifications)
 {
-    QString errorString;
-    switch (error) {
-        case QNetworkReply::ConnectionRefusedError:
-            errorString = "连接被拒绝";
-            break;
-        case QNetworkReply::HostNotFoundError:
-            errorString = "主机未找到";
-            break;
-        case QNetworkReply::TimeoutError:
-            errorString = "请求超时";
-            break;
-        default:
-            errorString = "网络错误：" + QString::number(error);
+    QUrl url(baseUrl + "/notifications");
+    QNetworkRequest request(url);
+    request.setHeader(QNetworkRequest::ContentTypeHeader, "application/json");
+    
+    QList<int> notificationIds;
+    QJsonArray items;
+    for (const ReminderRecord &notification : notifications) {
+        QJsonObject item;
+        item["id"] = notification.notificationId;
+        item["student_id"] = notification.studentId;
+        item["activity_id"] = notification.activityId;
+        item["message"] = notification.message;
+        items.append(item);
+        notificationIds.append(notification.notificationId);
+    }
+    QJsonObject json;
+    json["notifications"] = items;
+    
+    if (logLevel >= LogLevel::Info) {
+        qDebug() << "[通知投递] 条数:" << notifications.size() << "URL:" << url.toString();
+    }
+    
+    QNetworkReply *reply = startRequest("notifications", request, QJsonDocument(json).toJson(QJsonDocument::Compact), true);
+    if (!reply) {
+        emit notificationsDelivered(notificationIds, false);
+        return;
+    }
+    connect(reply, &QNetworkReply::finished, this, [this, reply, notificationIds]() {
+        onNotificationsReplyFinished(reply, notificationIds);
+    });
+}
+
+void NetworkManager::onNotificationsReplyFinished(QNetworkReply *reply, const QList<int> &notificationIds)
+{
+    bool success = false;
+    QString reason = finishRequest(reply);
+    
+    if (reason.isEmpty()) {
+        QJsonParseError error;
+        QJsonDocument doc = parseReplyBody(reply, reply->readAll(), &error);
+        success = error.error == QJsonParseError::NoError && doc.isObject() && doc.object()["success"].toBool();
+        if (!success) {
+            qDebug() << "[通知投递] 服务器未确认接收";
+        }
+    } else {
+        // 投递失败留在发件箱中稍后重试，不弹出错误提示
+        qDebug() << "[通知投递] 网络请求失败:" << reply->errorString() << "原因:" << reason;
+    }
+    
+    emit notificationsDelivered(notificationIds, success);
+}
+
+void NetworkManager::setDatabase(Database *db)
+{
+    database = db;
+}
+
+void NetworkManager::pullActivityChanges(int deadlineMs)
+{
+    if (!database) {
+        emit errorOccurred("增量同步失败：数据库未初始化", "database_error");
+        return;
     }
     
-    emit errorOccurred(errorString);
+    if (changesReply) {
+        qDebug() << "[增量同步] 上一次拉取尚未完成，忽略本次请求";
+        return;
+    }
+    
+    changesCursor = database->getSyncState("activity_changes_cursor", "0");
+    changesApplied = 0;
+    changesDeadlineMs = deadlineMs;
+    changesClock.start();
+    qDebug() << "[增量同步] 从游标" << changesCursor << "开始拉取";
+    
+    requestChangesPage();
 }
 
+void NetworkManager::requestChangesPage()
+{
+    // 整次拉取共享一个截止时间，每页只能使用剩余的时间
+    int remainingMs = changesDeadlineMs - static_cast<int>(changesClock.elapsed());
+    if (remainingMs <= 0) {
+        emit errorOccurred(QString("增量同步超出截止时间，已应用 %1 条变更，下次从游标 %2 继续")
+                           .arg(changesApplied).arg(changesCursor), "deadline_exceeded");
+        return;
+    }
+    
+    QUrl url(baseUrl + "/activities/changes");
+    QUrlQuery urlQuery;
+    urlQuery.addQueryItem("since", changesCursor);
+    urlQuery.addQueryItem("limit", QString::number(kChangesPageSize));
+    url.setQuery(urlQuery);
+    
+    QNetworkRequest request(url);
+    // 服务器以NDJSON返回：每行一条变更，最后一行为分页信息
+    request.setRawHeader("Accept", "application/x-ndjson");
+    
+    changesBuffer.clear();
+    pendingChanges.clear();
+    changesHasMore = false;
+    
+    int timeoutMs = qMin(endpointTimeouts.value("changes", 30000), remainingMs);
+    QNetworkReply *reply = startRequest("changes", request, QByteArray(), false, timeoutMs);
+    if (!reply) return;
+    
+    changesReply = reply;
+    connect(reply, &QNetworkReply::readyRead, this, &NetworkManager::onChangesReadyRead);
+    connect(reply, &QNetworkReply::finished, this, [this, reply]() {
+        onChangesReplyFinished(reply);
+    });
+}
+
+void NetworkManager::onChangesReadyRead()
+{
+    if (!changesReply) return;
+    
+    // 只解析已经完整到达的行，不等待整页下载完毕
+    changesBuffer.append(changesReply->readAll());
+    int lineEnd;
+    while ((lineEnd = changesBuffer.indexOf('\n')) >= 0) {
+        processChangeLine(changesBuffer.left(lineEnd));
+        changesBuffer.remove(0, lineEnd + 1);
+        
+        if (pendingChanges.size() >= kChangesBatchSize && !flushPendingChanges()) {
+            changesReply->abort();
+            return;
+        }
+    }
+}
+
+void NetworkManager::processChangeLine(const QByteArray &line)
+{
+    QByteArray trimmed = line.trimmed();
+    if (trimmed.isEmpty()) return;
+    
+    QJsonParseError error;
+    QJsonDocument doc = QJsonDocument::fromJson(trimmed, &error);
+    if (error.error != QJsonParseError::NoError || !doc.isObject()) {
+        qDebug() << "[增量同步] 跳过无法解析的行:" << error.errorString();
+        return;
+    }
+    
+    QJsonObject obj = doc.object();
+    
+    // 分页信息行
+    if (obj.contains("next_cursor")) {
+        changesCursor = obj["next_cursor"].toVariant().toString();
+        changesHasMore = obj["has_more"].toBool();
+        return;
+    }
+    
+    QJsonObject activity = obj["activity"].toObject();
+    QHash<QString, QVariant> change;
+    change["op"] = obj["op"].toString("upsert");
+    change["id"] = activity["id"].toInt();
+    change["title"] = activity["title"].toString();
+    change["description"] = activity["description"].toString();
+    change["category"] = activity["category"].toString();
+    change["organizer"] = activity["organizer"].toString();
+    change["start_time"] = QDateTime::fromString(activity["start_time"].toString(), Qt::ISODate);
+    change["end_time"] = QDateTime::fromString(activity["end_time"].toString(), Qt::ISODate);
+    change["max_participants"] = activity["max_participants"].toInt();
+    change["location"] = activity["location"].toString();
+    change["status"] = activity["status"].toInt();
+    pendingChanges.append(change);
+    
+    changesCursor = obj["seq"].toVariant().toString();
+}
+
+bool NetworkManager::flushPendingChanges()
+{
+    if (pendingChanges.isEmpty()) return true;
+    
+    if (!database->applyActivityChanges(pendingChanges, changesCursor)) {
+        emit errorOccurred("增量同步失败：写入数据库出错", "database_error");
+        pendingChanges.clear();
+        return false;
+    }
+    
+    changesApplied += pendingChanges.size();
+    pendingChanges.clear();
+    emit activityChangesProgress(changesApplied);
+    return true;
+}
+
+void NetworkManager::onChangesReplyFinished(QNetworkReply *reply)
+{
+    if (reply == changesReply) {
+        changesReply = nullptr;
+    }
+    QString reason = finishRequest(reply);
+    
+    if (!reason.isEmpty()) {
+        // 已完整解析的变更仍然写入，下次从游标处继续
+        flushPendingChanges();
+        if (reason != "cancelled") {
+            emit errorOccurred("增量同步失败：" + describeError(reply, reason), reason);
+        }
+        return;
+    }
+    
+    // 处理最后一行（可能没有换行符结尾）
+    changesBuffer.append(reply->readAll());
+    processChangeLine(changesBuffer);
+    changesBuffer.clear();
+    
+    if (!flushPendingChanges()) {
+        return;
+    }
+    
+    if (changesHasMore) {
+        requestChangesPage();
+        return;
+    }
+    
+    qDebug() << "[增量同步] 完成，共应用" << changesApplied << "条变更，游标:" << changesCursor;
+    emit activityChangesPulled(changesApplied, changesCursor);
+}
@@ -10,41 +10,134 @@
 #include <QStringList>
 #include <QHash>
 #include <QList>
+#include <QByteArray>
+#include <QElapsedTimer>
+
+class Database;
+struct ReminderRecord;
 
 class NetworkManager : public QObject
 {
     Q_OBJECT
 
 public:
+    // 活动同步请求体的编码方式
+    enum class PayloadEncoding {
+        IndentedJson,   // 带缩进的JSON（便于人工查看）
+        CompactJson,    // 紧凑JSON
+        Cbor            // CBOR二进制
+    };
+    
+    // 请求体压缩：Auto 表示服务器通过响应头 Accept-Encoding 声明支持 gzip 后才压缩
+    enum class Compression {
+        Off,
+        Auto,
+        Gzip
+    };
+    
+    // 日志级别：只有 Debug 级别才输出请求/响应的完整内容
+    enum class LogLevel {
+        Quiet,
+        Info,
+        Debug
+    };
+
     explicit NetworkManager(QObject *parent = nullptr);
     ~NetworkManager();
 
     void fetchActivityCategories();
     void fetchAnnouncements();
     void syncActivityToPlatform(int activityId, const QHash<QString, QVariant> &activityData);
+    // 把通知发件箱中的一批提醒投递到平台，结果通过 notificationsDelivered 返回
+    void deliverNotifications(const QList<ReminderRecord> &notifications);
+
+    // 增量拉取平台活动变更（按游标分页，边接收边解析，分批写入数据库）
+    // deadlineMs 为整次拉取的截止时间，每页请求的超时不会超过剩余时间
+    void setDatabase(Database *db);
+    void pullActivityChanges(int deadlineMs = 120000);
+
+    // 超时与熔断配置
+    // endpoint 取值："categories"、"announcements"、"sync"、"changes"、"notifications"
+    void setEndpointTimeout(const QString &endpoint, int msecs);
+    void setCircuitBreakerPolicy(int failureThreshold, int cooldownMs);
+    
+    // 同步负载编码、压缩与日志配置
+    void setPayloadEncoding(PayloadEncoding encoding);
+    void setCompression(Compression mode);
+    void setLogLevel(LogLevel level);
+    void setBaseUrl(const QString &url);
 
 signals:
     void categoriesReceived(const QStringList &categories);
     void announcementsReceived(const QList<QHash<QString, QString>> &announcements);
     void activitySynced(int activityId, bool success);
-    void errorOccurred(const QString &error);
+    void notificationsDelivered(const QList<int> &notificationIds, bool success);
+    // reason 为机器可读的错误原因："timeout"、"circuit_open"、"deadline_exceeded"、
+    // "network_error"、"http_error"、"parse_error"、"database_error"
+    void errorOccurred(const QString &error, const QString &reason = QString());
+    void activityChangesProgress(int appliedCount);
+    void activityChangesPulled(int appliedCount, const QString &cursor);
+    // 每个请求结束（包括被熔断拒绝）时发出，reason 为空表示成功，用于统计延迟
+    void requestFinished(const QString &endpoint, int elapsedMs, const QString &reason);
 
 private slots:
-    void onCategoriesReplyFinished();
-    void onAnnouncementsReplyFinished();
-    void onSyncActivityReplyFinished();
-    void onNetworkError(QNetworkReply::NetworkError error);
+    void onChangesReadyRead();
 
 private:
+    // 每个主机一个熔断器：连续失败达到阈值后断开，冷却后放行一个探测请求（半开）
+    struct CircuitBreaker {
+        enum State { Closed, Open, HalfOpen };
+        State state = Closed;
+        int consecutiveFailures = 0;
+        qint64 openedAtMs = 0;
+        bool probeInFlight = false;
+    };
+
     QNetworkAccessManager *networkManager;
-    QNetworkReply *categoriesReply;
-    QNetworkReply *announcementsReply;
-    QNetworkReply *syncActivityReply;
-    int syncingActivityId;
+    QHash<QString, int> endpointTimeouts;
+    QHash<QString, CircuitBreaker> breakers;
+    QElapsedTimer monotonicClock;  // 熔断冷却与请求耗时共用的单调时钟
+    int breakerFailureThreshold;
+    int breakerCooldownMs;
     
+    PayloadEncoding payloadEncoding;
+    Compression compression;
+    LogLevel logLevel;
+    QHash<QString, bool> gzipAcceptedByHost;  // 服务器是否声明接受 gzip 请求体
+
+    // 增量同步状态
+    Database *database;
+    QNetworkReply *changesReply;
+    QByteArray changesBuffer;                        // 尚未凑成完整一行的数据
+    QList<QHash<QString, QVariant>> pendingChanges;  // 已解析、待写入的变更
+    QString changesCursor;                           // 最后一条已解析变更的游标
+    bool changesHasMore;
+    int changesApplied;
+    QElapsedTimer changesClock;
+    int changesDeadlineMs;
+
+    QNetworkReply *startRequest(const QString &endpoint, QNetworkRequest request,
+                                const QByteArray &body = QByteArray(), bool isPost = false,
+                                int timeoutMs = -1);
+    QString finishRequest(QNetworkReply *reply);
+    QString describeError(QNetworkReply *reply, const QString &reason) const;
+    QJsonDocument parseReplyBody(QNetworkReply *reply, const QByteArray &data, QJsonParseError *error) const;
+    static QByteArray gzipCompress(const QByteArray &data);
+    bool allowRequest(const QString &hostKey);
+    void recordOutcome(const QString &hostKey, bool success);
+
+    void onCategoriesReplyFinished(QNetworkReply *reply);
+    void onAnnouncementsReplyFinished(QNetworkReply *reply);
+    void onSyncActivityReplyFinished(QNetworkReply *reply, int activityId);
+    void onNotificationsReplyFinished(QNetworkReply *reply, const QList<int> &notificationIds);
+    void onChangesReplyFinished(QNetworkReply *reply);
+
+    void requestChangesPage();
+    void processChangeLine(const QByteArray &line);
+    bool flushPendingChanges();
+
     // 模拟服务器URL（实际使用时需要替换为真实服务器地址）
     QString baseUrl = "http://localhost:8090/api";
 };
 
 #endif // NETWORKMANAGER_H
-
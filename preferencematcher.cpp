@@ -0,0 +1,146 @@
+#include "preferencematcher.h"
+#include <QQueue>
+#include <algorithm>
+
+PreferenceMatcher::PreferenceMatcher(const QVector<Activity> &activities, const QVector<Student> &students)
+    : activities(activities)
+    , students(students)
+    , held(activities.size())
+    , holding(students.size())
+    , rejected(students.size())
+    , heldCount(students.size(), 0)
+    , proposalCount(0)
+{
+    for (int s = 0; s < students.size(); ++s) {
+        holding[s].fill(0, students[s].preferences.size());
+        rejected[s].fill(0, students[s].preferences.size());
+    }
+}
+
+bool PreferenceMatcher::worse(int a, int b) const
+{
+    // 优先级相同时按下标，结果与输入顺序一致
+    if (students[a].priority != students[b].priority) {
+        return students[a].priority > students[b].priority;
+    }
+    return a > b;
+}
+
+bool PreferenceMatcher::conflicts(int student, int activity) const
+{
+    const Student &current = students[student];
+    const Activity &candidate = activities[activity];
+    for (const auto &interval : current.busy) {
+        if (interval.first < candidate.end && interval.second > candidate.start) {
+            return true;
+        }
+    }
+    for (int p = 0; p < current.preferences.size(); ++p) {
+        if (holding[student][p]) {
+            const Activity &other = activities[current.preferences[p]];
+            if (other.start < candidate.end && other.end > candidate.start) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+int PreferenceMatcher::nextChoice(int student) const
+{
+    const Student &current = students[student];
+    for (int p = 0; p < current.preferences.size(); ++p) {
+        if (!holding[student][p] && !rejected[student][p] && !conflicts(student, current.preferences[p])) {
+            return p;
+        }
+    }
+    return -1;
+}
+
+int PreferenceMatcher::preferenceIndex(int student, int activity) const
+{
+    const QVector<int> &preferences = students[student].preferences;
+    for (int p = 0; p < preferences.size(); ++p) {
+        if (preferences[p] == activity && holding[student][p]) {
+            return p;
+        }
+    }
+    return -1;
+}
+
+void PreferenceMatcher::run()
+{
+    // 堆顶为优先级最低的学生，名额超出时把它拒绝
+    auto heapLess = [this](int a, int b) { return worse(b, a); };
+
+    QQueue<int> pending;
+    QVector<char> queued(students.size(), 1);
+    for (int s = 0; s < students.size(); ++s) {
+        pending.enqueue(s);
+    }
+
+    while (!pending.isEmpty()) {
+        int student = pending.dequeue();
+        queued[student] = 0;
+
+        while (heldCount[student] < students[student].maxAssignments) {
+            int p = nextChoice(student);
+            if (p < 0) {
+                break;
+            }
+            int activity = students[student].preferences[p];
+            ++proposalCount;
+
+            if (activities[activity].capacity <= 0) {
+                rejected[student][p] = 1;
+                continue;
+            }
+            holding[student][p] = 1;
+            ++heldCount[student];
+            QVector<int> &heap = held[activity];
+            heap.append(student);
+            std::push_heap(heap.begin(), heap.end(), heapLess);
+            if (heap.size() <= activities[activity].capacity) {
+                continue;
+            }
+
+            std::pop_heap(heap.begin(), heap.end(), heapLess);
+            int loser = heap.takeLast();
+            int q = preferenceIndex(loser, activity);
+            holding[loser][q] = 0;
+            rejected[loser][q] = 1;
+            --heldCount[loser];
+            if (loser != student && !queued[loser]) {
+                // 被挤掉的学生重新从志愿表开头申请
+                queued[loser] = 1;
+                pending.enqueue(loser);
+            }
+        }
+    }
+}
+
+QVector<int> PreferenceMatcher::assignments(int student) const
+{
+    QVector<int> result;
+    const QVector<int> &preferences = students[student].preferences;
+    for (int p = 0; p < preferences.size(); ++p) {
+        if (holding[student][p]) {
+            result.append(preferences[p]);
+        }
+    }
+    return result;
+}
+
+int PreferenceMatcher::totalAssignments() const
+{
+    int total = 0;
+    for (int count : heldCount) {
+        total += count;
+    }
+    return total;
+}
+
+int PreferenceMatcher::proposals() const
+{
+    return proposalCount;
+}
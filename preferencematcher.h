@@ -0,0 +1,50 @@
+#ifndef PREFERENCEMATCHER_H
+#define PREFERENCEMATCHER_H
+
+#include <QtGlobal>
+#include <QVector>
+#include <QPair>
+
+// 志愿匹配：学生按志愿顺序申请，活动按名额暂时保留优先级最高的申请者（学生提出的延迟接受算法）。
+// 每个学生最多分配 maxAssignments 个活动，且分配到的活动之间、与已有日程之间时间不重叠。
+// 被活动拒绝后，学生从志愿表开头重新寻找未拒绝过、不冲突的活动（原先因冲突跳过的志愿可能重新可选）；
+// 每个 (学生, 活动) 至多被拒绝一次，因此一定终止。纯计算，不访问数据库，只在一个线程中使用。
+class PreferenceMatcher
+{
+public:
+    struct Activity {
+        int capacity = 0;     // 剩余名额
+        qint64 start = 0;     // 毫秒时间戳
+        qint64 end = 0;
+    };
+    struct Student {
+        int maxAssignments = 1;
+        QVector<int> preferences;                 // 活动下标，按志愿顺序
+        QVector<QPair<qint64, qint64>> busy;      // 已报名活动的时间段
+        quint32 priority = 0;                     // 越小越优先，由调用方按种子生成
+    };
+
+    PreferenceMatcher(const QVector<Activity> &activities, const QVector<Student> &students);
+
+    void run();
+    // run() 之后：每个学生分配到的活动下标（按志愿顺序）
+    QVector<int> assignments(int student) const;
+    int totalAssignments() const;
+    int proposals() const;   // 申请次数，用于压测
+
+private:
+    QVector<Activity> activities;
+    QVector<Student> students;
+    QVector<QVector<int>> held;        // 每个活动暂时保留的学生，按优先级组织成堆（最差的在堆顶）
+    QVector<QVector<char>> holding;    // holding[s][p]：学生 s 的第 p 个志愿当前被保留
+    QVector<QVector<char>> rejected;   // rejected[s][p]：学生 s 的第 p 个志愿已拒绝过
+    QVector<int> heldCount;
+    int proposalCount;
+
+    bool worse(int a, int b) const;   // 学生 a 的优先级低于 b
+    bool conflicts(int student, int activity) const;
+    int nextChoice(int student) const;   // 下一个可申请的志愿位置，没有时返回 -1
+    int preferenceIndex(int student, int activity) const;
+};
+
+#endif // PREFERENCEMATCHER_H
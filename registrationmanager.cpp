@@ -2,10 +2,14 @@
 #include <QVBoxLayout>
 #include <QHBoxLayout>
 #include <QTabWidget>
+#include <QTableView>
 #include <QTableWidget>
 #include <QPushButton>
 #include <QLabel>
 #include <QComboBox>
+#include <QLineEdit>
+#include <QSpinBox>
+#include <QRegExp>
 
 #include <QTextEdit>   // 新增：文本编辑框（用于详情对话框）
 #include <QFormLayout> // 新增：表单布局（用于详情对话框）
@@ -18,13 +22,55 @@
 #include <QDebug>
 #include "csvexporter.h"
 #include "conflictchecker.h"
+#include "activitytablemodel.h"
+#include "registrationtablemodel.h"
+#include "asyncdatabase.h"
+#include "snapshotdatabase.h"
+#include "checkinkiosk.h"
+#include "scandumpreader.h"
+#include "taskscheduler.h"
+#include <QElapsedTimer>
 
-RegistrationManager::RegistrationManager(Database *db, UserRole role, const QString &studentId, const QString &studentName, QWidget *parent)
+namespace {
+// 签到失败的原因
+QString checkInFailureText(CheckInResult result)
+{
+    switch (result) {
+    case CheckInResult::NotRegistered: return "未报名该活动";
+    case CheckInResult::TooEarly: return "活动尚未开始";
+    case CheckInResult::WrongCode: return "签到码不正确";
+    case CheckInResult::AlreadyCheckedIn: return "已经签到过了";
+    default: return "数据库错误，请稍后重试";
+    }
+}
+
+// 只有已批准（尚未开始）的活动可以报名
+QString registrationClosedText(ActivityStatus status)
+{
+    switch (status) {
+    case ActivityStatus::Ongoing: return "该活动已经开始，无法报名！";
+    case ActivityStatus::Finished: return "该活动已经结束，无法报名！";
+    case ActivityStatus::Rejected: return "该活动未通过审批，无法报名！";
+    default: return "该活动尚未批准，无法报名！";
+    }
+}
+}
+
+RegistrationManager::RegistrationManager(Database *db, DbExecutor *executor, AsyncDatabase *asyncDb, UserRole role, const QString &studentId, const QString &studentName, QWidget *parent)
     : QWidget(parent)
     , database(db)
+    , executor(executor)
+    , asyncDatabase(asyncDb)
+    , snapshotDatabase(nullptr)
+    , conflictChecker(nullptr)
+    , pendingSuggestionId(-1)
     , userRole(role)
     , currentStudentId(studentId)
     , currentStudentName(studentName)
+    , registrationModel(nullptr)
+    , availableModel(nullptr)
+    , displayedActivityId(-1)
+    , pendingRegistrationNotice(false)
 {
     // 如果是学生，且姓名未提供，才需要输入学号和姓名（向后兼容）
     if (role == UserRole::Student && currentStudentName.isEmpty()) {
@@ -75,21 +121,35 @@ void RegistrationManager::setupUI()
         QHBoxLayout *availableButtonLayout = new QHBoxLayout();
         viewDetailsButton = new QPushButton("查看详情并报名");
         availableButtonLayout->addWidget(viewDetailsButton);
+        preferencesButton = new QPushButton("志愿报名");
+        availableButtonLayout->addWidget(preferencesButton);
         availableButtonLayout->addStretch();
         availableLayout->addLayout(availableButtonLayout);
         
-        availableActivitiesTable = new QTableWidget();
-        availableActivitiesTable->setColumnCount(7);
-        QStringList headers = {"ID", "标题", "类别", "发起人", "开始时间", "结束时间", "剩余名额"};
-        availableActivitiesTable->setHorizontalHeaderLabels(headers);
+        availableModel = new ActivityTableModel(executor, {
+            ActivityTableModel::IdColumn, ActivityTableModel::TitleColumn,
+            ActivityTableModel::CategoryColumn, ActivityTableModel::OrganizerColumn,
+            ActivityTableModel::StartTimeColumn, ActivityTableModel::EndTimeColumn,
+            ActivityTableModel::RemainingColumn
+        }, this);
+        availableActivitiesTable = new QTableView();
+        availableActivitiesTable->setModel(availableModel);
         availableActivitiesTable->setSelectionBehavior(QAbstractItemView::SelectRows);
         availableActivitiesTable->setSelectionMode(QAbstractItemView::SingleSelection);
         availableActivitiesTable->setEditTriggers(QAbstractItemView::NoEditTriggers);
         availableActivitiesTable->horizontalHeader()->setStretchLastSection(true);
+        availableActivitiesTable->horizontalHeader()->setSortIndicator(-1, Qt::DescendingOrder);
+        availableActivitiesTable->setSortingEnabled(true);
         availableLayout->addWidget(availableActivitiesTable);
         
         connect(viewDetailsButton, &QPushButton::clicked, this, &RegistrationManager::onViewActivityDetails);
-        connect(availableActivitiesTable, &QTableWidget::itemDoubleClicked, this, &RegistrationManager::onViewActivityDetails);
+        connect(preferencesButton, &QPushButton::clicked, this, &RegistrationManager::onSubmitPreferences);
+        connect(availableActivitiesTable, &QTableView::doubleClicked, this, &RegistrationManager::onViewActivityDetails);
+        // 报名人数或审批状态变化时只刷新对应的活动行
+        connect(database, &Database::activityChanged, availableModel, &ActivityTableModel::markActivityDirty);
+        connect(availableModel, &ActivityTableModel::loadFinished, this, [this](int total) {
+            statusLabel->setText(QString("可报名活动：共 %1 项").arg(total));
+        });
         
         tabWidget->addTab(availableTab, "可报名活动");
         
@@ -107,18 +167,26 @@ void RegistrationManager::setupUI()
         
         connect(checkInButton, &QPushButton::clicked, this, &RegistrationManager::onCheckIn);
         
-        registrationsTable = new QTableWidget();
-        registrationsTable->setColumnCount(6);
-        QStringList headers2 = {"活动ID", "活动标题", "开始时间", "结束时间", "地点", "状态"};
-        registrationsTable->setHorizontalHeaderLabels(headers2);
+        registrationModel = new RegistrationTableModel(executor, {
+            RegistrationTableModel::ActivityIdColumn, RegistrationTableModel::TitleColumn,
+            RegistrationTableModel::StartTimeColumn, RegistrationTableModel::EndTimeColumn,
+            RegistrationTableModel::LocationColumn, RegistrationTableModel::StatusColumn
+        }, this);
+        registrationsTable = new QTableView();
+        registrationsTable->setModel(registrationModel);
         registrationsTable->setSelectionBehavior(QAbstractItemView::SelectRows);
         registrationsTable->setSelectionMode(QAbstractItemView::SingleSelection);
         registrationsTable->setEditTriggers(QAbstractItemView::NoEditTriggers);
         registrationsTable->horizontalHeader()->setStretchLastSection(true);
+        registrationsTable->horizontalHeader()->setSortIndicator(-1, Qt::AscendingOrder);
+        registrationsTable->setSortingEnabled(true);
         myRegistrationsLayout->addWidget(registrationsTable);
         
         connect(cancelButton, &QPushButton::clicked, this, &RegistrationManager::onCancelRegistration);
-        connect(registrationsTable, &QTableWidget::itemSelectionChanged, this, &RegistrationManager::onRegistrationSelectionChanged);
+        connect(registrationsTable->selectionModel(), &QItemSelectionModel::selectionChanged, this, &RegistrationManager::onRegistrationSelectionChanged);
+        connect(database, &Database::registrationChanged, registrationModel, &RegistrationTableModel::markRegistrationDirty);
+        connect(database, &Database::checkInRecorded, registrationModel, &RegistrationTableModel::markRegistrationDirty);
+        connect(database, &Database::activityChanged, registrationModel, &RegistrationTableModel::markActivityDirty);
         
         tabWidget->addTab(myRegistrationsTab, "我的报名");
         
@@ -147,6 +215,8 @@ void RegistrationManager::setupUI()
         }
         
         checkInButton = new QPushButton("签到管理");
+        kioskButton = new QPushButton("签到机模式");
+        importCheckInButton = new QPushButton("导入签到记录");
         viewCheckInListButton = new QPushButton("查看签到列表");
         viewCheckInStatsButton = new QPushButton("签到统计");
         
@@ -155,11 +225,15 @@ void RegistrationManager::setupUI()
         buttonLayout->addWidget(selectActivityButton);
         buttonLayout->addWidget(waitlistButton);
         buttonLayout->addWidget(checkInButton);
+        buttonLayout->addWidget(kioskButton);
+        buttonLayout->addWidget(importCheckInButton);
         buttonLayout->addWidget(viewCheckInListButton);
         buttonLayout->addWidget(viewCheckInStatsButton);
         buttonLayout->addWidget(exportButton);
         
         connect(checkInButton, &QPushButton::clicked, this, &RegistrationManager::onCheckIn);
+        connect(kioskButton, &QPushButton::clicked, this, &RegistrationManager::onStartKiosk);
+        connect(importCheckInButton, &QPushButton::clicked, this, &RegistrationManager::onImportCheckIns);
         connect(viewCheckInListButton, &QPushButton::clicked, this, &RegistrationManager::onViewCheckInList);
         connect(viewCheckInStatsButton, &QPushButton::clicked, this, &RegistrationManager::onViewCheckInStatistics);
         
@@ -170,58 +244,13 @@ void RegistrationManager::setupUI()
                 return;
             }
             
-            // 获取报名列表
-            QList<QHash<QString, QVariant>> registrations = database->getRegistrations(activityId);
-            
-            // 清空表格内容
-            registrationsTable->clearContents();
-            registrationsTable->setRowCount(registrations.size());
-            
-            // 如果没有报名记录
-            if (registrations.isEmpty()) {
-                statusLabel->setText(QString("活动ID %1 暂无报名记录").arg(activityId));
-                QMessageBox::information(this, "提示", "该活动暂无报名记录！");
-                return;
-            }
-            
-            // 填充表格数据
-            for (int i = 0; i < registrations.size(); ++i) {
-                const auto &reg = registrations[i];
-                
-                // 确保数据不为空
-                QString studentId = reg["student_id"].toString();
-                QString studentName = reg["student_name"].toString();
-                QString registeredAt = reg["registered_at"].toDateTime().toString("yyyy-MM-dd hh:mm");
-                QString activityIdStr = reg["activity_id"].toString();
-                
-                registrationsTable->setItem(i, 0, new QTableWidgetItem(studentId.isEmpty() ? "未知" : studentId));
-                registrationsTable->setItem(i, 1, new QTableWidgetItem(studentName.isEmpty() ? "未知" : studentName));
-                registrationsTable->setItem(i, 2, new QTableWidgetItem(registeredAt));
-                
-                QString statusText;
-                RegistrationStatus status = static_cast<RegistrationStatus>(reg["status"].toInt());
-                switch (status) {
-                    case RegistrationStatus::Registered: statusText = "已报名"; break;
-                    case RegistrationStatus::Cancelled: statusText = "已取消"; break;
-                    case RegistrationStatus::Waitlisted: statusText = "候补"; break;
-                    case RegistrationStatus::Confirmed: statusText = "已确认"; break;
-                    default: statusText = "未知"; break;
-                }
-                registrationsTable->setItem(i, 3, new QTableWidgetItem(statusText));
-                registrationsTable->setItem(i, 4, new QTableWidgetItem(activityIdStr));
-            }
-            
-            // 调整列宽以适应内容
-            registrationsTable->resizeColumnsToContents();
-            
-            // 确保表格可见
-            registrationsTable->show();
-            
-            // 更新状态标签
-            statusLabel->setText(QString("活动报名列表：共 %1 人").arg(registrations.size()));
-            
-            // 调试输出
-            qDebug() << "显示报名列表，活动ID:" << activityId << "，报名人数:" << registrations.size();
+            // 在后台加载报名列表（模型只读取第一页，滚动时继续加载），结果在 loadFinished 中处理
+            RegistrationQuery query;
+            query.activityId = activityId;
+            displayedActivityId = activityId;
+            pendingRegistrationNotice = true;
+            statusLabel->setText(QString("正在加载活动ID %1 的报名列表...").arg(activityId));
+            registrationModel->setQuery(query);
         });
         
         connect(waitlistButton, &QPushButton::clicked, this, &RegistrationManager::onViewWaitlist);
@@ -233,17 +262,45 @@ void RegistrationManager::setupUI()
     
     // 报名列表表格（仅组织者和管理员使用）
     if (userRole != UserRole::Student) {
-        registrationsTable = new QTableWidget();
-        registrationsTable->setColumnCount(5);
-        QStringList headers = {"学号", "姓名", "报名时间", "状态", "活动ID"};
-        registrationsTable->setHorizontalHeaderLabels(headers);
+        registrationModel = new RegistrationTableModel(executor, {
+            RegistrationTableModel::StudentIdColumn, RegistrationTableModel::StudentNameColumn,
+            RegistrationTableModel::RegisteredAtColumn, RegistrationTableModel::StatusColumn,
+            RegistrationTableModel::ActivityIdColumn
+        }, this);
+        registrationsTable = new QTableView();
+        registrationsTable->setModel(registrationModel);
         
         registrationsTable->setSelectionBehavior(QAbstractItemView::SelectRows);
         registrationsTable->setSelectionMode(QAbstractItemView::SingleSelection);
         registrationsTable->setEditTriggers(QAbstractItemView::NoEditTriggers);
         registrationsTable->horizontalHeader()->setStretchLastSection(true);
+        registrationsTable->horizontalHeader()->setSortIndicator(-1, Qt::AscendingOrder);
+        registrationsTable->setSortingEnabled(true);
         
-        connect(registrationsTable, &QTableWidget::itemSelectionChanged, this, &RegistrationManager::onRegistrationSelectionChanged);
+        connect(registrationsTable->selectionModel(), &QItemSelectionModel::selectionChanged, this, &RegistrationManager::onRegistrationSelectionChanged);
+        connect(database, &Database::registrationChanged, registrationModel, &RegistrationTableModel::markRegistrationDirty);
+        connect(database, &Database::checkInRecorded, registrationModel, &RegistrationTableModel::markRegistrationDirty);
+        connect(registrationModel, &RegistrationTableModel::loadFinished, this, [this](int total) {
+            // 只有点击"查看报名"触发的加载才提示，表头排序等重新加载不重复弹窗
+            if (!pendingRegistrationNotice) return;
+            pendingRegistrationNotice = false;
+            
+            // 如果没有报名记录
+            if (total == 0) {
+                statusLabel->setText(QString("活动ID %1 暂无报名记录").arg(displayedActivityId));
+                QMessageBox::information(this, "提示", "该活动暂无报名记录！");
+                return;
+            }
+            
+            // 调整列宽以适应已加载的内容
+            registrationsTable->resizeColumnsToContents();
+            
+            // 更新状态标签
+            statusLabel->setText(QString("活动报名列表：共 %1 人").arg(total));
+            
+            // 调试输出
+            qDebug() << "显示报名列表，活动ID:" << displayedActivityId << "，报名人数:" << total;
+        });
         
         mainLayout->addWidget(registrationsTable);
     }
@@ -257,28 +314,9 @@ void RegistrationManager::refreshRegistrations()
 void RegistrationManager::populateTable()
 {
     if (userRole == UserRole::Student) {
-        QList<QHash<QString, QVariant>> registrations = database->getStudentRegistrations(currentStudentId);
-        registrationsTable->setRowCount(registrations.size());
-        
-        for (int i = 0; i < registrations.size(); ++i) {
-            const auto &reg = registrations[i];
-            
-            registrationsTable->setItem(i, 0, new QTableWidgetItem(reg["activity_id"].toString()));
-            registrationsTable->setItem(i, 1, new QTableWidgetItem(reg["title"].toString()));
-            registrationsTable->setItem(i, 2, new QTableWidgetItem(reg["start_time"].toDateTime().toString("yyyy-MM-dd hh:mm")));
-            registrationsTable->setItem(i, 3, new QTableWidgetItem(reg["end_time"].toDateTime().toString("yyyy-MM-dd hh:mm")));
-            registrationsTable->setItem(i, 4, new QTableWidgetItem(reg["location"].toString()));
-            
-            QString statusText;
-            RegistrationStatus status = static_cast<RegistrationStatus>(reg["status"].toInt());
-            switch (status) {
-                case RegistrationStatus::Registered: statusText = "已报名"; break;
-                case RegistrationStatus::Cancelled: statusText = "已取消"; break;
-                case RegistrationStatus::Waitlisted: statusText = "候补"; break;
-                case RegistrationStatus::Confirmed: statusText = "已确认"; break;
-            }
-            registrationsTable->setItem(i, 5, new QTableWidgetItem(statusText));
-        }
+        RegistrationQuery query;
+        query.studentId = currentStudentId;
+        registrationModel->setQuery(query);
         
         // 同时刷新可报名活动列表
         populateAvailableActivities();
@@ -303,7 +341,7 @@ void RegistrationManager::onRegisterActivity()
     
     ActivityStatus status = static_cast<ActivityStatus>(activity["status"].toInt());
     if (status != ActivityStatus::Approved) {
-        QMessageBox::warning(this, "错误", "该活动尚未批准，无法报名！");
+        QMessageBox::warning(this, "错误", registrationClosedText(status));
         return;
     }
     
@@ -319,24 +357,117 @@ void RegistrationManager::onRegisterActivity()
     QList<QHash<QString, QVariant>> conflicts = database->checkTimeConflict(currentStudentId, startTime, endTime);
     
     if (!conflicts.isEmpty()) {
-        showConflictDialog(conflicts);
-        if (QMessageBox::question(this, "时间冲突", "检测到时间冲突，是否仍要报名？") != QMessageBox::Yes) {
+        showConflictDialog(activity, conflicts);
+        return;
+    }
+    
+    proceedRegistration(activity);
+}
+
+void RegistrationManager::onSubmitPreferences()
+{
+    QList<QHash<QString, QVariant>> rounds = database->getOpenMatchRounds();
+    if (rounds.isEmpty()) {
+        QMessageBox::information(this, "提示", "当前没有开放的志愿匹配。");
+        return;
+    }
+    
+    QDialog dialog(this);
+    dialog.setWindowTitle("志愿报名");
+    dialog.setMinimumWidth(450);
+    QFormLayout *formLayout = new QFormLayout(&dialog);
+    
+    QComboBox *roundComboBox = new QComboBox();
+    for (const auto &round : rounds) {
+        roundComboBox->addItem(QString("%1（%2 截止）").arg(round["title"].toString())
+                                   .arg(round["cutoff"].toDateTime().toString("yyyy-MM-dd hh:mm")),
+                               round["id"].toInt());
+    }
+    QLineEdit *preferencesEdit = new QLineEdit();
+    preferencesEdit->setPlaceholderText("按志愿顺序填写活动ID，用逗号分隔，如：12,7,30");
+    QSpinBox *maxAssignmentsEdit = new QSpinBox();
+    maxAssignmentsEdit->setRange(1, 10);
+    maxAssignmentsEdit->setValue(1);
+    QLabel *hintLabel = new QLabel("截止后统一匹配：按志愿顺序分配，最多分配所填个数，不会分配时间冲突的活动。"
+                                   "截止前可重新提交，以最后一次为准。");
+    hintLabel->setWordWrap(true);
+    hintLabel->setStyleSheet("color: gray;");
+    
+    formLayout->addRow("匹配轮次：", roundComboBox);
+    formLayout->addRow("志愿：", preferencesEdit);
+    formLayout->addRow("最多参加：", maxAssignmentsEdit);
+    formLayout->addRow("", hintLabel);
+    QDialogButtonBox *buttonBox = new QDialogButtonBox(QDialogButtonBox::Ok | QDialogButtonBox::Cancel);
+    formLayout->addRow(buttonBox);
+    connect(buttonBox, &QDialogButtonBox::accepted, &dialog, &QDialog::accept);
+    connect(buttonBox, &QDialogButtonBox::rejected, &dialog, &QDialog::reject);
+    
+    if (dialog.exec() != QDialog::Accepted) {
+        return;
+    }
+    
+    QList<int> activityIds;
+    for (const QString &item : preferencesEdit->text().split(QRegExp("[,，\\s]+"), QString::SkipEmptyParts)) {
+        bool ok = false;
+        int activityId = item.toInt(&ok);
+        if (!ok || activityId <= 0) {
+            QMessageBox::warning(this, "错误", QString("无效的活动ID：%1").arg(item));
             return;
         }
+        activityIds.append(activityId);
+    }
+    if (activityIds.isEmpty()) {
+        QMessageBox::warning(this, "错误", "请至少填写一个志愿！");
+        return;
     }
     
-    // 执行报名
-    if (database->registerActivity(activityId, currentStudentId, currentStudentName)) {
-        QMessageBox::information(this, "成功", "报名成功！");
-        refreshRegistrations();
-    } else {
-        // 可能已满，添加到候补
-        if (database->addToWaitlist(activityId, currentStudentId, currentStudentName)) {
-            QMessageBox::information(this, "提示", "活动已满，已加入候补列表！");
+    statusLabel->setText("正在提交志愿...");
+    AsyncDatabase::onFinished(asyncDatabase->submitPreferences(roundComboBox->currentData().toInt(), currentStudentId,
+                                                               currentStudentName, activityIds,
+                                                               maxAssignmentsEdit->value()),
+                              this, [this](bool success) {
+        if (success) {
+            statusLabel->setText("志愿已提交");
+            QMessageBox::information(this, "成功", "志愿已提交，截止后统一匹配，结果见\"我的报名\"。");
         } else {
-            QMessageBox::warning(this, "失败", "报名失败！");
+            statusLabel->setText("提交志愿失败");
+            QMessageBox::warning(this, "失败", "提交志愿失败：匹配可能已截止。");
         }
+    });
+}
+
+void RegistrationManager::proceedRegistration(const QHash<QString, QVariant> &activity)
+{
+    int activityId = activity["id"].toInt();
+    // 抽签报名的活动在抽签前只提交申请
+    if (!activity["lottery_deadline"].isNull() && activity["lottery_drawn_at"].isNull()) {
+        submitApplication(activityId, activity["lottery_deadline"].toDateTime());
+        return;
     }
+    
+    submitRegistration(activityId);
+}
+
+void RegistrationManager::submitApplication(int activityId, const QDateTime &deadline)
+{
+    if (QDateTime::currentDateTime() >= deadline) {
+        QMessageBox::information(this, "提示", "申请已截止，正在抽签，请稍后查看报名结果。");
+        return;
+    }
+    
+    statusLabel->setText("正在提交抽签申请...");
+    AsyncDatabase::onFinished(asyncDatabase->submitApplication(activityId, currentStudentId, currentStudentName), this,
+                              [this, deadline](bool success) {
+        if (success) {
+            statusLabel->setText("已提交抽签申请");
+            QMessageBox::information(this, "成功", QString("已提交抽签申请，将于 %1 统一抽签。\n"
+                                                          "与已报名活动时间冲突时不会中签。")
+                                     .arg(deadline.toString("yyyy-MM-dd hh:mm")));
+        } else {
+            statusLabel->setText("提交申请失败");
+            QMessageBox::warning(this, "失败", "提交申请失败：您可能已提交过申请，或申请已截止。");
+        }
+    });
 }
 
 void RegistrationManager::onCancelRegistration()
@@ -348,15 +479,41 @@ void RegistrationManager::onCancelRegistration()
     }
     
     if (QMessageBox::question(this, "确认", "确定要取消报名吗？") == QMessageBox::Yes) {
-        if (database->cancelRegistration(activityId, currentStudentId)) {
-            QMessageBox::information(this, "成功", "已取消报名！");
-            refreshRegistrations();
-        } else {
-            QMessageBox::warning(this, "失败", "取消报名失败！");
-        }
+        AsyncDatabase::onFinished(asyncDatabase->cancelRegistration(activityId, currentStudentId), this, [this](bool success) {
+            if (success) {
+                QMessageBox::information(this, "成功", "已取消报名！");
+            } else {
+                QMessageBox::warning(this, "失败", "取消报名失败！");
+            }
+        });
     }
 }
 
+void RegistrationManager::submitRegistration(int activityId)
+{
+    // 报名写入在后台按顺序执行，表格通过数据库变更信号单行更新
+    statusLabel->setText("正在提交报名...");
+    AsyncDatabase::onFinished(asyncDatabase->registerActivity(activityId, currentStudentId, currentStudentName), this,
+                              [this, activityId](bool success) {
+        if (success) {
+            statusLabel->setText("报名成功");
+            QMessageBox::information(this, "成功", "报名成功！");
+            return;
+        }
+        // 可能已满，添加到候补
+        AsyncDatabase::onFinished(asyncDatabase->addToWaitlist(activityId, currentStudentId, currentStudentName), this,
+                                  [this](bool added) {
+            if (added) {
+                statusLabel->setText("已加入候补列表");
+                QMessageBox::information(this, "提示", "活动已满，已加入候补列表！");
+            } else {
+                statusLabel->setText("报名失败");
+                QMessageBox::warning(this, "失败", "报名失败！");
+            }
+        });
+    });
+}
+
 void RegistrationManager::onViewWaitlist()
 {
     int activityId = -1;
@@ -372,24 +529,25 @@ void RegistrationManager::onViewWaitlist()
         if (!ok) return;
     }
     
-    QList<QHash<QString, QVariant>> waitlist = database->getWaitlist(activityId);
-    
-    if (waitlist.isEmpty()) {
-        QMessageBox::information(this, "提示", "该活动没有候补学生！");
-        return;
-    }
-    
-    QString message = QString("候补列表（共 %1 人）：\n\n").arg(waitlist.size());
-    for (int i = 0; i < waitlist.size(); ++i) {
-        const auto &item = waitlist[i];
-        message += QString("%1. %2 (%3) - %4\n")
-            .arg(i + 1)
-            .arg(item["student_name"].toString())
-            .arg(item["student_id"].toString())
-            .arg(item["added_at"].toDateTime().toString("yyyy-MM-dd hh:mm"));
-    }
-    
-    QMessageBox::information(this, "候补列表", message);
+    AsyncDatabase::onFinished(asyncDatabase->getWaitlist(activityId), this,
+                              [this](const QList<QHash<QString, QVariant>> &waitlist) {
+        if (waitlist.isEmpty()) {
+            QMessageBox::information(this, "提示", "该活动没有候补学生！");
+            return;
+        }
+        
+        QString message = QString("候补列表（共 %1 人）：\n\n").arg(waitlist.size());
+        for (int i = 0; i < waitlist.size(); ++i) {
+            const auto &item = waitlist[i];
+            message += QString("%1. %2 (%3) - %4\n")
+                .arg(i + 1)
+                .arg(item["student_name"].toString())
+                .arg(item["student_id"].toString())
+                .arg(item["added_at"].toDateTime().toString("yyyy-MM-dd hh:mm"));
+        }
+        
+        QMessageBox::information(this, "候补列表", message);
+    });
 }
 
 void RegistrationManager::onExportCSV()
@@ -430,7 +588,7 @@ void RegistrationManager::onExportCSV()
 
 void RegistrationManager::onRegistrationSelectionChanged()
 {
-    bool hasSelection = registrationsTable->currentRow() >= 0;
+    bool hasSelection = registrationsTable->selectionModel()->hasSelection();
     if (userRole == UserRole::Student) {
         cancelButton->setEnabled(hasSelection);
     }
@@ -438,16 +596,14 @@ void RegistrationManager::onRegistrationSelectionChanged()
 
 int RegistrationManager::getSelectedActivityId()
 {
-    int row = registrationsTable->currentRow();
-    if (row < 0) return -1;
-    
-    QTableWidgetItem *item = registrationsTable->item(row, 0);
-    if (!item) return -1;
+    QModelIndexList rows = registrationsTable->selectionModel()->selectedRows();
+    if (rows.isEmpty()) return -1;
     
-    return item->text().toInt();
+    return registrationModel->activityIdAt(rows.first().row());
 }
 
-void RegistrationManager::showConflictDialog(const QList<QHash<QString, QVariant>> &conflicts)
+void RegistrationManager::showConflictDialog(const QHash<QString, QVariant> &activity,
+                                             const QList<QHash<QString, QVariant>> &conflicts)
 {
     QString message = "检测到以下时间冲突的活动：\n\n";
     for (const auto &conflict : conflicts) {
@@ -456,67 +612,155 @@ void RegistrationManager::showConflictDialog(const QList<QHash<QString, QVariant
             .arg(conflict["start_time"].toDateTime().toString("yyyy-MM-dd hh:mm"))
             .arg(conflict["end_time"].toDateTime().toString("yyyy-MM-dd hh:mm"));
     }
+    message += "是否仍要报名？";
+    
+    QMessageBox box(QMessageBox::Warning, "时间冲突", message, QMessageBox::NoButton, this);
+    QPushButton *proceedButton = box.addButton("仍要报名", QMessageBox::AcceptRole);
+    QPushButton *suggestButton = nullptr;
+    if (conflictChecker) {
+        suggestButton = box.addButton("查看推荐方案", QMessageBox::ActionRole);
+    }
+    box.addButton("取消", QMessageBox::RejectRole);
+    box.exec();
     
-    QMessageBox::warning(this, "时间冲突", message);
+    if (box.clickedButton() == proceedButton) {
+        proceedRegistration(activity);
+    } else if (suggestButton && box.clickedButton() == suggestButton) {
+        requestScheduleSuggestion(activity, conflicts);
+    }
 }
 
-void RegistrationManager::onRefreshRegistrations()
+void RegistrationManager::setConflictChecker(ConflictChecker *checker)
 {
-    refreshRegistrations();
+    if (conflictChecker) {
+        disconnect(conflictChecker, nullptr, this, nullptr);
+    }
+    conflictChecker = checker;
+    if (conflictChecker) {
+        connect(conflictChecker, &ConflictChecker::scheduleSuggested, this, &RegistrationManager::onScheduleSuggested);
+    }
 }
 
-void RegistrationManager::populateAvailableActivities()
+void RegistrationManager::requestScheduleSuggestion(const QHash<QString, QVariant> &activity,
+                                                    const QList<QHash<QString, QVariant>> &conflicts)
 {
-    if (userRole != UserRole::Student) return;
-    
-    // 获取所有已批准的活动
-    QString filter = "status = " + QString::number(static_cast<int>(ActivityStatus::Approved));
-    QList<QHash<QString, QVariant>> activities = database->getActivities(filter);
+    // 新活动排在最前，权重最高；冲突的已报名活动按原顺序依次降低
+    QList<int> wishList;
+    wishList.append(activity["id"].toInt());
+    pendingSuggestionTitles.clear();
+    pendingSuggestionTitles.insert(activity["id"].toInt(), activity["title"].toString());
+    for (const auto &conflict : conflicts) {
+        wishList.append(conflict["id"].toInt());
+        pendingSuggestionTitles.insert(conflict["id"].toInt(), conflict["title"].toString());
+    }
     
-    // 过滤掉已报名的活动
-    QList<QHash<QString, QVariant>> availableActivities;
-    for (const auto &activity : activities) {
-        int activityId = activity["id"].toInt();
-        if (!database->isRegistered(activityId, currentStudentId)) {
-            availableActivities.append(activity);
+    pendingSuggestionActivity = activity;
+    pendingSuggestionId = conflictChecker->suggestSchedule(currentStudentId, wishList);
+    statusLabel->setText("正在计算推荐方案...");
+}
+
+void RegistrationManager::onScheduleSuggested(int requestId, const ScheduleSuggestion &suggestion)
+{
+    if (requestId != pendingSuggestionId) {
+        return;  // 其他窗口的请求，或已被新的请求取代
+    }
+    pendingSuggestionId = -1;
+    statusLabel->clear();
+    
+    QHash<QString, QVariant> activity = pendingSuggestionActivity;
+    int activityId = activity["id"].toInt();
+    auto titleOf = [this](int id) {
+        return QString("%1 (ID: %2)").arg(pendingSuggestionTitles.value(id)).arg(id);
+    };
+    
+    QString message = "推荐保留以下互不冲突的活动：\n";
+    for (int id : suggestion.selected) {
+        message += "• " + titleOf(id) + "\n";
+    }
+    if (!suggestion.dropped.isEmpty()) {
+        message += "\n放弃：\n";
+        for (int id : suggestion.dropped) {
+            message += "• " + titleOf(id) + "\n";
+        }
+    }
+    if (!suggestion.unavailable.isEmpty()) {
+        message += "\n已满或不可报名：\n";
+        for (int id : suggestion.unavailable) {
+            message += "• " + titleOf(id) + "\n";
         }
     }
     
-    availableActivitiesTable->setRowCount(availableActivities.size());
+    if (!suggestion.selected.contains(activityId)) {
+        message += "\n建议保留现有报名，不报名此活动。";
+        QMessageBox::information(this, "推荐方案", message);
+        return;
+    }
+    // 抽签活动此时只能提交申请，不能用已确认的报名去换一次抽签机会
+    bool lotteryPending = !activity["lottery_deadline"].isNull() && activity["lottery_drawn_at"].isNull();
+    if (lotteryPending && !suggestion.dropped.isEmpty()) {
+        message += "\n此活动为抽签报名，请先提交抽签申请，中签后再按需取消上面的报名。";
+        QMessageBox::information(this, "推荐方案", message);
+        return;
+    }
     
-    for (int i = 0; i < availableActivities.size(); ++i) {
-        const auto &activity = availableActivities[i];
-        
-        availableActivitiesTable->setItem(i, 0, new QTableWidgetItem(activity["id"].toString()));
-        availableActivitiesTable->setItem(i, 1, new QTableWidgetItem(activity["title"].toString()));
-        availableActivitiesTable->setItem(i, 2, new QTableWidgetItem(activity["category"].toString()));
-        availableActivitiesTable->setItem(i, 3, new QTableWidgetItem(activity["organizer"].toString()));
-        availableActivitiesTable->setItem(i, 4, new QTableWidgetItem(activity["start_time"].toDateTime().toString("yyyy-MM-dd hh:mm")));
-        availableActivitiesTable->setItem(i, 5, new QTableWidgetItem(activity["end_time"].toDateTime().toString("yyyy-MM-dd hh:mm")));
-        
-        int max = activity["max_participants"].toInt();
-        int current = activity["current_participants"].toInt();
-        int remaining = max - current;
-        availableActivitiesTable->setItem(i, 6, new QTableWidgetItem(QString::number(remaining)));
+    message += "\n按推荐方案调整将取消上面放弃的报名，并报名此活动。是否继续？";
+    QMessageBox box(QMessageBox::Question, "推荐方案", message, QMessageBox::NoButton, this);
+    QPushButton *applyButton = box.addButton("按推荐方案调整", QMessageBox::AcceptRole);
+    box.addButton("取消", QMessageBox::RejectRole);
+    box.exec();
+    if (box.clickedButton() != applyButton) {
+        return;
     }
     
-    statusLabel->setText(QString("可报名活动：共 %1 项").arg(availableActivities.size()));
+    if (suggestion.dropped.isEmpty()) {
+        proceedRegistration(activity);
+        return;
+    }
+    
+    // 取消和报名在同一个写操作中完成：报名不成功时取消也一并回滚，不会两边都落空
+    statusLabel->setText("正在按推荐方案调整...");
+    AsyncDatabase::onFinished(asyncDatabase->switchRegistrations(activityId, currentStudentId, currentStudentName,
+                                                                 suggestion.dropped),
+                              this, [this](bool success) {
+        if (success) {
+            statusLabel->setText("已按推荐方案调整");
+            QMessageBox::information(this, "成功", "已取消放弃的报名，并报名此活动！");
+        } else {
+            statusLabel->setText("调整失败");
+            QMessageBox::warning(this, "失败", "调整失败：活动可能已满或已停止报名，原有报名未改动。");
+        }
+    });
+}
+
+void RegistrationManager::onRefreshRegistrations()
+{
+    refreshRegistrations();
+}
+
+void RegistrationManager::populateAvailableActivities()
+{
+    if (userRole != UserRole::Student) return;
+    
+    // 已批准且未报名的活动（已报名的在SQL中用 NOT EXISTS 排除）
+    ActivityQuery query;
+    query.status = static_cast<int>(ActivityStatus::Approved);
+    query.excludeRegisteredBy = currentStudentId;
+    statusLabel->setText("正在加载可报名活动...");
+    availableModel->setQuery(query);
 }
 
 void RegistrationManager::onViewActivityDetails()
 {
     if (userRole != UserRole::Student) return;
     
-    int row = availableActivitiesTable->currentRow();
-    if (row < 0) {
+    QModelIndexList rows = availableActivitiesTable->selectionModel()->selectedRows();
+    if (rows.isEmpty()) {
         QMessageBox::warning(this, "提示", "请选择要查看的活动！");
         return;
     }
     
-    QTableWidgetItem *item = availableActivitiesTable->item(row, 0);
-    if (!item) return;
-    
-    int activityId = item->text().toInt();
+    int activityId = availableModel->activityIdAt(rows.first().row());
+    if (activityId <= 0) return;
     selectedActivityIdForRegistration = activityId;
     
     showActivityDetailsDialog(activityId);
@@ -605,7 +849,7 @@ void RegistrationManager::onRegisterFromDetails()
     
     ActivityStatus status = static_cast<ActivityStatus>(activity["status"].toInt());
     if (status != ActivityStatus::Approved) {
-        QMessageBox::warning(this, "错误", "该活动尚未批准，无法报名！");
+        QMessageBox::warning(this, "错误", registrationClosedText(status));
         return;
     }
     
@@ -622,25 +866,11 @@ void RegistrationManager::onRegisterFromDetails()
     QList<QHash<QString, QVariant>> conflicts = database->checkTimeConflict(currentStudentId, startTime, endTime);
     
     if (!conflicts.isEmpty()) {
-        showConflictDialog(conflicts);
-        if (QMessageBox::question(this, "时间冲突", "检测到时间冲突，是否仍要报名？") != QMessageBox::Yes) {
-            return;
-        }
+        showConflictDialog(activity, conflicts);
+        return;
     }
     
-    // 执行报名
-    if (database->registerActivity(activityId, currentStudentId, currentStudentName)) {
-        QMessageBox::information(this, "成功", "报名成功！");
-        refreshRegistrations();
-    } else {
-        // 可能已满，添加到候补
-        if (database->addToWaitlist(activityId, currentStudentId, currentStudentName)) {
-            QMessageBox::information(this, "提示", "活动已满，已加入候补列表！");
-            refreshRegistrations();
-        } else {
-            QMessageBox::warning(this, "失败", "报名失败！");
-        }
-    }
+    proceedRegistration(activity);
 }
 
 void RegistrationManager::onCheckIn()
@@ -649,17 +879,11 @@ void RegistrationManager::onCheckIn()
     
     // 学生签到：从"我的报名"表格中获取活动ID
     if (userRole == UserRole::Student) {
-        int row = registrationsTable->currentRow();
-        if (row < 0) {
-            QMessageBox::warning(this, "提示", "请选择要签到的活动！");
-            return;
-        }
-        QTableWidgetItem *item = registrationsTable->item(row, 0);
-        if (!item) {
+        activityId = getSelectedActivityId();
+        if (activityId <= 0) {
             QMessageBox::warning(this, "提示", "请选择要签到的活动！");
             return;
         }
-        activityId = item->text().toInt();
     } else {
         // 管理员/发起人：从下拉框选择活动
         activityId = activityComboBox->currentData().toInt();
@@ -686,15 +910,13 @@ void RegistrationManager::onCheckIn()
             return;
         }
         
-        if (database->checkIn(activityId, currentStudentId, checkinCode)) {
+        CheckInResult result = database->tryCheckIn(activityId, currentStudentId, checkinCode);
+        if (result == CheckInResult::Success) {
             QMessageBox::information(this, "成功", "签到成功！");
-            refreshRegistrations();
+        } else if (result == CheckInResult::AlreadyCheckedIn) {
+            QMessageBox::information(this, "提示", "您已经签到过了！");
         } else {
-            if (database->isCheckedIn(activityId, currentStudentId)) {
-                QMessageBox::information(this, "提示", "您已经签到过了！");
-            } else {
-                QMessageBox::warning(this, "失败", "签到失败！请确认：\n1. 您已报名该活动\n2. 活动已开始\n3. 签到码正确");
-            }
+            QMessageBox::warning(this, "失败", "签到失败：" + checkInFailureText(result));
         }
     } else {
         // 管理员/发起人：为学生签到（不需要签到码）
@@ -706,19 +928,94 @@ void RegistrationManager::onCheckIn()
         }
         
         // 管理员/发起人签到不需要验证签到码，传入空字符串
-        if (database->checkIn(activityId, studentId, "")) {
+        CheckInResult result = database->tryCheckIn(activityId, studentId, "");
+        if (result == CheckInResult::Success) {
             QMessageBox::information(this, "成功", QString("学号 %1 签到成功！").arg(studentId));
-            refreshRegistrations();
+        } else if (result == CheckInResult::AlreadyCheckedIn) {
+            QMessageBox::information(this, "提示", QString("学号 %1 已经签到过了！").arg(studentId));
         } else {
-            if (database->isCheckedIn(activityId, studentId)) {
-                QMessageBox::information(this, "提示", QString("学号 %1 已经签到过了！").arg(studentId));
-            } else {
-                QMessageBox::warning(this, "失败", QString("学号 %1 签到失败！请确认该学生已报名且活动已开始。").arg(studentId));
-            }
+            QMessageBox::warning(this, "失败", QString("学号 %1 签到失败：%2").arg(studentId, checkInFailureText(result)));
         }
     }
 }
 
+void RegistrationManager::onStartKiosk()
+{
+    int activityId = activityComboBox->currentData().toInt();
+    if (activityId <= 0) {
+        QMessageBox::warning(this, "提示", "请选择活动！");
+        return;
+    }
+    
+    // 非模态：签到机可以一直开着，关闭时剩余的签到照常写入
+    CheckInKiosk *kiosk = new CheckInKiosk(database, asyncDatabase, activityId, this);
+    kiosk->setAttribute(Qt::WA_DeleteOnClose);
+    kiosk->show();
+}
+
+void RegistrationManager::onImportCheckIns()
+{
+    int activityId = activityComboBox->currentData().toInt();
+    if (activityId <= 0) {
+        QMessageBox::warning(this, "提示", "请选择活动！");
+        return;
+    }
+    QString filename = QFileDialog::getOpenFileName(this, "导入扫码枪签到记录", QString(),
+                                                    "签到记录 (*.csv *.txt);;所有文件 (*)");
+    if (filename.isEmpty()) {
+        return;
+    }
+    
+    // 先在工作线程中流式读取并去重，再把每人一条的结果交给写线程按批写入
+    importCheckInButton->setEnabled(false);
+    statusLabel->setText("正在读取签到记录...");
+    QSharedPointer<QElapsedTimer> timer(new QElapsedTimer);
+    timer->start();
+    TaskScheduler::globalInstance()->submit(TaskPriority::Normal, this, [filename](TaskContext &) -> ScanDump {
+        ScanDump dump;
+        ScanDumpReader::read(filename, dump);
+        return dump;
+    }, [this, activityId, timer](const ScanDump &dump) {
+        if (!dump.error.isEmpty()) {
+            importCheckInButton->setEnabled(true);
+            statusLabel->setText("导入签到记录失败");
+            QMessageBox::warning(this, "失败", "无法读取文件：" + dump.error);
+            return;
+        }
+        statusLabel->setText(QString("正在写入 %1 人的签到...").arg(dump.earliest.size()));
+        AsyncDatabase::onFinished(asyncDatabase->importCheckIns(activityId, dump.earliest), this,
+                                  [this, dump, timer](const CheckInImportResult &result) {
+            importCheckInButton->setEnabled(true);
+            qDebug() << "[签到导入] 行数" << dump.lines << "学生" << dump.earliest.size()
+                     << "写入" << result.applied << "耗时" << timer->elapsed() << "ms";
+            
+            QString message = QString("读取 %1 行：有效扫描 %2 条（重复 %3 条，无法识别 %4 行），共 %5 人。\n"
+                                      "新签到或提前签到时间 %6 人，已有更早签到 %7 人；未报名 %8 人，学号不存在 %9 人。")
+                .arg(dump.lines).arg(dump.scans).arg(dump.duplicates).arg(dump.malformed)
+                .arg(dump.earliest.size()).arg(result.applied).arg(result.unchanged)
+                .arg(result.unregistered.size()).arg(result.unknown.size());
+            if (!result.success) {
+                message += "\n\n写入中途失败，已提交的部分保留，可重新导入同一文件。";
+            }
+            statusLabel->setText(QString("已导入签到 %1 人").arg(result.applied));
+            
+            QMessageBox box(result.success ? QMessageBox::Information : QMessageBox::Warning,
+                            "导入签到记录", message, QMessageBox::Ok, this);
+            if (!result.unregistered.isEmpty() || !result.unknown.isEmpty()) {
+                QString details;
+                if (!result.unregistered.isEmpty()) {
+                    details += "未报名：\n" + result.unregistered.join("\n") + "\n\n";
+                }
+                if (!result.unknown.isEmpty()) {
+                    details += "学号不存在：\n" + result.unknown.join("\n") + "\n";
+                }
+                box.setDetailedText(details);
+            }
+            box.exec();
+        });
+    });
+}
+
 void RegistrationManager::onViewCheckInList()
 {
     int activityId = activityComboBox->currentData().toInt();
@@ -763,6 +1060,11 @@ void RegistrationManager::onViewCheckInList()
     dialog.exec();
 }
 
+void RegistrationManager::setSnapshotDatabase(SnapshotDatabase *snapshot)
+{
+    snapshotDatabase = snapshot;
+}
+
 void RegistrationManager::onViewCheckInStatistics()
 {
     int activityId = activityComboBox->currentData().toInt();
@@ -771,9 +1073,27 @@ void RegistrationManager::onViewCheckInStatistics()
         return;
     }
     
-    QHash<QString, QVariant> stats = database->getCheckInStatistics(activityId);
-    QHash<QString, QVariant> activity = database->getActivity(activityId);
+    if (!snapshotDatabase) {
+        showCheckInStatistics(database->getCheckInStatistics(activityId), database->getActivity(activityId), QString());
+        return;
+    }
     
+    // 统计在只读快照上查询，并注明数据时间
+    snapshotDatabase->query(this, [activityId](Database *db) {
+        return qMakePair(db->getCheckInStatistics(activityId), db->getActivity(activityId));
+    }, [this](const QPair<QHash<QString, QVariant>, QHash<QString, QVariant>> &result) {
+        QString freshness = QString("数据截至 %1").arg(snapshotDatabase->snapshotTime().toString("hh:mm:ss"));
+        if (snapshotDatabase->hasNewerChanges()) {
+            freshness += "（之后的变更将在下次刷新后显示）";
+        }
+        showCheckInStatistics(result.first, result.second, freshness);
+    });
+}
+
+void RegistrationManager::showCheckInStatistics(const QHash<QString, QVariant> &stats,
+                                                const QHash<QString, QVariant> &activity,
+                                                const QString &freshness)
+{
     if (stats.isEmpty()) {
         QMessageBox::warning(this, "错误", "无法获取签到统计信息！");
         return;
@@ -799,6 +1119,9 @@ void RegistrationManager::onViewCheckInStatistics()
      .arg(totalCheckedIn)
      .arg(notCheckedIn)
      .arg(QString::number(checkinRate, 'f', 2));
+    if (!freshness.isEmpty()) {
+        message += "\n" + freshness;
+    }
     
     QMessageBox::information(this, "签到统计", message);
 }
\ No newline at end of file
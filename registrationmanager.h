@@ -4,8 +4,16 @@
 #include <QWidget>
 #include "database.h"
 
+class ActivityTableModel;
+class RegistrationTableModel;
+class DbExecutor;
+class AsyncDatabase;
+class SnapshotDatabase;
+class ConflictChecker;
+struct ScheduleSuggestion;
+
 QT_BEGIN_NAMESPACE
-class QTableWidget;
+class QTableView;
 class QPushButton;
 class QLabel;
 class QComboBox;
@@ -17,8 +25,12 @@ class RegistrationManager : public QWidget
     Q_OBJECT
 
 public:
-    explicit RegistrationManager(Database *db, UserRole role, const QString &studentId, const QString &studentName = "", QWidget *parent = nullptr);
+    explicit RegistrationManager(Database *db, DbExecutor *executor, AsyncDatabase *asyncDb, UserRole role, const QString &studentId, const QString &studentName = "", QWidget *parent = nullptr);
     void refreshRegistrations();
+    // 设置后签到统计从只读快照读取
+    void setSnapshotDatabase(SnapshotDatabase *snapshot);
+    // 设置后时间冲突时可查看推荐的日程方案
+    void setConflictChecker(ConflictChecker *checker);
 
 private slots:
     void onRegisterActivity();
@@ -30,24 +42,41 @@ private slots:
     void onViewActivityDetails();  // 新增：查看活动详情
     void onRegisterFromDetails();  // 新增：从详情对话框报名
     void onCheckIn();  // 新增：签到
+    void onStartKiosk();  // 签到机模式（发起人/管理员）
+    void onImportCheckIns();  // 导入扫码枪离线签到记录
     void onViewCheckInList();  // 新增：查看签到列表
     void onViewCheckInStatistics();  // 新增：查看签到统计
+    void onSubmitPreferences();  // 志愿匹配：按顺序填写志愿
 private:
     Database *database;
+    DbExecutor *executor;  // 表格数据在后台线程加载
+    AsyncDatabase *asyncDatabase;  // 报名、取消等写操作在后台执行
+    SnapshotDatabase *snapshotDatabase;  // 统计查询使用的只读快照，可为空
+    ConflictChecker *conflictChecker;    // 日程推荐在后台计算，可为空
+    int pendingSuggestionId;                          // 等待结果的推荐请求
+    QHash<QString, QVariant> pendingSuggestionActivity;  // 推荐请求对应的待报名活动
+    QHash<int, QString> pendingSuggestionTitles;      // 参与推荐的活动标题
     UserRole userRole;
     QString currentStudentId;
     QString currentStudentName;
     QTabWidget *tabWidget;  // 新增：标签页（学生角色使用）
-    QTableWidget *registrationsTable;
-    QTableWidget *availableActivitiesTable;  // 新增：可报名活动表格
+    QTableView *registrationsTable;
+    QTableView *availableActivitiesTable;  // 新增：可报名活动表格
+    RegistrationTableModel *registrationModel;  // 按页加载的报名列表模型
+    ActivityTableModel *availableModel;         // 按页加载的可报名活动模型
+    int displayedActivityId;                    // 发起人/管理员当前查看报名的活动
+    bool pendingRegistrationNotice;             // 下一次加载完成时提示报名人数
     QPushButton *registerButton;
     QPushButton *cancelButton;
     QPushButton *waitlistButton;
     QPushButton *exportButton;
     QPushButton *selectActivityButton;
     QPushButton *viewDetailsButton;  // 新增：查看详情按钮
+    QPushButton *preferencesButton;  // 志愿报名（学生）
     QPushButton *checkInButton;  // 新增：签到按钮
     QPushButton *viewCheckInListButton;  // 新增：查看签到列表按钮
+    QPushButton *kioskButton;  // 签到机模式
+    QPushButton *importCheckInButton;  // 导入离线签到
     QPushButton *viewCheckInStatsButton;  // 新增：查看签到统计按钮
     QComboBox *activityComboBox;
     QLabel *statusLabel;
@@ -57,8 +86,15 @@ private:
     void populateTable();
     void populateAvailableActivities();  // 新增：填充可报名活动列表
     int getSelectedActivityId();
+    void showCheckInStatistics(const QHash<QString, QVariant> &stats, const QHash<QString, QVariant> &activity,
+                               const QString &freshness);
     void showActivityDetailsDialog(int activityId);  // 新增：显示活动详情对话框
-    void showConflictDialog(const QList<QHash<QString, QVariant>> &conflicts);
+    void showConflictDialog(const QHash<QString, QVariant> &activity, const QList<QHash<QString, QVariant>> &conflicts);
+    void requestScheduleSuggestion(const QHash<QString, QVariant> &activity, const QList<QHash<QString, QVariant>> &conflicts);
+    void onScheduleSuggested(int requestId, const ScheduleSuggestion &suggestion);
+    void proceedRegistration(const QHash<QString, QVariant> &activity);  // 按活动的报名方式提交报名或抽签申请
+    void submitRegistration(int activityId);
+    void submitApplication(int activityId, const QDateTime &deadline);  // 抽签报名的活动截止前提交申请
 };
 
 #endif // REGISTRATIONMANAGER_H
@@ -0,0 +1,484 @@
+#include "registrationtablemodel.h"
+#include "dbexecutor.h"
+#include <QBrush>
+#include <QTimer>
+
+namespace {
+// 每次 fetchMore 从数据库读取的行数
+const int kPageSize = 200;
+
+// 后台查询结果
+struct RegistrationPageResult {
+    bool cancelled = false;
+    int total = 0;
+    QList<RegistrationRecord> rows;
+};
+
+QPair<int, QString> keyOf(const RegistrationRecord &record)
+{
+    return qMakePair(record.activityId, record.studentId);
+}
+}
+
+RegistrationTableModel::RegistrationTableModel(DbExecutor *executor, const QList<Column> &columns, QObject *parent)
+    : QAbstractTableModel(parent)
+    , executor(executor)
+    , columns(columns)
+    , hasQuery(false)
+    , total(0)
+    , loading(false)
+    , fetching(false)
+    , generation(new QAtomicInt(0))
+    , refreshScheduled(false)
+{
+}
+
+void RegistrationTableModel::setQuery(const RegistrationQuery &newQuery)
+{
+    // 排序由表头通过 sort() 决定，切换查询条件时保留
+    QString orderBy = query.orderBy;
+    bool descending = query.descending;
+    
+    query = newQuery;
+    query.orderBy = orderBy;
+    query.descending = descending;
+    // 两个条件都为空时会查出全部报名，视为无查询
+    hasQuery = query.activityId > 0 || !query.studentId.isEmpty();
+    reload();
+}
+
+void RegistrationTableModel::clear()
+{
+    hasQuery = false;
+    reload();
+}
+
+void RegistrationTableModel::reload()
+{
+    // 新的刷新开始，之前所有未完成的请求作废
+    const int token = generation->fetchAndAddOrdered(1) + 1;
+    
+    beginResetModel();
+    records.clear();
+    loadedKeys.clear();
+    dirtyKeys.clear();  // 整表重新加载会包含这些变更
+    total = 0;
+    loading = hasQuery && executor;
+    fetching = false;
+    endResetModel();
+    
+    if (!loading) {
+        emit loadFinished(0);
+        return;
+    }
+    
+    const RegistrationQuery pendingQuery = query;
+    const QSharedPointer<QAtomicInt> latest = generation;
+    executor->post(this, [pendingQuery, token, latest](Database *db) -> RegistrationPageResult {
+        RegistrationPageResult result;
+        // 排队期间已有更新的刷新，跳过查询
+        if (latest->loadAcquire() != token) {
+            result.cancelled = true;
+            return result;
+        }
+        result.total = db->countRegistrations(pendingQuery);
+        if (latest->loadAcquire() != token) {
+            result.cancelled = true;
+            return result;
+        }
+        result.rows = db->getRegistrationPage(pendingQuery, 0, kPageSize);
+        return result;
+    }, [this, token](const RegistrationPageResult &result) {
+        if (result.cancelled || generation->loadAcquire() != token) {
+            return;  // 过期结果
+        }
+        
+        beginResetModel();
+        loading = false;
+        total = result.total;
+        records.reserve(result.rows.size());
+        for (const RegistrationRecord &record : result.rows) {
+            records.append(record);
+            loadedKeys.insert(keyOf(record));
+        }
+        endResetModel();
+        emit loadFinished(total);
+        
+        // 加载期间发生的变更可能没有包含在结果中，补一次单行刷新
+        if (!dirtyKeys.isEmpty()) {
+            scheduleDirtyRefresh();
+        }
+    });
+}
+
+bool RegistrationTableModel::isLoading() const
+{
+    return loading;
+}
+
+int RegistrationTableModel::totalCount() const
+{
+    return total;
+}
+
+int RegistrationTableModel::activityIdAt(int row) const
+{
+    if (loading || row < 0 || row >= records.size()) return -1;
+    return records.at(row).activityId;
+}
+
+QString RegistrationTableModel::statusText(RegistrationStatus status)
+{
+    switch (status) {
+        case RegistrationStatus::Registered: return "已报名";
+        case RegistrationStatus::Cancelled: return "已取消";
+        case RegistrationStatus::Waitlisted: return "候补";
+        case RegistrationStatus::Confirmed: return "已确认";
+    }
+    return "未知";
+}
+
+int RegistrationTableModel::rowCount(const QModelIndex &parent) const
+{
+    if (parent.isValid()) return 0;
+    return loading ? 1 : records.size();  // 加载中只有一行占位
+}
+
+int RegistrationTableModel::columnCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : columns.size();
+}
+
+QVariant RegistrationTableModel::data(const QModelIndex &index, int role) const
+{
+    if (!index.isValid() || index.column() >= columns.size()) {
+        return QVariant();
+    }
+    
+    if (loading) {
+        if (index.column() == 0 && role == Qt::DisplayRole) return "正在加载...";
+        if (role == Qt::ForegroundRole) return QBrush(Qt::gray);
+        return QVariant();
+    }
+    
+    if (index.row() >= records.size()) {
+        return QVariant();
+    }
+    
+    const RegistrationRecord &record = records.at(index.row());
+    if (role == Qt::UserRole) {
+        return record.activityId;
+    }
+    if (role != Qt::DisplayRole) {
+        return QVariant();
+    }
+    
+    switch (columns.at(index.column())) {
+        case ActivityIdColumn: return record.activityId;
+        case TitleColumn: return record.title;
+        case StartTimeColumn: return record.startTime.toString("yyyy-MM-dd hh:mm");
+        case EndTimeColumn: return record.endTime.toString("yyyy-MM-dd hh:mm");
+        case LocationColumn: return record.location;
+        case StatusColumn: return statusText(record.status);
+        case StudentIdColumn: return record.studentId.isEmpty() ? QString("未知") : record.studentId;
+        case StudentNameColumn: return record.studentName.isEmpty() ? QString("未知") : record.studentName;
+        case RegisteredAtColumn: return record.registeredAt.toString("yyyy-MM-dd hh:mm");
+    }
+    return QVariant();
+}
+
+QVariant RegistrationTableModel::headerData(int section, Qt::Orientation orientation, int role) const
+{
+    if (orientation != Qt::Horizontal || role != Qt::DisplayRole || section < 0 || section >= columns.size()) {
+        return QAbstractTableModel::headerData(section, orientation, role);
+    }
+    
+    switch (columns.at(section)) {
+        case ActivityIdColumn: return "活动ID";
+        case TitleColumn: return "活动标题";
+        case StartTimeColumn: return "开始时间";
+        case EndTimeColumn: return "结束时间";
+        case LocationColumn: return "地点";
+        case StatusColumn: return "状态";
+        case StudentIdColumn: return "学号";
+        case StudentNameColumn: return "姓名";
+        case RegisteredAtColumn: return "报名时间";
+    }
+    return QVariant();
+}
+
+Qt::ItemFlags RegistrationTableModel::flags(const QModelIndex &index) const
+{
+    // 占位行不可选中
+    if (loading) return Qt::NoItemFlags;
+    return QAbstractTableModel::flags(index);
+}
+
+bool RegistrationTableModel::canFetchMore(const QModelIndex &parent) const
+{
+    return !parent.isValid() && !loading && !fetching && records.size() < total;
+}
+
+void RegistrationTableModel::fetchMore(const QModelIndex &parent)
+{
+    if (parent.isValid() || !executor || loading || fetching) return;
+    
+    fetching = true;
+    const int token = generation->loadAcquire();
+    const int offset = records.size();
+    const RegistrationQuery pendingQuery = query;
+    const QSharedPointer<QAtomicInt> latest = generation;
+    executor->post(this, [pendingQuery, token, latest, offset](Database *db) -> RegistrationPageResult {
+        RegistrationPageResult result;
+        if (latest->loadAcquire() != token) {
+            result.cancelled = true;
+            return result;
+        }
+        result.rows = db->getRegistrationPage(pendingQuery, offset, kPageSize);
+        return result;
+    }, [this, token](const RegistrationPageResult &result) {
+        if (result.cancelled || generation->loadAcquire() != token) {
+            return;  // 已被新的刷新取代，fetching 已在 reload() 中复位
+        }
+        
+        fetching = false;
+        if (result.rows.isEmpty()) {
+            // 加载期间有行被删除，按实际行数结束分页
+            total = records.size();
+            return;
+        }
+        
+        // 分页期间有单行插入/移除时，页边界可能与已加载的行重叠
+        QList<RegistrationRecord> newRows;
+        for (const RegistrationRecord &record : result.rows) {
+            if (!loadedKeys.contains(keyOf(record))) {
+                newRows.append(record);
+            }
+        }
+        if (newRows.isEmpty()) {
+            return;
+        }
+        
+        beginInsertRows(QModelIndex(), records.size(), records.size() + newRows.size() - 1);
+        for (const RegistrationRecord &record : newRows) {
+            records.append(record);
+            loadedKeys.insert(keyOf(record));
+        }
+        endInsertRows();
+    });
+}
+
+void RegistrationTableModel::sort(int column, Qt::SortOrder order)
+{
+    if (column < 0 || column >= columns.size()) {
+        query.orderBy.clear();  // 使用默认排序
+        query.descending = false;
+    } else {
+        switch (columns.at(column)) {
+            case ActivityIdColumn: query.orderBy = "activity_id"; break;
+            case TitleColumn: query.orderBy = "title"; break;
+            case StartTimeColumn: query.orderBy = "start_time"; break;
+            case EndTimeColumn: query.orderBy = "end_time"; break;
+            case LocationColumn: query.orderBy = "location"; break;
+            case StatusColumn: query.orderBy = "status"; break;
+            case StudentIdColumn: query.orderBy = "student_id"; break;
+            case StudentNameColumn: query.orderBy = "student_name"; break;
+            case RegisteredAtColumn: query.orderBy = "registered_at"; break;
+        }
+        query.descending = (order == Qt::DescendingOrder);
+    }
+    
+    if (hasQuery) {
+        reload();
+    }
+}
+
+void RegistrationTableModel::markRegistrationDirty(int activityId, const QString &studentId)
+{
+    if (!hasQuery) return;
+    if (query.activityId > 0 && query.activityId != activityId) return;
+    if (!query.studentId.isEmpty() && query.studentId != studentId) return;
+    
+    dirtyKeys.insert(qMakePair(activityId, studentId));
+    // 加载中时等第一页返回后再刷新
+    if (!loading) {
+        scheduleDirtyRefresh();
+    }
+}
+
+void RegistrationTableModel::markActivityDirty(int activityId)
+{
+    // 活动标题、时间、地点只在按学生查询时显示
+    if (!hasQuery || query.studentId.isEmpty()) return;
+    
+    QPair<int, QString> key = qMakePair(activityId, query.studentId);
+    if (loading || loadedKeys.contains(key)) {
+        markRegistrationDirty(activityId, query.studentId);
+    }
+}
+
+void RegistrationTableModel::scheduleDirtyRefresh()
+{
+    if (refreshScheduled) return;
+    refreshScheduled = true;
+    QTimer::singleShot(0, this, &RegistrationTableModel::refreshDirtyRows);
+}
+
+void RegistrationTableModel::refreshDirtyRows()
+{
+    refreshScheduled = false;
+    if (loading || dirtyKeys.isEmpty() || !executor) return;
+    
+    const QList<QPair<int, QString>> keys = dirtyKeys.values();
+    dirtyKeys.clear();
+    
+    const RegistrationQuery baseQuery = query;
+    const int token = generation->loadAcquire();
+    const QSharedPointer<QAtomicInt> latest = generation;
+    executor->post(this, [baseQuery, keys, token, latest](Database *db) -> RegistrationPageResult {
+        RegistrationPageResult result;
+        for (const QPair<int, QString> &key : keys) {
+            if (latest->loadAcquire() != token) {
+                result.cancelled = true;
+                return result;
+            }
+            // 报名表对（活动ID, 学号）唯一，每个键最多一行
+            RegistrationQuery rowQuery = baseQuery;
+            rowQuery.activityId = key.first;
+            rowQuery.studentId = key.second;
+            result.rows += db->getRegistrationPage(rowQuery, 0, 1);
+        }
+        return result;
+    }, [this, token, keys](const RegistrationPageResult &result) {
+        if (result.cancelled || generation->loadAcquire() != token) {
+            return;  // 期间整表已重新加载
+        }
+        applyRowUpdates(keys, result.rows);
+    });
+}
+
+void RegistrationTableModel::applyRowUpdates(const QList<QPair<int, QString>> &keys, const QList<RegistrationRecord> &rows)
+{
+    QHash<QPair<int, QString>, RegistrationRecord> matched;
+    for (const RegistrationRecord &record : rows) {
+        matched.insert(keyOf(record), record);
+    }
+    
+    for (const QPair<int, QString> &key : keys) {
+        int row = rowOfRegistration(key);
+        
+        if (!matched.contains(key)) {
+            // 报名已取消（记录被删除）
+            if (row >= 0) {
+                beginRemoveRows(QModelIndex(), row, row);
+                records.removeAt(row);
+                loadedKeys.remove(key);
+                endRemoveRows();
+                total--;
+            }
+            continue;
+        }
+        
+        const RegistrationRecord record = matched.value(key);
+        bool moreUnloaded = records.size() < total;
+        
+        if (row < 0) {
+            // 新报名：落在已加载区间内就插入，否则留给 fetchMore
+            total++;
+            int position = insertPosition(record);
+            if (position < records.size() || !moreUnloaded) {
+                beginInsertRows(QModelIndex(), position, position);
+                records.insert(position, record);
+                loadedKeys.insert(key);
+                endInsertRows();
+            }
+            continue;
+        }
+        
+        bool inPlace = (row == 0 || !lessThan(record, records.at(row - 1)))
+                    && (row == records.size() - 1 || !lessThan(records.at(row + 1), record));
+        if (inPlace) {
+            records[row] = record;
+            emit dataChanged(index(row, 0), index(row, columns.size() - 1));
+            continue;
+        }
+        
+        // 排序字段变化，移动到新位置（使用 move 以保留选中状态）
+        int position = insertPosition(record, row);
+        if (position == records.size() - 1 && moreUnloaded) {
+            // 排到了已加载行的末尾之后，交给 fetchMore 重新加载
+            beginRemoveRows(QModelIndex(), row, row);
+            records.removeAt(row);
+            loadedKeys.remove(key);
+            endRemoveRows();
+            continue;
+        }
+        
+        int destination = position >= row ? position + 1 : position;
+        if (beginMoveRows(QModelIndex(), row, row, QModelIndex(), destination)) {
+            records.removeAt(row);
+            records.insert(position, record);
+            endMoveRows();
+        }
+    }
+}
+
+int RegistrationTableModel::rowOfRegistration(const QPair<int, QString> &key) const
+{
+    if (!loadedKeys.contains(key)) return -1;
+    for (int row = 0; row < records.size(); ++row) {
+        if (records.at(row).activityId == key.first && records.at(row).studentId == key.second) return row;
+    }
+    return -1;
+}
+
+int RegistrationTableModel::insertPosition(const RegistrationRecord &record, int skipRow) const
+{
+    // 已加载的行与SQL排序一致，二分查找插入位置；skipRow 指定的行视为不存在
+    int low = 0;
+    int high = skipRow >= 0 ? records.size() - 1 : records.size();
+    while (low < high) {
+        int mid = (low + high) / 2;
+        int actual = (skipRow >= 0 && mid >= skipRow) ? mid + 1 : mid;
+        if (lessThan(records.at(actual), record)) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+    return low;
+}
+
+bool RegistrationTableModel::lessThan(const RegistrationRecord &a, const RegistrationRecord &b) const
+{
+    // 与 Database::getRegistrationPage 的 ORDER BY 保持一致（同值时按报名记录ID）
+    QString orderBy = query.orderBy;
+    if (orderBy.isEmpty()) {
+        orderBy = query.activityId > 0 ? "registered_at" : "start_time";
+    }
+    
+    int cmp = 0;
+    if (orderBy == "activity_id") {
+        cmp = a.activityId - b.activityId;
+    } else if (orderBy == "title") {
+        cmp = QString::compare(a.title, b.title);
+    } else if (orderBy == "start_time") {
+        cmp = a.startTime < b.startTime ? -1 : (b.startTime < a.startTime ? 1 : 0);
+    } else if (orderBy == "end_time") {
+        cmp = a.endTime < b.endTime ? -1 : (b.endTime < a.endTime ? 1 : 0);
+    } else if (orderBy == "location") {
+        cmp = QString::compare(a.location, b.location);
+    } else if (orderBy == "status") {
+        cmp = static_cast<int>(a.status) - static_cast<int>(b.status);
+    } else if (orderBy == "student_id") {
+        cmp = QString::compare(a.studentId, b.studentId);
+    } else if (orderBy == "student_name") {
+        cmp = QString::compare(a.studentName, b.studentName);
+    } else if (orderBy == "registered_at") {
+        cmp = a.registeredAt < b.registeredAt ? -1 : (b.registeredAt < a.registeredAt ? 1 : 0);
+    }
+    if (cmp == 0) {
+        cmp = a.id - b.id;
+    }
+    return query.descending ? cmp > 0 : cmp < 0;
+}
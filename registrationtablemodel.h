@@ -0,0 +1,85 @@
+#ifndef REGISTRATIONTABLEMODEL_H
+#define REGISTRATIONTABLEMODEL_H
+
+#include <QAbstractTableModel>
+#include <QVector>
+#include <QSharedPointer>
+#include <QAtomicInt>
+#include <QSet>
+#include <QPair>
+#include "database.h"
+
+class DbExecutor;
+
+// 报名列表模型：学生查看自己的报名，发起人/管理员查看某个活动的报名。
+// 与 ActivityTableModel 相同，查询在后台执行并用刷新代号丢弃过期结果，
+// 报名/签到变更只重新查询对应的（活动ID, 学号）行。
+class RegistrationTableModel : public QAbstractTableModel
+{
+    Q_OBJECT
+
+public:
+    enum Column {
+        ActivityIdColumn,
+        TitleColumn,
+        StartTimeColumn,
+        EndTimeColumn,
+        LocationColumn,
+        StatusColumn,
+        StudentIdColumn,
+        StudentNameColumn,
+        RegisteredAtColumn
+    };
+
+    explicit RegistrationTableModel(DbExecutor *executor, const QList<Column> &columns, QObject *parent = nullptr);
+
+    void setQuery(const RegistrationQuery &query);
+    void clear();
+    void reload();
+    bool isLoading() const;
+    int totalCount() const;
+    int activityIdAt(int row) const;
+
+    static QString statusText(RegistrationStatus status);
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    int columnCount(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+    QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const override;
+    Qt::ItemFlags flags(const QModelIndex &index) const override;
+    bool canFetchMore(const QModelIndex &parent) const override;
+    void fetchMore(const QModelIndex &parent) override;
+    void sort(int column, Qt::SortOrder order = Qt::AscendingOrder) override;
+
+public slots:
+    // 数据库变更通知：与当前查询无关的变更直接忽略
+    void markRegistrationDirty(int activityId, const QString &studentId);
+    void markActivityDirty(int activityId);
+
+signals:
+    // 第一页加载完成（过期的结果不会触发）
+    void loadFinished(int totalCount);
+
+private:
+    DbExecutor *executor;
+    QList<Column> columns;
+    RegistrationQuery query;
+    bool hasQuery;
+    QVector<RegistrationRecord> records;
+    int total;
+    bool loading;
+    bool fetching;
+    QSharedPointer<QAtomicInt> generation;
+    QSet<QPair<int, QString>> loadedKeys;   // 已加载行的（活动ID, 学号）
+    QSet<QPair<int, QString>> dirtyKeys;    // 等待单行刷新的行
+    bool refreshScheduled;
+
+    void scheduleDirtyRefresh();
+    void refreshDirtyRows();
+    void applyRowUpdates(const QList<QPair<int, QString>> &keys, const QList<RegistrationRecord> &rows);
+    int rowOfRegistration(const QPair<int, QString> &key) const;
+    int insertPosition(const RegistrationRecord &record, int skipRow = -1) const;
+    bool lessThan(const RegistrationRecord &a, const RegistrationRecord &b) const;
+};
+
+#endif // REGISTRATIONTABLEMODEL_H
@@ -0,0 +1,162 @@
+#include "reminderengine.h"
+#include "asyncdatabase.h"
+#include "networkmanager.h"
+#include <QTimer>
+#include <QDebug>
+
+namespace {
+const int kFireBatch = 500;        // 每批取出的提醒数
+const int kOutboxBatch = 200;      // 每次投递的通知数
+const int kMaxWaitMs = 60000;      // 最长一分钟重新核对一次（系统时间可能被调整）
+const int kSyncDelayMs = 300;
+const int kRetryDelayMs = 30000;
+}
+
+ReminderEngine::ReminderEngine(Database *database, AsyncDatabase *asyncDatabase, NetworkManager *networkManager,
+                               QObject *parent)
+    : QObject(parent)
+    , asyncDatabase(asyncDatabase)
+    , networkManager(networkManager)
+    , dueTimer(new QTimer(this))
+    , syncTimer(new QTimer(this))
+    , retryTimer(new QTimer(this))
+    , lead(kDefaultReminderLeadMinutes)
+    , firing(false)
+    , delivering(false)
+    , lastBatchEmpty(false)
+{
+    dueTimer->setSingleShot(true);
+    syncTimer->setSingleShot(true);
+    syncTimer->setInterval(kSyncDelayMs);
+    retryTimer->setSingleShot(true);
+    connect(dueTimer, &QTimer::timeout, this, &ReminderEngine::fireDue);
+    connect(syncTimer, &QTimer::timeout, this, &ReminderEngine::syncDirtyActivities);
+    connect(retryTimer, &QTimer::timeout, this, &ReminderEngine::flushOutbox);
+
+    // 报名、取消、审批、改期都会改变提醒
+    connect(database, &Database::registrationChanged, this, [this](int activityId, const QString &) {
+        onActivityDirty(activityId);
+    });
+    connect(database, &Database::activityChanged, this, &ReminderEngine::onActivityDirty);
+    if (networkManager) {
+        connect(networkManager, &NetworkManager::notificationsDelivered, this, &ReminderEngine::onNotificationsDelivered);
+    }
+
+    rearm();
+    flushOutbox();  // 上次退出前未投递的通知
+}
+
+void ReminderEngine::setLeadMinutes(int minutes)
+{
+    lead = qMax(0, minutes);
+}
+
+int ReminderEngine::leadMinutes() const
+{
+    return lead;
+}
+
+void ReminderEngine::onActivityDirty(int activityId)
+{
+    dirtyActivities.insert(activityId);
+    if (!syncTimer->isActive()) {
+        syncTimer->start();
+    }
+}
+
+void ReminderEngine::syncDirtyActivities()
+{
+    QFuture<bool> last;
+    for (int activityId : dirtyActivities) {
+        last = asyncDatabase->syncActivityReminders(activityId, lead);
+    }
+    dirtyActivities.clear();
+
+    // 写操作按顺序执行，最后一个完成时全部已完成，再按新的队首重新定时
+    AsyncDatabase::onFinished(last, this, [this](bool) {
+        rearm();
+    });
+}
+
+void ReminderEngine::rearm()
+{
+    if (firing) {
+        return;  // 这一批完成后会重新定时
+    }
+    AsyncDatabase::onFinished(asyncDatabase->nextReminderTime(), this, [this](const QDateTime &next) {
+        if (firing) {
+            return;
+        }
+        if (!next.isValid()) {
+            dueTimer->stop();  // 没有待发提醒，新的提醒生成后会重新定时
+            return;
+        }
+        qint64 delay = QDateTime::currentDateTime().msecsTo(next);
+        if (lastBatchEmpty) {
+            delay = qMax<qint64>(delay, 1000);  // 队首暂时无法发出时不要空转
+        }
+        dueTimer->start(static_cast<int>(qBound<qint64>(0, delay, kMaxWaitMs)));
+    });
+}
+
+void ReminderEngine::fireDue()
+{
+    if (firing) {
+        return;
+    }
+    firing = true;
+
+    AsyncDatabase::onFinished(asyncDatabase->fireDueReminders(QDateTime::currentDateTime(), kFireBatch), this,
+                              [this](const QList<ReminderRecord> &reminders) {
+        firing = false;
+        lastBatchEmpty = reminders.isEmpty();
+        if (!reminders.isEmpty()) {
+            qDebug() << "[提醒] 发出提醒:" << reminders.size();
+            emit remindersFired(reminders);
+            flushOutbox();
+        }
+        if (reminders.size() >= kFireBatch) {
+            // 还有到期的提醒：先回到事件循环，再取下一批
+            dueTimer->start(0);
+            return;
+        }
+        rearm();
+    });
+}
+
+void ReminderEngine::flushOutbox()
+{
+    if (!networkManager || delivering) {
+        return;
+    }
+    delivering = true;
+
+    AsyncDatabase::onFinished(asyncDatabase->getUndeliveredNotifications(kOutboxBatch), this,
+                              [this](const QList<ReminderRecord> &notifications) {
+        if (notifications.isEmpty()) {
+            delivering = false;
+            return;
+        }
+        networkManager->deliverNotifications(notifications);
+    });
+}
+
+void ReminderEngine::onNotificationsDelivered(const QList<int> &notificationIds, bool success)
+{
+    if (!delivering) {
+        return;
+    }
+    if (!success) {
+        // 留在发件箱中，稍后重试
+        delivering = false;
+        retryTimer->start(kRetryDelayMs);
+        return;
+    }
+
+    AsyncDatabase::onFinished(asyncDatabase->markNotificationsDelivered(notificationIds), this, [this](bool marked) {
+        delivering = false;
+        if (marked) {
+            flushOutbox();  // 继续投递下一批
+        }
+    });
+}
@@ -0,0 +1,52 @@
+#ifndef REMINDERENGINE_H
+#define REMINDERENGINE_H
+
+#include <QObject>
+#include <QSet>
+#include <QDateTime>
+#include "database.h"
+
+class AsyncDatabase;
+class NetworkManager;
+class QTimer;
+
+// 活动提醒：提醒时间预先算好存放在 reminders 表中（按 remind_at 排序的持久化队列），
+// 只用一个定时器，定在最早的提醒时间；到期后按批取出，写入通知发件箱，再投递到平台并在界面中通知。
+// 内存中只保留一批提醒，待发提醒数量不影响内存占用；批与批之间回到事件循环，不会卡住界面。
+class ReminderEngine : public QObject
+{
+    Q_OBJECT
+
+public:
+    // database 用于接收报名、活动变更通知；networkManager 可为空（只在界面中通知）
+    ReminderEngine(Database *database, AsyncDatabase *asyncDatabase, NetworkManager *networkManager,
+                   QObject *parent = nullptr);
+
+    void setLeadMinutes(int minutes);   // 之后新生成或改期的提醒使用
+    int leadMinutes() const;
+
+signals:
+    // 一批提醒已发出（已写入发件箱），界面据此显示当前用户的提醒
+    void remindersFired(const QList<ReminderRecord> &reminders);
+
+private:
+    AsyncDatabase *asyncDatabase;
+    NetworkManager *networkManager;
+    QTimer *dueTimer;          // 唯一的提醒定时器
+    QTimer *syncTimer;         // 合并短时间内的多次变更
+    QTimer *retryTimer;        // 投递失败后重试
+    QSet<int> dirtyActivities; // 等待重建提醒的活动
+    int lead;
+    bool firing;
+    bool delivering;
+    bool lastBatchEmpty;
+
+    void onActivityDirty(int activityId);
+    void syncDirtyActivities();
+    void rearm();
+    void fireDue();
+    void flushOutbox();
+    void onNotificationsDelivered(const QList<int> &notificationIds, bool success);
+};
+
+#endif // REMINDERENGINE_H
@@ -0,0 +1,73 @@
+#include "roomindex.h"
+#include <algorithm>
+
+RoomIndex::RoomIndex()
+    : bookingCount(0)
+{
+}
+
+QString RoomIndex::locationKey(const QString &location)
+{
+    QString normalized = location.normalized(QString::NormalizationForm_KC).toCaseFolded();
+    QString key;
+    key.reserve(normalized.size());
+    for (const QChar &c : normalized) {
+        if (c.isSpace() || c == QLatin1Char('-') || c == QLatin1Char('_') || c == QLatin1Char('.')
+            || c == QChar(0x00B7)) {  // 中点 "·"
+            continue;
+        }
+        key.append(c);
+    }
+    return key;
+}
+
+void RoomIndex::add(const QString &locationKey, int activityId, qint64 startMs, qint64 endMs)
+{
+    if (locationKey.isEmpty() || endMs <= startMs) {
+        return;
+    }
+    Room &room = rooms[locationKey];
+    Booking booking = {startMs, endMs, activityId};
+    // 按开始时间顺序添加时直接追加
+    auto it = std::upper_bound(room.bookings.begin(), room.bookings.end(), startMs,
+                               [](qint64 start, const Booking &b) { return start < b.start; });
+    room.bookings.insert(it, booking);
+    room.longest = qMax(room.longest, endMs - startMs);
+    ++bookingCount;
+}
+
+QList<int> RoomIndex::overlapping(const QString &locationKey, qint64 startMs, qint64 endMs,
+                                  int excludeActivityId) const
+{
+    QList<int> result;
+    auto roomIt = rooms.constFind(locationKey);
+    if (locationKey.isEmpty() || roomIt == rooms.constEnd() || endMs <= startMs) {
+        return result;
+    }
+    const Room &room = roomIt.value();
+    
+    // 开始时间早于 endMs 的预订是 [0, last)
+    auto last = std::lower_bound(room.bookings.constBegin(), room.bookings.constEnd(), endMs,
+                                 [](const Booking &b, qint64 end) { return b.start < end; });
+    // 开始时间不晚于 startMs - longest 的预订一定在 startMs 之前结束
+    for (auto it = last; it != room.bookings.constBegin(); ) {
+        --it;
+        if (it->start <= startMs - room.longest) {
+            break;
+        }
+        if (it->end > startMs && it->activityId != excludeActivityId) {
+            result.prepend(it->activityId);
+        }
+    }
+    return result;
+}
+
+int RoomIndex::roomCount() const
+{
+    return rooms.size();
+}
+
+int RoomIndex::size() const
+{
+    return bookingCount;
+}
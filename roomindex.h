@@ -0,0 +1,46 @@
+#ifndef ROOMINDEX_H
+#define ROOMINDEX_H
+
+#include <QtGlobal>
+#include <QString>
+#include <QHash>
+#include <QVector>
+#include <QList>
+
+// 场地占用索引：按规范化的地点键分组，每个地点的预订按开始时间排序。
+// 查询某个时间段时先二分找到开始时间早于结束时间的预订，再向前扫描到
+// “开始时间 + 该地点最长预订时长”不晚于查询开始时间为止，只检查可能重叠的少数预订，
+// 与地点数量和一个学期的预订总数基本无关。时间为毫秒时间戳，半开区间（首尾相接不算冲突）。
+// 纯内存结构，不访问数据库，只在一个线程中使用。
+class RoomIndex
+{
+public:
+    RoomIndex();
+
+    // 规范化地点：全角转半角、忽略大小写、空白和常见分隔符，"Ａ栋 101" 与 "a栋-101" 相同；
+    // 结果为空表示未填写地点（线上活动等），不参与场地冲突检测
+    static QString locationKey(const QString &location);
+
+    void add(const QString &locationKey, int activityId, qint64 startMs, qint64 endMs);
+    // 与 [startMs, endMs) 重叠的预订（活动ID，按开始时间排列），excludeActivityId 为正时排除该活动
+    QList<int> overlapping(const QString &locationKey, qint64 startMs, qint64 endMs,
+                           int excludeActivityId = -1) const;
+    int roomCount() const;
+    int size() const;
+
+private:
+    struct Booking {
+        qint64 start;
+        qint64 end;
+        int activityId;
+    };
+    struct Room {
+        QVector<Booking> bookings;   // 按开始时间排序
+        qint64 longest = 0;          // 最长预订时长，限定向前扫描的范围
+    };
+
+    QHash<QString, Room> rooms;
+    int bookingCount;
+};
+
+#endif // ROOMINDEX_H
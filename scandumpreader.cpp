@@ -0,0 +1,201 @@
+#include "scandumpreader.h"
+#include <QFile>
+
+namespace {
+bool isDigit(char c)
+{
+    return c >= '0' && c <= '9';
+}
+}
+
+bool ScanDumpReader::read(const QString &fileName, ScanDump &dump)
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly)) {
+        dump.error = file.errorString();
+        return false;
+    }
+    
+    QString studentId;
+    QDateTime scannedAt;
+    while (!file.atEnd()) {
+        QByteArray line = file.readLine();
+        ++dump.lines;
+        if (dump.lines == 1 && line.startsWith("\xEF\xBB\xBF")) {
+            line.remove(0, 3);  // UTF-8 BOM
+        }
+        QByteArray trimmed = line.trimmed();
+        if (trimmed.isEmpty() || trimmed.startsWith('#')) {
+            continue;
+        }
+        if (!parseLine(trimmed, studentId, scannedAt)) {
+            if (dump.lines > 1) {
+                ++dump.malformed;  // 首行解析不了时视为表头
+            }
+            continue;
+        }
+        
+        ++dump.scans;
+        auto it = dump.earliest.find(studentId);
+        if (it == dump.earliest.end()) {
+            dump.earliest.insert(studentId, scannedAt);
+        } else {
+            ++dump.duplicates;
+            if (scannedAt < it.value()) {
+                it.value() = scannedAt;
+            }
+        }
+    }
+    return true;
+}
+
+bool ScanDumpReader::parseLine(const QByteArray &line, QString &studentId, QDateTime &scannedAt)
+{
+    // 有逗号、制表符或分号时按它分隔；否则在第一段空白处分开（时间中可能带空格）
+    int separator = -1;
+    for (int i = 0; i < line.size(); ++i) {
+        char c = line.at(i);
+        if (c == ',' || c == '\t' || c == ';') {
+            separator = i;
+            break;
+        }
+    }
+    if (separator < 0) {
+        separator = line.indexOf(' ');
+    }
+    if (separator < 0) {
+        return false;
+    }
+    
+    QByteArray first = cleanField(line.left(separator));
+    QByteArray second = line.mid(separator + 1);
+    // 只取第二个字段（后面可能还有设备号等）
+    for (int i = 0; i < second.size(); ++i) {
+        char c = second.at(i);
+        if (c == ',' || c == '\t' || c == ';') {
+            second.truncate(i);
+            break;
+        }
+    }
+    second = cleanField(second);
+    
+    // 学号也可能是 10 位数字，先按格式化的日期时间找时间字段，两个都不是时才按数字时间戳识别
+    QDateTime time = parseDateTime(second);
+    QByteArray id = first;
+    if (!time.isValid()) {
+        time = parseDateTime(first);  // 时间在前
+        id = second;
+    }
+    if (!time.isValid()) {
+        time = parseEpoch(second);
+        id = first;
+        if (!time.isValid()) {
+            time = parseEpoch(first);
+            id = second;
+        }
+    }
+    if (!time.isValid() || id.isEmpty()) {
+        return false;
+    }
+    studentId = QString::fromUtf8(id);
+    scannedAt = time;
+    return true;
+}
+
+QDateTime ScanDumpReader::parseTimestamp(const QByteArray &field)
+{
+    QDateTime time = parseDateTime(field);
+    return time.isValid() ? time : parseEpoch(field);
+}
+
+QDateTime ScanDumpReader::parseEpoch(const QByteArray &field)
+{
+    // 10 位秒或 13 位毫秒时间戳（学号也是纯数字，其他长度不当作时间）
+    if (field.size() != 10 && field.size() != 13) {
+        return QDateTime();
+    }
+    for (char c : field) {
+        if (!isDigit(c)) {
+            return QDateTime();
+        }
+    }
+    qint64 value = field.toLongLong();
+    return field.size() == 10 ? QDateTime::fromSecsSinceEpoch(value) : QDateTime::fromMSecsSinceEpoch(value);
+}
+
+QDateTime ScanDumpReader::parseDateTime(const QByteArray &field)
+{
+    const char *p = field.constData();
+    const char *end = p + field.size();
+    if (p == end) {
+        return QDateTime();
+    }
+    
+    // 年 月 日 时 分 [秒 [毫秒]]，逐字符解析，比 QDateTime::fromString 快得多
+    int parts[7] = {0, 0, 0, 0, 0, 0, 0};
+    int count = 0;
+    while (p != end && count < 7) {
+        if (!isDigit(*p)) {
+            return QDateTime();
+        }
+        int value = 0;
+        int digits = 0;
+        if (count == 6) {
+            // 毫秒按小数处理："5" 是 500 毫秒，超过三位的部分舍去
+            for (; p != end && isDigit(*p); ++p) {
+                if (digits < 3) {
+                    value = value * 10 + (*p - '0');
+                    ++digits;
+                }
+            }
+            for (; digits < 3; ++digits) {
+                value *= 10;
+            }
+            parts[count++] = value;
+            break;  // 时区后缀等忽略
+        }
+        while (p != end && isDigit(*p)) {
+            if (++digits > 4) {
+                return QDateTime();
+            }
+            value = value * 10 + (*p - '0');
+            ++p;
+        }
+        parts[count++] = value;
+        if (p == end) {
+            break;
+        }
+        
+        char c = *p;
+        bool expected = (count <= 2 && (c == '-' || c == '/'))
+                     || (count == 3 && (c == ' ' || c == 'T'))
+                     || ((count == 4 || count == 5) && c == ':')
+                     || (count == 6 && c == '.');
+        if (!expected) {
+            if (count >= 5) {
+                break;  // 时区后缀等忽略
+            }
+            return QDateTime();
+        }
+        ++p;
+    }
+    if (count < 5) {
+        return QDateTime();
+    }
+    
+    QDate date(parts[0], parts[1], parts[2]);
+    QTime time(parts[3], parts[4], parts[5], parts[6]);
+    if (!date.isValid() || !time.isValid()) {
+        return QDateTime();
+    }
+    return QDateTime(date, time);
+}
+
+QByteArray ScanDumpReader::cleanField(const QByteArray &field)
+{
+    QByteArray cleaned = field.trimmed();
+    if (cleaned.size() >= 2 && cleaned.startsWith('"') && cleaned.endsWith('"')) {
+        cleaned = cleaned.mid(1, cleaned.size() - 2).trimmed();
+    }
+    return cleaned;
+}
@@ -0,0 +1,39 @@
+#ifndef SCANDUMPREADER_H
+#define SCANDUMPREADER_H
+
+#include <QString>
+#include <QByteArray>
+#include <QHash>
+#include <QDateTime>
+
+// 一个扫码枪导出文件的读取结果：同一学号只保留最早的扫描时间
+struct ScanDump {
+    QHash<QString, QDateTime> earliest;   // 学号 -> 最早的扫描时间
+    int lines = 0;          // 读取的行数（含空行和表头）
+    int scans = 0;          // 有效的扫描记录
+    int duplicates = 0;     // 同一学号的重复扫描
+    int malformed = 0;      // 无法解析的行
+    QString error;          // 文件无法打开时的原因
+};
+
+// 扫码枪离线导出文件（CSV / 文本）的流式读取：逐行读取、边读边去重，内存只保留每个学号一条记录。
+// 每行一个学号和一个时间，逗号、制表符或分号分隔时顺序不限（空白分隔时学号在前），字段可带引号；
+// 两个字段都像时间（如 10 位学号与时间戳）时以格式化的日期时间为准，都是数字时按学号在前处理；
+// 时间支持 "yyyy-MM-dd HH:mm[:ss[.zzz]]"（"-" 或 "/"，日期与时间之间可为 "T"，按本地时间）
+// 和 10 位秒 / 13 位毫秒时间戳。空行、"#" 开头的注释和首行表头跳过。纯计算，不访问数据库。
+class ScanDumpReader
+{
+public:
+    static bool read(const QString &fileName, ScanDump &dump);
+    // 解析一行；不是有效的扫描记录时返回 false
+    static bool parseLine(const QByteArray &line, QString &studentId, QDateTime &scannedAt);
+    // 格式化的日期时间或数字时间戳
+    static QDateTime parseTimestamp(const QByteArray &field);
+
+private:
+    static QDateTime parseDateTime(const QByteArray &field);
+    static QDateTime parseEpoch(const QByteArray &field);
+    static QByteArray cleanField(const QByteArray &field);
+};
+
+#endif // SCANDUMPREADER_H
@@ -0,0 +1,118 @@
+#include "snapshotdatabase.h"
+#include <QTimer>
+#include <QFileInfo>
+#include <QDebug>
+
+SnapshotDatabase::SnapshotDatabase(Database *liveDatabase, int refreshIntervalMs, QObject *parent)
+    : QObject(parent)
+    , liveDatabase(liveDatabase)
+    , executor(new DbExecutor(":memory:", this))
+    , refreshTimer(new QTimer(this))
+    , refreshing(false)
+    , ready(false)
+    , changeSerial(0)
+    , snapshotSerial(-1)
+    , liveWal(liveDatabase->journalMode() == "wal")
+{
+    connect(liveDatabase, &Database::activityChanged, this, &SnapshotDatabase::onLiveChanged);
+    connect(liveDatabase, &Database::registrationChanged, this, &SnapshotDatabase::onLiveChanged);
+    connect(liveDatabase, &Database::checkInRecorded, this, &SnapshotDatabase::onLiveChanged);
+    connect(refreshTimer, &QTimer::timeout, this, &SnapshotDatabase::onRefreshTimer);
+    
+    setRefreshInterval(refreshIntervalMs);
+    refresh();
+}
+
+void SnapshotDatabase::setRefreshInterval(int msecs)
+{
+    if (msecs > 0) {
+        refreshTimer->start(msecs);
+    } else {
+        refreshTimer->stop();
+    }
+}
+
+int SnapshotDatabase::refreshInterval() const
+{
+    return refreshTimer->isActive() ? refreshTimer->interval() : 0;
+}
+
+void SnapshotDatabase::refresh()
+{
+    if (refreshing) {
+        return;
+    }
+    refreshing = true;
+    
+    // 以开始刷新的时间作为快照时间：之后的写入不一定包含在快照中
+    const int serial = changeSerial;
+    const QDateTime fileStamp = liveFileStamp();
+    const QDateTime startedAt = QDateTime::currentDateTime();
+    QElapsedTimer startedClock;
+    startedClock.start();
+    
+    const QString liveFile = liveDatabase->databaseFileName();
+    executor->post(this, [liveFile](Database *db) {
+        return db->loadSnapshotFrom(liveFile);
+    }, [this, serial, fileStamp, startedAt, startedClock](bool success) {
+        refreshing = false;
+        if (!success) {
+            qDebug() << "[快照] 刷新失败，继续使用上一份快照";
+            return;
+        }
+        ready = true;
+        takenAt = startedAt;
+        age = startedClock;
+        snapshotSerial = serial;
+        snapshotFileStamp = fileStamp;
+        qDebug() << "[快照] 已刷新，耗时" << startedClock.elapsed() << "ms";
+        emit snapshotRefreshed(takenAt);
+    });
+}
+
+bool SnapshotDatabase::isReady() const
+{
+    return ready;
+}
+
+QDateTime SnapshotDatabase::snapshotTime() const
+{
+    return takenAt;
+}
+
+qint64 SnapshotDatabase::ageMs() const
+{
+    return ready ? age.elapsed() : -1;
+}
+
+bool SnapshotDatabase::hasNewerChanges() const
+{
+    return !ready || changeSerial != snapshotSerial || liveFileStamp() != snapshotFileStamp;
+}
+
+QDateTime SnapshotDatabase::liveFileStamp() const
+{
+    const QString liveFile = liveDatabase->databaseFileName();
+    QDateTime stamp = QFileInfo(liveFile).lastModified();
+    if (liveWal) {
+        // 检查点之前的写入只改动 -wal 文件
+        QFileInfo walFile(liveFile + "-wal");
+        if (walFile.exists() && walFile.lastModified() > stamp) {
+            stamp = walFile.lastModified();
+        }
+    }
+    return stamp;
+}
+
+void SnapshotDatabase::onLiveChanged()
+{
+    changeSerial++;
+}
+
+void SnapshotDatabase::onRefreshTimer()
+{
+    // 没有新写入时不必重复复制
+    if (hasNewerChanges()) {
+        refresh();
+    }
+}
@@ -0,0 +1,66 @@
+#ifndef SNAPSHOTDATABASE_H
+#define SNAPSHOTDATABASE_H
+
+#include <QObject>
+#include <QDateTime>
+#include <QElapsedTimer>
+#include "database.h"
+#include "dbexecutor.h"
+
+class QTimer;
+
+// 只读内存快照：在后台线程中定期把实时数据库复制到一个内存数据库，
+// 统计、导出等只读的大查询在快照上执行，不与写入争用数据库文件。
+// 实时库为预写日志模式时复制本身也不阻塞写入（否则每个表单独复制，写入最多等待一个表）。
+// 快照之后实时库有写入时才会在下一个周期刷新；通过 snapshotTime()/ageMs()/hasNewerChanges() 判断数据新旧。
+class SnapshotDatabase : public QObject
+{
+    Q_OBJECT
+
+public:
+    // liveDatabase 提供数据库文件名和变更通知，必须已完成 initializeDatabase()
+    explicit SnapshotDatabase(Database *liveDatabase, int refreshIntervalMs = 30000, QObject *parent = nullptr);
+
+    // 刷新周期，0 表示只在调用 refresh() 时刷新
+    void setRefreshInterval(int msecs);
+    int refreshInterval() const;
+    // 立即在后台刷新；已有刷新在进行时忽略
+    void refresh();
+
+    // 过期指示
+    bool isReady() const;              // 是否已有可用的快照
+    QDateTime snapshotTime() const;    // 快照对应的时间点（无快照时为空）
+    qint64 ageMs() const;              // 快照已存在的毫秒数（无快照时为 -1）
+    bool hasNewerChanges() const;      // 快照之后实时库是否有写入
+
+    // 在快照线程上执行只读查询，签名同 DbExecutor::post。
+    // 首次快照完成前提交的查询会排在首次刷新之后执行
+    template <typename Task, typename Callback>
+    void query(QObject *context, Task task, Callback callback)
+    {
+        executor->post(context, task, callback);
+    }
+
+signals:
+    void snapshotRefreshed(const QDateTime &takenAt);
+
+private:
+    Database *liveDatabase;
+    DbExecutor *executor;       // 连接到 ":memory:"，刷新与查询都在其线程上串行执行
+    QTimer *refreshTimer;
+    bool refreshing;
+    bool ready;
+    QDateTime takenAt;
+    QElapsedTimer age;
+    int changeSerial;           // 实时库每次变更加一
+    int snapshotSerial;         // 当前快照对应的 changeSerial
+    QDateTime snapshotFileStamp;  // 当前快照开始时数据库文件的修改时间
+    bool liveWal;               // 实时库是否为预写日志模式（写入先进入 -wal 文件）
+
+    // 数据库文件（预写日志模式下含 -wal 文件）的最后修改时间，用于发现不经过信号的写入（如其他窗口、平台同步）
+    QDateTime liveFileStamp() const;
+    void onLiveChanged();
+    void onRefreshTimer();
+};
+
+#endif // SNAPSHOTDATABASE_H
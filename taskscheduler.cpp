@@ -0,0 +1,264 @@
+#include "taskscheduler.h"
+#include "database.h"
+#include <QThread>
+#include <QCoreApplication>
+#include <QHash>
+#include <QDebug>
+
+// 工作线程：循环从调度器取任务执行，并持有本线程的数据库连接
+class TaskWorker : public QThread
+{
+public:
+    TaskWorker(TaskScheduler *scheduler, int index)
+        : scheduler(scheduler)
+        , index(index)
+    {
+    }
+
+    Database *database(const QString &databaseName);
+
+protected:
+    void run() override;
+
+private:
+    TaskScheduler *scheduler;
+    int index;
+    QHash<QString, Database *> connections;  // 只在本线程中创建和访问
+};
+
+namespace {
+const int kLaneCount = 3;
+// 当前线程所属的调度器和编号，用于把任务中提交的子任务放入本线程的队列
+thread_local TaskScheduler *currentScheduler = nullptr;
+thread_local int currentWorkerIndex = -1;
+}
+
+Database *TaskWorker::database(const QString &databaseName)
+{
+    Database *db = connections.value(databaseName);
+    if (!db) {
+        QString connectionName = QString("task_worker_%1_%2_%3")
+            .arg(reinterpret_cast<quintptr>(scheduler)).arg(index).arg(connections.size());
+        db = new Database(connectionName, databaseName);
+        if (!db->open()) {
+            qDebug() << "[任务调度] 打开数据库连接失败:" << databaseName;
+        }
+        connections.insert(databaseName, db);
+    }
+    return db;
+}
+
+void TaskWorker::run()
+{
+    currentScheduler = scheduler;
+    currentWorkerIndex = index;
+    scheduler->workerLoop(index, this);
+
+    // 连接必须在创建它的线程中关闭
+    qDeleteAll(connections);
+    connections.clear();
+}
+
+TaskContext::TaskContext(const CancellationToken &token, const std::function<void(int)> &progress, TaskWorker *worker)
+    : token(token)
+    , progress(progress)
+    , worker(worker)
+    , lastProgress(-1)
+{
+}
+
+bool TaskContext::isCancelled() const
+{
+    return token.isCancelled();
+}
+
+void TaskContext::reportProgress(int percentage)
+{
+    percentage = qBound(0, percentage, 100);
+    if (percentage == lastProgress || !progress) {
+        return;
+    }
+    lastProgress = percentage;
+    progress(percentage);
+}
+
+Database *TaskContext::database(const QString &databaseName)
+{
+    return worker->database(databaseName);
+}
+
+TaskScheduler::TaskScheduler(int workerCount, QObject *parent)
+    : QObject(parent)
+    , nextQueue(0)
+    , pendingUrgent(0)
+    , pendingBulk(0)
+    , runningBulk(0)
+    , stopping(0)
+{
+    if (workerCount <= 0) {
+        workerCount = QThread::idealThreadCount();
+    }
+    // 至少两个线程，其中一个永远不执行 Bulk 任务
+    workerCount = qMax(2, workerCount);
+    bulkLimit = workerCount - 1;
+
+    for (int i = 0; i < workerCount; ++i) {
+        queues.append(new WorkerQueue);
+    }
+    for (int i = 0; i < workerCount; ++i) {
+        TaskWorker *worker = new TaskWorker(this, i);
+        worker->setObjectName(QString("TaskWorker-%1").arg(i));
+        workers.append(worker);
+    }
+    for (TaskWorker *worker : workers) {
+        worker->start();
+    }
+}
+
+TaskScheduler::~TaskScheduler()
+{
+    // 正在执行的任务会执行完，排队中的任务直接丢弃
+    stopping.storeRelease(1);
+    {
+        QMutexLocker locker(&idleMutex);
+        wakeCondition.wakeAll();
+    }
+    for (TaskWorker *worker : workers) {
+        worker->wait();
+    }
+    qDeleteAll(workers);
+    qDeleteAll(queues);
+}
+
+TaskScheduler *TaskScheduler::globalInstance()
+{
+    // 只在GUI线程中调用
+    static QPointer<TaskScheduler> instance;
+    if (!instance) {
+        instance = new TaskScheduler(0, QCoreApplication::instance());
+    }
+    return instance;
+}
+
+int TaskScheduler::workerCount() const
+{
+    return workers.size();
+}
+
+void TaskScheduler::enqueue(TaskPriority priority, const CancellationToken &token,
+                            const std::function<void(TaskContext &)> &run,
+                            const std::function<void(int)> &progress)
+{
+    Job job;
+    job.priority = priority;
+    job.token = token;
+    job.run = run;
+    job.progress = progress;
+
+    int target;
+    if (currentScheduler == this) {
+        target = currentWorkerIndex;
+    } else {
+        target = static_cast<int>(static_cast<uint>(nextQueue.fetchAndAddRelaxed(1)) % static_cast<uint>(queues.size()));
+    }
+
+    {
+        QMutexLocker locker(&queues[target]->mutex);
+        queues[target]->lanes[static_cast<int>(priority)].append(job);
+    }
+    if (priority == TaskPriority::Bulk) {
+        pendingBulk.ref();
+    } else {
+        pendingUrgent.ref();
+    }
+
+    QMutexLocker locker(&idleMutex);
+    wakeCondition.wakeOne();
+}
+
+bool TaskScheduler::popFrom(WorkerQueue *queue, int lane, bool fromFront, Job &job)
+{
+    QMutexLocker locker(&queue->mutex);
+    QList<Job> &jobs = queue->lanes[lane];
+    if (jobs.isEmpty()) {
+        return false;
+    }
+    job = fromFront ? jobs.takeFirst() : jobs.takeLast();
+    return true;
+}
+
+bool TaskScheduler::takeJob(int workerIndex, Job &job)
+{
+    const int bulkLane = static_cast<int>(TaskPriority::Bulk);
+
+    for (int lane = 0; lane < kLaneCount; ++lane) {
+        if (lane == bulkLane) {
+            if (pendingBulk.loadAcquire() <= 0) {
+                return false;
+            }
+            // 先占用一个 Bulk 名额，占满时把剩下的线程留给交互任务
+            if (runningBulk.fetchAndAddOrdered(1) >= bulkLimit) {
+                runningBulk.deref();
+                return false;
+            }
+        } else if (pendingUrgent.loadAcquire() <= 0) {
+            continue;
+        }
+
+        // 先取自己队列的队首，再从其他线程的队尾窃取
+        bool found = popFrom(queues[workerIndex], lane, true, job);
+        for (int offset = 1; !found && offset < queues.size(); ++offset) {
+            found = popFrom(queues[(workerIndex + offset) % queues.size()], lane, false, job);
+        }
+
+        if (found) {
+            if (lane == bulkLane) {
+                pendingBulk.deref();
+            } else {
+                pendingUrgent.deref();
+            }
+            return true;
+        }
+        if (lane == bulkLane) {
+            runningBulk.deref();
+        }
+    }
+    return false;
+}
+
+bool TaskScheduler::hasRunnableJob() const
+{
+    return pendingUrgent.loadAcquire() > 0
+        || (pendingBulk.loadAcquire() > 0 && runningBulk.loadAcquire() < bulkLimit);
+}
+
+void TaskScheduler::runJob(Job &job, TaskWorker *worker)
+{
+    if (job.token.isCancelled()) {
+        return;  // 排队期间被取消
+    }
+    TaskContext context(job.token, job.progress, worker);
+    job.run(context);
+}
+
+void TaskScheduler::workerLoop(int workerIndex, TaskWorker *worker)
+{
+    while (!stopping.loadAcquire()) {
+        Job job;
+        if (takeJob(workerIndex, job)) {
+            runJob(job, worker);
+            if (job.priority == TaskPriority::Bulk) {
+                // 释放 Bulk 名额，唤醒因名额已满而等待的线程
+                runningBulk.deref();
+                QMutexLocker locker(&idleMutex);
+                wakeCondition.wakeOne();
+            }
+            continue;
+        }
+
+        QMutexLocker locker(&idleMutex);
+        if (!stopping.loadAcquire() && !hasRunnableJob()) {
+            wakeCondition.wait(&idleMutex);
+        }
+    }
+}
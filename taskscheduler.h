@@ -0,0 +1,142 @@
+#ifndef TASKSCHEDULER_H
+#define TASKSCHEDULER_H
+
+#include <QObject>
+#include <QPointer>
+#include <QMetaObject>
+#include <QSharedPointer>
+#include <QAtomicInt>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QVector>
+#include <QList>
+#include <functional>
+
+class Database;
+class TaskWorker;
+
+// 任务优先级：工作线程总是先取高优先级的任务；
+// Bulk 任务最多占用 (线程数 - 1) 个线程，保证交互任务不会排在批量任务后面
+enum class TaskPriority {
+    Interactive,    // 用户正在等待结果（如报名时的冲突检测）
+    Normal,
+    Bulk            // 导出等耗时的批量任务
+};
+
+// 取消标记：可复制，所有副本共享同一状态
+class CancellationToken
+{
+public:
+    CancellationToken() : flag(new QAtomicInt(0)) {}
+    void cancel() { flag->storeRelease(1); }
+    bool isCancelled() const { return flag->loadAcquire() != 0; }
+
+private:
+    QSharedPointer<QAtomicInt> flag;
+};
+
+// 传给任务函数的上下文，只在执行任务的工作线程中使用
+class TaskContext
+{
+public:
+    bool isCancelled() const;
+    // 报告进度（0~100），排队送到GUI线程；相同的值不会重复发送
+    void reportProgress(int percentage);
+    // 当前工作线程连接到 databaseName 的数据库（首次使用时打开）
+    Database *database(const QString &databaseName);
+
+private:
+    friend class TaskScheduler;
+    TaskContext(const CancellationToken &token, const std::function<void(int)> &progress, TaskWorker *worker);
+
+    CancellationToken token;
+    std::function<void(int)> progress;
+    TaskWorker *worker;
+    int lastProgress;
+};
+
+// 统一的后台任务调度器：线程数等于CPU核心数（至少2个），每个线程一个任务队列，
+// 自己的队列为空时从其他线程的队列末尾窃取任务。结果和进度排队回到GUI线程，
+// 请求方（context）销毁或任务被取消后不再回调。
+class TaskScheduler : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit TaskScheduler(int workerCount = 0, QObject *parent = nullptr);
+    ~TaskScheduler();
+
+    // 应用内共享的调度器（首次调用时创建，随 QCoreApplication 销毁）
+    static TaskScheduler *globalInstance();
+
+    int workerCount() const;
+
+    // task 在工作线程执行，签名为 Result(TaskContext &)；
+    // callback 在GUI线程执行，签名为 void(const Result &)；
+    // progress 可选，在GUI线程执行，签名为 void(int)
+    template <typename Task, typename Callback>
+    CancellationToken submit(TaskPriority priority, QObject *context, Task task, Callback callback,
+                             std::function<void(int)> progress = std::function<void(int)>())
+    {
+        CancellationToken token;
+        QPointer<QObject> guard(context);
+
+        std::function<void(int)> progressSink;
+        if (progress) {
+            progressSink = [this, guard, progress, token](int percentage) {
+                QMetaObject::invokeMethod(this, [guard, progress, token, percentage]() {
+                    if (guard && !token.isCancelled()) {
+                        progress(percentage);
+                    }
+                }, Qt::QueuedConnection);
+            };
+        }
+
+        enqueue(priority, token, [this, guard, task, callback, token](TaskContext &taskContext) {
+            auto result = task(taskContext);
+            QMetaObject::invokeMethod(this, [guard, callback, result, token]() {
+                if (guard && !token.isCancelled()) {
+                    callback(result);
+                }
+            }, Qt::QueuedConnection);
+        }, progressSink);
+
+        return token;
+    }
+
+private:
+    struct Job {
+        TaskPriority priority;
+        CancellationToken token;
+        std::function<void(TaskContext &)> run;
+        std::function<void(int)> progress;
+    };
+    // 每个工作线程的队列，按优先级分道；本线程从队首取，其他线程从队尾窃取
+    struct WorkerQueue {
+        QMutex mutex;
+        QList<Job> lanes[3];
+    };
+    friend class TaskWorker;
+
+    QVector<WorkerQueue *> queues;
+    QVector<TaskWorker *> workers;
+    QAtomicInt nextQueue;        // GUI线程提交任务时轮流放入各队列
+    QAtomicInt pendingUrgent;    // 排队中的 Interactive/Normal 任务数
+    QAtomicInt pendingBulk;      // 排队中的 Bulk 任务数
+    QAtomicInt runningBulk;      // 正在执行的 Bulk 任务数
+    QAtomicInt stopping;
+    int bulkLimit;
+    QMutex idleMutex;
+    QWaitCondition wakeCondition;
+
+    void enqueue(TaskPriority priority, const CancellationToken &token,
+                 const std::function<void(TaskContext &)> &run,
+                 const std::function<void(int)> &progress);
+    bool takeJob(int workerIndex, Job &job);
+    bool popFrom(WorkerQueue *queue, int lane, bool fromFront, Job &job);
+    bool hasRunnableJob() const;
+    void runJob(Job &job, TaskWorker *worker);
+    void workerLoop(int workerIndex, TaskWorker *worker);
+};
+
+#endif // TASKSCHEDULER_H
@@ -13,14 +13,20 @@ SOURCES += \
     database.cpp \
     conflictchecker.cpp \
     exportthread.cpp \
-    csvexporter.cpp
+    csvexporter.cpp \
+    taskscheduler.cpp \
+    preferencematcher.cpp \
+    roomindex.cpp
 
 # 测试程序头文件
 HEADERS += \
     database.h \
     conflictchecker.h \
     exportthread.h \
-    csvexporter.h
+    csvexporter.h \
+    taskscheduler.h \
+    preferencematcher.h \
+    roomindex.h
 
 # 不需要UI文件，因为测试程序是纯代码实现的
 
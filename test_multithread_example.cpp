@@ -1,7 +1,8 @@
 /**
  * 多线程测试示例程序
  * 
- * 这是一个简单的测试程序，演示如何测试 ConflictChecker 和 ExportThread
+ * 这是一个简单的测试程序，演示如何测试 ConflictChecker 和 ExportThread，
+ * 并包含 ConflictChecker 的吞吐量测试（请求合并效果与逐条同步查询对比）
  * 可以直接在Qt项目中运行，或作为参考实现完整的单元测试
  */
 
@@ -16,6 +17,8 @@
 #include <QProgressBar>
 #include <QDateTime>
 #include <QTime>
+#include <QElapsedTimer>
+#include <QSharedPointer>
 #include "database.h"
 #include "conflictchecker.h"
 #include "exportthread.h"
@@ -159,6 +162,88 @@ private slots:
         logOutput("=== ConflictChecker 测试完成 ===\n");
     }
     
+    void benchmarkConflictChecker()
+    {
+        logOutput("=== 开始 ConflictChecker 吞吐量测试 ===");
+        
+        const int studentCount = 50;
+        const int activityCount = 20;
+        const int requestCount = 5000;
+        
+        // 准备数据：若干已批准的活动，每个学生报名其中一部分（只准备一次）
+        static QList<int> activityIds;
+        static QList<QPair<QDateTime, QDateTime>> activityTimes;
+        if (activityIds.isEmpty()) {
+            QDateTime base = QDateTime::currentDateTime().addDays(10);
+            for (int i = 0; i < activityCount; ++i) {
+                QDateTime start = base.addSecs(i * 5400);  // 每个活动2小时，间隔1.5小时，相邻活动互相重叠
+                QDateTime end = start.addSecs(7200);
+                int id = database->createActivity(QString("吞吐量测试活动%1").arg(i + 1), "吞吐量测试",
+                                                  "学术", "测试发起人", start, end, studentCount, "测试地点");
+                database->updateActivityStatus(id, ActivityStatus::Approved);
+                activityIds.append(id);
+                activityTimes.append(qMakePair(start, end));
+            }
+            for (int s = 0; s < studentCount; ++s) {
+                for (int i = s % 4; i < activityCount; i += 4) {
+                    database->registerActivity(activityIds[i], QString("bench_student_%1").arg(s), "测试学生");
+                }
+            }
+            logOutput(QString("已准备 %1 个活动、%2 名学生的报名数据").arg(activityCount).arg(studentCount));
+        }
+        
+        // 基线：在当前线程逐条调用 checkTimeConflict
+        const int baselineCount = 500;
+        QElapsedTimer baselineTimer;
+        baselineTimer.start();
+        for (int i = 0; i < baselineCount; ++i) {
+            int index = (i * 7) % activityCount;
+            database->checkTimeConflict(QString("bench_student_%1").arg(i % studentCount),
+                                        activityTimes[index].first, activityTimes[index].second,
+                                        activityIds[index]);
+        }
+        double baselineMs = baselineTimer.nsecsElapsed() / 1e6;
+        logOutput(QString("逐条同步查询：%1 次，耗时 %2 ms，%3 次/秒（阻塞UI线程）")
+                  .arg(baselineCount).arg(baselineMs, 0, 'f', 1)
+                  .arg(baselineMs > 0 ? baselineCount * 1000.0 / baselineMs : 0.0, 0, 'f', 0));
+        
+        // 服务：一次性提交全部请求，统计提交耗时、完成耗时和实际执行的查询数
+        ConflictChecker *service = new ConflictChecker(database, this);
+        QSharedPointer<QElapsedTimer> timer(new QElapsedTimer);
+        QSharedPointer<int> received(new int(0));
+        QSharedPointer<int> withConflict(new int(0));
+        
+        connect(service, &ConflictChecker::conflictChecked, this,
+                [this, service, timer, received, withConflict, requestCount](int, const QList<QHash<QString, QVariant>> &conflicts) {
+            (*received)++;
+            if (!conflicts.isEmpty()) {
+                (*withConflict)++;
+            }
+            if (*received < requestCount) {
+                return;
+            }
+            double elapsedMs = timer->nsecsElapsed() / 1e6;
+            logOutput(QString("冲突检测服务：%1 个请求全部完成，耗时 %2 ms，%3 次/秒")
+                      .arg(requestCount).arg(elapsedMs, 0, 'f', 1)
+                      .arg(elapsedMs > 0 ? requestCount * 1000.0 / elapsedMs : 0.0, 0, 'f', 0));
+            logOutput(QString("实际数据库查询 %1 次（合并率 %2 请求/查询），%3 个请求存在冲突")
+                      .arg(service->executedQueries())
+                      .arg(service->executedQueries() > 0 ? double(requestCount) / service->executedQueries() : 0.0, 0, 'f', 1)
+                      .arg(*withConflict));
+            logOutput("=== ConflictChecker 吞吐量测试完成 ===\n");
+            service->deleteLater();
+        });
+        
+        timer->start();
+        for (int i = 0; i < requestCount; ++i) {
+            int index = (i * 7) % activityCount;
+            service->check(QString("bench_student_%1").arg(i % studentCount),
+                           activityIds[index], activityTimes[index].first, activityTimes[index].second);
+        }
+        logOutput(QString("提交 %1 个请求耗时 %2 ms（不阻塞UI）")
+                  .arg(requestCount).arg(timer->nsecsElapsed() / 1e6, 0, 'f', 1));
+    }
+    
     void testExportThread()
     {
         logOutput("=== 开始测试 ExportThread ===");
@@ -275,6 +360,10 @@ private:
         connect(testConflictBtn, &QPushButton::clicked, this, &TestWindow::testConflictChecker);
         layout->addWidget(testConflictBtn);
         
+        QPushButton *benchConflictBtn = new QPushButton("ConflictChecker 吞吐量测试", this);
+        connect(benchConflictBtn, &QPushButton::clicked, this, &TestWindow::benchmarkConflictChecker);
+        layout->addWidget(benchConflictBtn);
+        
         QPushButton *testExportBtn = new QPushButton("测试 ExportThread", this);
         connect(testExportBtn, &QPushButton::clicked, this, &TestWindow::testExportThread);
         layout->addWidget(testExportBtn);
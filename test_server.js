@@ -14,9 +14,99 @@ const cors = require('cors');
 const app = express();
 const PORT = 8090;
 
+// 线路字节数统计（用于比较 JSON/CBOR/gzip 的体积）
+const wireStats = { requests: 0, wireBytes: 0, decodedBytes: 0 };
+
+// 记录压缩前的线路字节数（body-parser 会自动解压 gzip 请求体）
+function recordWireBytes(req, res, buf) {
+    req.decodedLength = buf.length;
+}
+
+// 最小化的 CBOR 解码器，覆盖活动同步用到的类型（整数、字符串、数组、映射、浮点、布尔、null）
+function decodeCbor(buf) {
+    let offset = 0;
+
+    function readLength(info) {
+        if (info < 24) return info;
+        if (info === 24) return buf.readUInt8(offset++);
+        if (info === 25) { const v = buf.readUInt16BE(offset); offset += 2; return v; }
+        if (info === 26) { const v = buf.readUInt32BE(offset); offset += 4; return v; }
+        if (info === 27) { const v = Number(buf.readBigUInt64BE(offset)); offset += 8; return v; }
+        throw new Error(`不支持的CBOR长度编码: ${info}`);
+    }
+
+    function readItem() {
+        const initial = buf.readUInt8(offset++);
+        const major = initial >> 5;
+        const info = initial & 0x1f;
+
+        switch (major) {
+            case 0: return readLength(info);
+            case 1: return -1 - readLength(info);
+            case 2: { const len = readLength(info); const v = buf.subarray(offset, offset + len); offset += len; return v; }
+            case 3: { const len = readLength(info); const v = buf.toString('utf8', offset, offset + len); offset += len; return v; }
+            case 4: { const len = readLength(info); const arr = []; for (let i = 0; i < len; i++) arr.push(readItem()); return arr; }
+            case 5: {
+                const len = readLength(info);
+                const obj = {};
+                for (let i = 0; i < len; i++) { const key = readItem(); obj[key] = readItem(); }
+                return obj;
+            }
+            case 6: readLength(info); return readItem(); // 忽略标签
+            case 7:
+                if (info === 20) return false;
+                if (info === 21) return true;
+                if (info === 22 || info === 23) return null;
+                if (info === 25) { const v = buf.readUInt16BE(offset); offset += 2; return decodeHalf(v); }
+                if (info === 26) { const v = buf.readFloatBE(offset); offset += 4; return v; }
+                if (info === 27) { const v = buf.readDoubleBE(offset); offset += 8; return v; }
+                throw new Error(`不支持的CBOR简单值: ${info}`);
+        }
+        throw new Error(`不支持的CBOR主类型: ${major}`);
+    }
+
+    function decodeHalf(half) {
+        const exp = (half >> 10) & 0x1f;
+        const mant = half & 0x3ff;
+        const sign = half & 0x8000 ? -1 : 1;
+        if (exp === 0) return sign * Math.pow(2, -14) * (mant / 1024);
+        if (exp === 31) return mant ? NaN : sign * Infinity;
+        return sign * Math.pow(2, exp - 15) * (1 + mant / 1024);
+    }
+
+    return readItem();
+}
+
 // 中间件配置
 app.use(cors()); // 允许跨域请求
-app.use(express.json()); // 解析JSON请求体
+app.use(express.json({ verify: recordWireBytes })); // 解析JSON请求体（自动解压gzip）
+app.use(express.raw({ type: 'application/cbor', verify: recordWireBytes })); // CBOR请求体
+
+// 解码CBOR请求体并统计线路字节数
+app.use((req, res, next) => {
+    // 声明可接受 gzip 压缩的请求体（RFC 7694），客户端据此决定是否压缩
+    res.set('Accept-Encoding', 'gzip');
+
+    if (req.method !== 'POST' || req.decodedLength === undefined) {
+        return next();
+    }
+
+    try {
+        if (req.is('application/cbor')) {
+            req.body = decodeCbor(req.body);
+        }
+    } catch (error) {
+        return res.status(400).json({ success: false, message: `CBOR解析失败: ${error.message}` });
+    }
+
+    const wireLength = parseInt(req.headers['content-length'] || req.decodedLength, 10);
+    wireStats.requests += 1;
+    wireStats.wireBytes += wireLength;
+    wireStats.decodedBytes += req.decodedLength;
+    console.log(`[负载] ${req.headers['content-type']} ${req.headers['content-encoding'] || 'identity'}: ` +
+                `线路 ${wireLength} 字节，解码后 ${req.decodedLength} 字节`);
+    next();
+});
 
 // 存储同步的活动（用于测试）
 let syncedActivities = [];
@@ -114,6 +204,16 @@ app.post('/api/activities/sync', (req, res) => {
     }
 });
 
+// 查看请求体的线路字节数与解码后字节数（用于测试压缩效果）
+app.get('/api/wire-stats', (req, res) => {
+    res.json({
+        requests: wireStats.requests,
+        wire_bytes: wireStats.wireBytes,
+        decoded_bytes: wireStats.decodedBytes,
+        ratio: wireStats.decodedBytes ? +(wireStats.wireBytes / wireStats.decodedBytes).toFixed(3) : undefined
+    });
+});
+
 // 获取已同步的活动列表（用于测试和调试）
 app.get('/api/synced-activities', (req, res) => {
     res.json({
@@ -165,6 +265,7 @@ app.get('/', (req, res) => {
             "GET /api/announcements": "获取公告列表",
             "POST /api/activities/sync": "同步活动信息",
             "GET /api/synced-activities": "获取已同步的活动（测试用）",
+            "GET /api/wire-stats": "查看同步请求体的线路字节统计",
             "DELETE /api/synced-activities": "清除所有已同步的活动",
             "POST /api/synced-activities/clear": "清除所有已同步的活动（POST方法）",
             "GET /api/health": "健康检查"
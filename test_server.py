@@ -10,10 +10,19 @@
 服务器将在 http://localhost:8090 启动
 """
 
-from flask import Flask, jsonify, request
+from flask import Flask, jsonify, request, Response
 from flask_cors import CORS
-from datetime import datetime
+from datetime import datetime, timedelta
+import gzip
 import json
+import os
+import random
+import time
+
+try:
+    import cbor2  # 可选依赖：解析 application/cbor 请求体
+except ImportError:
+    cbor2 = None
 
 app = Flask(__name__)
 CORS(app)  # 允许跨域请求
@@ -21,6 +30,113 @@ CORS(app)  # 允许跨域请求
 # 存储同步的活动（用于测试）
 synced_activities = []
 
+# 客户端发件箱投递的活动提醒（按通知ID去重）
+delivered_notifications = {}
+
+# 增量同步：合成变更的总条数与涉及的活动数量（可通过环境变量或接口调整）
+synthetic_change_total = int(os.environ.get('SYNTHETIC_CHANGES', '5000'))
+synthetic_activity_count = int(os.environ.get('SYNTHETIC_ACTIVITIES', '2000'))
+SYNTHETIC_ID_BASE = 100000  # 避免与本地自增ID冲突
+SYNTHETIC_CATEGORIES = ["学术讲座", "文体活动", "社会实践", "志愿服务", "竞赛活动", "其他"]
+
+
+def make_synthetic_change(seq):
+    """按序号确定性地生成一条活动变更，同一序号每次生成的内容相同"""
+    index = (seq - 1) % synthetic_activity_count
+    activity_id = SYNTHETIC_ID_BASE + index + 1
+    revision = (seq - 1) // synthetic_activity_count
+
+    # 每隔一段插入一条删除变更，覆盖客户端的删除路径
+    if seq % 97 == 0:
+        return {"seq": seq, "op": "delete", "activity": {"id": activity_id}}
+
+    start = datetime(2024, 3, 1, 8, 0) + timedelta(hours=index * 3 + revision)
+    return {
+        "seq": seq,
+        "op": "upsert",
+        "activity": {
+            "id": activity_id,
+            "title": f"平台活动{activity_id}（第{revision + 1}版）",
+            "description": "由测试服务器生成的增量变更",
+            "category": SYNTHETIC_CATEGORIES[index % len(SYNTHETIC_CATEGORIES)],
+            "organizer": "platform",
+            "start_time": start.isoformat(),
+            "end_time": (start + timedelta(hours=2)).isoformat(),
+            "max_participants": 30 + index % 200,
+            "location": f"教学楼{index % 20 + 1}-{index % 50 + 101}",
+            "status": 1
+        }
+    }
+
+
+# 故障注入：每个API请求的附加延迟（毫秒）与返回503的概率，用于压测重试和连接池行为
+inject_delay_ms = int(os.environ.get('INJECT_DELAY_MS', '0'))
+inject_jitter_ms = int(os.environ.get('INJECT_JITTER_MS', '0'))
+inject_error_rate = float(os.environ.get('INJECT_ERROR_RATE', '0'))
+
+
+@app.before_request
+def inject_faults():
+    """按配置注入延迟和错误（健康检查与配置接口不受影响）"""
+    if not request.path.startswith('/api/') or request.path in ('/api/health', '/api/faults'):
+        return None
+    delay = inject_delay_ms + (random.randint(0, inject_jitter_ms) if inject_jitter_ms > 0 else 0)
+    if delay > 0:
+        time.sleep(delay / 1000.0)
+    if inject_error_rate > 0 and random.random() < inject_error_rate:
+        return jsonify({"success": False, "message": "注入的服务器错误"}), 503
+    return None
+
+
+@app.route('/api/faults', methods=['GET', 'POST'])
+def configure_faults():
+    """查看或修改故障注入配置：{"delay_ms": 20, "jitter_ms": 10, "error_rate": 0.05}"""
+    global inject_delay_ms, inject_jitter_ms, inject_error_rate
+    if request.method == 'POST':
+        data = request.get_json(silent=True) or {}
+        inject_delay_ms = int(data.get('delay_ms', inject_delay_ms))
+        inject_jitter_ms = int(data.get('jitter_ms', inject_jitter_ms))
+        inject_error_rate = float(data.get('error_rate', inject_error_rate))
+        print(f"[故障注入] 延迟 {inject_delay_ms}ms(+{inject_jitter_ms}ms), 错误率 {inject_error_rate}")
+    return jsonify({
+        "delay_ms": inject_delay_ms,
+        "jitter_ms": inject_jitter_ms,
+        "error_rate": inject_error_rate
+    })
+
+
+# 线路字节数统计（用于比较 JSON/CBOR/gzip 的体积）
+wire_stats = {"requests": 0, "wire_bytes": 0, "decoded_bytes": 0}
+
+
+def read_payload():
+    """按 Content-Encoding/Content-Type 解码请求体，支持 gzip 压缩的 JSON 或 CBOR"""
+    raw = request.get_data(cache=True)
+    body = raw
+    if request.headers.get('Content-Encoding', '').lower() == 'gzip':
+        body = gzip.decompress(raw)
+
+    if request.mimetype == 'application/cbor':
+        if cbor2 is None:
+            raise ValueError("服务器未安装 cbor2，无法解析 CBOR 请求体（pip install cbor2）")
+        data = cbor2.loads(body)
+    else:
+        data = json.loads(body.decode('utf-8')) if body else None
+
+    wire_stats["requests"] += 1
+    wire_stats["wire_bytes"] += len(raw)
+    wire_stats["decoded_bytes"] += len(body)
+    print(f"[负载] {request.mimetype} {request.headers.get('Content-Encoding', 'identity')}: "
+          f"线路 {len(raw)} 字节，解码后 {len(body)} 字节")
+    return data
+
+
+@app.after_request
+def advertise_request_encodings(response):
+    """声明可接受 gzip 压缩的请求体（RFC 7694），客户端据此决定是否压缩"""
+    response.headers['Accept-Encoding'] = 'gzip'
+    return response
+
 
 @app.route('/api/categories', methods=['GET'])
 def get_categories():
@@ -63,8 +179,8 @@ def get_announcements():
 def sync_activity():
     """同步活动信息到校园平台"""
     try:
-        # 获取JSON数据
-        data = request.get_json()
+        # 获取请求数据（JSON/CBOR，可能经过gzip压缩）
+        data = read_payload()
         
         if not data:
             return jsonify({
@@ -115,6 +231,86 @@ def sync_activity():
         }), 500
 
 
+@app.route('/api/activities/changes', methods=['GET'])
+def get_activity_changes():
+    """按游标分页返回活动变更（NDJSON：每行一条变更，最后一行为分页信息）"""
+    try:
+        since = int(request.args.get('since', '0') or 0)
+        limit = int(request.args.get('limit', '1000'))
+    except ValueError:
+        return jsonify({"success": False, "message": "since/limit 必须为整数"}), 400
+
+    limit = max(1, min(limit, 5000))
+    first = since + 1
+    last = min(since + limit, synthetic_change_total)
+
+    def generate():
+        for seq in range(first, last + 1):
+            yield json.dumps(make_synthetic_change(seq), ensure_ascii=False) + "\n"
+        next_cursor = max(since, last)
+        yield json.dumps({
+            "next_cursor": str(next_cursor),
+            "has_more": next_cursor < synthetic_change_total
+        }) + "\n"
+
+    print(f"[增量同步] since={since} 返回 {max(0, last - since)} 条变更")
+    return Response(generate(), mimetype='application/x-ndjson')
+
+
+@app.route('/api/activities/changes/generate', methods=['POST'])
+def generate_activity_changes():
+    """调整合成变更的数量（用于大数据量测试）"""
+    global synthetic_change_total, synthetic_activity_count
+    data = request.get_json(silent=True) or {}
+    synthetic_change_total = int(data.get('count', synthetic_change_total))
+    synthetic_activity_count = max(1, int(data.get('activities', synthetic_activity_count)))
+    print(f"[增量同步] 合成变更总数: {synthetic_change_total}, 活动数: {synthetic_activity_count}")
+    return jsonify({
+        "success": True,
+        "count": synthetic_change_total,
+        "activities": synthetic_activity_count
+    })
+
+
+@app.route('/api/notifications', methods=['POST'])
+def receive_notifications():
+    """接收客户端通知发件箱中的一批活动提醒"""
+    data = read_payload()
+    items = (data or {}).get('notifications')
+    if not isinstance(items, list):
+        return jsonify({"success": False, "message": "缺少 notifications 数组"}), 400
+
+    accepted = 0
+    for item in items:
+        if 'id' not in item or 'student_id' not in item:
+            continue
+        # 重复投递（客户端重试）只保留一份
+        if item['id'] not in delivered_notifications:
+            accepted += 1
+        delivered_notifications[item['id']] = dict(item, received_at=datetime.now().isoformat())
+
+    print(f"[活动提醒] 收到 {len(items)} 条，新增 {accepted} 条，累计 {len(delivered_notifications)} 条")
+    return jsonify({"success": True, "accepted": accepted})
+
+
+@app.route('/api/notifications', methods=['GET'])
+def get_notifications():
+    """查看已收到的活动提醒（可按 student_id 过滤）"""
+    student_id = request.args.get('student_id')
+    items = [n for n in delivered_notifications.values()
+             if not student_id or n.get('student_id') == student_id]
+    return jsonify({"count": len(items), "notifications": items})
+
+
+@app.route('/api/wire-stats', methods=['GET'])
+def get_wire_stats():
+    """查看请求体的线路字节数与解码后字节数（用于测试压缩效果）"""
+    stats = dict(wire_stats)
+    if stats["decoded_bytes"]:
+        stats["ratio"] = round(stats["wire_bytes"] / stats["decoded_bytes"], 3)
+    return jsonify(stats)
+
+
 @app.route('/api/synced-activities', methods=['GET'])
 def get_synced_activities():
     """获取已同步的活动列表（用于测试和调试）"""
@@ -170,7 +366,13 @@ def index():
             "GET /api/categories": "获取活动类别列表",
             "GET /api/announcements": "获取公告列表",
             "POST /api/activities/sync": "同步活动信息",
+            "GET /api/activities/changes?since=<cursor>&limit=<n>": "按游标增量拉取活动变更（NDJSON）",
+            "POST /api/activities/changes/generate": "设置合成变更数量（count/activities）",
             "GET /api/synced-activities": "获取已同步的活动（测试用）",
+            "POST /api/notifications": "接收客户端投递的活动提醒",
+            "GET /api/notifications?student_id=<id>": "查看已收到的活动提醒",
+            "GET /api/wire-stats": "查看同步请求体的线路字节统计",
+            "GET/POST /api/faults": "查看或设置故障注入（延迟、错误率）",
             "DELETE /api/synced-activities": "清除所有已同步的活动",
             "POST /api/synced-activities/clear": "清除所有已同步的活动（POST方法）",
             "GET /api/health": "健康检查"
@@ -190,7 +392,9 @@ if __name__ == '__main__':
     print("  GET  /api/categories          - 获取活动类别")
     print("  GET  /api/announcements        - 获取公告")
     print("  POST /api/activities/sync      - 同步活动")
+    print("  GET  /api/activities/changes   - 增量拉取活动变更")
     print("  GET  /api/synced-activities    - 查看已同步活动")
+    print("  POST /api/notifications        - 接收活动提醒")
     print("  GET  /api/health               - 健康检查")
     print("=" * 60)
     print("\n按 Ctrl+C 停止服务器\n")
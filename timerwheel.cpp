@@ -0,0 +1,166 @@
+#include "timerwheel.h"
+#include <QPair>
+#include <algorithm>
+
+TimerWheel::TimerWheel(qint64 nowMs, qint64 tickMs)
+    : originMs(nowMs)
+    , tickMs(qMax<qint64>(1, tickMs))
+    , currentTick(0)
+{
+}
+
+qint64 TimerWheel::tickFor(qint64 dueMs) const
+{
+    // 向上取整：到期时刻所在的刻度走完才取出，不会提前
+    qint64 offset = dueMs - originMs;
+    if (offset <= currentTick * tickMs) {
+        return currentTick + 1;  // 已过期，下一个刻度取出
+    }
+    return (offset + tickMs - 1) / tickMs;
+}
+
+void TimerWheel::place(int key, Entry &entry)
+{
+    qint64 delta = entry.dueTick - currentTick;
+    for (int level = 0; level < kLevels; ++level) {
+        if (delta < (qint64(1) << (kSlotBits * (level + 1)))) {
+            entry.level = level;
+            entry.slot = static_cast<int>((entry.dueTick >> (kSlotBits * level)) & (kSlots - 1));
+            wheel[level][entry.slot].insert(key);
+            return;
+        }
+    }
+    entry.level = -1;
+    entry.slot = -1;
+    overflow.insert(key);
+}
+
+void TimerWheel::unlink(const Entry &entry, int key)
+{
+    if (entry.level < 0) {
+        overflow.remove(key);
+    } else {
+        wheel[entry.level][entry.slot].remove(key);
+    }
+}
+
+void TimerWheel::schedule(int key, qint64 dueMs)
+{
+    auto it = entries.find(key);
+    if (it != entries.end()) {
+        unlink(it.value(), key);
+    } else {
+        it = entries.insert(key, Entry());
+    }
+    it->dueMs = dueMs;
+    it->dueTick = tickFor(dueMs);
+    place(key, it.value());
+}
+
+bool TimerWheel::cancel(int key)
+{
+    auto it = entries.find(key);
+    if (it == entries.end()) {
+        return false;
+    }
+    unlink(it.value(), key);
+    entries.erase(it);
+    return true;
+}
+
+bool TimerWheel::contains(int key) const
+{
+    return entries.contains(key);
+}
+
+qint64 TimerWheel::dueTime(int key) const
+{
+    auto it = entries.constFind(key);
+    return it == entries.constEnd() ? -1 : it->dueMs;
+}
+
+int TimerWheel::size() const
+{
+    return entries.size();
+}
+
+void TimerWheel::cascade(int level)
+{
+    // 把上层当前槽中的键按剩余时间重新放到下层
+    int slot = static_cast<int>((currentTick >> (kSlotBits * level)) & (kSlots - 1));
+    QSet<int> keys;
+    keys.swap(wheel[level][slot]);
+    for (int key : keys) {
+        place(key, entries[key]);
+    }
+}
+
+void TimerWheel::rebuild(qint64 targetTick, QList<int> &expired)
+{
+    // 一次跨越很多刻度时（如休眠后恢复）直接重排，代价与键的数量成正比
+    currentTick = targetTick;
+    for (int level = 0; level < kLevels; ++level) {
+        for (int slot = 0; slot < kSlots; ++slot) {
+            wheel[level][slot].clear();
+        }
+    }
+    overflow.clear();
+
+    QList<QPair<qint64, int>> due;
+    for (auto it = entries.begin(); it != entries.end();) {
+        if (it->dueTick <= targetTick) {
+            due.append(qMakePair(it->dueTick, it.key()));
+            it = entries.erase(it);
+        } else {
+            place(it.key(), it.value());
+            ++it;
+        }
+    }
+    std::sort(due.begin(), due.end());
+    for (const auto &item : due) {
+        expired.append(item.second);
+    }
+}
+
+QList<int> TimerWheel::advance(qint64 nowMs)
+{
+    QList<int> expired;
+    qint64 targetTick = (nowMs - originMs) / tickMs;
+    if (targetTick <= currentTick) {
+        return expired;
+    }
+    if (targetTick - currentTick > kSlots * kSlots) {
+        rebuild(targetTick, expired);
+        return expired;
+    }
+
+    while (currentTick < targetTick) {
+        ++currentTick;
+        int slot = static_cast<int>(currentTick & (kSlots - 1));
+        if (slot == 0) {
+            // 下层转完一圈时，从上层取下一槽；上层也刚好转完一圈时继续向上
+            int level = 1;
+            for (; level < kLevels; ++level) {
+                cascade(level);
+                if (((currentTick >> (kSlotBits * level)) & (kSlots - 1)) != 0) {
+                    break;
+                }
+            }
+            if (level == kLevels) {
+                QSet<int> keys;
+                keys.swap(overflow);
+                for (int key : keys) {
+                    place(key, entries[key]);
+                }
+            }
+        }
+
+        QSet<int> keys;
+        keys.swap(wheel[0][slot]);
+        for (int key : keys) {
+            entries.remove(key);
+            expired.append(key);
+        }
+    }
+    return expired;
+}
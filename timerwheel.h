@@ -0,0 +1,53 @@
+#ifndef TIMERWHEEL_H
+#define TIMERWHEEL_H
+
+#include <QtGlobal>
+#include <QHash>
+#include <QSet>
+#include <QList>
+
+// 分层时间轮：按整数键登记到期时间（毫秒时间戳），advance() 推进时间并取出到期的键。
+// 4 层、每层 64 个槽，时间粒度为 tickMs（默认 1 秒时可覆盖约 194 天，更远的放在溢出集合中）。
+// 登记、改期、取消都是 O(1)；每个键只在跨越层边界时下移一次。只在一个线程中使用。
+class TimerWheel
+{
+public:
+    TimerWheel(qint64 nowMs, qint64 tickMs = 1000);
+
+    // 登记或改期；已过期的时间在下一次 advance() 时取出
+    void schedule(int key, qint64 dueMs);
+    bool cancel(int key);
+    bool contains(int key) const;
+    qint64 dueTime(int key) const;  // 未登记时返回 -1
+    int size() const;
+
+    // 推进到 nowMs，返回到期的键（按到期先后）
+    QList<int> advance(qint64 nowMs);
+
+private:
+    static const int kLevels = 4;
+    static const int kSlotBits = 6;
+    static const int kSlots = 1 << kSlotBits;
+
+    struct Entry {
+        qint64 dueTick;
+        qint64 dueMs;
+        int level;      // -1 表示在溢出集合中
+        int slot;
+    };
+
+    qint64 originMs;
+    qint64 tickMs;
+    qint64 currentTick;
+    QSet<int> wheel[kLevels][kSlots];
+    QSet<int> overflow;
+    QHash<int, Entry> entries;
+
+    qint64 tickFor(qint64 dueMs) const;
+    void place(int key, Entry &entry);
+    void unlink(const Entry &entry, int key);
+    void cascade(int level);
+    void rebuild(qint64 targetTick, QList<int> &expired);
+};
+
+#endif // TIMERWHEEL_H